@@ -24,6 +24,84 @@
 #include "hmm/transition-model.h"
 #include "fstext/fstext-lib.h"
 #include "decoder/training-graph-compiler.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Compiles a batch of training graphs; used with TaskSequencer when
+// --num-threads > 1.  A TrainingGraphCompiler cannot be used from two
+// threads at once, so each task borrows one from a pool that has one compiler
+// per thread.  If batch_size is 1, each task has one transcript and is compiled
+// with CompileGraphFromText(), as in the one-threaded code.
+class CompileGraphsTask {
+ public:
+  // Swaps "keys" and "transcripts" into this object.
+  CompileGraphsTask(std::vector<TrainingGraphCompiler*> *compilers,
+                    Mutex *compilers_mutex,
+                    int32 batch_size,
+                    std::vector<std::string> *keys,
+                    std::vector<std::vector<int32> > *transcripts,
+                    TableWriter<fst::VectorFstHolder> *fst_writer,
+                    int32 *num_succeed,
+                    int32 *num_fail):
+      compilers_(compilers), compilers_mutex_(compilers_mutex),
+      batch_size_(batch_size), fst_writer_(fst_writer),
+      num_succeed_(num_succeed), num_fail_(num_fail) {
+    keys_.swap(*keys);
+    transcripts_.swap(*transcripts);
+  }
+
+  void operator () () {
+    compilers_mutex_->Lock();
+    KALDI_ASSERT(!compilers_->empty());
+    TrainingGraphCompiler *gc = compilers_->back();
+    compilers_->pop_back();
+    compilers_mutex_->Unlock();
+
+    if (batch_size_ == 1) {
+      KALDI_ASSERT(transcripts_.size() == 1);
+      fsts_.push_back(new fst::VectorFst<fst::StdArc>());
+      if (!gc->CompileGraphFromText(transcripts_[0], fsts_[0]))
+        fsts_[0]->DeleteStates();  // Just make it empty.
+    } else if (!gc->CompileGraphsFromText(transcripts_, &fsts_)) {
+      KALDI_ERR << "Not expecting CompileGraphs to fail.";
+    }
+
+    compilers_mutex_->Lock();
+    compilers_->push_back(gc);
+    compilers_mutex_->Unlock();
+  }
+
+  // The destructor is called sequentially, in the order the tasks were given
+  // to the TaskSequencer, so this is where we write the output.
+  ~CompileGraphsTask() {
+    KALDI_ASSERT(fsts_.size() == keys_.size());
+    for (size_t i = 0; i < fsts_.size(); i++) {
+      if (fsts_[i]->Start() != fst::kNoStateId) {
+        (*num_succeed_)++;
+        fst_writer_->Write(keys_[i], *(fsts_[i]));
+      } else {
+        KALDI_WARN << "Empty decoding graph for utterance "
+                   << keys_[i];
+        (*num_fail_)++;
+      }
+    }
+    DeletePointers(&fsts_);
+  }
+ private:
+  std::vector<TrainingGraphCompiler*> *compilers_;
+  Mutex *compilers_mutex_;
+  int32 batch_size_;
+  std::vector<std::string> keys_;
+  std::vector<std::vector<int32> > transcripts_;
+  std::vector<fst::VectorFst<fst::StdArc>* > fsts_;
+  TableWriter<fst::VectorFstHolder> *fst_writer_;
+  int32 *num_succeed_;
+  int32 *num_fail_;
+};
+
+} // namespace kaldi
 
 
 int main(int argc, char *argv[]) {
@@ -43,6 +121,7 @@ int main(int argc, char *argv[]) {
     ParseOptions po(usage);
 
     TrainingGraphCompilerOptions gopts;
+    TaskSequencerConfig sequencer_config; // has --num-threads option
     int32 batch_size = 250;
     gopts.transition_scale = 0.0;  // Change the default to 0.0 since we will generally add the
     // transition probs in the alignment phase (since they change eacm time)
@@ -55,6 +134,7 @@ int main(int argc, char *argv[]) {
                 "more memory.  E.g. 500");
     po.Register("read-disambig-syms", &disambig_rxfilename, "File containing "
                 "list of disambiguation symbols in phone symbol table");
+    sequencer_config.Register(&po);
     
     po.Read(argc, argv);
 
@@ -90,14 +170,55 @@ int main(int argc, char *argv[]) {
         KALDI_ERR << "fstcomposecontext: Could not read disambiguation symbols from "
                   << disambig_rxfilename;
     
-    TrainingGraphCompiler gc(trans_model, ctx_dep, lex_fst, disambig_syms, gopts);
-
-    lex_fst = NULL;  // we gave ownership to gc.
-
     SequentialInt32VectorReader transcript_reader(transcript_rspecifier);
     TableWriter<fst::VectorFstHolder> fst_writer(fsts_wspecifier);
 
-    int num_succeed = 0, num_fail = 0;
+    int32 num_succeed = 0, num_fail = 0;
+
+    if (sequencer_config.num_threads > 1) {
+      // Batches are compiled in parallel and written in the same order as
+      // they were read, so the output is the same as with one thread.  Each
+      // thread needs its own compiler, with its own copy of the lexicon.  The
+      // copy is made through the Fst interface, so it is a deep copy; the
+      // VectorFst copy constructor would share the implementation (and its
+      // non-thread-safe reference count) between the compilers.
+      KALDI_ASSERT(batch_size > 0);
+      const fst::Fst<StdArc> &lex = *lex_fst;
+      std::vector<TrainingGraphCompiler*> compilers;
+      for (int32 i = 0; i < sequencer_config.num_threads; i++)
+        compilers.push_back(new TrainingGraphCompiler(
+            trans_model, ctx_dep, new VectorFst<StdArc>(lex), disambig_syms,
+            gopts));
+      delete lex_fst;
+      lex_fst = NULL;
+      Mutex compilers_mutex;
+      {
+        TaskSequencer<CompileGraphsTask> sequencer(sequencer_config);
+        while (!transcript_reader.Done()) {
+          std::vector<std::string> keys;
+          std::vector<std::vector<int32> > transcripts;
+          for (; !transcript_reader.Done() &&
+                  static_cast<int32>(transcripts.size()) < batch_size;
+              transcript_reader.Next()) {
+            keys.push_back(transcript_reader.Key());
+            transcripts.push_back(transcript_reader.Value());
+          }
+          sequencer.Run(new CompileGraphsTask(&compilers, &compilers_mutex,
+                                              batch_size, &keys, &transcripts,
+                                              &fst_writer, &num_succeed,
+                                              &num_fail));
+        }
+        sequencer.Wait();
+      }
+      DeletePointers(&compilers);
+      KALDI_LOG << "compile-train-graphs: succeeded for " << num_succeed
+                << " graphs, failed for " << num_fail;
+      return (num_succeed != 0 ? 0 : 1);
+    }
+
+    TrainingGraphCompiler gc(trans_model, ctx_dep, lex_fst, disambig_syms, gopts);
+
+    lex_fst = NULL;  // we gave ownership to gc.
 
     if (batch_size == 1) {  // We treat batch_size of 1 as a special case in order
       // to test more parts of the code.
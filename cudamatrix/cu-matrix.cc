@@ -1148,11 +1148,7 @@ void CuMatrixBase<Real>::ApplySoftMaxPerRow(const CuMatrixBase<Real> &src) {
   } else
   #endif
   {
-    MatrixBase<Real> &mat(this->Mat());
-    mat.CopyFromMat(src.Mat());
-    for(MatrixIndexT r = 0; r < mat.NumRows(); r++) {
-      mat.Row(r).ApplySoftMax();
-    }
+    Mat().SoftMaxPerRow(src.Mat());
   }
 }
 
@@ -0,0 +1,104 @@
+// decoder/batch-log-likes.h
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_BATCH_LOG_LIKES_H_
+#define KALDI_DECODER_BATCH_LOG_LIKES_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "itf/decodable-itf.h"
+
+namespace kaldi {
+
+/// BatchLogLikes is a helper class for the decoders, for use with decodable
+/// objects for which HasBatchLogLikelihoods() returns true.  For each frame,
+/// the decoder calls Begin(), then AddIndex() for the ilabel of each emitting
+/// arc it is going to traverse, then Compute(); this gets the
+/// log-likelihoods of all the distinct indices with a single call to
+/// DecodableInterface::LogLikelihoods().  After that, LogLikelihood(index)
+/// is a simple array lookup.
+class BatchLogLikes {
+ public:
+  BatchLogLikes(): decodable_(NULL), frame_(-1), stamp_(0) { }
+
+  /// Starts collecting indices for a new frame (zero-based, as for the
+  /// decodable object).
+  void Begin(DecodableInterface *decodable, int32 frame) {
+    decodable_ = decodable;
+    frame_ = frame;
+    indices_.clear();
+    size_t size = decodable->NumIndices() + 1;  // indices are one-based.
+    if (stamps_.size() < size) {
+      stamps_.resize(size, 0);
+      loglikes_.resize(size, 0.0);
+    }
+    if (++stamp_ == 0) {  // the counter wrapped around; very unlikely.
+      std::fill(stamps_.begin(), stamps_.end(), 0);
+      stamp_ = 1;
+    }
+  }
+
+  /// Notes that we will need the log-likelihood for this index.  It's OK to
+  /// call this more than once for the same index.
+  inline void AddIndex(int32 index) {
+    KALDI_PARANOID_ASSERT(index > 0 &&
+                          static_cast<size_t>(index) < stamps_.size());
+    if (stamps_[index] != stamp_) {
+      stamps_[index] = stamp_;
+      indices_.push_back(index);
+    }
+  }
+
+  /// Computes the log-likelihoods for all indices added since Begin().
+  void Compute() {
+    decodable_->LogLikelihoods(frame_, indices_, &batch_loglikes_);
+    KALDI_ASSERT(batch_loglikes_.size() == indices_.size());
+    for (size_t i = 0; i < indices_.size(); i++)
+      loglikes_[indices_[i]] = batch_loglikes_[i];
+  }
+
+  /// Returns the log-likelihood for this index, which must have been given
+  /// to AddIndex() before the last call to Compute().
+  inline BaseFloat LogLikelihood(int32 index) const {
+    KALDI_PARANOID_ASSERT(static_cast<size_t>(index) < stamps_.size() &&
+                          stamps_[index] == stamp_);
+    return loglikes_[index];
+  }
+
+  /// Returns the number of distinct indices on the current frame.
+  int32 NumIndices() const { return indices_.size(); }
+
+ private:
+  DecodableInterface *decodable_;
+  int32 frame_;
+  uint32 stamp_;  // incremented each frame; stamps_[i] == stamp_ means index
+                  // i has been added on this frame.
+  std::vector<uint32> stamps_;  // indexed by index.
+  std::vector<BaseFloat> loglikes_;  // indexed by index.
+  std::vector<int32> indices_;  // distinct indices added on this frame.
+  std::vector<BaseFloat> batch_loglikes_;  // output of LogLikelihoods().
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BatchLogLikes);
+};
+
+
+}  // namespace kaldi
+
+#endif  // KALDI_DECODER_BATCH_LOG_LIKES_H_
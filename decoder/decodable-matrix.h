@@ -69,6 +69,16 @@ class DecodableMatrixScaledMapped: public DecodableInterface {
     return scale_ * (*likes_)(frame, trans_model_.TransitionIdToPdf(tid));
   }
 
+  // Batch version of LogLikelihood(); the indices are transition-ids.
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &indices,
+                              std::vector<BaseFloat> *loglikes) {
+    const BaseFloat *row = likes_->RowData(frame);
+    loglikes->resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+      (*loglikes)[i] = scale_ * row[trans_model_.TransitionIdToPdf(indices[i])];
+  }
+  virtual bool HasBatchLogLikelihoods() { return true; }
+
   // Indices are one-based!  This is for compatibility with OpenFst.
   virtual int32 NumIndices() { return trans_model_.NumTransitionIds(); }
 
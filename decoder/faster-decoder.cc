@@ -19,12 +19,15 @@
 // limitations under the License.
 
 #include "decoder/faster-decoder.h"
+#include "fstext/decode-fst.h"
 
 namespace kaldi {
 
 
-FasterDecoder::FasterDecoder(const fst::Fst<fst::StdArc> &fst,
-                             const FasterDecoderOptions &opts): fst_(fst), config_(opts) {
+template <typename FST>
+FasterDecoderTpl<FST>::FasterDecoderTpl(const FST &fst,
+                                        const FasterDecoderOptions &opts):
+    fst_(fst), config_(opts) {
   KALDI_ASSERT(config_.hash_ratio >= 1.0);  // less doesn't make much sense.
   KALDI_ASSERT(config_.max_active > 1);
   KALDI_ASSERT(config_.min_active >= 0 && config_.min_active < config_.max_active);
@@ -32,7 +35,8 @@ FasterDecoder::FasterDecoder(const fst::Fst<fst::StdArc> &fst,
 }
 
 
-void FasterDecoder::Decode(DecodableInterface *decodable) {
+template <typename FST>
+void FasterDecoderTpl<FST>::Decode(DecodableInterface *decodable) {
   // clean up from last time:
   ClearToks(toks_.Clear());
   StateId start_state = fst_.Start();
@@ -46,7 +50,8 @@ void FasterDecoder::Decode(DecodableInterface *decodable) {
   }
 }
 
-bool FasterDecoder::ReachedFinal() {
+template <typename FST>
+bool FasterDecoderTpl<FST>::ReachedFinal() {
   for (Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
     Weight this_weight = Times(e->val->weight_, fst_.Final(e->key));
     if (this_weight != Weight::Zero())
@@ -55,7 +60,8 @@ bool FasterDecoder::ReachedFinal() {
   return false;
 }
 
-bool FasterDecoder::GetBestPath(fst::MutableFst<LatticeArc> *fst_out) {
+template <typename FST>
+bool FasterDecoderTpl<FST>::GetBestPath(fst::MutableFst<LatticeArc> *fst_out) {
   // GetBestPath gets the decoding output.  If is_final == true, it limits itself
   // to final states; otherwise it gets the most likely token not taking into
   // account final-probs.  fst_out will be empty (Start() == kNoStateId) if
@@ -117,8 +123,10 @@ bool FasterDecoder::GetBestPath(fst::MutableFst<LatticeArc> *fst_out) {
 
 
 // Gets the weight cutoff.  Also counts the active tokens.
-BaseFloat FasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
-                                   BaseFloat *adaptive_beam, Elem **best_elem) {
+template <typename FST>
+BaseFloat FasterDecoderTpl<FST>::GetCutoff(Elem *list_head, size_t *tok_count,
+                                           BaseFloat *adaptive_beam,
+                                           Elem **best_elem) {
   BaseFloat best_weight = std::numeric_limits<BaseFloat>::infinity();
   size_t count = 0;
   if (config_.max_active == std::numeric_limits<int32>::max() &&
@@ -181,7 +189,8 @@ BaseFloat FasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
   }
 }
 
-void FasterDecoder::PossiblyResizeHash(size_t num_toks) {
+template <typename FST>
+void FasterDecoderTpl<FST>::PossiblyResizeHash(size_t num_toks) {
   size_t new_sz = static_cast<size_t>(static_cast<BaseFloat>(num_toks)
                                       * config_.hash_ratio);
   if (new_sz > toks_.Size()) {
@@ -189,8 +198,54 @@ void FasterDecoder::PossiblyResizeHash(size_t num_toks) {
   }
 }
 
-// ProcessEmitting returns the likelihood cutoff used.
-BaseFloat FasterDecoder::ProcessEmitting(DecodableInterface *decodable, int frame) {
+template <typename FST>
+BaseFloat FasterDecoderTpl<FST>::ProcessEmitting(DecodableInterface *decodable,
+                                                 int frame) {
+  return ProcessEmittingForFst(fst_, decodable, frame);
+}
+
+template <typename FST>
+void FasterDecoderTpl<FST>::ProcessNonemitting(BaseFloat cutoff) {
+  ProcessNonemittingForFst(fst_, cutoff);
+}
+
+// If we were given the graph as a generic Fst, use the code specialized for
+// its actual type if it's one we know (see LatticeFasterDecoderTpl).
+template <>
+BaseFloat FasterDecoderTpl<fst::Fst<fst::StdArc> >::ProcessEmitting(
+    DecodableInterface *decodable, int frame) {
+  if (const fst::ConstFst<Arc> *f =
+      dynamic_cast<const fst::ConstFst<Arc>*>(&fst_))
+    return ProcessEmittingForFst(*f, decodable, frame);
+  else if (const fst::VectorFst<Arc> *f =
+           dynamic_cast<const fst::VectorFst<Arc>*>(&fst_))
+    return ProcessEmittingForFst(*f, decodable, frame);
+  else if (const fst::DecodeFst *f = dynamic_cast<const fst::DecodeFst*>(&fst_))
+    return ProcessEmittingForFst(*f, decodable, frame);
+  else
+    return ProcessEmittingForFst(fst_, decodable, frame);
+}
+
+template <>
+void FasterDecoderTpl<fst::Fst<fst::StdArc> >::ProcessNonemitting(
+    BaseFloat cutoff) {
+  if (const fst::ConstFst<Arc> *f =
+      dynamic_cast<const fst::ConstFst<Arc>*>(&fst_))
+    ProcessNonemittingForFst(*f, cutoff);
+  else if (const fst::VectorFst<Arc> *f =
+           dynamic_cast<const fst::VectorFst<Arc>*>(&fst_))
+    ProcessNonemittingForFst(*f, cutoff);
+  else if (const fst::DecodeFst *f = dynamic_cast<const fst::DecodeFst*>(&fst_))
+    ProcessNonemittingForFst(*f, cutoff);
+  else
+    ProcessNonemittingForFst(fst_, cutoff);
+}
+
+// ProcessEmittingForFst returns the likelihood cutoff used.
+template <typename FST>
+template <typename F>
+BaseFloat FasterDecoderTpl<FST>::ProcessEmittingForFst(
+    const F &fst, DecodableInterface *decodable, int frame) {
   Elem *last_toks = toks_.Clear();
   size_t tok_cnt;
   BaseFloat adaptive_beam;
@@ -204,18 +259,40 @@ BaseFloat FasterDecoder::ProcessEmitting(DecodableInterface *decodable, int fram
   // for the next frame).  This is a bound on the cutoff we will use
   // on the next frame.
   BaseFloat next_weight_cutoff = std::numeric_limits<BaseFloat>::infinity();
+
+  // If the decodable object can compute many likelihoods efficiently at once,
+  // collect all the indices we will need on this frame and get them with a
+  // single call.
+  bool use_batch = decodable->HasBatchLogLikelihoods();
+  if (use_batch) {
+    batch_loglikes_.Begin(decodable, frame);
+    for (Elem *e = last_toks; e != NULL; e = e->tail) {
+      if (e->val->weight_.Value() < weight_cutoff || e == best_elem) {
+        for (fst::ArcIterator<F> aiter(fst, e->key);
+             !aiter.Done();
+             aiter.Next()) {
+          const Arc &arc = aiter.Value();
+          if (arc.ilabel != 0)
+            batch_loglikes_.AddIndex(arc.ilabel);
+        }
+      }
+    }
+    batch_loglikes_.Compute();
+  }
   
   // First process the best token to get a hopefully
   // reasonably tight bound on the next cutoff.
   if (best_elem) {
     StateId state = best_elem->key;
     Token *tok = best_elem->val;
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+    for (fst::ArcIterator<F> aiter(fst, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
       if (arc.ilabel != 0) {  // we'd propagate..
-        BaseFloat ac_cost = - decodable->LogLikelihood(frame, arc.ilabel),
+        BaseFloat ac_cost = - (use_batch ?
+                               batch_loglikes_.LogLikelihood(arc.ilabel) :
+                               decodable->LogLikelihood(frame, arc.ilabel)),
             new_weight = arc.weight.Value() + tok->weight_.Value() + ac_cost;
         if (new_weight + adaptive_beam < next_weight_cutoff)
           next_weight_cutoff = new_weight + adaptive_beam;
@@ -236,12 +313,14 @@ BaseFloat FasterDecoder::ProcessEmitting(DecodableInterface *decodable, int fram
     if (tok->weight_.Value() < weight_cutoff) {  // not pruned.
       // np++;
       KALDI_ASSERT(state == tok->arc_.nextstate);
-      for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+      for (fst::ArcIterator<F> aiter(fst, state);
            !aiter.Done();
            aiter.Next()) {
         Arc arc = aiter.Value();
         if (arc.ilabel != 0) {  // propagate..
-          Weight ac_weight(- decodable->LogLikelihood(frame, arc.ilabel));
+          Weight ac_weight(- (use_batch ?
+                              batch_loglikes_.LogLikelihood(arc.ilabel) :
+                              decodable->LogLikelihood(frame, arc.ilabel)));
           BaseFloat new_weight = arc.weight.Value() + tok->weight_.Value()
               + ac_weight.Value();
           if (new_weight < next_weight_cutoff) {  // not pruned..
@@ -271,7 +350,10 @@ BaseFloat FasterDecoder::ProcessEmitting(DecodableInterface *decodable, int fram
 }
 
 // TODO: first time we go through this, could avoid using the queue.
-void FasterDecoder::ProcessNonemitting(BaseFloat cutoff) {
+template <typename FST>
+template <typename F>
+void FasterDecoderTpl<FST>::ProcessNonemittingForFst(const F &fst,
+                                                     BaseFloat cutoff) {
   // Processes nonemitting arcs for one frame. 
   KALDI_ASSERT(queue_.empty());
   for (Elem *e = toks_.GetList(); e != NULL;  e = e->tail)
@@ -285,7 +367,7 @@ void FasterDecoder::ProcessNonemitting(BaseFloat cutoff) {
       continue;
     }
     KALDI_ASSERT(tok != NULL && state == tok->arc_.nextstate);
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+    for (fst::ArcIterator<F> aiter(fst, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
@@ -313,7 +395,8 @@ void FasterDecoder::ProcessNonemitting(BaseFloat cutoff) {
   }
 }
 
-void FasterDecoder::ClearToks(Elem *list) {
+template <typename FST>
+void FasterDecoderTpl<FST>::ClearToks(Elem *list) {
   for (Elem *e = list, *e_tail; e != NULL; e = e_tail) {
     Token::TokenDelete(e->val);
     e_tail = e->tail;
@@ -321,4 +404,10 @@ void FasterDecoder::ClearToks(Elem *list) {
   }
 }
 
+// Instantiate the decoder for the FST types we expect to decode with.
+template class FasterDecoderTpl<fst::Fst<fst::StdArc> >;
+template class FasterDecoderTpl<fst::ConstFst<fst::StdArc> >;
+template class FasterDecoderTpl<fst::VectorFst<fst::StdArc> >;
+template class FasterDecoderTpl<fst::DecodeFst>;
+
 } // end namespace kaldi.
@@ -25,6 +25,7 @@
 #include "util/hash-list.h"
 #include "fst/fstlib.h"
 #include "itf/decodable-itf.h"
+#include "decoder/batch-log-likes.h"
 #include "lat/kaldi-lattice.h" // for CompactLatticeArc
 
 #ifdef _MSC_VER
@@ -64,19 +65,24 @@ struct FasterDecoderOptions {
   }
 };
 
-class FasterDecoder {
+/// The template argument FST is the type of the decoding graph; the class is
+/// instantiated for fst::Fst<StdArc>, fst::ConstFst<StdArc>,
+/// fst::VectorFst<StdArc> and fst::DecodeFst.  As for LatticeFasterDecoderTpl,
+/// the generic version FasterDecoder uses the code for the graph's actual type
+/// if it is one of those.
+template <typename FST>
+class FasterDecoderTpl {
  public:
   typedef fst::StdArc Arc;
   typedef Arc::Label Label;
   typedef Arc::StateId StateId;
   typedef Arc::Weight Weight;
 
-  FasterDecoder(const fst::Fst<fst::StdArc> &fst,
-                const FasterDecoderOptions &config);
+  FasterDecoderTpl(const FST &fst, const FasterDecoderOptions &config);
 
   void SetOptions(const FasterDecoderOptions &config) { config_ = config; }
   
-  ~FasterDecoder() { ClearToks(toks_.Clear()); }
+  ~FasterDecoderTpl() { ClearToks(toks_.Clear()); }
 
   void Decode(DecodableInterface *decodable);
 
@@ -129,7 +135,7 @@ class FasterDecoder {
 #endif
     }
   };
-  typedef HashList<StateId, Token*>::Elem Elem;
+  typedef typename HashList<StateId, Token*>::Elem Elem;
 
 
   /// Gets the weight cutoff.  Also counts the active tokens.
@@ -144,15 +150,25 @@ class FasterDecoder {
   // TODO: first time we go through this, could avoid using the queue.
   void ProcessNonemitting(BaseFloat cutoff);
 
+  // These do the work of ProcessEmitting() and ProcessNonemitting(); "fst" is
+  // fst_, possibly cast to a more specific type.
+  template <typename F>
+  BaseFloat ProcessEmittingForFst(const F &fst, DecodableInterface *decodable,
+                                  int frame);
+  template <typename F>
+  void ProcessNonemittingForFst(const F &fst, BaseFloat cutoff);
+
   // HashList defined in ../util/hash-list.h.  It actually allows us to maintain
   // more than one list (e.g. for current and previous frames), but only one of
   // them at a time can be indexed by StateId.
   HashList<StateId, Token*> toks_;
-  const fst::Fst<fst::StdArc> &fst_;
+  const FST &fst_;
   FasterDecoderOptions config_;
   std::vector<StateId> queue_;  // temp variable used in ProcessNonemitting,
   std::vector<BaseFloat> tmp_array_;  // used in GetCutoff.
   // make it class member to avoid internal new/delete.
+  BatchLogLikes batch_loglikes_;  // used in ProcessEmitting if the decodable
+  // object has a batch LogLikelihoods() function.
 
   // It might seem unclear why we call ClearToks(toks_.Clear()).
   // There are two separate cleanup tasks we need to do at when we start a new file.
@@ -162,9 +178,21 @@ class FasterDecoder {
   // this way for convenience in propagating tokens from one frame to the next.
   void ClearToks(Elem *list);
 
-  KALDI_DISALLOW_COPY_AND_ASSIGN(FasterDecoder);
+  KALDI_DISALLOW_COPY_AND_ASSIGN(FasterDecoderTpl);
 };
 
+// These are specialized in faster-decoder.cc; they must be declared here so
+// that other translation units (e.g. OnlineFasterDecoder) use the
+// specializations rather than instantiating the generic versions.
+template <>
+BaseFloat FasterDecoderTpl<fst::Fst<fst::StdArc> >::ProcessEmitting(
+    DecodableInterface *decodable, int frame);
+template <>
+void FasterDecoderTpl<fst::Fst<fst::StdArc> >::ProcessNonemitting(
+    BaseFloat cutoff);
+
+typedef FasterDecoderTpl<fst::Fst<fst::StdArc> > FasterDecoder;
+
 
 } // end namespace kaldi.
 
@@ -0,0 +1,149 @@
+// decoder/lattice-faster-decoder-speed-test.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/lattice-faster-decoder.h"
+#include "decoder/decodable-matrix.h"
+#include "fstext/decode-fst.h"
+#include "util/timer.h"
+
+namespace kaldi {
+
+// This FST type just forwards to another FST.  Decoding with it shows the
+// speed of the decoder when it can only access the graph through the
+// generic fst::Fst interface, as it always did before it was templated.
+class ForwardingFst: public fst::Fst<fst::StdArc> {
+ public:
+  typedef fst::StdArc Arc;
+  explicit ForwardingFst(const fst::Fst<Arc> &fst): fst_(fst) { }
+  virtual StateId Start() const { return fst_.Start(); }
+  virtual Weight Final(StateId s) const { return fst_.Final(s); }
+  virtual size_t NumArcs(StateId s) const { return fst_.NumArcs(s); }
+  virtual size_t NumInputEpsilons(StateId s) const {
+    return fst_.NumInputEpsilons(s);
+  }
+  virtual size_t NumOutputEpsilons(StateId s) const {
+    return fst_.NumOutputEpsilons(s);
+  }
+  virtual uint64 Properties(uint64 mask, bool test) const {
+    return fst_.Properties(mask, test);
+  }
+  virtual const std::string &Type() const {
+    static const std::string type = "forwarding";
+    return type;
+  }
+  virtual ForwardingFst *Copy(bool safe = false) const {
+    return new ForwardingFst(fst_);
+  }
+  virtual const fst::SymbolTable *InputSymbols() const { return NULL; }
+  virtual const fst::SymbolTable *OutputSymbols() const { return NULL; }
+  virtual void InitStateIterator(fst::StateIteratorData<Arc> *data) const {
+    fst_.InitStateIterator(data);
+  }
+  virtual void InitArcIterator(StateId s,
+                               fst::ArcIteratorData<Arc> *data) const {
+    fst_.InitArcIterator(s, data);
+  }
+ private:
+  const fst::Fst<Arc> &fst_;
+};
+
+// Creates a random graph that looks a little like a decoding graph: each
+// state has a self-loop, a few emitting arcs to other states and sometimes an
+// input-epsilon arc with a word label on it.
+static void CreateRandomGraph(int32 num_states, int32 num_pdfs,
+                              fst::VectorFst<fst::StdArc> *fst) {
+  typedef fst::StdArc Arc;
+  fst->DeleteStates();
+  for (int32 s = 0; s < num_states; s++)
+    fst->AddState();
+  fst->SetStart(0);
+  for (int32 s = 0; s < num_states; s++) {
+    fst->AddArc(s, Arc(1 + Rand() % (num_pdfs - 1), 0,
+                       RandUniform(), s));
+    int32 num_emitting = 1 + Rand() % 3;
+    for (int32 i = 0; i < num_emitting; i++)
+      fst->AddArc(s, Arc(1 + Rand() % (num_pdfs - 1), 0,
+                         1.0 + RandUniform(), Rand() % num_states));
+    if (Rand() % 3 == 0)
+      fst->AddArc(s, Arc(0, 1 + Rand() % 1000, 2.0 + RandUniform(),
+                         Rand() % num_states));
+    if (Rand() % 10 == 0)
+      fst->SetFinal(s, RandUniform());
+  }
+}
+
+template <typename FST>
+void TestDecoderSpeed(const FST &fst, const std::string &name,
+                      const Matrix<BaseFloat> &loglikes,
+                      BaseFloat *best_cost) {
+  LatticeFasterDecoderConfig config;
+  config.beam = 12.0;
+  config.max_active = 2000;
+  LatticeFasterDecoderTpl<FST> decoder(fst, config);
+  DecodableMatrixScaled decodable(loglikes, 1.0);
+  BaseFloat time_in_secs = 0.5;
+  Timer tim;
+  int32 iter = 0;
+  for (; tim.Elapsed() < time_in_secs; iter++)
+    decoder.Decode(&decodable);
+  BaseFloat frames_per_sec = iter * loglikes.NumRows() / tim.Elapsed();
+  KALDI_LOG << "For decoding with FST of type " << name << ", speed was "
+            << frames_per_sec << " frames per second ("
+            << (1.0e+03 / frames_per_sec) << " ms per frame).";
+
+  fst::VectorFst<LatticeArc> best_path;
+  bool ans = decoder.GetBestPath(&best_path);
+  KALDI_ASSERT(ans);
+  std::vector<int32> alignment, words;
+  LatticeWeight weight;
+  GetLinearSymbolSequence(best_path, &alignment, &words, &weight);
+  *best_cost = weight.Value1() + weight.Value2();
+}
+
+void TestLatticeFasterDecoderSpeed() {
+  int32 num_states = 20000, num_pdfs = 2000, num_frames = 100;
+  fst::VectorFst<fst::StdArc> vector_fst;
+  CreateRandomGraph(num_states, num_pdfs, &vector_fst);
+  fst::ConstFst<fst::StdArc> const_fst(vector_fst);
+  fst::DecodeFst decode_fst(vector_fst);
+  ForwardingFst forwarding_fst(vector_fst);
+
+  Matrix<BaseFloat> loglikes(num_frames, num_pdfs);
+  loglikes.SetRandn();
+
+  BaseFloat cost[5];
+  TestDecoderSpeed<fst::Fst<fst::StdArc> >(forwarding_fst, "forwarding",
+                                           loglikes, &cost[0]);
+  TestDecoderSpeed<fst::Fst<fst::StdArc> >(vector_fst, "vector (generic)",
+                                           loglikes, &cost[1]);
+  TestDecoderSpeed(vector_fst, "vector", loglikes, &cost[2]);
+  TestDecoderSpeed(const_fst, "const", loglikes, &cost[3]);
+  TestDecoderSpeed(decode_fst, "decode", loglikes, &cost[4]);
+  for (int32 i = 1; i < 5; i++)
+    KALDI_ASSERT(ApproxEqual(cost[i], cost[0]));
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  TestLatticeFasterDecoderSpeed();
+  std::cout << "Test OK.\n";
+  return 0;
+}
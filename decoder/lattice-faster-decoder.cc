@@ -24,17 +24,25 @@
 namespace kaldi {
 
 // instantiate this class once for each thing you have to decode.
-LatticeFasterDecoder::LatticeFasterDecoder(const fst::Fst<fst::StdArc> &fst,
-                                           const LatticeFasterDecoderConfig &config):
-    fst_(fst), delete_fst_(false), config_(config), num_toks_(0) {
+template <typename FST>
+LatticeFasterDecoderTpl<FST>::LatticeFasterDecoderTpl(
+    const FST &fst, const LatticeFasterDecoderConfig &config):
+    fst_(fst), delete_fst_(false),
+    epsilons_first_(fst.Type() == "decode" ||
+                    fst.Properties(fst::kILabelSorted, false) != 0),
+    config_(config), num_toks_(0) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
 
 
-LatticeFasterDecoder::LatticeFasterDecoder(const LatticeFasterDecoderConfig &config,
-                                           fst::Fst<fst::StdArc> *fst):
-    fst_(*fst), delete_fst_(true), config_(config), num_toks_(0) {
+template <typename FST>
+LatticeFasterDecoderTpl<FST>::LatticeFasterDecoderTpl(
+    const LatticeFasterDecoderConfig &config, FST *fst):
+    fst_(*fst), delete_fst_(true),
+    epsilons_first_(fst->Type() == "decode" ||
+                    fst->Properties(fst::kILabelSorted, false) != 0),
+    config_(config), num_toks_(0) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -42,7 +50,8 @@ LatticeFasterDecoder::LatticeFasterDecoder(const LatticeFasterDecoderConfig &con
 
 // Returns true if any kind of traceback is available (not necessarily from
 // a final state).
-bool LatticeFasterDecoder::Decode(DecodableInterface *decodable) {
+template <typename FST>
+bool LatticeFasterDecoderTpl<FST>::Decode(DecodableInterface *decodable) {
   // clean up from last time:
   DeleteElems(toks_.Clear());
   cost_offsets_.clear();
@@ -54,7 +63,7 @@ bool LatticeFasterDecoder::Decode(DecodableInterface *decodable) {
   StateId start_state = fst_.Start();
   KALDI_ASSERT(start_state != fst::kNoStateId);
   active_toks_.resize(1);
-  Token *start_tok = new Token(0.0, 0.0, NULL, NULL);
+  Token *start_tok = NewToken(0.0, 0.0, NULL, NULL);
   active_toks_[0].toks = start_tok;
   toks_.Insert(start_state, start_tok);
   num_toks_++;
@@ -82,7 +91,8 @@ bool LatticeFasterDecoder::Decode(DecodableInterface *decodable) {
 
 // Outputs an FST corresponding to the single best path
 // through the lattice.
-bool LatticeFasterDecoder::GetBestPath(fst::MutableFst<LatticeArc> *ofst) const {
+template <typename FST>
+bool LatticeFasterDecoderTpl<FST>::GetBestPath(fst::MutableFst<LatticeArc> *ofst) const {
   fst::VectorFst<LatticeArc> fst;
   if (!GetRawLattice(&fst)) return false;
   // std::cout << "Raw lattice is:\n";
@@ -94,7 +104,8 @@ bool LatticeFasterDecoder::GetBestPath(fst::MutableFst<LatticeArc> *ofst) const
 
 // Outputs an FST corresponding to the raw, state-level
 // tracebacks.
-bool LatticeFasterDecoder::GetRawLattice(fst::MutableFst<LatticeArc> *ofst) const {
+template <typename FST>
+bool LatticeFasterDecoderTpl<FST>::GetRawLattice(fst::MutableFst<LatticeArc> *ofst) const {
   typedef LatticeArc Arc;
   typedef Arc::StateId StateId;
   typedef Arc::Weight Weight;
@@ -133,7 +144,7 @@ bool LatticeFasterDecoder::GetRawLattice(fst::MutableFst<LatticeArc> *ofst) cons
       for (ForwardLink *l = tok->links;
            l != NULL;
            l = l->next) {
-        unordered_map<Token*, StateId>::const_iterator iter =
+        typename unordered_map<Token*, StateId>::const_iterator iter =
             tok_map.find(l->next_tok);
         StateId nextstate = iter->second;
         KALDI_ASSERT(iter != tok_map.end());
@@ -148,7 +159,7 @@ bool LatticeFasterDecoder::GetRawLattice(fst::MutableFst<LatticeArc> *ofst) cons
         ofst->AddArc(cur_state, arc);
       }
       if (f == num_frames) {
-        std::map<Token*, BaseFloat>::const_iterator iter =
+        typename std::map<Token*, BaseFloat>::const_iterator iter =
             final_costs_.find(tok);
         if (iter != final_costs_.end())
           ofst->SetFinal(cur_state, LatticeWeight(iter->second, 0));
@@ -163,7 +174,8 @@ bool LatticeFasterDecoder::GetRawLattice(fst::MutableFst<LatticeArc> *ofst) cons
 // the LatticeFasterDecoder class.
 // Outputs an FST corresponding to the lattice-determinized
 // lattice (one path per word sequence).
-bool LatticeFasterDecoder::GetLattice(fst::MutableFst<CompactLatticeArc> *ofst) const {
+template <typename FST>
+bool LatticeFasterDecoderTpl<FST>::GetLattice(fst::MutableFst<CompactLatticeArc> *ofst) const {
   Lattice raw_fst;
   if (!GetRawLattice(&raw_fst)) return false;
   Invert(&raw_fst); // make it so word labels are on the input.
@@ -186,7 +198,8 @@ bool LatticeFasterDecoder::GetLattice(fst::MutableFst<CompactLatticeArc> *ofst)
   return true;
 }
 
-void LatticeFasterDecoder::PossiblyResizeHash(size_t num_toks) {
+template <typename FST>
+void LatticeFasterDecoderTpl<FST>::PossiblyResizeHash(size_t num_toks) {
   size_t new_sz = static_cast<size_t>(static_cast<BaseFloat>(num_toks)
                                       * config_.hash_ratio);
   if (new_sz > toks_.Size()) {
@@ -199,7 +212,9 @@ void LatticeFasterDecoder::PossiblyResizeHash(size_t num_toks) {
 // for the current frame.  [note: it's inserted if necessary into hash toks_
 // and also into the singly linked list of tokens active on this frame
 // (whose head is at active_toks_[frame]).
-inline LatticeFasterDecoder::Token *LatticeFasterDecoder::FindOrAddToken(
+template <typename FST>
+inline typename LatticeFasterDecoderTpl<FST>::Token *
+LatticeFasterDecoderTpl<FST>::FindOrAddToken(
     StateId state, int32 frame, BaseFloat tot_cost,
     bool *changed) {
   // Returns the Token pointer.  Sets "changed" (if non-NULL) to true
@@ -212,7 +227,7 @@ inline LatticeFasterDecoder::Token *LatticeFasterDecoder::FindOrAddToken(
     // tokens on the currently final frame have zero extra_cost
     // as any of them could end up
     // on the winning path.
-    Token *new_tok = new Token (tot_cost, extra_cost, NULL, toks);
+    Token *new_tok = NewToken(tot_cost, extra_cost, NULL, toks);
     // NULL: no forward links yet
     toks = new_tok;
     num_toks_++;
@@ -241,7 +256,8 @@ inline LatticeFasterDecoder::Token *LatticeFasterDecoder::FindOrAddToken(
 // prunes outgoing links for all tokens in active_toks_[frame]
 // it's called by PruneActiveTokens
 // all links, that have link_extra_cost > lattice_beam are pruned
-void LatticeFasterDecoder::PruneForwardLinks(
+template <typename FST>
+void LatticeFasterDecoderTpl<FST>::PruneForwardLinks(
     int32 frame, bool *extra_costs_changed,
     bool *links_pruned, BaseFloat delta) {
   // delta is the amount by which the extra_costs must change
@@ -284,7 +300,7 @@ void LatticeFasterDecoder::PruneForwardLinks(
           ForwardLink *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          DeleteForwardLink(link);
           link = next_link; // advance link but leave prev_link the same.
           *links_pruned = true;
         } else { // keep the link and update the tok_extra_cost if needed.
@@ -316,7 +332,8 @@ void LatticeFasterDecoder::PruneForwardLinks(
 // PruneForwardLinksFinal is a version of PruneForwardLinks that we call
 // on the final frame.  If there are final tokens active, it uses
 // the final-probs for pruning, otherwise it treats all tokens as final.
-void LatticeFasterDecoder::PruneForwardLinksFinal(int32 frame) {
+template <typename FST>
+void LatticeFasterDecoderTpl<FST>::PruneForwardLinksFinal(int32 frame) {
   KALDI_ASSERT(static_cast<size_t>(frame+1) == active_toks_.size());
   if (active_toks_[frame].toks == NULL ) // empty list; should not happen.
     KALDI_WARN << "No tokens alive at end of file\n";
@@ -372,7 +389,7 @@ void LatticeFasterDecoder::PruneForwardLinksFinal(int32 frame) {
           ForwardLink *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          DeleteForwardLink(link);
           link = next_link; // advance link but leave prev_link the same.
         } else { // keep the link and update the tok_extra_cost if needed.
           if (link_extra_cost < 0.0) { // this is just a precaution.
@@ -420,7 +437,8 @@ void LatticeFasterDecoder::PruneForwardLinksFinal(int32 frame) {
 // [we don't do this in PruneForwardLinks because it would give us
 // a problem with dangling pointers].
 // It's called by PruneActiveTokens if any forward links have been pruned
-void LatticeFasterDecoder::PruneTokensForFrame(int32 frame) {
+template <typename FST>
+void LatticeFasterDecoderTpl<FST>::PruneTokensForFrame(int32 frame) {
   KALDI_ASSERT(frame >= 0 && frame < active_toks_.size());
   Token *&toks = active_toks_[frame].toks;
   if (toks == NULL)
@@ -433,7 +451,7 @@ void LatticeFasterDecoder::PruneTokensForFrame(int32 frame) {
       // excise tok from list and delete tok.
       if (prev_tok != NULL) prev_tok->next = tok->next;
       else toks = tok->next;
-      delete tok;
+      DeleteToken(tok);
       num_toks_--;
     } else { // fetch next Token
       prev_tok = tok;
@@ -448,7 +466,8 @@ void LatticeFasterDecoder::PruneTokensForFrame(int32 frame) {
 // delta controls when it considers a cost to have changed enough to continue
 // going backward and propagating the change.
 // for a larger delta, we will recurse less far back
-void LatticeFasterDecoder::PruneActiveTokens(int32 cur_frame, BaseFloat delta) {
+template <typename FST>
+void LatticeFasterDecoderTpl<FST>::PruneActiveTokens(int32 cur_frame, BaseFloat delta) {
   int32 num_toks_begin = num_toks_;
   for (int32 frame = cur_frame-1; frame >= 0; frame--) {
     // Reason why we need to prune forward links in this situation:
@@ -476,7 +495,8 @@ void LatticeFasterDecoder::PruneActiveTokens(int32 cur_frame, BaseFloat delta) {
 
 // Version of PruneActiveTokens that we call on the final frame.
 // Takes into account the final-prob of tokens.
-void LatticeFasterDecoder::PruneActiveTokensFinal(int32 cur_frame) {
+template <typename FST>
+void LatticeFasterDecoderTpl<FST>::PruneActiveTokensFinal(int32 cur_frame) {
   int32 num_toks_begin = num_toks_;
   PruneForwardLinksFinal(cur_frame); // prune final frame (with final-probs)
   // sets final_active_ and final_probs_
@@ -492,7 +512,8 @@ void LatticeFasterDecoder::PruneActiveTokensFinal(int32 cur_frame) {
 }
   
 /// Gets the weight cutoff.  Also counts the active tokens.
-BaseFloat LatticeFasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
+template <typename FST>
+BaseFloat LatticeFasterDecoderTpl<FST>::GetCutoff(Elem *list_head, size_t *tok_count,
                                           BaseFloat *adaptive_beam, Elem **best_elem) {
   BaseFloat best_weight = std::numeric_limits<BaseFloat>::infinity();
   // positive == high cost == bad.
@@ -558,7 +579,55 @@ BaseFloat LatticeFasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
   }
 }
 
-void LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable, int32 frame) {
+template <typename FST>
+void LatticeFasterDecoderTpl<FST>::ProcessEmitting(DecodableInterface *decodable,
+                                                   int32 frame) {
+  ProcessEmittingForFst(fst_, decodable, frame);
+}
+
+template <typename FST>
+void LatticeFasterDecoderTpl<FST>::ProcessNonemitting(int32 frame) {
+  ProcessNonemittingForFst(fst_, frame);
+}
+
+// If we were given the graph as a generic Fst, we check whether it is one of
+// the types we know; if so we use the code specialized for that type, so that
+// the arc iteration in the inner loops can be inlined.  (This is per frame, so
+// the dynamic_cast costs nothing to speak of.)
+template <>
+void LatticeFasterDecoderTpl<fst::Fst<fst::StdArc> >::ProcessEmitting(
+    DecodableInterface *decodable, int32 frame) {
+  if (const fst::ConstFst<Arc> *f =
+      dynamic_cast<const fst::ConstFst<Arc>*>(&fst_))
+    ProcessEmittingForFst(*f, decodable, frame);
+  else if (const fst::VectorFst<Arc> *f =
+           dynamic_cast<const fst::VectorFst<Arc>*>(&fst_))
+    ProcessEmittingForFst(*f, decodable, frame);
+  else if (const fst::DecodeFst *f = dynamic_cast<const fst::DecodeFst*>(&fst_))
+    ProcessEmittingForFst(*f, decodable, frame);
+  else
+    ProcessEmittingForFst(fst_, decodable, frame);
+}
+
+template <>
+void LatticeFasterDecoderTpl<fst::Fst<fst::StdArc> >::ProcessNonemitting(
+    int32 frame) {
+  if (const fst::ConstFst<Arc> *f =
+      dynamic_cast<const fst::ConstFst<Arc>*>(&fst_))
+    ProcessNonemittingForFst(*f, frame);
+  else if (const fst::VectorFst<Arc> *f =
+           dynamic_cast<const fst::VectorFst<Arc>*>(&fst_))
+    ProcessNonemittingForFst(*f, frame);
+  else if (const fst::DecodeFst *f = dynamic_cast<const fst::DecodeFst*>(&fst_))
+    ProcessNonemittingForFst(*f, frame);
+  else
+    ProcessNonemittingForFst(fst_, frame);
+}
+
+template <typename FST>
+template <typename F>
+void LatticeFasterDecoderTpl<FST>::ProcessEmittingForFst(
+    const F &fst, DecodableInterface *decodable, int32 frame) {
   // Processes emitting arcs for one frame.  Propagates from prev_toks_ to cur_toks_.
   Elem *last_toks = toks_.Clear(); // analogous to swapping prev_toks_ / cur_toks_
   // in simple-decoder.h.  
@@ -573,6 +642,26 @@ void LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable, int32
 
   BaseFloat cost_offset = 0.0; // Used to keep probabilities in a good
   // dynamic range.
+
+  // If the decodable object can compute many likelihoods efficiently at once,
+  // collect all the indices we will need on this frame and get them with a
+  // single call.
+  bool use_batch = decodable->HasBatchLogLikelihoods();
+  if (use_batch) {
+    batch_loglikes_.Begin(decodable, frame-1);
+    for (Elem *e = last_toks; e != NULL; e = e->tail) {
+      if (e->val->tot_cost <= cur_cutoff) {
+        fst::ArcIterator<F> aiter(fst, e->key);
+        if (epsilons_first_) aiter.Seek(fst.NumInputEpsilons(e->key));
+        for (; !aiter.Done(); aiter.Next()) {
+          const Arc &arc = aiter.Value();
+          if (arc.ilabel != 0)
+            batch_loglikes_.AddIndex(arc.ilabel);
+        }
+      }
+    }
+    batch_loglikes_.Compute();
+  }
   
   // First process the best token to get a hopefully
   // reasonably tight bound on the next cutoff.  The only
@@ -581,14 +670,15 @@ void LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable, int32
     StateId state = best_elem->key;
     Token *tok = best_elem->val;
     cost_offset = - tok->tot_cost;
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
-         !aiter.Done();
-         aiter.Next()) {
+    fst::ArcIterator<F> aiter(fst, state);
+    if (epsilons_first_) aiter.Seek(fst.NumInputEpsilons(state));
+    for (; !aiter.Done(); aiter.Next()) {
       Arc arc = aiter.Value();
       if (arc.ilabel != 0) {  // propagate..
-        arc.weight = Times(arc.weight,
-                           Weight(cost_offset -
-                                  decodable->LogLikelihood(frame-1, arc.ilabel)));
+        BaseFloat loglike = (use_batch ?
+                             batch_loglikes_.LogLikelihood(arc.ilabel) :
+                             decodable->LogLikelihood(frame-1, arc.ilabel));
+        arc.weight = Times(arc.weight, Weight(cost_offset - loglike));
         BaseFloat new_weight = arc.weight.Value() + tok->tot_cost;
         if (new_weight + adaptive_beam < next_cutoff)
           next_cutoff = new_weight + adaptive_beam;
@@ -610,13 +700,15 @@ void LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable, int32
     StateId state = e->key;
     Token *tok = e->val;
     if (tok->tot_cost <=  cur_cutoff) {
-      for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
-           !aiter.Done();
-           aiter.Next()) {
+      fst::ArcIterator<F> aiter(fst, state);
+      if (epsilons_first_) aiter.Seek(fst.NumInputEpsilons(state));
+      for (; !aiter.Done(); aiter.Next()) {
         const Arc &arc = aiter.Value();
         if (arc.ilabel != 0) {  // propagate..
-          BaseFloat ac_cost = cost_offset -
-              decodable->LogLikelihood(frame-1, arc.ilabel),
+          BaseFloat loglike = (use_batch ?
+                               batch_loglikes_.LogLikelihood(arc.ilabel) :
+                               decodable->LogLikelihood(frame-1, arc.ilabel));
+          BaseFloat ac_cost = cost_offset - loglike,
               graph_cost = arc.weight.Value(),
               cur_cost = tok->tot_cost,
               tot_cost = cur_cost + ac_cost + graph_cost;
@@ -627,8 +719,8 @@ void LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable, int32
           // NULL: no change indicator needed
           
           // Add ForwardLink from tok to next_tok (put on head of list tok->links)
-          tok->links = new ForwardLink(next_tok, arc.ilabel, arc.olabel, 
-                                       graph_cost, ac_cost, tok->links);
+          tok->links = NewForwardLink(next_tok, arc.ilabel, arc.olabel,
+                                      graph_cost, ac_cost, tok->links);
         }
       } // for all arcs
     }
@@ -639,7 +731,10 @@ void LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable, int32
 
 // TODO: could possibly add adaptive_beam back as an argument here (was
 // returned from ProcessEmitting, in faster-decoder.h).
-void LatticeFasterDecoder::ProcessNonemitting(int32 frame) {
+template <typename FST>
+template <typename F>
+void LatticeFasterDecoderTpl<FST>::ProcessNonemittingForFst(const F &fst,
+                                                            int32 frame) {
   // note: "frame" is the same as emitting states just processed.
     
   // Processes nonemitting arcs for one frame.  Propagates within toks_.
@@ -676,9 +771,8 @@ void LatticeFasterDecoder::ProcessNonemitting(int32 frame) {
     // because we're about to regenerate them.  This is a kind
     // of non-optimality (remember, this is the simple decoder),
     // but since most states are emitting it's not a huge issue.
-    tok->DeleteForwardLinks(); // necessary when re-visiting
-    tok->links = NULL;
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+    DeleteForwardLinks(tok); // necessary when re-visiting
+    for (fst::ArcIterator<F> aiter(fst, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
@@ -691,20 +785,23 @@ void LatticeFasterDecoder::ProcessNonemitting(int32 frame) {
           Token *new_tok = FindOrAddToken(arc.nextstate, frame, tot_cost,
                                           &changed);
             
-          tok->links = new ForwardLink(new_tok, 0, arc.olabel,
-                                       graph_cost, 0, tok->links);
+          tok->links = NewForwardLink(new_tok, 0, arc.olabel,
+                                      graph_cost, 0, tok->links);
             
           // "changed" tells us whether the new token has a different
           // cost from before, or is new [if so, add into queue].
           if (changed) queue_.push_back(arc.nextstate);
         }
+      } else if (epsilons_first_) {
+        break;  // The rest of the arcs are emitting.
       }
     } // for all arcs
   } // while queue not empty
 }
 
 
-void LatticeFasterDecoder::DeleteElems(Elem *list) {
+template <typename FST>
+void LatticeFasterDecoderTpl<FST>::DeleteElems(Elem *list) {
   for (Elem *e = list, *e_tail; e != NULL; e = e_tail) {
     // Token::TokenDelete(e->val);
     e_tail = e->tail;
@@ -712,20 +809,23 @@ void LatticeFasterDecoder::DeleteElems(Elem *list) {
   }
 }
   
-void LatticeFasterDecoder::ClearActiveTokens() { // a cleanup routine, at utt end/begin
-  for (size_t i = 0; i < active_toks_.size(); i++) {
-    // Delete all tokens alive on this frame, and any forward
-    // links they may have.
-    for (Token *tok = active_toks_[i].toks; tok != NULL; ) {
-      tok->DeleteForwardLinks();
-      Token *next_tok = tok->next;
-      delete tok;
-      num_toks_--;
-      tok = next_tok;
-    }
+template <typename FST>
+void LatticeFasterDecoderTpl<FST>::ClearActiveTokens() { // a cleanup routine, at utt end/begin
+  // All tokens and forward links live in token_pool_ and link_pool_, so we
+  // can free them all at once instead of walking the per-frame lists.
+  KALDI_ASSERT(token_pool_.NumLive() == static_cast<size_t>(num_toks_));
+  if (!active_toks_.empty() && GetVerboseLevel() >= 2) {
+    std::ostringstream os;
+    os << "Token pool: ";
+    token_pool_.Stats().Print(os);
+    os << "; link pool: ";
+    link_pool_.Stats().Print(os);
+    KALDI_VLOG(2) << os.str();
   }
+  token_pool_.Reset();
+  link_pool_.Reset();
+  num_toks_ = 0;
   active_toks_.clear();
-  KALDI_ASSERT(num_toks_ == 0);
 }
 
 DecodeUtteranceLatticeFasterClass::DecodeUtteranceLatticeFasterClass(
@@ -891,8 +991,9 @@ DecodeUtteranceLatticeFasterClass::~DecodeUtteranceLatticeFasterClass() {
 
 
 // Takes care of output.  Returns true on success.
+template <typename FST>
 bool DecodeUtteranceLatticeFaster(
-    LatticeFasterDecoder &decoder, // not const but is really an input.
+    LatticeFasterDecoderTpl<FST> &decoder, // not const but is really an input.
     DecodableInterface &decodable, // not const but is really an input.
     const TransitionModel &trans_model,
     const fst::SymbolTable *word_syms,
@@ -987,4 +1088,32 @@ bool DecodeUtteranceLatticeFaster(
   return true;
 }
 
+// Instantiate the decoder for the FST types we expect to decode with.
+template class LatticeFasterDecoderTpl<fst::Fst<fst::StdArc> >;
+template class LatticeFasterDecoderTpl<fst::ConstFst<fst::StdArc> >;
+template class LatticeFasterDecoderTpl<fst::VectorFst<fst::StdArc> >;
+template class LatticeFasterDecoderTpl<fst::DecodeFst>;
+
+#define KALDI_INSTANTIATE_DECODE_UTTERANCE(FST)                         \
+  template bool DecodeUtteranceLatticeFaster(                           \
+      LatticeFasterDecoderTpl<FST > &decoder,                           \
+      DecodableInterface &decodable,                                    \
+      const TransitionModel &trans_model,                               \
+      const fst::SymbolTable *word_syms,                                \
+      std::string utt,                                                  \
+      double acoustic_scale,                                            \
+      bool determinize,                                                 \
+      bool allow_partial,                                               \
+      Int32VectorWriter *alignment_writer,                              \
+      Int32VectorWriter *words_writer,                                  \
+      CompactLatticeWriter *compact_lattice_writer,                     \
+      LatticeWriter *lattice_writer,                                    \
+      double *like_ptr);
+
+KALDI_INSTANTIATE_DECODE_UTTERANCE(fst::Fst<fst::StdArc>)
+KALDI_INSTANTIATE_DECODE_UTTERANCE(fst::ConstFst<fst::StdArc>)
+KALDI_INSTANTIATE_DECODE_UTTERANCE(fst::VectorFst<fst::StdArc>)
+KALDI_INSTANTIATE_DECODE_UTTERANCE(fst::DecodeFst)
+#undef KALDI_INSTANTIATE_DECODE_UTTERANCE
+
 } // end namespace kaldi.
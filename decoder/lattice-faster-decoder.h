@@ -25,8 +25,10 @@
 
 #include "util/stl-utils.h"
 #include "util/hash-list.h"
+#include "util/memory-pool.h"
 #include "fst/fstlib.h"
 #include "itf/decodable-itf.h"
+#include "decoder/batch-log-likes.h"
 #include "fstext/fstext-lib.h"
 #include "lat/determinize-lattice-pruned.h"
 #include "lat/kaldi-lattice.h"
@@ -83,8 +85,19 @@ struct LatticeFasterDecoderConfig {
 /** A bit more optimized version of the lattice decoder.
    See \ref lattices_generation \ref decoders_faster and \ref decoders_simple
     for more information.
+
+   The template argument FST is the type of the decoding graph; the arcs are
+   accessed through fst::ArcIterator<FST>, which for fst::ConstFst and
+   fst::VectorFst is a plain pointer walk that the compiler can inline.  The
+   class is instantiated (in lattice-faster-decoder.cc) for fst::Fst<StdArc>,
+   fst::ConstFst<StdArc>, fst::VectorFst<StdArc> and fst::DecodeFst.  The
+   generic version LatticeFasterDecoder, which takes fst::Fst<StdArc>, checks
+   the actual type of the graph it was given and uses the code specialized for
+   that type if there is one, so the decoding programs get the faster code
+   without needing to know the type of the graph they read.
  */
-class LatticeFasterDecoder {
+template <typename FST>
+class LatticeFasterDecoderTpl {
  public:
   typedef fst::StdArc Arc;
   typedef Arc::Label Label;
@@ -92,13 +105,13 @@ class LatticeFasterDecoder {
   typedef Arc::Weight Weight;
 
   // instantiate this class once for each thing you have to decode.
-  LatticeFasterDecoder(const fst::Fst<fst::StdArc> &fst,
-                       const LatticeFasterDecoderConfig &config);
+  LatticeFasterDecoderTpl(const FST &fst,
+                          const LatticeFasterDecoderConfig &config);
 
   // This version of the initializer "takes ownership" of the fst,
   // and will delete it when this object is destroyed.
-  LatticeFasterDecoder(const LatticeFasterDecoderConfig &config,
-                       fst::Fst<fst::StdArc> *fst);
+  LatticeFasterDecoderTpl(const LatticeFasterDecoderConfig &config,
+                          FST *fst);
                        
   
   void SetOptions(const LatticeFasterDecoderConfig &config) {
@@ -109,7 +122,7 @@ class LatticeFasterDecoder {
     return config_;
   }
 
-  ~LatticeFasterDecoder() {
+  ~LatticeFasterDecoderTpl() {
     ClearActiveTokens();
     if (delete_fst_) delete &(fst_);
   }
@@ -136,6 +149,13 @@ class LatticeFasterDecoder {
   // lattice (one path per word sequence).
   bool GetLattice(fst::MutableFst<CompactLatticeArc> *ofst) const;
 
+  /// Statistics on the allocation of Tokens and ForwardLinks.  These are
+  /// allocated from pools owned by this object which are reset in bulk at the
+  /// start of each utterance; the stats accumulate over the lifetime of the
+  /// decoder.
+  const MemoryPoolStats &TokenPoolStats() const { return token_pool_.Stats(); }
+  const MemoryPoolStats &LinkPoolStats() const { return link_pool_.Stats(); }
+
 
  private:
   struct Token;
@@ -177,15 +197,6 @@ class LatticeFasterDecoder {
     inline Token(BaseFloat tot_cost, BaseFloat extra_cost, ForwardLink *links,
                  Token *next): tot_cost(tot_cost), extra_cost(extra_cost),
                  links(links), next(next) { }
-    inline void DeleteForwardLinks() {
-      ForwardLink *l = links, *m; 
-      while (l != NULL) {
-        m = l->next;
-        delete l;
-        l = m;
-      }
-      links = NULL;
-    }
   };
   
   // head and tail of per-frame list of Tokens (list is in topological order),
@@ -198,7 +209,35 @@ class LatticeFasterDecoder {
                  must_prune_tokens(true) { }
   };
 
-  typedef HashList<StateId, Token*>::Elem Elem;
+  typedef typename HashList<StateId, Token*>::Elem Elem;
+
+  // Tokens and ForwardLinks are allocated from token_pool_ and link_pool_
+  // (see ../util/memory-pool.h) rather than with new and delete.
+  inline Token *NewToken(BaseFloat tot_cost, BaseFloat extra_cost,
+                         ForwardLink *links, Token *next) {
+    return new (token_pool_.Allocate()) Token(tot_cost, extra_cost, links,
+                                              next);
+  }
+  inline void DeleteToken(Token *tok) { token_pool_.Free(tok); }
+  inline ForwardLink *NewForwardLink(Token *next_tok, Label ilabel,
+                                     Label olabel, BaseFloat graph_cost,
+                                     BaseFloat acoustic_cost,
+                                     ForwardLink *next) {
+    return new (link_pool_.Allocate()) ForwardLink(next_tok, ilabel, olabel,
+                                                   graph_cost, acoustic_cost,
+                                                   next);
+  }
+  inline void DeleteForwardLink(ForwardLink *link) { link_pool_.Free(link); }
+  // Deletes all the forward links of this token.
+  inline void DeleteForwardLinks(Token *tok) {
+    ForwardLink *l = tok->links, *m;
+    while (l != NULL) {
+      m = l->next;
+      DeleteForwardLink(l);
+      l = m;
+    }
+    tok->links = NULL;
+  }
 
   void PossiblyResizeHash(size_t num_toks);
 
@@ -263,18 +302,33 @@ class LatticeFasterDecoder {
   /// returned from ProcessEmitting, in faster-decoder.h).
   void ProcessNonemitting(int32 frame);
 
+  /// These do the work of ProcessEmitting() and ProcessNonemitting();
+  /// "fst" is fst_, possibly cast to a more specific type.
+  template <typename F>
+  void ProcessEmittingForFst(const F &fst, DecodableInterface *decodable,
+                             int32 frame);
+  template <typename F>
+  void ProcessNonemittingForFst(const F &fst, int32 frame);
+
   // HashList defined in ../util/hash-list.h.  It actually allows us to maintain
   // more than one list (e.g. for current and previous frames), but only one of
   // them at a time can be indexed by StateId.
   HashList<StateId, Token*> toks_;
+  MemoryPool<Token> token_pool_;
+  MemoryPool<ForwardLink> link_pool_;
   std::vector<TokenList> active_toks_; // Lists of tokens, indexed by
   // frame (members of TokenList are toks, must_prune_forward_links,
   // must_prune_tokens).
   std::vector<StateId> queue_;  // temp variable used in ProcessNonemitting,
   std::vector<BaseFloat> tmp_array_;  // used in GetCutoff.
   // make it class member to avoid internal new/delete.
-  const fst::Fst<fst::StdArc> &fst_;
+  BatchLogLikes batch_loglikes_;  // used in ProcessEmitting if the decodable
+  // object has a batch LogLikelihoods() function.
+  const FST &fst_;
   bool delete_fst_;
+  bool epsilons_first_;  // True if in each state of fst_ the input-epsilon
+  // arcs come before the others (e.g. if it is of type "decode", see
+  // ../fstext/decode-fst.h, or is sorted on input label); lets us skip arcs.
   std::vector<BaseFloat> cost_offsets_; // This contains, for each
   // frame, an offset that was added to the acoustic likelihoods on that
   // frame in order to keep everything in a nice dynamic range.
@@ -298,11 +352,24 @@ class LatticeFasterDecoder {
   // but are also linked together on each frame by their own linked-list,
   // using the "next" pointer.  We delete them manually.
   void DeleteElems(Elem *list);
-  
+
+  // Frees all Tokens and ForwardLinks; this resets token_pool_ and link_pool_
+  // rather than deleting them one by one.
   void ClearActiveTokens();
   
 };
 
+// These are specialized in lattice-faster-decoder.cc, and declared here so
+// that other translation units do not instantiate the generic versions.
+template <>
+void LatticeFasterDecoderTpl<fst::Fst<fst::StdArc> >::ProcessEmitting(
+    DecodableInterface *decodable, int32 frame);
+template <>
+void LatticeFasterDecoderTpl<fst::Fst<fst::StdArc> >::ProcessNonemitting(
+    int32 frame);
+
+typedef LatticeFasterDecoderTpl<fst::Fst<fst::StdArc> > LatticeFasterDecoder;
+
 
 // This function DecodeUtteranceLatticeFaster is used in several decoders, and
 // we have moved it here.  Note: this is really "binary-level" code as it
@@ -310,8 +377,9 @@ class LatticeFasterDecoder {
 // other obvious place to put it.  If determinize == false, it writes to
 // lattice_writer, else to compact_lattice_writer.  The writers for
 // alignments and words will only be written to if they are open.
+template <typename FST>
 bool DecodeUtteranceLatticeFaster(
-    LatticeFasterDecoder &decoder, // not const but is really an input.
+    LatticeFasterDecoderTpl<FST> &decoder, // not const but is really an input.
     DecodableInterface &decodable, // not const but is really an input.
     const TransitionModel &trans_model,
     const fst::SymbolTable *word_syms,
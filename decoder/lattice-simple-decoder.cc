@@ -23,7 +23,8 @@
 
 namespace kaldi {
 
-bool LatticeSimpleDecoder::Decode(DecodableInterface *decodable) {
+template <typename FST>
+bool LatticeSimpleDecoderTpl<FST>::Decode(DecodableInterface *decodable) {
   // clean up from last time:
   cur_toks_.clear();
   prev_toks_.clear();
@@ -64,7 +65,8 @@ bool LatticeSimpleDecoder::Decode(DecodableInterface *decodable) {
 
 // Outputs an FST corresponding to the single best path
 // through the lattice.
-bool LatticeSimpleDecoder::GetBestPath(fst::MutableFst<LatticeArc> *ofst) const {
+template <typename FST>
+bool LatticeSimpleDecoderTpl<FST>::GetBestPath(fst::MutableFst<LatticeArc> *ofst) const {
   fst::VectorFst<LatticeArc> fst;
   if (!GetRawLattice(&fst)) return false;
   // std::cout << "Raw lattice is:\n";
@@ -76,7 +78,8 @@ bool LatticeSimpleDecoder::GetBestPath(fst::MutableFst<LatticeArc> *ofst) const
 
 // Outputs an FST corresponding to the raw, state-level
 // tracebacks.
-bool LatticeSimpleDecoder::GetRawLattice(fst::MutableFst<LatticeArc> *ofst) const {
+template <typename FST>
+bool LatticeSimpleDecoderTpl<FST>::GetRawLattice(fst::MutableFst<LatticeArc> *ofst) const {
   typedef LatticeArc Arc;
   typedef Arc::StateId StateId;
   typedef Arc::Weight Weight;
@@ -111,7 +114,7 @@ bool LatticeSimpleDecoder::GetRawLattice(fst::MutableFst<LatticeArc> *ofst) cons
       for (ForwardLink *l = tok->links;
            l != NULL;
            l = l->next) {
-        unordered_map<Token*, StateId>::const_iterator iter =
+        typename unordered_map<Token*, StateId>::const_iterator iter =
             tok_map.find(l->next_tok);
         StateId nextstate = iter->second;
         KALDI_ASSERT(iter != tok_map.end());
@@ -121,7 +124,7 @@ bool LatticeSimpleDecoder::GetRawLattice(fst::MutableFst<LatticeArc> *ofst) cons
         ofst->AddArc(cur_state, arc);
       }
       if (f == num_frames) {
-        std::map<Token*, BaseFloat>::const_iterator iter =
+        typename std::map<Token*, BaseFloat>::const_iterator iter =
             final_costs_.find(tok);
         if (iter != final_costs_.end())
           ofst->SetFinal(cur_state, LatticeWeight(iter->second, 0));
@@ -136,7 +139,8 @@ bool LatticeSimpleDecoder::GetRawLattice(fst::MutableFst<LatticeArc> *ofst) cons
 // the LatticeSimpleDecoder class.
 // Outputs an FST corresponding to the lattice-determinized
 // lattice (one path per word sequence).
-bool LatticeSimpleDecoder::GetLattice(fst::MutableFst<CompactLatticeArc> *ofst) const {
+template <typename FST>
+bool LatticeSimpleDecoderTpl<FST>::GetLattice(fst::MutableFst<CompactLatticeArc> *ofst) const {
   Lattice raw_fst;
   if (!GetRawLattice(&raw_fst)) return false;
   Invert(&raw_fst); // make it so word labels are on the input.
@@ -168,13 +172,15 @@ bool LatticeSimpleDecoder::GetLattice(fst::MutableFst<CompactLatticeArc> *ofst)
 //
 // Returns the Token pointer.  Sets "changed" (if non-NULL) to true
 // if the token was newly created or the cost changed.
-inline LatticeSimpleDecoder::Token *LatticeSimpleDecoder::FindOrAddToken(
+template <typename FST>
+inline typename LatticeSimpleDecoderTpl<FST>::Token *
+LatticeSimpleDecoderTpl<FST>::FindOrAddToken(
     StateId state, int32 frame, BaseFloat tot_cost,
     bool emitting, bool *changed) {
   KALDI_ASSERT(frame < active_toks_.size());
   Token *&toks = active_toks_[frame].toks;
     
-  unordered_map<StateId, Token*>::iterator find_iter = cur_toks_.find(state);
+  typename unordered_map<StateId, Token*>::iterator find_iter = cur_toks_.find(state);
   if (find_iter == cur_toks_.end()) { // no such token presently.
     // Create one.
     const BaseFloat extra_cost = 0.0;
@@ -202,7 +208,8 @@ inline LatticeSimpleDecoder::Token *LatticeSimpleDecoder::FindOrAddToken(
 // delta is the amount by which the extra_costs must
 // change before it sets "extra_costs_changed" to true.  If delta is larger,
 // we'll tend to go back less far toward the beginning of the file.
-void LatticeSimpleDecoder::PruneForwardLinks(
+template <typename FST>
+void LatticeSimpleDecoderTpl<FST>::PruneForwardLinks(
     int32 frame, bool *extra_costs_changed,
     bool *links_pruned, BaseFloat delta) {
   // We have to iterate until there is no more change, because the links
@@ -268,7 +275,8 @@ void LatticeSimpleDecoder::PruneForwardLinks(
 // PruneForwardLinksFinal is a version of PruneForwardLinks that we call
 // on the final frame.  If there are final tokens active, it uses the final-probs
 // for pruning, otherwise it treats all tokens as final.
-void LatticeSimpleDecoder::PruneForwardLinksFinal(int32 frame) {
+template <typename FST>
+void LatticeSimpleDecoderTpl<FST>::PruneForwardLinksFinal(int32 frame) {
   KALDI_ASSERT(static_cast<size_t>(frame+1) == active_toks_.size());
   if (active_toks_[frame].toks == NULL ) // empty list; this should
     // not happen.
@@ -282,7 +290,7 @@ void LatticeSimpleDecoder::PruneForwardLinksFinal(int32 frame) {
       best_cost_nofinal = infinity;
   unordered_map<Token*, StateId> tok_to_state_map;
 
-  unordered_map<StateId, Token*>::iterator iter(cur_toks_.begin());
+  typename unordered_map<StateId, Token*>::iterator iter(cur_toks_.begin());
   for(; iter != cur_toks_.end(); ++iter) {
     StateId state = iter->first;
     Token *tok = iter->second;
@@ -371,7 +379,8 @@ void LatticeSimpleDecoder::PruneForwardLinksFinal(int32 frame) {
 // Prune away any tokens on this frame that have no forward links. [we don't do
 // this in PruneForwardLinks because it would give us a problem with dangling
 // pointers].
-void LatticeSimpleDecoder::PruneTokensForFrame(int32 frame) {
+template <typename FST>
+void LatticeSimpleDecoderTpl<FST>::PruneTokensForFrame(int32 frame) {
   KALDI_ASSERT(frame >= 0 && frame < active_toks_.size());
   Token *&toks = active_toks_[frame].toks;
   if (toks == NULL)
@@ -399,7 +408,8 @@ void LatticeSimpleDecoder::PruneTokensForFrame(int32 frame) {
 // delta controls when it considers a cost to have changed enough to continue
 // going backward and propagating the change.  larger delta -> will recurse less
 // far.
-void LatticeSimpleDecoder::PruneActiveTokens(int32 cur_frame, BaseFloat delta) {
+template <typename FST>
+void LatticeSimpleDecoderTpl<FST>::PruneActiveTokens(int32 cur_frame, BaseFloat delta) {
   int32 num_toks_begin = num_toks_;
   for (int32 frame = cur_frame-1; frame >= 0; frame--) {
     // Reason why we need to prune forward links in this situation:
@@ -433,7 +443,8 @@ void LatticeSimpleDecoder::PruneActiveTokens(int32 cur_frame, BaseFloat delta) {
 // it can be dangerous, depending what you want the lattices for).
 // final_active_ is set intenally (by PruneForwardLinksFinal),
 // and final_probs_ (a hash) is also set by PruneForwardLinksFinal.
-void LatticeSimpleDecoder::PruneActiveTokensFinal(int32 cur_frame) {
+template <typename FST>
+void LatticeSimpleDecoderTpl<FST>::PruneActiveTokensFinal(int32 cur_frame) {
   int32 num_toks_begin = num_toks_;
   PruneForwardLinksFinal(cur_frame); 
   for (int32 frame = cur_frame-1; frame >= 0; frame--) {
@@ -447,16 +458,17 @@ void LatticeSimpleDecoder::PruneActiveTokensFinal(int32 cur_frame) {
                 << " to " << num_toks_;
 }
   
-void LatticeSimpleDecoder::ProcessEmitting(DecodableInterface *decodable, int32 frame) {
+template <typename FST>
+void LatticeSimpleDecoderTpl<FST>::ProcessEmitting(DecodableInterface *decodable, int32 frame) {
   // Processes emitting arcs for one frame.  Propagates from
   // prev_toks_ to cur_toks_.
   BaseFloat cutoff = std::numeric_limits<BaseFloat>::infinity();
-  for (unordered_map<StateId, Token*>::iterator iter = prev_toks_.begin();
+  for (typename unordered_map<StateId, Token*>::iterator iter = prev_toks_.begin();
        iter != prev_toks_.end();
        ++iter) {
     StateId state = iter->first;
     Token *tok = iter->second;
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+    for (fst::ArcIterator<FST> aiter(fst_, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
@@ -479,7 +491,8 @@ void LatticeSimpleDecoder::ProcessEmitting(DecodableInterface *decodable, int32
   }
 }
 
-void LatticeSimpleDecoder::ProcessNonemitting(int32 frame) {
+template <typename FST>
+void LatticeSimpleDecoderTpl<FST>::ProcessNonemitting(int32 frame) {
   // note: "frame" is the same as emitting states
   // just processed.
     
@@ -490,7 +503,7 @@ void LatticeSimpleDecoder::ProcessNonemitting(int32 frame) {
   // problem did not improve overall speed.
   std::vector<StateId> queue;
   BaseFloat best_cost = std::numeric_limits<BaseFloat>::infinity();
-  for (unordered_map<StateId, Token*>::iterator iter = cur_toks_.begin();
+  for (typename unordered_map<StateId, Token*>::iterator iter = cur_toks_.begin();
        iter != cur_toks_.end();
        ++iter) {
     queue.push_back(iter->first);
@@ -515,7 +528,7 @@ void LatticeSimpleDecoder::ProcessNonemitting(int32 frame) {
     // but since most states are emitting it's not a huge issue.
     tok->DeleteForwardLinks();
     tok->links = NULL;
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+    for (fst::ArcIterator<FST> aiter(fst_, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
@@ -541,7 +554,8 @@ void LatticeSimpleDecoder::ProcessNonemitting(int32 frame) {
   }
 }
 
-void LatticeSimpleDecoder::ClearActiveTokens() { // a cleanup routine, at utt end/begin
+template <typename FST>
+void LatticeSimpleDecoderTpl<FST>::ClearActiveTokens() { // a cleanup routine, at utt end/begin
   for (size_t i = 0; i < active_toks_.size(); i++) {
     // Delete all tokens alive on this frame, and any forward
     // links they may have.
@@ -560,13 +574,14 @@ void LatticeSimpleDecoder::ClearActiveTokens() { // a cleanup routine, at utt en
 // PruneCurrentTokens deletes the tokens from the "toks" map, but not
 // from the active_toks_ list, which could cause dangling forward pointers
 // (will delete it during regular pruning operation).
-void LatticeSimpleDecoder::PruneCurrentTokens(BaseFloat beam, unordered_map<StateId, Token*> *toks) {
+template <typename FST>
+void LatticeSimpleDecoderTpl<FST>::PruneCurrentTokens(BaseFloat beam, unordered_map<StateId, Token*> *toks) {
   if (toks->empty()) {
     KALDI_VLOG(2) <<  "No tokens to prune.\n";
     return;
   }
   BaseFloat best_cost = 1.0e+10;  // positive == high cost == bad.
-  for (unordered_map<StateId, Token*>::iterator iter = toks->begin();
+  for (typename unordered_map<StateId, Token*>::iterator iter = toks->begin();
        iter != toks->end(); ++iter) {
     best_cost =
         std::min(best_cost,
@@ -574,7 +589,7 @@ void LatticeSimpleDecoder::PruneCurrentTokens(BaseFloat beam, unordered_map<Stat
   }
   std::vector<StateId> retained;
   BaseFloat cutoff = best_cost + beam;
-  for (unordered_map<StateId, Token*>::iterator iter = toks->begin();
+  for (typename unordered_map<StateId, Token*>::iterator iter = toks->begin();
        iter != toks->end(); ++iter) {
     if (iter->second->tot_cost < cutoff)
       retained.push_back(iter->first);
@@ -685,6 +700,12 @@ bool DecodeUtteranceLatticeSimple(
 }
 
 
+// Instantiate the decoder for the FST types we expect to decode with.
+template class LatticeSimpleDecoderTpl<fst::Fst<fst::StdArc> >;
+template class LatticeSimpleDecoderTpl<fst::ConstFst<fst::StdArc> >;
+template class LatticeSimpleDecoderTpl<fst::VectorFst<fst::StdArc> >;
+template class LatticeSimpleDecoderTpl<fst::DecodeFst>;
+
 } // end namespace kaldi.
 
 
@@ -72,19 +72,24 @@ struct LatticeSimpleDecoderConfig {
 /** Simplest possible decoder, included largely for didactic purposes and as a
     means to debug more highly optimized decoders.  See \ref decoders_simple
     for more information.
+
+    The template argument FST is the type of the decoding graph; the class is
+    instantiated for fst::Fst<StdArc>, fst::ConstFst<StdArc>,
+    fst::VectorFst<StdArc> and fst::DecodeFst.
  */
-class LatticeSimpleDecoder {
+template <typename FST>
+class LatticeSimpleDecoderTpl {
  public:
   typedef fst::StdArc Arc;
   typedef Arc::Label Label;
   typedef Arc::StateId StateId;
   typedef Arc::Weight Weight;
   // instantiate this class onece for each thing you have to decode.
-  LatticeSimpleDecoder(const fst::Fst<fst::StdArc> &fst,
-                       const LatticeSimpleDecoderConfig &config):
+  LatticeSimpleDecoderTpl(const FST &fst,
+                          const LatticeSimpleDecoderConfig &config):
       fst_(fst), config_(config), num_toks_(0) { config.Check(); }
   
-  ~LatticeSimpleDecoder() { ClearActiveTokens(); }
+  ~LatticeSimpleDecoderTpl() { ClearActiveTokens(); }
 
   LatticeSimpleDecoderConfig GetOptions() {
     return config_;
@@ -237,7 +242,7 @@ class LatticeSimpleDecoder {
   std::vector<TokenList> active_toks_; // Lists of tokens, indexed by
   // frame (members of TokenList are toks, must_prune_forward_links,
   // must_prune_tokens).
-  const fst::Fst<fst::StdArc> &fst_;
+  const FST &fst_;
   LatticeSimpleDecoderConfig config_;
   int32 num_toks_; // current total #toks allocated...
   bool warned_;
@@ -248,6 +253,8 @@ class LatticeSimpleDecoder {
   
 };
 
+typedef LatticeSimpleDecoderTpl<fst::Fst<fst::StdArc> > LatticeSimpleDecoder;
+
 // This function DecodeUtteranceLatticeSimple is used in several decoders, and
 // we have moved it here.  Note: this is really "binary-level" code as it
 // involves table readers and writers; we've just put it here as there is no
@@ -31,6 +31,10 @@ Fbank::Fbank(const FbankOptions &opts)
   int32 padded_window_size = opts.frame_opts.PaddedWindowSize();
   if ((padded_window_size & (padded_window_size-1)) == 0)  // Is a power of two...
     srfft_ = new SplitRadixRealFft<BaseFloat>(padded_window_size);
+
+  // We cache the mel banks for no VTLN warping now, so that the const
+  // version of Compute() can use them.
+  GetMelBanks(1.0);
 }
 
 Fbank::~Fbank() {
@@ -61,71 +65,82 @@ void Fbank::Compute(const VectorBase<BaseFloat> &wave,
                    Matrix<BaseFloat> *output,
                    Vector<BaseFloat> *wave_remainder) {
   KALDI_ASSERT(output != NULL);
+  if (NumFrames(wave.Dim(), opts_.frame_opts) == 0)
+    KALDI_ERR << "No frames fit in file (#samples is " << wave.Dim() << ")";
+  // Optionally extract the remainder for further processing
+  if (wave_remainder != NULL)
+    ExtractWaveformRemainder(wave, opts_.frame_opts, wave_remainder);
+  ComputeInternal(wave, *GetMelBanks(vtln_warp), output);
+}
+
+void Fbank::Compute(const VectorBase<BaseFloat> &wave,
+                    BaseFloat vtln_warp,
+                    Matrix<BaseFloat> *output) const {
+  std::map<BaseFloat, MelBanks*>::const_iterator iter =
+      mel_banks_.find(vtln_warp);
+  if (iter != mel_banks_.end()) {
+    ComputeInternal(wave, *(iter->second), output);
+  } else {
+    MelBanks mel_banks(opts_.mel_opts, opts_.frame_opts, vtln_warp);
+    ComputeInternal(wave, mel_banks, output);
+  }
+}
+
+void Fbank::ComputeInternal(const VectorBase<BaseFloat> &wave,
+                            const MelBanks &mel_banks,
+                            Matrix<BaseFloat> *output) const {
+  KALDI_ASSERT(output != NULL);
 
   // Get dimensions of output features
   int32 rows_out = NumFrames(wave.Dim(), opts_.frame_opts);
-  int32 cols_out = opts_.mel_opts.num_bins + opts_.use_energy;
+  int32 num_bins = opts_.mel_opts.num_bins,
+      cols_out = num_bins + opts_.use_energy;
   if (rows_out == 0)
     KALDI_ERR << "No frames fit in file (#samples is " << wave.Dim() << ")";
-  // Prepare the output buffer
-  output->Resize(rows_out, cols_out);
 
-  // Optionally extract the remainder for further processing
-  if (wave_remainder != NULL)
-    ExtractWaveformRemainder(wave, opts_.frame_opts, wave_remainder);
+  // Cut all the windows and apply the window function.
+  Matrix<BaseFloat> windows;  // windowed waveform, one row per frame.
+  Vector<BaseFloat> log_energy;
+  ExtractWindows(wave, opts_.frame_opts, feature_window_function_, &windows,
+                 (opts_.use_energy && opts_.raw_energy ? &log_energy : NULL));
+
+  // Compute energy after window function (not the raw one)
+  if (opts_.use_energy && !opts_.raw_energy) {
+    log_energy.Resize(rows_out, kUndefined);
+    log_energy.AddDiagMat2(1.0, windows, kNoTrans, 0.0);
+    log_energy.ApplyLog();
+  }
 
-  // Buffers
-  Vector<BaseFloat> window;  // windowed waveform.
-  Vector<BaseFloat> mel_energies;
-  BaseFloat log_energy;
-
-  // Compute all the freames, r is frame index..
-  for (int32 r = 0; r < rows_out; r++) {
-    // Cut the window, apply window function
-    ExtractWindow(wave, r, opts_.frame_opts, feature_window_function_, &window,
-                  (opts_.use_energy && opts_.raw_energy ? &log_energy : NULL));
-
-    // Compute energy after window function (not the raw one)
-    if (opts_.use_energy && !opts_.raw_energy)
-      log_energy = log(VecVec(window, window));
-
-    if (srfft_ != NULL)  // Compute FFT using split-radix algorithm.
-      srfft_->Compute(window.Data(), true);
-    else  // An alternative algorithm that works for non-powers-of-two.
-      RealFft(&window, true);
-
-    // Convert the FFT into a power spectrum.
-    ComputePowerSpectrum(&window);
-    SubVector<BaseFloat> power_spectrum(window, 0, window.Dim()/2 + 1);
-
-    // Integrate with MelFiterbank over power spectrum
-    const MelBanks *this_mel_banks = GetMelBanks(vtln_warp);
-    this_mel_banks->Compute(power_spectrum, &mel_energies);
-    if (opts_.use_log_fbank)
-      mel_energies.ApplyLog();  // take the log.
-
-    // Output buffers
-    SubVector<BaseFloat> this_output(output->Row(r));
-    SubVector<BaseFloat> this_fbank(this_output.Range((opts_.use_energy? 1 : 0),
-                                                      opts_.mel_opts.num_bins));
-
-    // Copy to output
-    this_fbank.CopyFromVec(mel_energies);
-    // Copy energy as first value
-    if (opts_.use_energy) {
-      if (opts_.energy_floor > 0.0 && log_energy < log_energy_floor_) {
-        log_energy = log_energy_floor_;
-      }
-      this_output(0) = log_energy;
-    }
+  // Do the FFTs and convert them into power spectra.
+  ComputePowerSpectra(srfft_, &windows);
+  SubMatrix<BaseFloat> power_spectra(windows, 0, rows_out,
+                                     0, windows.NumCols() / 2 + 1);
+
+  // Prepare the output buffer
+  output->Resize(rows_out, cols_out, kUndefined);
+  SubMatrix<BaseFloat> fbank(*output, 0, rows_out,
+                             (opts_.use_energy ? 1 : 0), num_bins);
+
+  // Integrate with MelFiterbank over power spectrum
+  mel_banks.Compute(power_spectra, &fbank);
+  if (opts_.use_log_fbank)
+    fbank.ApplyLog();  // take the log.
+
+  // Copy energy as first value
+  if (opts_.use_energy) {
+    if (opts_.energy_floor > 0.0)
+      log_energy.ApplyFloor(log_energy_floor_);
+    output->CopyColFromVec(log_energy, 0);
+  }
 
-    // HTK compat: Shift features, so energy is last value
-    if (opts_.htk_compat && opts_.use_energy) {
+  // HTK compat: Shift features, so energy is last value
+  if (opts_.htk_compat && opts_.use_energy) {
+    for (int32 r = 0; r < rows_out; r++) {
+      SubVector<BaseFloat> this_output(*output, r);
       BaseFloat energy = this_output(0);
-      for (int32 i = 0; i < opts_.mel_opts.num_bins; i++) {
+      for (int32 i = 0; i < num_bins; i++)
         this_output(i) = this_output(i+1);
-      }
-      this_output(opts_.mel_opts.num_bins) = energy;
+      this_output(num_bins) = energy;
     }
   }
 }
@@ -86,8 +86,22 @@ class Fbank {
                Matrix<BaseFloat> *output,
                Vector<BaseFloat> *wave_remainder = NULL);
 
+  /// This version of Compute() is const, so it may be called from several
+  /// threads at once on the same object (compute-fbank-feats does this if
+  /// --num-threads > 1).  If the mel banks for this VTLN warp factor are not
+  /// already cached (those for no warping are computed in the constructor),
+  /// they are computed for this call only.
+  void Compute(const VectorBase<BaseFloat> &wave,
+               BaseFloat vtln_warp,
+               Matrix<BaseFloat> *output) const;
+
  private:
   const MelBanks *GetMelBanks(BaseFloat vtln_warp);
+  // Does the work of both versions of Compute(), computing all the frames
+  // of the utterance together.
+  void ComputeInternal(const VectorBase<BaseFloat> &wave,
+                       const MelBanks &mel_banks,
+                       Matrix<BaseFloat> *output) const;
   FbankOptions opts_;
   BaseFloat log_energy_floor_;
   std::map<BaseFloat, MelBanks*> mel_banks_;  // BaseFloat is VTLN coefficient.
@@ -92,6 +92,146 @@ void UnitTestOnlineCmvn() {
   }
 }
 
+void UnitTestExtractWindows() {
+  for (int32 i = 0; i < 20; i++) {
+    FrameExtractionOptions opts;
+    opts.snip_edges = (rand() % 2 == 0);
+    opts.round_to_power_of_two = (rand() % 2 == 0);
+    opts.remove_dc_offset = (rand() % 2 == 0);
+    opts.preemph_coeff = (rand() % 2 == 0 ? 0.0 : 0.97);
+    opts.dither = 0.0;  // so the results are deterministic.
+    opts.window_type = (rand() % 2 == 0 ? "povey" : "hamming");
+    FeatureWindowFunction window_function(opts);
+    Vector<BaseFloat> wave(100 + rand() % 2000);
+    wave.SetRandn();
+    wave.Scale(1000.0);
+
+    Matrix<BaseFloat> windows;
+    Vector<BaseFloat> log_energy;
+    ExtractWindows(wave, opts, window_function, &windows, &log_energy);
+    int32 num_frames = NumFrames(wave.Dim(), opts);
+    if (num_frames == 0) {
+      KALDI_ASSERT(windows.NumRows() == 0 && log_energy.Dim() == 0);
+      continue;
+    }
+    KALDI_ASSERT(windows.NumRows() == num_frames &&
+                 windows.NumCols() == opts.PaddedWindowSize() &&
+                 log_energy.Dim() == num_frames);
+    Vector<BaseFloat> window;
+    for (int32 f = 0; f < num_frames; f++) {
+      BaseFloat this_log_energy;
+      ExtractWindow(wave, f, opts, window_function, &window, &this_log_energy);
+      SubVector<BaseFloat> row(windows, f);
+      AssertEqual(window, row, 1.0e-04);
+      AssertEqual(this_log_energy, log_energy(f), 1.0e-04);
+    }
+
+    SplitRadixRealFft<BaseFloat> *srfft = NULL;
+    if (opts.round_to_power_of_two)
+      srfft = new SplitRadixRealFft<BaseFloat>(windows.NumCols());
+    Matrix<BaseFloat> spectra(windows);
+    ComputePowerSpectra(srfft, &spectra);
+    delete srfft;
+    int32 num_bins = windows.NumCols() / 2 + 1;
+    for (int32 f = 0; f < num_frames; f++) {
+      Vector<BaseFloat> spectrum(windows.Row(f));
+      RealFft(&spectrum, true);
+      ComputePowerSpectrum(&spectrum);
+      SubVector<BaseFloat> spectrum_part(spectrum, 0, num_bins),
+          row_part(spectra.Row(f), 0, num_bins);
+      AssertEqual(spectrum_part, row_part, 1.0e-03);
+    }
+  }
+}
+
+void UnitTestMelBanksCompute() {
+  for (int32 i = 0; i < 10; i++) {
+    MelBanksOptions mel_opts(10 + rand() % 30);
+    mel_opts.htk_mode = (rand() % 2 == 0);
+    FrameExtractionOptions frame_opts;
+    frame_opts.round_to_power_of_two = (rand() % 2 == 0);
+    BaseFloat vtln_warp = (rand() % 2 == 0 ? 1.0 : 1.1);
+    MelBanks mel_banks(mel_opts, frame_opts, vtln_warp);
+    int32 num_bins = mel_banks.NumBins(), num_frames = 1 + rand() % 20,
+        num_fft_bins = frame_opts.PaddedWindowSize() / 2 + 1;
+    KALDI_ASSERT(num_bins == mel_opts.num_bins);
+    Matrix<BaseFloat> power_spectra(num_frames, num_fft_bins),
+        mel_energies(num_frames, num_bins);
+    power_spectra.SetRandn();
+    power_spectra.ApplyPow(2.0);
+    mel_banks.Compute(power_spectra, &mel_energies);
+    Vector<BaseFloat> this_mel_energies;
+    for (int32 r = 0; r < num_frames; r++) {
+      mel_banks.Compute(power_spectra.Row(r), &this_mel_energies);
+      SubVector<BaseFloat> row(mel_energies, r);
+      AssertEqual(this_mel_energies, row, 1.0e-05);
+    }
+    // Each FFT bin contributes with a weight in [0, 1] to at most two mel
+    // bins, so the mel energies of a flat spectrum are bounded by the number
+    // of FFT bins.
+    Vector<BaseFloat> flat(num_fft_bins);
+    flat.Set(1.0);
+    mel_banks.Compute(flat, &this_mel_energies);
+    KALDI_ASSERT(this_mel_energies.Sum() <= 2.0 * num_fft_bins &&
+                 this_mel_energies.Min() > 0.0);
+  }
+}
+
+void UnitTestMfccConstCompute() {
+  for (int32 i = 0; i < 10; i++) {
+    MfccOptions opts;
+    opts.frame_opts.dither = 0.0;
+    opts.raw_energy = (rand() % 2 == 0);
+    opts.htk_compat = (rand() % 2 == 0);
+    opts.use_energy = (rand() % 2 == 0);
+    Mfcc mfcc(opts);
+    Vector<BaseFloat> wave(1000 + rand() % 5000);
+    wave.SetRandn();
+    wave.Scale(1000.0);
+    BaseFloat vtln_warp = (rand() % 2 == 0 ? 1.0 : 0.9);
+    Matrix<BaseFloat> feats1, feats2;
+    mfcc.Compute(wave, vtln_warp, &feats1, NULL);
+    const Mfcc &const_mfcc = mfcc;
+    const_mfcc.Compute(wave, vtln_warp, &feats2);
+    AssertEqual(feats1, feats2);
+
+    // Compare with the frame-by-frame computation.
+    Vector<BaseFloat> window, mel_energies, mfcc_row(opts.num_ceps);
+    MelBanks mel_banks(opts.mel_opts, opts.frame_opts, vtln_warp);
+    FeatureWindowFunction window_function(opts.frame_opts);
+    Matrix<BaseFloat> dct_matrix(opts.mel_opts.num_bins,
+                                 opts.mel_opts.num_bins);
+    ComputeDctMatrix(&dct_matrix);
+    Vector<BaseFloat> lifter_coeffs(opts.num_ceps);
+    ComputeLifterCoeffs(opts.cepstral_lifter, &lifter_coeffs);
+    for (int32 r = 0; r < feats1.NumRows(); r++) {
+      BaseFloat log_energy;
+      ExtractWindow(wave, r, opts.frame_opts, window_function, &window,
+                    &log_energy);
+      if (!opts.raw_energy)
+        log_energy = log(VecVec(window, window));
+      RealFft(&window, true);
+      ComputePowerSpectrum(&window);
+      mel_banks.Compute(window.Range(0, window.Dim() / 2 + 1), &mel_energies);
+      mel_energies.ApplyLog();
+      mfcc_row.AddMatVec(1.0, dct_matrix.Range(0, opts.num_ceps, 0,
+                                               opts.mel_opts.num_bins),
+                         kNoTrans, mel_energies, 0.0);
+      mfcc_row.MulElements(lifter_coeffs);
+      if (opts.use_energy)
+        mfcc_row(0) = log_energy;
+      if (opts.htk_compat) {
+        BaseFloat energy = mfcc_row(0) * (opts.use_energy ? 1.0 : M_SQRT2);
+        for (int32 i = 0; i + 1 < opts.num_ceps; i++)
+          mfcc_row(i) = mfcc_row(i + 1);
+        mfcc_row(opts.num_ceps - 1) = energy;
+      }
+      SubVector<BaseFloat> row(feats1, r);
+      AssertEqual(mfcc_row, row, 1.0e-03);
+    }
+  }
+}
+
 
 }
 
@@ -101,6 +241,9 @@ int main() {
   using namespace kaldi;
   try {
     UnitTestOnlineCmvn();
+    UnitTestExtractWindows();
+    UnitTestMelBanksCompute();
+    UnitTestMfccConstCompute();
     std::cout << "Tests succeeded.\n";
     return 0;
   } catch (const std::exception &e) {
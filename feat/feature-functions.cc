@@ -84,26 +84,19 @@ FeatureWindowFunction::FeatureWindowFunction(const FrameExtractionOptions &opts)
   }
 }
 
-// ExtractWindow extracts a windowed frame of waveform with a power-of-two,
-// padded size.  It does mean subtraction, pre-emphasis and dithering as
-// requested.
-
-void ExtractWindow(const VectorBase<BaseFloat> &wave,
-                   int32 f,  // with 0 <= f < NumFrames(feats, opts)
-                   const FrameExtractionOptions &opts,
-                   const FeatureWindowFunction &window_function,
-                   Vector<BaseFloat> *window,
-                   BaseFloat *log_energy_pre_window) {
+// Copies the samples of frame f of the waveform into "wave_part", which
+// must have dimension opts.WindowSize(); no other processing is done.
+static void ExtractWaveformPart(const VectorBase<BaseFloat> &wave,
+                                int32 f,
+                                const FrameExtractionOptions &opts,
+                                VectorBase<BaseFloat> *wave_part) {
   int32 frame_shift = opts.WindowShift();
   int32 frame_length = opts.WindowSize();
-  KALDI_ASSERT(window_function.window.Dim() == frame_length);
-  KALDI_ASSERT(frame_shift != 0 && frame_length != 0);
-
-  Vector<BaseFloat> wave_part(frame_length);
+  KALDI_ASSERT(wave_part->Dim() == frame_length);
   if (opts.snip_edges) {
     int32 start = frame_shift*f, end = start + frame_length;
     KALDI_ASSERT(start >= 0 && end <= wave.Dim());
-    wave_part.CopyFromVec(wave.Range(start, frame_length));
+    wave_part->CopyFromVec(wave.Range(start, frame_length));
   } else {
     // If opts.snip_edges = false, we allow the frames to go slightly over the
     // edges of the file; we'll extend the data by reflection.
@@ -115,7 +108,7 @@ void ExtractWindow(const VectorBase<BaseFloat> &wave,
         length_limited = end_limited - begin_limited;
 
     // Copy the main part.  Usually this will be the entire window.
-    wave_part.Range(begin_limited - begin, length_limited).
+    wave_part->Range(begin_limited - begin, length_limited).
         CopyFromVec(wave.Range(begin_limited, length_limited));
     
     // Deal with any end effects by reflection, if needed.  This code will
@@ -125,7 +118,7 @@ void ExtractWindow(const VectorBase<BaseFloat> &wave,
       // The next statement will only have an effect in the case of files
       // shorter than a single frame, it's to avoid a crash in those cases.
       reflected_f = reflected_f % wave.Dim(); 
-      wave_part(f - begin) = wave(reflected_f);
+      (*wave_part)(f - begin) = wave(reflected_f);
     }
     for (int32 f = wave.Dim(); f < end; f++) {
       int32 distance_to_end = f - wave.Dim();
@@ -133,9 +126,25 @@ void ExtractWindow(const VectorBase<BaseFloat> &wave,
       // shorter than a single frame, it's to avoid a crash in those cases.
       distance_to_end = distance_to_end % wave.Dim();
       int32 reflected_f = wave.Dim() - 1 - distance_to_end;
-      wave_part(f - begin) = wave(reflected_f);
+      (*wave_part)(f - begin) = wave(reflected_f);
     }
   }
+}
+
+// ExtractWindow extracts a windowed frame of waveform with a power-of-two,
+// padded size.  It does mean subtraction, pre-emphasis and dithering as
+// requested.
+
+void ExtractWindow(const VectorBase<BaseFloat> &wave,
+                   int32 f,  // with 0 <= f < NumFrames(feats, opts)
+                   const FrameExtractionOptions &opts,
+                   const FeatureWindowFunction &window_function,
+                   Vector<BaseFloat> *window,
+                   BaseFloat *log_energy_pre_window) {
+  int32 frame_shift = opts.WindowShift();
+  int32 frame_length = opts.WindowSize();
+  KALDI_ASSERT(window_function.window.Dim() == frame_length);
+  KALDI_ASSERT(frame_shift != 0 && frame_length != 0);
   KALDI_ASSERT(window != NULL);
   int32 frame_length_padded = opts.PaddedWindowSize();
 
@@ -143,7 +152,7 @@ void ExtractWindow(const VectorBase<BaseFloat> &wave,
     window->Resize(frame_length_padded);
 
   SubVector<BaseFloat> window_part(*window, 0, frame_length);
-  window_part.CopyFromVec(wave_part);
+  ExtractWaveformPart(wave, f, opts, &window_part);
 
   if (opts.dither != 0.0) Dither(&window_part, opts.dither);
 
@@ -165,6 +174,57 @@ void ExtractWindow(const VectorBase<BaseFloat> &wave,
                          frame_length_padded-frame_length).SetZero();
 }
 
+void ExtractWindows(const VectorBase<BaseFloat> &wave,
+                    const FrameExtractionOptions &opts,
+                    const FeatureWindowFunction &window_function,
+                    Matrix<BaseFloat> *windows,
+                    Vector<BaseFloat> *log_energy_pre_window) {
+  int32 frame_shift = opts.WindowShift();
+  int32 frame_length = opts.WindowSize();
+  KALDI_ASSERT(window_function.window.Dim() == frame_length);
+  KALDI_ASSERT(frame_shift != 0 && frame_length != 0);
+  KALDI_ASSERT(windows != NULL);
+  int32 num_frames = NumFrames(wave.Dim(), opts),
+      frame_length_padded = opts.PaddedWindowSize();
+  if (num_frames == 0) {
+    windows->Resize(0, 0);
+    if (log_energy_pre_window != NULL)
+      log_energy_pre_window->Resize(0);
+    return;
+  }
+  // Resize() zeroes the matrix, so the padding is zero.
+  windows->Resize(num_frames, frame_length_padded);
+  SubMatrix<BaseFloat> frames(*windows, 0, num_frames, 0, frame_length);
+  for (int32 f = 0; f < num_frames; f++) {
+    SubVector<BaseFloat> frame(frames, f);
+    ExtractWaveformPart(wave, f, opts, &frame);
+    // Dithering is done frame by frame, as in ExtractWindow(), so we get the
+    // same random numbers in the same order.
+    if (opts.dither != 0.0) Dither(&frame, opts.dither);
+  }
+
+  if (opts.remove_dc_offset != 0.0) {
+    Vector<BaseFloat> frame_sums(num_frames);
+    frame_sums.AddColSumMat(1.0, frames, 0.0);
+    frames.AddVecToCols(-1.0 / frame_length, frame_sums);
+  }
+
+  if (log_energy_pre_window != NULL) {
+    log_energy_pre_window->Resize(num_frames, kUndefined);
+    log_energy_pre_window->AddDiagMat2(1.0, frames, kNoTrans, 0.0);
+    log_energy_pre_window->ApplyLog();
+  }
+
+  if (opts.preemph_coeff != 0.0) {
+    for (int32 f = 0; f < num_frames; f++) {
+      SubVector<BaseFloat> frame(frames, f);
+      Preemphasize(&frame, opts.preemph_coeff);
+    }
+  }
+
+  frames.MulColsVec(window_function.window);
+}
+
 void ExtractWaveformRemainder(const VectorBase<BaseFloat> &wave,
                               const FrameExtractionOptions &opts,
                               Vector<BaseFloat> *wave_remainder) {
@@ -205,6 +265,20 @@ void ComputePowerSpectrum(VectorBase<BaseFloat> *waveform) {
   // if the signal has been bandlimited sensibly this should be zero.
 }
 
+void ComputePowerSpectra(const SplitRadixRealFft<BaseFloat> *srfft,
+                         MatrixBase<BaseFloat> *windows) {
+  std::vector<BaseFloat> temp_buffer;
+  for (int32 r = 0; r < windows->NumRows(); r++) {
+    SubVector<BaseFloat> window(*windows, r);
+    if (srfft != NULL) {  // Compute FFT using the split-radix algorithm.
+      srfft->Compute(window.Data(), true, &temp_buffer);
+    } else {  // An alternative algorithm that works for non-powers-of-two.
+      RealFft(&window, true);
+    }
+    ComputePowerSpectrum(&window);
+  }
+}
+
 
 DeltaFeatures::DeltaFeatures(const DeltaFeaturesOptions &opts): opts_(opts) {
   KALDI_ASSERT(opts.order >= 0 && opts.order < 1000);  // just make sure we don't get binary junk.
@@ -153,6 +153,19 @@ void ExtractWindow(const VectorBase<BaseFloat> &wave,
                    Vector<BaseFloat> *window,
                    BaseFloat *log_energy_pre_window = NULL);
 
+/// ExtractWindows does the same as calling ExtractWindow() for each frame
+/// f = 0 ... NumFrames(wave.Dim(), opts) - 1, but the frames are put in the
+/// rows of *windows (which is resized to NumFrames(...) by
+/// opts.PaddedWindowSize()), and most of the processing is done on the
+/// whole matrix at once.  If log_energy_pre_window != NULL, it is resized to
+/// the number of frames and gets the log-energy of each frame before
+/// preemphasis and windowing.
+void ExtractWindows(const VectorBase<BaseFloat> &wave,
+                    const FrameExtractionOptions &opts,
+                    const FeatureWindowFunction &window_function,
+                    Matrix<BaseFloat> *windows,
+                    Vector<BaseFloat> *log_energy_pre_window = NULL);
+
 // ExtractWaveformRemainder is useful if the waveform is coming in segments.
 // It extracts the bit of the waveform at the end of this block that you
 // would have to append the next bit of waveform to, if you wanted to have
@@ -172,6 +185,15 @@ void ExtractWaveformRemainder(const VectorBase<BaseFloat> &wave,
 // remaining (n/2) - 1 elements are undefined at output.
 void ComputePowerSpectrum(VectorBase<BaseFloat> *complex_fft);
 
+/// ComputePowerSpectra does the FFT of each row of "windows" (e.g. as output
+/// by ExtractWindows()), followed by ComputePowerSpectrum(), so that at
+/// output the first (windows->NumCols() / 2) + 1 columns contain the power
+/// spectra.  It uses "srfft" if it is non-NULL (its dimension must then be
+/// windows->NumCols()), and RealFft() otherwise.  It is safe to call this
+/// from several threads at once with the same srfft object.
+void ComputePowerSpectra(const SplitRadixRealFft<BaseFloat> *srfft,
+                         MatrixBase<BaseFloat> *windows);
+
 
 
 inline void MaxNormalizeEnergy(Matrix<BaseFloat> *feats) {
@@ -44,6 +44,10 @@ Mfcc::Mfcc(const MfccOptions &opts)
   int32 padded_window_size = opts.frame_opts.PaddedWindowSize();
   if ((padded_window_size & (padded_window_size-1)) == 0)  // Is a power of two...
     srfft_ = new SplitRadixRealFft<BaseFloat>(padded_window_size);
+
+  // We cache the mel banks for no VTLN warping now, so that the const
+  // version of Compute() can use them.
+  GetMelBanks(1.0);
 }
 
 Mfcc::~Mfcc() {
@@ -74,52 +78,72 @@ void Mfcc::Compute(const VectorBase<BaseFloat> &wave,
                    Matrix<BaseFloat> *output,
                    Vector<BaseFloat> *wave_remainder) {
   KALDI_ASSERT(output != NULL);
-  int32 rows_out = NumFrames(wave.Dim(), opts_.frame_opts),
-      cols_out = opts_.num_ceps;
-  if (rows_out == 0)
+  if (NumFrames(wave.Dim(), opts_.frame_opts) == 0)
     KALDI_ERR << "No frames fit in file (#samples is " << wave.Dim() << ")";
-  output->Resize(rows_out, cols_out);
   if (wave_remainder != NULL)
     ExtractWaveformRemainder(wave, opts_.frame_opts, wave_remainder);
-  Vector<BaseFloat> window;  // windowed waveform.
-  Vector<BaseFloat> mel_energies;
-  for (int32 r = 0; r < rows_out; r++) {  // r is frame index..
-    BaseFloat log_energy;
-    ExtractWindow(wave, r, opts_.frame_opts, feature_window_function_, &window,
-                  (opts_.use_energy && opts_.raw_energy ? &log_energy : NULL));
+  ComputeInternal(wave, *GetMelBanks(vtln_warp), output);
+}
 
-    if (opts_.use_energy && !opts_.raw_energy)
-      log_energy = log(VecVec(window, window));
+void Mfcc::Compute(const VectorBase<BaseFloat> &wave,
+                   BaseFloat vtln_warp,
+                   Matrix<BaseFloat> *output) const {
+  std::map<BaseFloat, MelBanks*>::const_iterator iter =
+      mel_banks_.find(vtln_warp);
+  if (iter != mel_banks_.end()) {
+    ComputeInternal(wave, *(iter->second), output);
+  } else {
+    MelBanks mel_banks(opts_.mel_opts, opts_.frame_opts, vtln_warp);
+    ComputeInternal(wave, mel_banks, output);
+  }
+}
 
-    if (srfft_ != NULL)  // Compute FFT using the split-radix algorithm.
-      srfft_->Compute(window.Data(), true);
-    else  // An alternative algorithm that works for non-powers-of-two.
-      RealFft(&window, true);
+void Mfcc::ComputeInternal(const VectorBase<BaseFloat> &wave,
+                           const MelBanks &mel_banks,
+                           Matrix<BaseFloat> *output) const {
+  KALDI_ASSERT(output != NULL);
+  int32 rows_out = NumFrames(wave.Dim(), opts_.frame_opts),
+      cols_out = opts_.num_ceps, num_bins = opts_.mel_opts.num_bins;
+  if (rows_out == 0)
+    KALDI_ERR << "No frames fit in file (#samples is " << wave.Dim() << ")";
 
-    // Convert the FFT into a power spectrum.
-    ComputePowerSpectrum(&window);
-    SubVector<BaseFloat> power_spectrum(window, 0, window.Dim()/2 + 1);
+  Matrix<BaseFloat> windows;  // windowed waveform, one row per frame.
+  Vector<BaseFloat> log_energy;
+  ExtractWindows(wave, opts_.frame_opts, feature_window_function_, &windows,
+                 (opts_.use_energy && opts_.raw_energy ? &log_energy : NULL));
 
-    const MelBanks *this_mel_banks = GetMelBanks(vtln_warp);
-    this_mel_banks->Compute(power_spectrum, &mel_energies);
+  if (opts_.use_energy && !opts_.raw_energy) {
+    log_energy.Resize(rows_out, kUndefined);
+    log_energy.AddDiagMat2(1.0, windows, kNoTrans, 0.0);
+    log_energy.ApplyLog();
+  }
 
-    mel_energies.ApplyLog();  // take the log.
+  // Do the FFTs and convert them into power spectra.
+  ComputePowerSpectra(srfft_, &windows);
+  SubMatrix<BaseFloat> power_spectra(windows, 0, rows_out,
+                                     0, windows.NumCols() / 2 + 1);
 
-    SubVector<BaseFloat> this_mfcc(output->Row(r));
+  Matrix<BaseFloat> mel_energies(rows_out, num_bins, kUndefined);
+  mel_banks.Compute(power_spectra, &mel_energies);
+  mel_energies.ApplyLog();  // take the log.
 
-    // this_mfcc = dct_matrix_ * mel_energies [which now have log]
-    this_mfcc.AddMatVec(1.0, dct_matrix_, kNoTrans, mel_energies, 0.0);
+  // The DCT of all the frames is one matrix multiplication:
+  // output = mel_energies * dct_matrix_^T.
+  output->Resize(rows_out, cols_out, kUndefined);
+  output->AddMatMat(1.0, mel_energies, kNoTrans, dct_matrix_, kTrans, 0.0);
 
-    if (opts_.cepstral_lifter != 0.0)
-      this_mfcc.MulElements(lifter_coeffs_);
+  if (opts_.cepstral_lifter != 0.0)
+    output->MulColsVec(lifter_coeffs_);
 
-    if (opts_.use_energy) {
-      if (opts_.energy_floor > 0.0 && log_energy < log_energy_floor_)
-        log_energy = log_energy_floor_;
-      this_mfcc(0) = log_energy;
-    }
+  if (opts_.use_energy) {
+    if (opts_.energy_floor > 0.0)
+      log_energy.ApplyFloor(log_energy_floor_);
+    output->CopyColFromVec(log_energy, 0);
+  }
 
-    if (opts_.htk_compat) {
+  if (opts_.htk_compat) {
+    for (int32 r = 0; r < rows_out; r++) {
+      SubVector<BaseFloat> this_mfcc(*output, r);
       BaseFloat energy = this_mfcc(0);
       for (int32 i = 0; i < opts_.num_ceps-1; i++)
         this_mfcc(i) = this_mfcc(i+1);
@@ -132,9 +156,4 @@ void Mfcc::Compute(const VectorBase<BaseFloat> &wave,
   }
 }
 
-
-
-
-
-
 }  // namespace kaldi
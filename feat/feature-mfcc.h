@@ -100,8 +100,22 @@ class Mfcc {
                Matrix<BaseFloat> *output,
                Vector<BaseFloat> *wave_remainder = NULL);
 
+  /// This version of Compute() is const, so it may be called from several
+  /// threads at once on the same object (compute-mfcc-feats does this if
+  /// --num-threads > 1).  If the mel banks for this VTLN warp factor are not
+  /// already cached (those for no warping are computed in the constructor),
+  /// they are computed for this call only.
+  void Compute(const VectorBase<BaseFloat> &wave,
+               BaseFloat vtln_warp,
+               Matrix<BaseFloat> *output) const;
+
  private:
   const MelBanks *GetMelBanks(BaseFloat vtln_warp);
+  // Does the work of both versions of Compute(), computing all the frames
+  // of the utterance together.
+  void ComputeInternal(const VectorBase<BaseFloat> &wave,
+                       const MelBanks &mel_banks,
+                       Matrix<BaseFloat> *output) const;
   MfccOptions opts_;
   Vector<BaseFloat> lifter_coeffs_;
   Matrix<BaseFloat> dct_matrix_;  // matrix we left-multiply by to perform DCT.
@@ -98,8 +98,25 @@ void Plp::Compute(const VectorBase<BaseFloat> &wave,
   output->Resize(rows_out, cols_out);
   if (wave_remainder != NULL)
     ExtractWaveformRemainder(wave, opts_.frame_opts, wave_remainder);
-  Vector<BaseFloat> window;  // windowed waveform.
   int32 num_mel_bins = opts_.mel_opts.num_bins;
+
+  // Extract the windows of all the frames and compute their power spectra.
+  Matrix<BaseFloat> windows;  // windowed waveform, one row per frame.
+  Vector<BaseFloat> log_energies;
+  ExtractWindows(wave, opts_.frame_opts, feature_window_function_, &windows,
+                 (opts_.use_energy && opts_.raw_energy ? &log_energies : NULL));
+  if (opts_.use_energy && !opts_.raw_energy) {
+    log_energies.Resize(rows_out, kUndefined);
+    log_energies.AddDiagMat2(1.0, windows, kNoTrans, 0.0);
+    log_energies.ApplyLog();
+  }
+  ComputePowerSpectra(srfft_, &windows);
+  SubMatrix<BaseFloat> power_spectra(windows, 0, rows_out,
+                                     0, windows.NumCols() / 2 + 1);
+  Matrix<BaseFloat> all_mel_energies(rows_out, num_mel_bins, kUndefined);
+  GetMelBanks(vtln_warp)->Compute(power_spectra, &all_mel_energies);
+  const Vector<BaseFloat> &equal_loudness = *GetEqualLoudness(vtln_warp);
+
   Vector<BaseFloat> mel_energies(num_mel_bins);
   Vector<BaseFloat> mel_energies_duplicated(num_mel_bins+2);
   Vector<BaseFloat> autocorr_coeffs(opts_.lpc_order+1);
@@ -109,32 +126,14 @@ void Plp::Compute(const VectorBase<BaseFloat> &wave,
   Vector<BaseFloat> final_cepstrum(opts_.num_ceps);
   KALDI_ASSERT(opts_.num_ceps <= opts_.lpc_order+1);  // our num-ceps includes C0.
   for (int32 r = 0; r < rows_out; r++) {  // r is frame index..
-    BaseFloat log_energy;
-    ExtractWindow(wave, r, opts_.frame_opts,
-                  feature_window_function_, &window,
-                  (opts_.use_energy && opts_.raw_energy ? &log_energy : NULL));
-
-    if (opts_.use_energy && !opts_.raw_energy)
-      log_energy = log(VecVec(window, window));
-
-    if (srfft_ != NULL)  // Compute FFT using split-radix algorithm.
-      srfft_->Compute(window.Data(), true);
-    else  // An alternative algorithm that works for non-powers-of-two.
-      RealFft(&window, true);
-
-    // Convert the FFT into a power spectrum.
-    ComputePowerSpectrum(&window);  // elements 0 ... window.Dim()/2
-
-    SubVector<BaseFloat> power_spectrum(window, 0, window.Dim()/2 + 1);
-
-    const MelBanks *this_mel_banks = GetMelBanks(vtln_warp);
+    BaseFloat log_energy = (opts_.use_energy ? log_energies(r) : 0.0);
 
-    this_mel_banks->Compute(power_spectrum, &mel_energies);
+    mel_energies.CopyFromVec(all_mel_energies.Row(r));
 
     // HTK doesn't log the mel bank outputs for the PLPs' [HARDCODED]
     // mel_energies.ApplyLog();  // take the log.
 
-    mel_energies.MulElements(*GetEqualLoudness(vtln_warp));
+    mel_energies.MulElements(equal_loudness);
 
     mel_energies.ApplyPow(opts_.compress_factor);
 
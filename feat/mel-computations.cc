@@ -26,6 +26,14 @@
 #include "feat/mel-computations.h"
 #include "feat/feature-functions.h"
 
+// The inner products in MelBanks::ComputeFrame() are hand-vectorized with
+// SSE for single precision, if the compiler flags allow it (the default
+// flags in kaldi.mk include -msse -msse2).
+#if (KALDI_DOUBLEPRECISION == 0) && defined(__SSE__)
+#define KALDI_MEL_BANKS_SSE 1
+#include <xmmintrin.h>
+#endif
+
 namespace kaldi {
 
 
@@ -84,7 +92,10 @@ MelBanks::MelBanks(const MelBanksOptions &opts,
               << "low-freq " << low_freq << " and high-freq "
               << high_freq;
 
-  bins_.resize(num_bins);
+  first_index_.resize(num_bins);
+  weight_offsets_.resize(num_bins + 1);
+  weights_.clear();
+  max_fft_bin_ = 0;
   center_freqs_.Resize(num_bins);
 
   for (int32 bin = 0; bin < num_bins; bin++) {
@@ -123,20 +134,25 @@ MelBanks::MelBanks(const MelBanksOptions &opts,
     KALDI_ASSERT(first_index != -1 && last_index >= first_index
                  && "You may have set --num-mel-bins too large.");
                  
-    bins_[bin].first = first_index;
-    int32 size = last_index + 1 - first_index;
-    bins_[bin].second.Resize(size);
-    bins_[bin].second.CopyFromVec(this_bin.Range(first_index, size));
+    first_index_[bin] = first_index;
+    weight_offsets_[bin] = weights_.size();
+    weights_.insert(weights_.end(), this_bin.Data() + first_index,
+                    this_bin.Data() + last_index + 1);
+    max_fft_bin_ = std::max(max_fft_bin_, last_index + 1);
 
     // Replicate a bug in HTK, for testing purposes.
     if (opts.htk_mode && bin == 0 && mel_low_freq != 0.0)
-      bins_[bin].second(0) = 0.0;
+      weights_[weight_offsets_[bin]] = 0.0;
     
   }
+  weight_offsets_[num_bins] = weights_.size();
   if (debug_) {
-    for (size_t i = 0; i < bins_.size(); i++) {
-      KALDI_LOG << "bin " << i << ", offset = " << bins_[i].first
-                << ", vec = " << bins_[i].second;
+    for (int32 i = 0; i < num_bins; i++) {
+      int32 size = weight_offsets_[i + 1] - weight_offsets_[i];
+      KALDI_LOG << "bin " << i << ", offset = " << first_index_[i]
+                << ", vec = " << SubVector<BaseFloat>(
+                    const_cast<BaseFloat*>(&(weights_[weight_offsets_[i]])),
+                    size);
     }
   }
 }
@@ -216,26 +232,56 @@ BaseFloat MelBanks::VtlnWarpMelFreq(BaseFloat vtln_low_cutoff,  // upper+lower f
 }
 
 
-// "power_spectrum" contains fft energies.
-void MelBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
-                       Vector<BaseFloat> *mel_energies_out) const {
-  int32 num_bins = bins_.size();
-  if (mel_energies_out->Dim() != num_bins)
-    mel_energies_out->Resize(num_bins);
+// Returns the inner product of a and b, which have dimension n.
+static inline BaseFloat MelDotProduct(const BaseFloat *a, const BaseFloat *b,
+                                      int32 n) {
+  int32 i = 0;
+  BaseFloat sum = 0.0;
+#if defined(KALDI_MEL_BANKS_SSE)
+  if (n >= 4) {
+    __m128 sum4 = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4)
+      sum4 = _mm_add_ps(sum4, _mm_mul_ps(_mm_loadu_ps(a + i),
+                                         _mm_loadu_ps(b + i)));
+    sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+    sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+    sum = _mm_cvtss_f32(sum4);
+  }
+#endif
+  for (; i < n; i++)
+    sum += a[i] * b[i];
+  return sum;
+}
 
+void MelBanks::ComputeFrame(const BaseFloat *power_spectrum,
+                            BaseFloat *mel_energies) const {
+  int32 num_bins = first_index_.size();
+  const BaseFloat *weights = &(weights_[0]);
   for (int32 i = 0; i < num_bins; i++) {
-    int32 offset = bins_[i].first;
-    const Vector<BaseFloat> &v(bins_[i].second);
-    BaseFloat energy = VecVec(v, power_spectrum.Range(offset, v.Dim()));
+    int32 offset = weight_offsets_[i];
+    BaseFloat energy = MelDotProduct(weights + offset,
+                                     power_spectrum + first_index_[i],
+                                     weight_offsets_[i + 1] - offset);
     // HTK-like flooring- for testing purposes (we prefer dither)
     if (htk_mode_ && energy < 1.0) energy = 1.0; 
-    (*mel_energies_out)(i) = energy;
+    mel_energies[i] = energy;
     
     // The following assert was added due to a problem with OpenBlas that
     // we had at one point (it was a bug in that library).  Just to detect
     // it early.
-    KALDI_ASSERT(!KALDI_ISNAN((*mel_energies_out)(i)));
+    KALDI_ASSERT(!KALDI_ISNAN(energy));
   }
+}
+
+// "power_spectrum" contains fft energies.
+void MelBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
+                       Vector<BaseFloat> *mel_energies_out) const {
+  int32 num_bins = first_index_.size();
+  KALDI_ASSERT(power_spectrum.Dim() >= max_fft_bin_);
+  if (mel_energies_out->Dim() != num_bins)
+    mel_energies_out->Resize(num_bins);
+
+  ComputeFrame(power_spectrum.Data(), mel_energies_out->Data());
 
   if (debug_) {
     fprintf(stderr, "MEL BANKS:\n");
@@ -245,6 +291,16 @@ void MelBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
   }
 }
 
+void MelBanks::Compute(const MatrixBase<BaseFloat> &power_spectra,
+                       MatrixBase<BaseFloat> *mel_energies_out) const {
+  int32 num_frames = power_spectra.NumRows();
+  KALDI_ASSERT(power_spectra.NumCols() >= max_fft_bin_ &&
+               mel_energies_out->NumRows() == num_frames &&
+               mel_energies_out->NumCols() == NumBins());
+  for (int32 r = 0; r < num_frames; r++)
+    ComputeFrame(power_spectra.RowData(r), mel_energies_out->RowData(r));
+}
+
 void ComputeLifterCoeffs(BaseFloat Q, VectorBase<BaseFloat> *coeffs) {
   // Compute liftering coefficients (scaling on cepstral coeffs)
   // coeffs are numbered slightly differently from HTK: the zeroth
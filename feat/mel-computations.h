@@ -76,19 +76,38 @@ class MelBanks {
   void Compute(const VectorBase<BaseFloat> &fft_energies,
                Vector<BaseFloat> *mel_energies_out) const;
 
-  int32 NumBins() const { return bins_.size(); }
+  /// This version of Compute() does all the frames of an utterance at once:
+  /// each row of "fft_energies" is the power spectrum of one frame (it should
+  /// have at least as many columns as there are FFT bins used; see
+  /// ComputePowerSpectra()), and the corresponding row of "mel_energies_out",
+  /// which must have NumBins() columns, gets the mel energies.
+  void Compute(const MatrixBase<BaseFloat> &fft_energies,
+               MatrixBase<BaseFloat> *mel_energies_out) const;
+
+  int32 NumBins() const { return first_index_.size(); }
 
   // returns vector of central freq of each bin; needed by plp code.
   const Vector<BaseFloat> &GetCenterFreqs() const { return center_freqs_; }
 
  private:
+  // Computes the mel energies of one frame; "power_spectrum" must have
+  // space for all the FFT bins used and "mel_energies" for NumBins() values.
+  void ComputeFrame(const BaseFloat *power_spectrum,
+                    BaseFloat *mel_energies) const;
+
   // center frequencies of bins, numbered from 0 ... num_bins-1.
   // Needed by GetCenterFreqs().
   Vector<BaseFloat> center_freqs_;
 
-  // the "bins_" vector is a vector, one for each bin, of a pair:
-  // (the first nonzero fft-bin), (the vector of weights).
-  std::vector<std::pair<int32, Vector<BaseFloat> > > bins_;
+  // The filterbank is stored in a compressed sparse row format, with one
+  // row per mel bin.  The nonzero weights of each bin are for consecutive
+  // FFT bins, so we only store the first FFT bin of each.  For bin i, the
+  // weights are weights_[weight_offsets_[i] ... weight_offsets_[i+1] - 1],
+  // and they apply to FFT bins first_index_[i], first_index_[i] + 1, ...
+  std::vector<int32> first_index_;  // dimension is the number of bins.
+  std::vector<int32> weight_offsets_;  // dimension is number of bins + 1.
+  std::vector<BaseFloat> weights_;  // all the weights, bin by bin.
+  int32 max_fft_bin_;  // one plus the largest FFT bin index used.
 
   bool debug_;
   bool htk_mode_;
@@ -43,6 +43,7 @@
 #ifndef KALDI_FEAT_WAVE_READER_H_
 #define KALDI_FEAT_WAVE_READER_H_
 
+#include <algorithm>
 #include <cstring>
 
 #include "base/kaldi-types.h"
@@ -89,6 +90,11 @@ class WaveData {
     samp_freq_ = 0.0;
   }
 
+  void Swap(WaveData *other) {
+    data_.Swap(&(other->data_));
+    std::swap(samp_freq_, other->samp_freq_);
+  }
+
  private:
   Matrix<BaseFloat> data_;
   BaseFloat samp_freq_;
@@ -131,6 +137,8 @@ class WaveHolder {
 
   const T &Value() { return t_; }
 
+  void Swap(WaveHolder *other) { t_.Swap(&(other->t_)); }
+
   WaveHolder &operator = (const WaveHolder &other) {
     t_.CopyFrom(other.t_);
     return *this;
@@ -22,14 +22,95 @@
 #include "util/common-utils.h"
 #include "feat/feature-fbank.h"
 #include "feat/wave-reader.h"
+#include "thread/kaldi-task-sequence.h"
+
+
+namespace kaldi {
+
+// This class computes the features of one utterance; it is used with
+// TaskSequencer, so the computation may happen in a separate thread (see
+// kaldi-task-sequence.h), but the destructor, which writes the output, is
+// called in the same order as the utterances were read.
+class FbankComputeTask {
+ public:
+  FbankComputeTask(const Fbank &fbank,
+                   const FbankOptions &opts,
+                   const std::string &utt,
+                   const VectorBase<BaseFloat> &waveform,
+                   BaseFloat vtln_warp,
+                   bool subtract_mean,
+                   BaseFloatMatrixWriter *kaldi_writer,
+                   TableWriter<HtkMatrixHolder> *htk_writer,
+                   int32 *num_success):
+      fbank_(fbank), opts_(opts), utt_(utt), waveform_(waveform),
+      vtln_warp_(vtln_warp), subtract_mean_(subtract_mean),
+      kaldi_writer_(kaldi_writer), htk_writer_(htk_writer),
+      num_success_(num_success), computed_(false) { }
+
+  void operator () () {
+    try {
+      fbank_.Compute(waveform_, vtln_warp_, &features_);
+    } catch (...) {
+      return;
+    }
+    if (subtract_mean_) {
+      Vector<BaseFloat> mean(features_.NumCols());
+      mean.AddRowSumMat(1.0, features_);
+      mean.Scale(1.0 / features_.NumRows());
+      features_.AddVecToRows(-1.0, mean);
+    }
+    computed_ = true;
+  }
 
+  ~FbankComputeTask() {  // Produces the output.
+    if (!computed_) {
+      KALDI_WARN << "Failed to compute features for utterance "
+                 << utt_;
+      return;
+    }
+    if (kaldi_writer_ != NULL) {
+      kaldi_writer_->Write(utt_, features_);
+    } else {
+      std::pair<Matrix<BaseFloat>, HtkHeader> p;
+      p.first.Swap(&features_);
+      HtkHeader header = {
+        p.first.NumRows(),
+        100000,  // 10ms shift
+        static_cast<int16>(sizeof(float)*p.first.NumCols()),
+        static_cast<uint16>(007 | // FBANK
+        (opts_.use_energy ? 0100 : 020000)) // energy; otherwise c0
+      };
+      p.second = header;
+      htk_writer_->Write(utt_, p);
+    }
+    KALDI_VLOG(2) << "Processed features for key " << utt_;
+    (*num_success_)++;
+  }
+
+ private:
+  const Fbank &fbank_;
+  const FbankOptions &opts_;
+  std::string utt_;
+  Vector<BaseFloat> waveform_;
+  BaseFloat vtln_warp_;
+  bool subtract_mean_;
+  BaseFloatMatrixWriter *kaldi_writer_;
+  TableWriter<HtkMatrixHolder> *htk_writer_;
+  int32 *num_success_;
+  bool computed_;
+  Matrix<BaseFloat> features_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
     using namespace kaldi;
     const char *usage =
         "Create Mel-filter bank (FBANK) feature files.\n"
-        "Usage:  compute-fbank-feats [options...] <wav-rspecifier> <feats-wspecifier>\n";
+        "Usage:  compute-fbank-feats [options...] <wav-rspecifier> <feats-wspecifier>\n"
+        "With --num-threads > 1, utterances are processed in parallel (the output\n"
+        "order is unchanged, but with --dither the random numbers will differ).\n";
 
     // construct all the global objects
     ParseOptions po(usage);
@@ -42,6 +123,7 @@ int main(int argc, char *argv[]) {
     BaseFloat min_duration = 0.0;
     // Define defaults for gobal options
     std::string output_format = "kaldi";
+    TaskSequencerConfig sequencer_config;
 
     // Register the option struct
     fbank_opts.Register(&po);
@@ -53,6 +135,7 @@ int main(int argc, char *argv[]) {
     po.Register("utt2spk", &utt2spk_rspecifier, "Utterance to speaker-id map (if doing VTLN and you have warps per speaker)");
     po.Register("channel", &channel, "Channel to extract (-1 -> expect mono, 0 -> left, 1 -> right)");
     po.Register("min-duration", &min_duration, "Minimum duration of segments to process (in seconds).");
+    sequencer_config.Register(&po);
 
     // OPTION PARSING ..........................................................
     //
@@ -94,6 +177,9 @@ int main(int argc, char *argv[]) {
     }
 
     int32 num_utts = 0, num_success = 0;
+    // The features are computed in parallel if --num-threads > 1; this uses
+    // the const version of Fbank::Compute(), which is thread-safe.
+    TaskSequencer<FbankComputeTask> sequencer(sequencer_config);
     for (; !reader.Done(); reader.Next()) {
       num_utts++;
       std::string utt = reader.Key();
@@ -139,42 +225,14 @@ int main(int argc, char *argv[]) {
                   << "option).  Utterance is " << utt;
 
       SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
-      Matrix<BaseFloat> features;
-      try {
-        fbank.Compute(waveform, vtln_warp_local, &features, NULL);
-      } catch (...) {
-        KALDI_WARN << "Failed to compute features for utterance "
-                   << utt;
-        continue;
-      }
-      if (subtract_mean) {
-        Vector<BaseFloat> mean(features.NumCols());
-        mean.AddRowSumMat(1.0, features);
-        mean.Scale(1.0 / features.NumRows());
-        for (int32 i = 0; i < features.NumRows(); i++)
-          features.Row(i).AddVec(-1.0, mean);
-      }
-      if (output_format == "kaldi") {
-        kaldi_writer.Write(utt, features);
-      } else {
-        std::pair<Matrix<BaseFloat>, HtkHeader> p;
-        p.first.Resize(features.NumRows(), features.NumCols());
-        p.first.CopyFromMat(features);
-        HtkHeader header = {
-          features.NumRows(),
-          100000,  // 10ms shift
-          static_cast<int16>(sizeof(float)*features.NumCols()),
-          static_cast<uint16>(007 | // FBANK
-          (fbank_opts.use_energy ? 0100 : 020000)) // energy; otherwise c0
-        };
-        p.second = header;
-        htk_writer.Write(utt, p);
-      }
+      sequencer.Run(new FbankComputeTask(
+          fbank, fbank_opts, utt, waveform, vtln_warp_local, subtract_mean,
+          (output_format == "kaldi" ? &kaldi_writer : NULL), &htk_writer,
+          &num_success));
       if (num_utts % 10 == 0)
         KALDI_LOG << "Processed " << num_utts << " utterances";
-      KALDI_VLOG(2) << "Processed features for key " << utt;
-      num_success++;
     }
+    sequencer.Wait();
     KALDI_LOG << " Done " << num_success << " out of " << num_utts
               << " utterances.";
     return (num_success != 0 ? 0 : 1);
@@ -0,0 +1,72 @@
+// fstbin/fstmakedecodefst.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "fst/fstlib.h"
+#include "fstext/decode-fst.h"
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+    using kaldi::int32;
+
+    const char *usage =
+        "Converts a decoding graph (e.g. HCLG.fst) to the \"decode\" FST type,\n"
+        "in which the input-epsilon arcs of each state come first and which is\n"
+        "memory-mapped when read by the decoding programs, so that processes\n"
+        "using the same graph on a machine share its memory.  The output should\n"
+        "be a file, not a pipe, for the memory-mapping to be possible.\n"
+        "\n"
+        "Usage:  fstmakedecodefst [in.fst [out.fst] ]\n"
+        "E.g.: fstmakedecodefst exp/tri1/graph/HCLG.fst exp/tri1/graph/HCLG.dfst\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() > 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string fst_rxfilename = po.GetOptArg(1),
+        fst_wxfilename = po.GetOptArg(2);
+
+    Fst<StdArc> *fst = ReadFstKaldiGeneric(fst_rxfilename);
+    DecodeFst decode_fst(*fst);
+    delete fst;
+
+    if (fst_wxfilename == "") fst_wxfilename = "-";
+    bool write_binary = true, write_header = false;
+    Output ko(fst_wxfilename, write_binary, write_header);
+    if (!decode_fst.Write(ko.Stream(),
+                          FstWriteOptions(PrintableWxfilename(fst_wxfilename))))
+      KALDI_ERR << "Error writing FST to "
+                << PrintableWxfilename(fst_wxfilename);
+    KALDI_LOG << "Wrote decode FST with " << decode_fst.NumStates()
+              << " states.";
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
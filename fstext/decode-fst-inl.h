@@ -0,0 +1,265 @@
+// fstext/decode-fst-inl.h
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FSTEXT_DECODE_FST_INL_H_
+#define KALDI_FSTEXT_DECODE_FST_INL_H_
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+// Do not include this file directly.  It is included by decode-fst.h.
+
+namespace fst {
+
+/// \addtogroup fst_extensions
+///  @{
+
+template<class A>
+DecodeFstImpl<A>::DecodeFstImpl():
+    states_(NULL), arcs_(NULL), num_states_(0), num_arcs_(0),
+    start_(kNoStateId), mapped_file_(NULL) {
+  SetType("decode");
+  SetProperties(kNullProperties | kStaticProperties);
+}
+
+template<class A>
+DecodeFstImpl<A>::DecodeFstImpl(const Fst<Arc> &fst):
+    states_(NULL), arcs_(NULL), num_states_(0), num_arcs_(0),
+    start_(kNoStateId), mapped_file_(NULL) {
+  SetType("decode");
+  SetInputSymbols(fst.InputSymbols());
+  SetOutputSymbols(fst.OutputSymbols());
+  start_ = fst.Start();
+  num_states_ = CountStates(fst);
+  state_vec_.resize(num_states_);
+  for (StateIterator<Fst<Arc> > siter(fst); !siter.Done(); siter.Next()) {
+    StateId s = siter.Value();
+    KALDI_ASSERT(s < num_states_);
+    State &state = state_vec_[s];
+    state.final = fst.Final(s);
+    state.num_input_epsilons = 0;
+    state.num_output_epsilons = 0;
+    state.num_arcs = 0;
+    state.arc_offset = arc_vec_.size();
+    // First the input-epsilon arcs, then the rest, keeping the order within
+    // each group.
+    for (int32 pass = 0; pass < 2; pass++) {
+      for (ArcIterator<Fst<Arc> > aiter(fst, s); !aiter.Done(); aiter.Next()) {
+        const Arc &arc = aiter.Value();
+        if ((arc.ilabel == 0) != (pass == 0)) continue;
+        arc_vec_.push_back(arc);
+        state.num_arcs++;
+        if (arc.ilabel == 0) state.num_input_epsilons++;
+        if (arc.olabel == 0) state.num_output_epsilons++;
+      }
+    }
+  }
+  num_arcs_ = arc_vec_.size();
+  states_ = (state_vec_.empty() ? NULL : &(state_vec_[0]));
+  arcs_ = (arc_vec_.empty() ? NULL : &(arc_vec_[0]));
+
+  uint64 props = fst.Properties(kCopyProperties, false);
+  if (!(props & kILabelSorted)) {
+    // Moving the input-epsilon arcs to the front may have changed whether the
+    // arcs are sorted.  (If they were sorted on input label, the epsilons were
+    // already at the front and nothing moved).
+    props &= ~(kILabelSorted | kNotILabelSorted |
+               kOLabelSorted | kNotOLabelSorted);
+  }
+  SetProperties(props | kStaticProperties);
+}
+
+template<class A>
+bool DecodeFstImpl<A>::ReadHeaderAndPadding(std::istream &is,
+                                            const FstReadOptions &opts) {
+  FstHeader hdr;
+  if (!ReadHeader(is, opts, kFileVersion, &hdr))
+    return false;
+  start_ = hdr.Start();
+  num_states_ = hdr.NumStates();
+  num_arcs_ = hdr.NumArcs();
+  int32 pad;
+  is.read(reinterpret_cast<char*>(&pad), sizeof(pad));
+  if (!is || num_states_ < 0 || num_arcs_ < 0 || pad < 0 ||
+      pad >= kFileAlign) {
+    LOG(ERROR) << "DecodeFst::Read: read failed or bad header: "
+               << opts.source;
+    return false;
+  }
+  is.ignore(pad);
+  return !is.fail();
+}
+
+template<class A>
+DecodeFstImpl<A> *DecodeFstImpl<A>::Read(std::istream &is,
+                                         const FstReadOptions &opts) {
+  DecodeFstImpl *impl = new DecodeFstImpl();
+  if (!impl->ReadHeaderAndPadding(is, opts)) {
+    delete impl;
+    return NULL;
+  }
+  impl->state_vec_.resize(impl->num_states_);
+  impl->arc_vec_.resize(impl->num_arcs_);
+  if (impl->num_states_ > 0)
+    is.read(reinterpret_cast<char*>(&(impl->state_vec_[0])),
+            impl->num_states_ * sizeof(State));
+  if (impl->num_arcs_ > 0)
+    is.read(reinterpret_cast<char*>(&(impl->arc_vec_[0])),
+            impl->num_arcs_ * sizeof(Arc));
+  if (!is) {
+    LOG(ERROR) << "DecodeFst::Read: read failed: " << opts.source;
+    delete impl;
+    return NULL;
+  }
+  impl->states_ = (impl->num_states_ > 0 ? &(impl->state_vec_[0]) : NULL);
+  impl->arcs_ = (impl->num_arcs_ > 0 ? &(impl->arc_vec_[0]) : NULL);
+  return impl;
+}
+
+template<class A>
+DecodeFstImpl<A> *DecodeFstImpl<A>::ReadMapped(const std::string &filename) {
+  kaldi::MappedFile *file = new kaldi::MappedFile();
+  if (!file->Open(filename)) {
+    delete file;
+    return NULL;
+  }
+  DecodeFstImpl *impl = new DecodeFstImpl();
+  impl->mapped_file_ = file;  // so it's deleted with impl.
+  kaldi::MemoryInputBuf buf(file->Data(), file->Size());
+  std::istream is(&buf);
+  FstReadOptions opts(filename);
+  if (!impl->ReadHeaderAndPadding(is, opts)) {
+    delete impl;
+    return NULL;
+  }
+  size_t offset = is.tellg(),
+      states_size = impl->num_states_ * sizeof(State),
+      arcs_size = impl->num_arcs_ * sizeof(Arc);
+  if (offset + states_size + arcs_size > file->Size()) {
+    LOG(ERROR) << "DecodeFst::Read: file is too short: " << filename;
+    delete impl;
+    return NULL;
+  }
+  const char *data = file->Data() + offset;
+  if (offset % kFileAlign == 0) {
+    // The normal case: point straight into the mapped file.  (The mapping
+    // itself starts on a page boundary.)
+    impl->states_ = reinterpret_cast<const State*>(data);
+    impl->arcs_ = reinterpret_cast<const Arc*>(data + states_size);
+  } else {
+    // This can only happen if the header was not written together with the
+    // data, which we don't expect; copy the data so it's aligned.
+    impl->state_vec_.resize(impl->num_states_);
+    impl->arc_vec_.resize(impl->num_arcs_);
+    if (states_size > 0)
+      memcpy(&(impl->state_vec_[0]), data, states_size);
+    if (arcs_size > 0)
+      memcpy(&(impl->arc_vec_[0]), data + states_size, arcs_size);
+    impl->states_ = (states_size > 0 ? &(impl->state_vec_[0]) : NULL);
+    impl->arcs_ = (arcs_size > 0 ? &(impl->arc_vec_[0]) : NULL);
+    delete impl->mapped_file_;
+    impl->mapped_file_ = NULL;
+  }
+  return impl;
+}
+
+template<class A>
+bool DecodeFstImpl<A>::Write(std::ostream &os,
+                             const FstWriteOptions &opts) const {
+  FstHeader hdr;
+  hdr.SetStart(start_);
+  hdr.SetNumStates(num_states_);
+  hdr.SetNumArcs(num_arcs_);
+  // We write the header to a string first so we know how much padding we need
+  // to align the data that follows.
+  std::ostringstream header_os;
+  WriteHeader(header_os, opts, kFileVersion, &hdr);
+  std::string header = header_os.str();
+  int32 pad = (kFileAlign - (header.size() + sizeof(int32)) % kFileAlign) %
+      kFileAlign;
+  char zeros[kFileAlign] = { 0 };
+  os.write(header.data(), header.size());
+  os.write(reinterpret_cast<const char*>(&pad), sizeof(pad));
+  os.write(zeros, pad);
+  if (num_states_ > 0)
+    os.write(reinterpret_cast<const char*>(states_),
+             num_states_ * sizeof(State));
+  if (num_arcs_ > 0)
+    os.write(reinterpret_cast<const char*>(arcs_), num_arcs_ * sizeof(Arc));
+  os.flush();
+  if (!os) {
+    LOG(ERROR) << "DecodeFst::Write: write failed: " << opts.source;
+    return false;
+  }
+  return true;
+}
+
+template<class A>
+bool DecodeFstTpl<A>::Write(const string &filename) const {
+  std::ofstream os(filename.c_str(),
+                   std::ios_base::out | std::ios_base::binary);
+  if (!os) {
+    LOG(ERROR) << "DecodeFst::Write: can't open file: " << filename;
+    return false;
+  }
+  return Write(os, FstWriteOptions(filename));
+}
+
+
+inline Fst<StdArc> *ReadFstKaldiGeneric(std::string rxfilename) {
+  if (rxfilename == "") rxfilename = "-"; // interpret "" as stdin,
+  // for compatibility with OpenFst conventions.
+  kaldi::Input ki(rxfilename);
+  FstHeader hdr;
+  if (!hdr.Read(ki.Stream(), rxfilename))
+    KALDI_ERR << "Reading FST: error reading FST header from "
+              << kaldi::PrintableRxfilename(rxfilename);
+  if (hdr.ArcType() != StdArc::Type())
+    KALDI_ERR << "FST with arc type " << hdr.ArcType() << " not supported, in "
+              << kaldi::PrintableRxfilename(rxfilename);
+  FstReadOptions ropts("<unspecified>", &hdr);
+  Fst<StdArc> *fst = NULL;
+  if (hdr.FstType() == "vector") {
+    fst = VectorFst<StdArc>::Read(ki.Stream(), ropts);
+  } else if (hdr.FstType() == "const") {
+    fst = ConstFst<StdArc>::Read(ki.Stream(), ropts);
+  } else if (hdr.FstType() == "decode") {
+    if (kaldi::ClassifyRxfilename(rxfilename) == kaldi::kFileInput) {
+      // Memory-map it, so processes decoding with the same graph share it.
+      ki.Close();
+      fst = DecodeFst::Read(rxfilename);
+    } else {
+      fst = DecodeFst::Read(ki.Stream(), ropts);
+    }
+  } else {
+    KALDI_ERR << "FST with type " << hdr.FstType() << " not supported, in "
+              << kaldi::PrintableRxfilename(rxfilename);
+  }
+  if (!fst)
+    KALDI_ERR << "Could not read fst from "
+              << kaldi::PrintableRxfilename(rxfilename);
+  return fst;
+}
+
+/// @}
+
+}  // namespace fst
+
+#endif  // KALDI_FSTEXT_DECODE_FST_INL_H_
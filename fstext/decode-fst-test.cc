@@ -0,0 +1,137 @@
+// fstext/decode-fst-test.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cstdio>
+#include <sstream>
+
+#include "fstext/rand-fst.h"
+#include "fstext/decode-fst.h"
+
+
+namespace fst {
+
+// Checks that "dfst" has the same states and arcs as "fst", except that in
+// each state the input-epsilon arcs come first.
+void CheckDecodeFst(const VectorFst<StdArc> &fst, const DecodeFst &dfst) {
+  typedef StdArc::StateId StateId;
+  assert(dfst.Type() == "decode");
+  assert(dfst.Start() == fst.Start());
+  assert(dfst.NumStates() == fst.NumStates());
+  for (StateId s = 0; s < fst.NumStates(); s++) {
+    assert(dfst.Final(s) == fst.Final(s));
+    assert(dfst.NumArcs(s) == fst.NumArcs(s));
+    assert(dfst.NumInputEpsilons(s) == fst.NumInputEpsilons(s));
+    assert(dfst.NumOutputEpsilons(s) == fst.NumOutputEpsilons(s));
+    std::vector<StdArc> arcs;
+    for (int32 pass = 0; pass < 2; pass++)
+      for (ArcIterator<VectorFst<StdArc> > aiter(fst, s); !aiter.Done();
+           aiter.Next())
+        if ((aiter.Value().ilabel == 0) == (pass == 0))
+          arcs.push_back(aiter.Value());
+    const StdArc *dfst_arcs = dfst.Arcs(s);
+    size_t i = 0;
+    for (ArcIterator<DecodeFst> aiter(dfst, s); !aiter.Done();
+         aiter.Next(), i++) {
+      const StdArc &arc = aiter.Value();
+      assert(&arc == dfst_arcs + i);
+      assert(arc.ilabel == arcs[i].ilabel && arc.olabel == arcs[i].olabel &&
+             arc.nextstate == arcs[i].nextstate &&
+             arc.weight == arcs[i].weight);
+      assert((arc.ilabel == 0) == (i < dfst.NumInputEpsilons(s)));
+    }
+    assert(i == arcs.size());
+  }
+  assert(RandEquivalent(fst, dfst, 5, 0.01, rand(), 10));
+}
+
+void TestDecodeFst() {
+  for (int32 i = 0; i < 10; i++) {
+    RandFstOptions opts;
+    opts.acyclic = (i % 2 == 0);
+    VectorFst<StdArc> *fst = RandFst<StdArc>(opts);
+    if (i % 3 == 0)
+      ArcSort(fst, ILabelCompare<StdArc>());
+    DecodeFst dfst(*fst);
+    CheckDecodeFst(*fst, dfst);
+    if (fst->Properties(kILabelSorted, false) != 0)
+      assert(dfst.Properties(kILabelSorted, false) != 0);
+
+    {  // Write and read back through a stream.
+      std::ostringstream os;
+      assert(dfst.Write(os, FstWriteOptions("<test>")));
+      std::istringstream is(os.str());
+      DecodeFst *dfst2 = DecodeFst::Read(is, FstReadOptions("<test>"));
+      assert(dfst2 != NULL);
+      CheckDecodeFst(*fst, *dfst2);
+      delete dfst2;
+    }
+    {  // Write to a file, memory-map it and copy the result.
+      std::string filename = "tmp.dfst";
+      assert(dfst.Write(filename));
+      DecodeFst *dfst2 = DecodeFst::Read(filename);
+      assert(dfst2 != NULL);
+      DecodeFst *dfst3 = dfst2->Copy();
+      delete dfst2;
+      CheckDecodeFst(*fst, *dfst3);
+      delete dfst3;
+      // And through the generic reading function.
+      Fst<StdArc> *fst4 = ReadFstKaldiGeneric(filename);
+      assert(fst4->Type() == "decode");
+      CheckDecodeFst(*fst, *static_cast<DecodeFst*>(fst4));
+      delete fst4;
+      std::remove(filename.c_str());
+    }
+    delete fst;
+  }
+}
+
+// Tests another arc type, and that the symbol tables are kept (the keyword
+// search index relies on the output symbol table).
+void TestDecodeFstLogArc() {
+  RandFstOptions opts;
+  VectorFst<LogArc> *fst = RandFst<LogArc>(opts);
+  SymbolTable symtab("test");
+  symtab.AddSymbol("<eps>", 0);
+  symtab.AddSymbol("a", 1);
+  fst->SetOutputSymbols(&symtab);
+  DecodeFstTpl<LogArc> dfst(*fst);
+  std::string filename = "tmp.dfst";
+  assert(dfst.Write(filename));
+  DecodeFstTpl<LogArc> *dfst2 = DecodeFstTpl<LogArc>::Read(filename);
+  assert(dfst2 != NULL);
+  assert(dfst2->NumStates() == fst->NumStates());
+  assert(dfst2->OutputSymbols() != NULL &&
+         dfst2->OutputSymbols()->Find(1) == "a");
+  assert(RandEquivalent(*fst, *dfst2, 5, 0.01, rand(), 10));
+  delete dfst2;
+  std::remove(filename.c_str());
+  delete fst;
+}
+
+} // end namespace fst
+
+int main() {
+  using namespace fst;
+  for (int i = 0; i < 2; i++) {
+    TestDecodeFst();
+    TestDecodeFstLogArc();
+  }
+  std::cout << "Test OK\n";
+}
@@ -0,0 +1,281 @@
+// fstext/decode-fst.h
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FSTEXT_DECODE_FST_H_
+#define KALDI_FSTEXT_DECODE_FST_H_
+
+#include <fst/fstlib.h>
+#include <fst/fst-decl.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/kaldi-io.h"
+#include "util/kaldi-mmap.h"
+
+namespace fst {
+
+/// \addtogroup fst_extensions
+///  @{
+
+/*
+   DecodeFst is a read-only FST type (its type name is "decode") that is
+   designed for the decoding graph (HCLG.fst).  The arcs of each state are
+   stored contiguously, with the input-epsilon (non-emitting) arcs first and
+   the emitting arcs after them, so a decoder can go straight to the arcs it
+   needs: state s has NumInputEpsilons(s) non-emitting arcs, starting at
+   Arcs(s), followed by NumArcs(s) - NumInputEpsilons(s) emitting ones.
+
+   The on-disk format is an OpenFst header followed by the state and arc
+   arrays exactly as they are laid out in memory.  When a DecodeFst is read
+   from a file with Read(filename) [or with ReadFstKaldiGeneric()], the file
+   is memory-mapped rather than read, so startup is almost instant and all
+   the processes on a machine that decode with the same graph share a single
+   copy of it in the page cache.
+
+   Use the program fstmakedecodefst to convert a graph to this format.  Like
+   ConstFst, the data is stored in the native byte order.
+
+   The class is templated on the arc type (DecodeFst is the version for
+   StdArc) so that other large, read-only FSTs, such as the keyword search
+   index, can be stored the same way.  The arc type must be a plain struct
+   (as ArcTpl<Weight> is, for the weights we use) as it is copied byte for byte.
+ */
+
+/// The per-state information in a DecodeFst, as it is stored on disk.
+template<class W>
+struct DecodeFstState {
+  W final;  // Final weight; Zero() if not final.
+  int32 num_input_epsilons;  // Number of input-epsilon arcs.
+  int32 num_output_epsilons;  // Number of output-epsilon arcs.
+  int32 num_arcs;  // Total number of arcs.
+  int64 arc_offset;  // Index of the first arc of this state in the arcs.
+};
+
+
+template<class A>
+class DecodeFstImpl : public FstImpl<A> {
+ public:
+  using FstImpl<A>::SetType;
+  using FstImpl<A>::SetProperties;
+  using FstImpl<A>::Properties;
+  using FstImpl<A>::SetInputSymbols;
+  using FstImpl<A>::SetOutputSymbols;
+  using FstImpl<A>::ReadHeader;
+  using FstImpl<A>::WriteHeader;
+
+  typedef A Arc;
+  typedef typename Arc::Weight Weight;
+  typedef typename Arc::StateId StateId;
+  typedef DecodeFstState<Weight> State;
+
+  static const int32 kFileVersion = 1;
+  // The state and arc arrays start at a multiple of this many bytes from the
+  // start of the FST (the start of the file, if it is memory-mapped).
+  static const int32 kFileAlign = 16;
+
+  DecodeFstImpl();
+
+  /// Converts a generic FST.
+  explicit DecodeFstImpl(const Fst<Arc> &fst);
+
+  ~DecodeFstImpl() { delete mapped_file_; }
+
+  StateId Start() const { return start_; }
+  Weight Final(StateId s) const { return states_[s].final; }
+  StateId NumStates() const { return num_states_; }
+  size_t NumArcs(StateId s) const { return states_[s].num_arcs; }
+  size_t NumInputEpsilons(StateId s) const {
+    return states_[s].num_input_epsilons;
+  }
+  size_t NumOutputEpsilons(StateId s) const {
+    return states_[s].num_output_epsilons;
+  }
+  const Arc *Arcs(StateId s) const { return arcs_ + states_[s].arc_offset; }
+
+  void InitStateIterator(StateIteratorData<Arc> *data) const {
+    data->base = NULL;
+    data->nstates = num_states_;
+  }
+
+  void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const {
+    data->base = NULL;
+    data->arcs = Arcs(s);
+    data->narcs = NumArcs(s);
+    data->ref_count = NULL;
+  }
+
+  /// Reads the FST into memory from a stream.  If opts.header is non-NULL
+  /// the header is assumed to have been read already.  Returns NULL on error.
+  static DecodeFstImpl *Read(std::istream &is, const FstReadOptions &opts);
+
+  /// Memory-maps the FST from a file.  Returns NULL on error.
+  static DecodeFstImpl *ReadMapped(const std::string &filename);
+
+  bool Write(std::ostream &os, const FstWriteOptions &opts) const;
+
+ private:
+  // Reads the header and the padding that follows it, and sets up the
+  // properties, symbol tables, start state and sizes; returns false on error.
+  // After this the stream is positioned at the start of the state array.
+  bool ReadHeaderAndPadding(std::istream &is, const FstReadOptions &opts);
+
+  // Storage for the states and arcs, if they are not memory-mapped.
+  std::vector<State> state_vec_;
+  std::vector<Arc> arc_vec_;
+
+  const State *states_;  // Points into state_vec_ or mapped_file_.
+  const Arc *arcs_;  // Points into arc_vec_ or mapped_file_.
+  StateId num_states_;
+  int64 num_arcs_;
+  StateId start_;
+  kaldi::MappedFile *mapped_file_;  // Non-NULL if memory-mapped.
+
+  void operator = (const DecodeFstImpl &impl);  // disallow
+  DecodeFstImpl(const DecodeFstImpl &impl);  // disallow
+};
+
+
+/// See the comment at the top of this file.
+template<class A>
+class DecodeFstTpl : public ExpandedFst<A> {
+ public:
+  typedef A Arc;
+  typedef typename Arc::Weight Weight;
+  typedef typename Arc::StateId StateId;
+  typedef DecodeFstImpl<A> Impl;
+
+  DecodeFstTpl(): impl_(new Impl()) { }
+
+  explicit DecodeFstTpl(const Fst<Arc> &fst): impl_(new Impl(fst)) { }
+
+  /// The copy shares the data with "fst"; "safe" makes no difference, as
+  /// this FST type is read-only.
+  DecodeFstTpl(const DecodeFstTpl &fst, bool safe = false): impl_(fst.impl_) {
+    impl_->IncrRefCount();
+  }
+
+  virtual ~DecodeFstTpl() { if (!impl_->DecrRefCount()) delete impl_; }
+
+  virtual StateId Start() const { return impl_->Start(); }
+
+  virtual Weight Final(StateId s) const { return impl_->Final(s); }
+
+  virtual StateId NumStates() const { return impl_->NumStates(); }
+
+  virtual size_t NumArcs(StateId s) const { return impl_->NumArcs(s); }
+
+  virtual size_t NumInputEpsilons(StateId s) const {
+    return impl_->NumInputEpsilons(s);
+  }
+
+  virtual size_t NumOutputEpsilons(StateId s) const {
+    return impl_->NumOutputEpsilons(s);
+  }
+
+  /// Returns the arcs of state s: first the NumInputEpsilons(s) input-epsilon
+  /// arcs, then the others; there are NumArcs(s) in total.
+  const Arc *Arcs(StateId s) const { return impl_->Arcs(s); }
+
+  virtual uint64 Properties(uint64 mask, bool test) const {
+    if (test) {
+      uint64 known, test = TestProperties(*this, mask, &known);
+      impl_->SetProperties(test, known);
+      return test & mask;
+    } else {
+      return impl_->Properties(mask);
+    }
+  }
+
+  virtual const string& Type() const { return impl_->Type(); }
+
+  virtual DecodeFstTpl *Copy(bool safe = false) const {
+    return new DecodeFstTpl(*this, safe);
+  }
+
+  virtual const SymbolTable* InputSymbols() const {
+    return impl_->InputSymbols();
+  }
+
+  virtual const SymbolTable* OutputSymbols() const {
+    return impl_->OutputSymbols();
+  }
+
+  virtual void InitStateIterator(StateIteratorData<Arc> *data) const {
+    impl_->InitStateIterator(data);
+  }
+
+  virtual void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const {
+    impl_->InitArcIterator(s, data);
+  }
+
+  virtual bool Write(std::ostream &os, const FstWriteOptions &opts) const {
+    return impl_->Write(os, opts);
+  }
+
+  virtual bool Write(const string &filename) const;
+
+  /// Reads the FST into memory from a stream (see DecodeFstImpl::Read()).
+  /// Returns NULL on error.
+  static DecodeFstTpl *Read(std::istream &is, const FstReadOptions &opts) {
+    Impl *impl = Impl::Read(is, opts);
+    return (impl != NULL ? new DecodeFstTpl(impl) : NULL);
+  }
+
+  /// Memory-maps the FST from the file "filename" (which must be an actual
+  /// file, not a pipe or an rxfilename with an offset).  Returns NULL on
+  /// error.
+  static DecodeFstTpl *Read(const string &filename) {
+    Impl *impl = Impl::ReadMapped(filename);
+    return (impl != NULL ? new DecodeFstTpl(impl) : NULL);
+  }
+
+  static const string &TypeName() {
+    static const string type = "decode";
+    return type;
+  }
+
+ private:
+  explicit DecodeFstTpl(Impl *impl): impl_(impl) { }
+
+  Impl *impl_;
+
+  void operator = (const DecodeFstTpl &fst);  // disallow
+};
+
+/// The decoding-graph version, which is what the decoders use.
+typedef DecodeFstTpl<StdArc> DecodeFst;
+
+
+/// Reads a decoding graph of type "vector", "const" or "decode" using Kaldi
+/// I/O mechanisms (pipes, etc.); a DecodeFst that is in an actual file is
+/// memory-mapped.  On error, throws using KALDI_ERR.  Programs that just
+/// decode with a single graph should use this in preference to
+/// ReadFstKaldi(), so they can use graphs in the "decode" format.
+inline Fst<StdArc> *ReadFstKaldiGeneric(std::string rxfilename);
+
+/// @}
+
+}  // namespace fst
+
+#include "fstext/decode-fst-inl.h"
+
+#endif  // KALDI_FSTEXT_DECODE_FST_H_
@@ -65,10 +65,10 @@ template<class IntType> class LatticeStringRepository {
     
     std::pair<typename SetType::iterator, bool> pr = set_.insert(new_entry_);
     if (pr.second) { // Was successfully inserted (was not there).  We need to
-                     // replace the element we inserted, which resides on the
-                     // stack, with one from the heap.
+                     // replace new_entry_, which now belongs to the set,
+                     // with a fresh one.
       const Entry *ans = new_entry_;
-      new_entry_ = new Entry();
+      new_entry_ = NewEntry();
       return ans;
     } else { // Was not inserted because an equivalent Entry already
              // existed.
@@ -170,19 +170,20 @@ template<class IntType> class LatticeStringRepository {
     return e;
   }
   
-  LatticeStringRepository() { new_entry_ = new Entry; }
+  LatticeStringRepository(): block_used_(kBlockSize), free_list_(NULL) {
+    new_entry_ = NewEntry();
+  }
   
   void Destroy() {
-    for (typename SetType::iterator iter = set_.begin();
-         iter != set_.end();
-         ++iter)
-      delete *iter;
+    for (size_t i = 0; i < blocks_.size(); i++)
+      delete [] blocks_[i];
+    std::vector<Entry*> tmp_blocks;
+    tmp_blocks.swap(blocks_);
+    block_used_ = kBlockSize;
+    free_list_ = NULL;
     SetType tmp;
     tmp.swap(set_);
-    if (new_entry_) {
-      delete new_entry_;
-      new_entry_ = NULL;
-    }
+    new_entry_ = NULL;
   }
 
   // Rebuild will rebuild this object, guaranteeing only
@@ -195,11 +196,11 @@ template<class IntType> class LatticeStringRepository {
              iter = to_keep.begin();
          iter != to_keep.end(); ++iter)
       RebuildHelper(*iter, &tmp_set);
-    // Now delete all elems not in tmp_set.
+    // Now free all elems not in tmp_set.
     for (typename SetType::iterator iter = set_.begin();
          iter != set_.end(); ++iter) {
       if (tmp_set.count(*iter) == 0)
-        delete (*iter); // delete the Entry; not needed.
+        FreeEntry(*iter); // free the Entry; not needed.
     }
     set_.swap(tmp_set);
   }
@@ -239,10 +240,36 @@ template<class IntType> class LatticeStringRepository {
     }
   }
   
+  // Entries are allocated from blocks of kBlockSize, rather than one by one
+  // with new, which saves time and the per-allocation overhead; the Entries
+  // freed by Rebuild() go on a free list (linked through their "parent"
+  // pointers) and are reused.
+  Entry *NewEntry() {
+    if (free_list_ != NULL) {
+      Entry *ans = free_list_;
+      free_list_ = const_cast<Entry*>(ans->parent);
+      return ans;
+    }
+    if (block_used_ == kBlockSize) {
+      blocks_.push_back(new Entry[kBlockSize]);
+      block_used_ = 0;
+    }
+    return blocks_.back() + block_used_++;
+  }
+  void FreeEntry(const Entry *entry) {
+    Entry *e = const_cast<Entry*>(entry);
+    e->parent = free_list_;
+    free_list_ = e;
+  }
+
   DISALLOW_COPY_AND_ASSIGN(LatticeStringRepository);
+  static const size_t kBlockSize = 1024;
   Entry *new_entry_; // We always have a pre-allocated Entry ready to use,
-                     // to avoid unnecessary news and deletes.
+                     // to avoid unnecessary allocation.
   SetType set_;
+  std::vector<Entry*> blocks_;  // The blocks that the Entries are in.
+  size_t block_used_;  // Number of Entries used in blocks_.back().
+  Entry *free_list_;  // Entries freed by Rebuild(), for reuse.
 
 };
 
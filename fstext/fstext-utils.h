@@ -523,6 +523,10 @@ class VectorFstTplHolder {
     return *t_;
   }
 
+  void Swap(VectorFstTplHolder *other) {
+    std::swap(t_, other->t_);
+  }
+
   void Clear() {
     if (t_) {
       delete t_;
@@ -0,0 +1,104 @@
+// gmm/am-diag-gmm-gselect-test.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gmm/model-test-common.h"
+#include "gmm/am-diag-gmm.h"
+#include "gmm/am-diag-gmm-gselect.h"
+
+namespace kaldi {
+
+void UnitTestAmDiagGmmGselect() {
+  int32 dim = 1 + RandInt(0, 9),  // random dimension of the gmm
+      num_pdfs = 5 + RandInt(0, 9);  // random number of states
+
+  AmDiagGmm am_gmm;
+  for (int32 i = 0; i < num_pdfs; i++) {
+    int32 num_comp = 1 + RandInt(0, 9);  // random number of mixtures
+    DiagGmm gmm;
+    unittest::InitRandDiagGmm(dim, num_comp, &gmm);
+    am_gmm.AddPdf(gmm);
+  }
+
+  UbmClusteringOptions ubm_opts(am_gmm.NumGauss() / 5 + 1, 0.2,
+                                am_gmm.NumGauss() / 2 + 1, 0.01, 1000);
+  AmDiagGmmGselectOptions opts;
+  opts.num_gselect = 1 + RandInt(0, 2);
+  opts.num_ubm_per_gauss = 1 + RandInt(0, 1);
+  AmDiagGmmGselect gselect;
+  gselect.Init(am_gmm, ubm_opts, opts);
+  KALDI_ASSERT(gselect.NumPdfs() == num_pdfs &&
+               gselect.NumUbmGauss() <= ubm_opts.ubm_num_gauss);
+
+  // If all the UBM Gaussians are selected, all the Gaussians of each pdf
+  // should be evaluated.
+  std::vector<bool> ubm_mask(gselect.NumUbmGauss(), true);
+  std::vector<int32> gauss;
+  for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+    gselect.SelectGauss(pdf, ubm_mask, &gauss);
+    KALDI_ASSERT(static_cast<int32>(gauss.size()) ==
+                 am_gmm.GetPdf(pdf).NumGauss());
+  }
+
+  // The likelihood computed from the selected Gaussians can be no greater
+  // than the exact one.  Also check that a Gaussian of the model tends to
+  // get selected for data at its own mean.
+  int32 num_own_selected = 0, num_tried = 0;
+  Vector<BaseFloat> feat(dim);
+  std::vector<int32> ubm_gauss;
+  for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+    const DiagGmm &gmm = am_gmm.GetPdf(pdf);
+    for (int32 i = 0; i < gmm.NumGauss(); i++, num_tried++) {
+      gmm.GetComponentMean(i, &feat);
+      gselect.SelectUbmGauss(feat, &ubm_gauss);
+      KALDI_ASSERT(static_cast<int32>(ubm_gauss.size()) ==
+                   std::min(opts.num_gselect, gselect.NumUbmGauss()));
+      std::fill(ubm_mask.begin(), ubm_mask.end(), false);
+      for (size_t j = 0; j < ubm_gauss.size(); j++)
+        ubm_mask[ubm_gauss[j]] = true;
+      gselect.SelectGauss(pdf, ubm_mask, &gauss);
+      if (std::find(gauss.begin(), gauss.end(), i) != gauss.end())
+        num_own_selected++;
+      if (!gauss.empty()) {
+        Vector<BaseFloat> loglikes;
+        gmm.LogLikelihoodsPreselect(feat, gauss, &loglikes);
+        KALDI_ASSERT(loglikes.LogSumExp() <= gmm.LogLikelihood(feat) + 1.0e-03);
+      }
+    }
+  }
+  KALDI_LOG << "Gaussian was selected at its own mean " << num_own_selected
+            << " times out of " << num_tried;
+  KALDI_ASSERT(num_own_selected >= num_tried / 2);
+
+  AmDiagGmmGselectStats stats, stats2;
+  stats.num_evals = 10;
+  stats.max_diff = 1.0;
+  stats2.Add(stats);
+  stats2.Add(stats);
+  KALDI_ASSERT(stats2.num_evals == 20 && stats2.max_diff == 1.0);
+  stats2.Print();
+}
+
+}  // namespace kaldi
+
+int main() {
+  for (int i = 0; i < 10; i++)
+    kaldi::UnitTestAmDiagGmmGselect();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,120 @@
+// gmm/am-diag-gmm-gselect.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "gmm/am-diag-gmm-gselect.h"
+
+namespace kaldi {
+
+void AmDiagGmmGselectStats::Reset() {
+  num_evals = 0;
+  num_gauss_total = 0;
+  num_gauss_evaluated = 0;
+  num_fallback = 0;
+  num_checked = 0;
+  tot_diff = 0.0;
+  max_diff = 0.0;
+}
+
+void AmDiagGmmGselectStats::Add(const AmDiagGmmGselectStats &other) {
+  num_evals += other.num_evals;
+  num_gauss_total += other.num_gauss_total;
+  num_gauss_evaluated += other.num_gauss_evaluated;
+  num_fallback += other.num_fallback;
+  num_checked += other.num_checked;
+  tot_diff += other.tot_diff;
+  max_diff = std::max(max_diff, other.max_diff);
+}
+
+void AmDiagGmmGselectStats::Print() const {
+  KALDI_LOG << "Gaussian selection: evaluated " << num_gauss_evaluated
+            << " out of " << num_gauss_total << " Gaussians ("
+            << (100.0 * num_gauss_evaluated / std::max<int64>(1, num_gauss_total))
+            << "%) over " << num_evals << " pdf evaluations; "
+            << num_fallback << " evaluations had no Gaussian selected.";
+  if (num_checked > 0)
+    KALDI_LOG << "Gaussian selection: average log-likelihood loss per pdf "
+              << "evaluation was " << (tot_diff / num_checked) << ", max was "
+              << max_diff << ", over " << num_checked << " evaluations.";
+}
+
+void AmDiagGmmGselect::Init(const AmDiagGmm &am, const DiagGmm &ubm,
+                            const AmDiagGmmGselectOptions &opts) {
+  opts.Check();
+  if (ubm.Dim() != am.Dim())
+    KALDI_ERR << "Dimension mismatch between UBM (" << ubm.Dim()
+              << ") and model (" << am.Dim() << ")";
+  ubm_.CopyFromDiagGmm(ubm);
+  num_gselect_ = opts.num_gselect;
+  num_ubm_per_gauss_ = std::min(opts.num_ubm_per_gauss, ubm.NumGauss());
+  check_accuracy_ = opts.check_accuracy;
+
+  int32 num_pdfs = am.NumPdfs(), offset = 0;
+  offsets_.resize(num_pdfs + 1);
+  ubm_index_.resize(static_cast<size_t>(am.NumGauss()) * num_ubm_per_gauss_);
+  Vector<BaseFloat> mean(am.Dim());
+  std::vector<int32> best;
+  for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+    const DiagGmm &gmm = am.GetPdf(pdf);
+    offsets_[pdf] = offset;
+    for (int32 i = 0; i < gmm.NumGauss(); i++, offset++) {
+      // Associate each Gaussian with the UBM Gaussians that give its mean
+      // the highest likelihood.
+      gmm.GetComponentMean(i, &mean);
+      ubm_.GaussianSelection(mean, num_ubm_per_gauss_, &best);
+      KALDI_ASSERT(static_cast<int32>(best.size()) == num_ubm_per_gauss_);
+      std::copy(best.begin(), best.end(),
+                ubm_index_.begin() + offset * num_ubm_per_gauss_);
+    }
+  }
+  offsets_[num_pdfs] = offset;
+  KALDI_LOG << "Initialized Gaussian selection with " << ubm_.NumGauss()
+            << " UBM Gaussians, selecting " << num_gselect_ << " per frame.";
+}
+
+void AmDiagGmmGselect::Init(const AmDiagGmm &am,
+                            const UbmClusteringOptions &ubm_opts,
+                            const AmDiagGmmGselectOptions &opts) {
+  Vector<BaseFloat> state_occs(am.NumPdfs());
+  state_occs.Set(1.0);
+  DiagGmm ubm;
+  ClusterGaussiansToUbm(am, state_occs, ubm_opts, &ubm);
+  Init(am, ubm, opts);
+}
+
+void AmDiagGmmGselect::SelectGauss(int32 pdf,
+                                   const std::vector<bool> &ubm_mask,
+                                   std::vector<int32> *gauss) const {
+  KALDI_ASSERT(static_cast<size_t>(pdf) < static_cast<size_t>(NumPdfs()) &&
+               ubm_mask.size() == static_cast<size_t>(ubm_.NumGauss()));
+  gauss->clear();
+  int32 num_gauss = offsets_[pdf + 1] - offsets_[pdf];
+  const int32 *index = &(ubm_index_[0]) + offsets_[pdf] * num_ubm_per_gauss_;
+  for (int32 i = 0; i < num_gauss; i++, index += num_ubm_per_gauss_) {
+    for (int32 k = 0; k < num_ubm_per_gauss_; k++) {
+      if (ubm_mask[index[k]]) {
+        gauss->push_back(i);
+        break;
+      }
+    }
+  }
+}
+
+}  // namespace kaldi
@@ -0,0 +1,135 @@
+// gmm/am-diag-gmm-gselect.h
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_GMM_AM_DIAG_GMM_GSELECT_H_
+#define KALDI_GMM_AM_DIAG_GMM_GSELECT_H_ 1
+
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "gmm/am-diag-gmm.h"
+#include "gmm/diag-gmm.h"
+#include "itf/options-itf.h"
+
+namespace kaldi {
+
+struct AmDiagGmmGselectOptions {
+  int32 num_gselect;
+  int32 num_ubm_per_gauss;
+  bool check_accuracy;
+
+  AmDiagGmmGselectOptions(): num_gselect(20), num_ubm_per_gauss(2),
+                             check_accuracy(false) { }
+
+  void Register(OptionsItf *po) {
+    std::string module = "AmDiagGmmGselectOptions: ";
+    po->Register("num-gselect", &num_gselect, module +
+                 "Number of UBM Gaussians to select on each frame (larger "
+                 "is slower but more exact).");
+    po->Register("gselect-ubm-per-gauss", &num_ubm_per_gauss, module +
+                 "Number of UBM Gaussians each Gaussian of the model is "
+                 "associated with; it is evaluated if any of these is "
+                 "selected.");
+    po->Register("gselect-check-accuracy", &check_accuracy, module +
+                 "If true, also compute the exact likelihoods and report the "
+                 "difference (for tuning; this makes decoding slower).");
+  }
+
+  void Check() const {
+    KALDI_ASSERT(num_gselect > 0 && num_ubm_per_gauss > 0);
+  }
+};
+
+/// Statistics on Gaussian selection, for reporting the speed/accuracy
+/// trade-off.  "Evaluations" are of a pdf on a frame.
+struct AmDiagGmmGselectStats {
+  int64 num_evals;  // number of pdf evaluations.
+  int64 num_gauss_total;  // total #Gaussians in the pdfs evaluated.
+  int64 num_gauss_evaluated;  // #Gaussians actually evaluated.
+  int64 num_fallback;  // #evaluations where no Gaussian was selected, so we
+                       // evaluated all of them.
+  int64 num_checked;  // #evaluations where we also computed the exact value
+                      // (only if check_accuracy == true).
+  double tot_diff;  // total of (exact - approximate) log-likelihood.
+  double max_diff;  // max of (exact - approximate) log-likelihood.
+
+  AmDiagGmmGselectStats() { Reset(); }
+  void Reset();
+  void Add(const AmDiagGmmGselectStats &other);
+  /// Prints the stats with KALDI_LOG.
+  void Print() const;
+};
+
+/** \class AmDiagGmmGselect
+ *  Gaussian selection for fast likelihood evaluation of an AmDiagGmm in
+ *  decoding.  We have a small "UBM" (a DiagGmm, e.g. obtained by clustering
+ *  the Gaussians of the model with ClusterGaussiansToUbm()), and each
+ *  Gaussian of each pdf is associated with the few UBM Gaussians that give
+ *  its mean the highest likelihood.  On each frame we select the best
+ *  num_gselect UBM Gaussians, and for each pdf we only evaluate those of its
+ *  Gaussians that are associated with one of the selected UBM Gaussians.
+ */
+class AmDiagGmmGselect {
+ public:
+  AmDiagGmmGselect(): num_gselect_(0), num_ubm_per_gauss_(0) { }
+
+  /// Initializes from the model and the UBM.
+  void Init(const AmDiagGmm &am, const DiagGmm &ubm,
+            const AmDiagGmmGselectOptions &opts);
+
+  /// Initializes by clustering the model's Gaussians to get the UBM; we don't
+  /// have the state occupancies in decoding, so all the states are treated
+  /// as equally likely.
+  void Init(const AmDiagGmm &am, const UbmClusteringOptions &ubm_opts,
+            const AmDiagGmmGselectOptions &opts);
+
+  const DiagGmm &Ubm() const { return ubm_; }
+  int32 NumPdfs() const { return static_cast<int32>(offsets_.size()) - 1; }
+  int32 NumUbmGauss() const { return ubm_.NumGauss(); }
+  bool CheckAccuracy() const { return check_accuracy_; }
+
+  /// Outputs the selected UBM Gaussians for this frame.
+  void SelectUbmGauss(const VectorBase<BaseFloat> &data,
+                      std::vector<int32> *ubm_gauss) const {
+    ubm_.GaussianSelection(data, num_gselect_, ubm_gauss);
+  }
+
+  /// Outputs the Gaussians of pdf "pdf" that should be evaluated, given
+  /// "ubm_mask", which is indexed by UBM Gaussian and is true for the
+  /// selected ones on this frame.  The output may be empty.
+  void SelectGauss(int32 pdf, const std::vector<bool> &ubm_mask,
+                   std::vector<int32> *gauss) const;
+
+ private:
+  DiagGmm ubm_;
+  int32 num_gselect_;
+  int32 num_ubm_per_gauss_;
+  bool check_accuracy_;
+  // For Gaussian i of pdf j, the UBM Gaussians associated with it are
+  // ubm_index_[(offsets_[j] + i) * num_ubm_per_gauss_ + k] for
+  // 0 <= k < num_ubm_per_gauss_.
+  std::vector<int32> offsets_;
+  std::vector<int32> ubm_index_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(AmDiagGmmGselect);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_GMM_AM_DIAG_GMM_GSELECT_H_
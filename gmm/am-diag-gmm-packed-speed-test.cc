@@ -0,0 +1,106 @@
+// gmm/am-diag-gmm-packed-speed-test.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gmm/model-test-common.h"
+#include "gmm/am-diag-gmm.h"
+#include "gmm/am-diag-gmm-packed.h"
+#include "util/timer.h"
+
+namespace kaldi {
+
+// Compares the speed of the likelihood computation the way
+// DecodableAmDiagGmmUnmapped used to do it (a newly allocated vector and two
+// matrix-vector products per pdf), with that of AmDiagGmmPacked, one pdf at a
+// time and batched over all the pdfs.
+void TestAmDiagGmmPackedSpeed(int32 dim, int32 num_gauss) {
+  BaseFloat time_in_secs = 0.05;
+  int32 num_pdfs = 50;
+  AmDiagGmm am_gmm;
+  for (int32 i = 0; i < num_pdfs; i++) {
+    DiagGmm gmm;
+    unittest::InitRandDiagGmm(dim, num_gauss, &gmm);
+    am_gmm.AddPdf(gmm);
+  }
+  AmDiagGmmPacked packed(am_gmm);
+
+  Vector<BaseFloat> feat(dim), feat_squared(dim), packed_feat, scratch;
+  feat.SetRandn();
+  feat_squared.CopyFromVec(feat);
+  feat_squared.ApplyPow(2.0);
+  packed.PackData(feat, &packed_feat);
+
+  BaseFloat flops_per_iter = num_pdfs * num_gauss * dim * 4.0;
+  double sum = 0.0;  // so the computation can't be optimized away.
+  {
+    Timer tim;
+    int32 iter = 0;
+    for (; tim.Elapsed() < time_in_secs; iter++) {
+      for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+        const DiagGmm &gmm = am_gmm.GetPdf(pdf);
+        Vector<BaseFloat> loglikes(gmm.gconsts());
+        loglikes.AddMatVec(1.0, gmm.means_invvars(), kNoTrans, feat, 1.0);
+        loglikes.AddMatVec(-0.5, gmm.inv_vars(), kNoTrans, feat_squared, 1.0);
+        sum += loglikes.LogSumExp(5.0);
+      }
+    }
+    BaseFloat gflops = (flops_per_iter * iter) / (tim.Elapsed() * 1.0e+09);
+    KALDI_LOG << "For unpacked likelihoods, dim = " << dim << ", num-gauss = "
+              << num_gauss << ", speed was " << gflops << " gigaflops.";
+  }
+  {
+    Timer tim;
+    int32 iter = 0;
+    for (; tim.Elapsed() < time_in_secs; iter++) {
+      for (int32 pdf = 0; pdf < num_pdfs; pdf++)
+        sum += packed.LogLikelihood(pdf, packed_feat, 5.0, &scratch);
+    }
+    BaseFloat gflops = (flops_per_iter * iter) / (tim.Elapsed() * 1.0e+09);
+    KALDI_LOG << "For packed likelihoods, dim = " << dim << ", num-gauss = "
+              << num_gauss << ", speed was " << gflops << " gigaflops.";
+  }
+  {
+    std::vector<int32> pdfs(num_pdfs);
+    for (int32 pdf = 0; pdf < num_pdfs; pdf++)
+      pdfs[pdf] = pdf;
+    std::vector<BaseFloat> loglikes;
+    Timer tim;
+    int32 iter = 0;
+    for (; tim.Elapsed() < time_in_secs; iter++) {
+      packed.LogLikelihoods(pdfs, packed_feat, 5.0, &scratch, &loglikes);
+      sum += loglikes[0];
+    }
+    BaseFloat gflops = (flops_per_iter * iter) / (tim.Elapsed() * 1.0e+09);
+    KALDI_LOG << "For batched packed likelihoods, dim = " << dim
+              << ", num-gauss = " << num_gauss << ", speed was " << gflops
+              << " gigaflops.";
+  }
+  KALDI_VLOG(1) << "Sum is " << sum;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  int32 dims[] = { 13, 39, 40, 60 }, num_gauss[] = { 4, 16, 32 };
+  for (int32 i = 0; i < 4; i++)
+    for (int32 j = 0; j < 3; j++)
+      TestAmDiagGmmPackedSpeed(dims[i], num_gauss[j]);
+  std::cout << "Test OK.\n";
+  return 0;
+}
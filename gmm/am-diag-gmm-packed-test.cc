@@ -0,0 +1,87 @@
+// gmm/am-diag-gmm-packed-test.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gmm/model-test-common.h"
+#include "gmm/am-diag-gmm.h"
+#include "gmm/am-diag-gmm-packed.h"
+
+namespace kaldi {
+
+void UnitTestAmDiagGmmPacked() {
+  int32 dim = 1 + RandInt(0, 40),  // random dimension of the gmm
+      num_pdfs = 5 + RandInt(0, 9);  // random number of states
+
+  AmDiagGmm am_gmm;
+  for (int32 i = 0; i < num_pdfs; i++) {
+    int32 num_comp = 1 + RandInt(0, 9);  // random number of mixtures
+    DiagGmm gmm;
+    unittest::InitRandDiagGmm(dim, num_comp, &gmm);
+    am_gmm.AddPdf(gmm);
+  }
+
+  AmDiagGmmPacked packed(am_gmm);
+  KALDI_ASSERT(packed.NumPdfs() == num_pdfs && packed.Dim() == dim &&
+               packed.PackedDim() % 8 == 0 && packed.PackedDim() >= 2 * dim);
+
+  Vector<BaseFloat> feat(dim), packed_feat, scratch;
+  for (int32 n = 0; n < 5; n++) {
+    feat.SetRandn();
+    packed.PackData(feat, &packed_feat);
+    for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+      const DiagGmm &gmm = am_gmm.GetPdf(pdf);
+      KALDI_ASSERT(packed.NumGaussInPdf(pdf) == gmm.NumGauss() &&
+                   packed.MaxGauss() >= gmm.NumGauss());
+      Vector<BaseFloat> loglikes, packed_loglikes(gmm.NumGauss());
+      gmm.LogLikelihoods(feat, &loglikes);
+      packed.ComponentLogLikelihoods(pdf, packed_feat, &packed_loglikes);
+      AssertEqual(loglikes, packed_loglikes, 1.0e-04);
+
+      BaseFloat loglike = gmm.LogLikelihood(feat),
+          packed_loglike = packed.LogLikelihood(pdf, packed_feat, -1.0,
+                                                &scratch);
+      AssertEqual(loglike, packed_loglike, 1.0e-04);
+      // With pruning, the answer can only get smaller, and not by much.
+      BaseFloat pruned_loglike = packed.LogLikelihood(pdf, packed_feat, 5.0,
+                                                      &scratch);
+      KALDI_ASSERT(pruned_loglike <= packed_loglike + 1.0e-04 &&
+                   pruned_loglike > packed_loglike - 0.1);
+    }
+
+    // The batch version, on a random list of pdfs that may have repeats.
+    std::vector<int32> pdfs(RandInt(0, 2 * num_pdfs));
+    for (size_t i = 0; i < pdfs.size(); i++)
+      pdfs[i] = RandInt(0, num_pdfs - 1);
+    std::vector<BaseFloat> batch_loglikes;
+    packed.LogLikelihoods(pdfs, packed_feat, -1.0, &scratch, &batch_loglikes);
+    KALDI_ASSERT(batch_loglikes.size() == pdfs.size());
+    for (size_t i = 0; i < pdfs.size(); i++)
+      AssertEqual(batch_loglikes[i],
+                  packed.LogLikelihood(pdfs[i], packed_feat, -1.0, &scratch),
+                  1.0e-04);
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  for (int i = 0; i < 10; i++)
+    kaldi::UnitTestAmDiagGmmPacked();
+  std::cout << "Test OK.\n";
+  return 0;
+}
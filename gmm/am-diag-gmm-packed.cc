@@ -0,0 +1,259 @@
+// gmm/am-diag-gmm-packed.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "gmm/am-diag-gmm-packed.h"
+
+// The inner product below is hand-vectorized for single precision.  We use
+// AVX if the compiler was told it may (e.g. -mavx in EXTRA_CXXFLAGS), else
+// SSE (the default flags in kaldi.mk include -msse -msse2), else plain C.
+#if (KALDI_DOUBLEPRECISION == 0) && defined(__AVX__)
+#define KALDI_PACKED_GMM_AVX 1
+#include <immintrin.h>
+#elif (KALDI_DOUBLEPRECISION == 0) && defined(__SSE__)
+#define KALDI_PACKED_GMM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace kaldi {
+
+// Returns the inner product of a and b, which have dimension n; n must be a
+// multiple of 8.
+static inline BaseFloat PackedDotProduct(const BaseFloat *a,
+                                         const BaseFloat *b,
+                                         int32 n) {
+#if defined(KALDI_PACKED_GMM_AVX)
+  __m256 sum = _mm256_setzero_ps();
+  for (int32 i = 0; i < n; i += 8)
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(a + i),
+                                           _mm256_loadu_ps(b + i)));
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(sum),
+                        _mm256_extractf128_ps(sum, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+#elif defined(KALDI_PACKED_GMM_SSE)
+  // Two accumulators, to hide the latency of the additions.
+  __m128 sum1 = _mm_setzero_ps(), sum2 = _mm_setzero_ps();
+  for (int32 i = 0; i < n; i += 8) {
+    sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i),
+                                       _mm_loadu_ps(b + i)));
+    sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+                                       _mm_loadu_ps(b + i + 4)));
+  }
+  __m128 s = _mm_add_ps(sum1, sum2);
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+#else
+  BaseFloat sum1 = 0.0, sum2 = 0.0;
+  for (int32 i = 0; i < n; i += 2) {
+    sum1 += a[i] * b[i];
+    sum2 += a[i + 1] * b[i + 1];
+  }
+  return sum1 + sum2;
+#endif
+}
+
+// Sets out[j] to the inner product of rows[j] and x, for j = 0 ... 3; the
+// dimension n must be a multiple of 8.  Each load of x is shared by the four
+// rows.
+static inline void PackedDotProduct4(const BaseFloat *const *rows,
+                                     const BaseFloat *x,
+                                     int32 n, BaseFloat *out) {
+#if defined(KALDI_PACKED_GMM_AVX)
+  __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps(),
+      sum2 = _mm256_setzero_ps(), sum3 = _mm256_setzero_ps();
+  for (int32 i = 0; i < n; i += 8) {
+    __m256 xi = _mm256_loadu_ps(x + i);
+    sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(rows[0] + i), xi));
+    sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(rows[1] + i), xi));
+    sum2 = _mm256_add_ps(sum2, _mm256_mul_ps(_mm256_loadu_ps(rows[2] + i), xi));
+    sum3 = _mm256_add_ps(sum3, _mm256_mul_ps(_mm256_loadu_ps(rows[3] + i), xi));
+  }
+  __m128 s0 = _mm_add_ps(_mm256_castps256_ps128(sum0),
+                         _mm256_extractf128_ps(sum0, 1)),
+      s1 = _mm_add_ps(_mm256_castps256_ps128(sum1),
+                      _mm256_extractf128_ps(sum1, 1)),
+      s2 = _mm_add_ps(_mm256_castps256_ps128(sum2),
+                      _mm256_extractf128_ps(sum2, 1)),
+      s3 = _mm_add_ps(_mm256_castps256_ps128(sum3),
+                      _mm256_extractf128_ps(sum3, 1));
+  // After the transpose, lane j of the sum is the total of s<j>.
+  _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+  _mm_storeu_ps(out, _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3)));
+#elif defined(KALDI_PACKED_GMM_SSE)
+  __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps(),
+      sum2 = _mm_setzero_ps(), sum3 = _mm_setzero_ps();
+  for (int32 i = 0; i < n; i += 4) {
+    __m128 xi = _mm_loadu_ps(x + i);
+    sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(rows[0] + i), xi));
+    sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(rows[1] + i), xi));
+    sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(rows[2] + i), xi));
+    sum3 = _mm_add_ps(sum3, _mm_mul_ps(_mm_loadu_ps(rows[3] + i), xi));
+  }
+  // After the transpose, lane j of the sum is the total of sum<j>.
+  _MM_TRANSPOSE4_PS(sum0, sum1, sum2, sum3);
+  _mm_storeu_ps(out, _mm_add_ps(_mm_add_ps(sum0, sum1),
+                                _mm_add_ps(sum2, sum3)));
+#else
+  BaseFloat sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+  for (int32 i = 0; i < n; i++) {
+    sum0 += rows[0][i] * x[i];
+    sum1 += rows[1][i] * x[i];
+    sum2 += rows[2][i] * x[i];
+    sum3 += rows[3][i] * x[i];
+  }
+  out[0] = sum0;
+  out[1] = sum1;
+  out[2] = sum2;
+  out[3] = sum3;
+#endif
+}
+
+
+void AmDiagGmmPacked::Init(const AmDiagGmm &am) {
+  int32 num_pdfs = am.NumPdfs(), tot_gauss = am.NumGauss();
+  dim_ = am.Dim();
+  packed_dim_ = ((2 * dim_ + 7) / 8) * 8;
+  max_gauss_ = 0;
+  offsets_.resize(num_pdfs + 1);
+  params_.Resize(tot_gauss, packed_dim_);  // zeroes the padding.
+  gconsts_.Resize(tot_gauss);
+  int32 offset = 0;
+  for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+    const DiagGmm &gmm = am.GetPdf(pdf);
+    if (!gmm.valid_gconsts())
+      KALDI_ERR << "Pdf " << pdf << ": must call ComputeGconsts() before "
+                << "packing the model.";
+    int32 num_gauss = gmm.NumGauss();
+    offsets_[pdf] = offset;
+    max_gauss_ = std::max(max_gauss_, num_gauss);
+    const Matrix<BaseFloat> &means_invvars = gmm.means_invvars(),
+        &inv_vars = gmm.inv_vars();
+    for (int32 i = 0; i < num_gauss; i++) {
+      BaseFloat *row = params_.RowData(offset + i);
+      for (int32 d = 0; d < dim_; d++) {
+        row[2 * d] = means_invvars(i, d);
+        row[2 * d + 1] = -0.5 * inv_vars(i, d);
+      }
+    }
+    SubVector<BaseFloat>(gconsts_, offset, num_gauss).CopyFromVec(
+        gmm.gconsts());
+    offset += num_gauss;
+  }
+  offsets_[num_pdfs] = offset;
+  KALDI_ASSERT(offset == tot_gauss);
+}
+
+void AmDiagGmmPacked::PackData(const VectorBase<BaseFloat> &data,
+                               Vector<BaseFloat> *packed_data) const {
+  KALDI_ASSERT(data.Dim() == dim_);
+  if (packed_data->Dim() != packed_dim_)
+    packed_data->Resize(packed_dim_);  // zeroes the padding.
+  const BaseFloat *x = data.Data();
+  BaseFloat *p = packed_data->Data();
+  for (int32 d = 0; d < dim_; d++) {
+    p[2 * d] = x[d];
+    p[2 * d + 1] = x[d] * x[d];
+  }
+}
+
+void AmDiagGmmPacked::ComponentLogLikelihoods(
+    int32 pdf, const VectorBase<BaseFloat> &packed_data,
+    VectorBase<BaseFloat> *loglikes) const {
+  KALDI_ASSERT(static_cast<size_t>(pdf) < static_cast<size_t>(NumPdfs()) &&
+               packed_data.Dim() == packed_dim_ &&
+               loglikes->Dim() == NumGaussInPdf(pdf));
+  int32 offset = offsets_[pdf], num_gauss = loglikes->Dim();
+  const BaseFloat *x = packed_data.Data(), *gconsts = gconsts_.Data() + offset;
+  BaseFloat *out = loglikes->Data();
+  for (int32 i = 0; i < num_gauss; i++)
+    out[i] = gconsts[i] + PackedDotProduct(params_.RowData(offset + i), x,
+                                           packed_dim_);
+}
+
+BaseFloat AmDiagGmmPacked::LogLikelihood(
+    int32 pdf, const VectorBase<BaseFloat> &packed_data,
+    BaseFloat log_sum_exp_prune, Vector<BaseFloat> *scratch) const {
+  if (scratch->Dim() < max_gauss_)
+    scratch->Resize(max_gauss_, kUndefined);
+  SubVector<BaseFloat> loglikes(scratch->Data(), NumGaussInPdf(pdf));
+  ComponentLogLikelihoods(pdf, packed_data, &loglikes);
+  return loglikes.LogSumExp(log_sum_exp_prune);
+}
+
+void AmDiagGmmPacked::LogLikelihoods(const std::vector<int32> &pdfs,
+                                     const VectorBase<BaseFloat> &packed_data,
+                                     BaseFloat log_sum_exp_prune,
+                                     Vector<BaseFloat> *scratch,
+                                     std::vector<BaseFloat> *loglikes) const {
+  KALDI_ASSERT(packed_data.Dim() == packed_dim_);
+  int32 num_pdfs = NumPdfs(), tot_gauss = 0;
+  for (size_t i = 0; i < pdfs.size(); i++) {
+    KALDI_ASSERT(static_cast<size_t>(pdfs[i]) <
+                 static_cast<size_t>(num_pdfs));
+    tot_gauss += NumGaussInPdf(pdfs[i]);
+  }
+  if (scratch->Dim() < tot_gauss)
+    scratch->Resize(tot_gauss, kUndefined);
+  const BaseFloat *x = packed_data.Data();
+  BaseFloat *out = scratch->Data();
+
+  // First the inner products, for the Gaussians of all the pdfs in order and
+  // four at a time regardless of where the pdfs begin and end.  "i" is the
+  // position in "pdfs", and "g" the next Gaussian of pdfs[i].
+  size_t i = 0;
+  int32 g = 0, k = 0;
+  while (k < tot_gauss) {
+    const BaseFloat *rows[4];
+    int32 n = 0;
+    for (; n < 4 && k + n < tot_gauss; n++) {
+      while (g == NumGaussInPdf(pdfs[i])) {
+        i++;
+        g = 0;
+      }
+      rows[n] = params_.RowData(offsets_[pdfs[i]] + g);
+      g++;
+    }
+    if (n == 4) {
+      PackedDotProduct4(rows, x, packed_dim_, out + k);
+    } else {
+      for (int32 j = 0; j < n; j++)
+        out[k + j] = PackedDotProduct(rows[j], x, packed_dim_);
+    }
+    k += n;
+  }
+
+  // Then add the gconsts, and the log-sum-exp for each pdf.
+  loglikes->resize(pdfs.size());
+  k = 0;
+  for (i = 0; i < pdfs.size(); i++) {
+    int32 pdf = pdfs[i], num_gauss = NumGaussInPdf(pdf);
+    SubVector<BaseFloat> pdf_loglikes(out + k, num_gauss);
+    pdf_loglikes.AddVec(1.0, SubVector<BaseFloat>(gconsts_, offsets_[pdf],
+                                                  num_gauss));
+    (*loglikes)[i] = pdf_loglikes.LogSumExp(log_sum_exp_prune);
+    k += num_gauss;
+  }
+}
+
+
+}  // namespace kaldi
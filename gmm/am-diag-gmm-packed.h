@@ -0,0 +1,116 @@
+// gmm/am-diag-gmm-packed.h
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_GMM_AM_DIAG_GMM_PACKED_H_
+#define KALDI_GMM_AM_DIAG_GMM_PACKED_H_ 1
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "gmm/am-diag-gmm.h"
+#include "matrix/matrix-lib.h"
+
+namespace kaldi {
+
+/** \class AmDiagGmmPacked
+ *  A read-only copy of the parameters of an AmDiagGmm, in a layout designed
+ *  for fast likelihood evaluation in decoding.  The log-likelihood of
+ *  Gaussian i given data x is
+ *     gconsts(i) + means_invvars(i, :) . x  - 0.5 * inv_vars(i, :) . x^2,
+ *  which is a single dot product if, for each Gaussian, we interleave the
+ *  means_invvars with the (-0.5 times) inv_vars, i.e. store
+ *     [ means_invvars(i,0), -0.5 inv_vars(i,0), means_invvars(i,1), ... ]
+ *  and pack the data as [ x(0), x(0)^2, x(1), x(1)^2, ... ].  The rows are
+ *  padded with zeros to a multiple of 8 floats, and the Gaussians of each pdf
+ *  are stored contiguously, so the likelihood computation for a pdf is one
+ *  streaming pass over memory.  The inner product is hand-vectorized with
+ *  AVX or SSE if the compiler flags allow it (see am-diag-gmm-packed.cc).
+ *
+ *  This object has to be re-initialized if the AmDiagGmm changes.
+ */
+class AmDiagGmmPacked {
+ public:
+  AmDiagGmmPacked(): dim_(0), packed_dim_(0), max_gauss_(0) { }
+
+  explicit AmDiagGmmPacked(const AmDiagGmm &am) { Init(am); }
+
+  /// Copies the parameters from "am".  All the pdfs must have valid gconsts.
+  void Init(const AmDiagGmm &am);
+
+  int32 NumPdfs() const { return static_cast<int32>(offsets_.size()) - 1; }
+  int32 Dim() const { return dim_; }
+  /// Dimension of the packed data and of the rows of the packed parameters.
+  int32 PackedDim() const { return packed_dim_; }
+  int32 NumGaussInPdf(int32 pdf) const {
+    return offsets_[pdf + 1] - offsets_[pdf];
+  }
+  /// Returns the largest number of Gaussians in any pdf; a buffer of this
+  /// dimension is enough for ComponentLogLikelihoods().
+  int32 MaxGauss() const { return max_gauss_; }
+
+  /// Puts "data" into the packed form needed by the likelihood functions;
+  /// resizes *packed_data to PackedDim() if necessary.
+  void PackData(const VectorBase<BaseFloat> &data,
+                Vector<BaseFloat> *packed_data) const;
+
+  /// Computes the log-likelihoods of all the Gaussians of this pdf given the
+  /// packed data, and puts them in "loglikes", which must have dimension
+  /// NumGaussInPdf(pdf).
+  void ComponentLogLikelihoods(int32 pdf,
+                               const VectorBase<BaseFloat> &packed_data,
+                               VectorBase<BaseFloat> *loglikes) const;
+
+  /// Returns the log-likelihood of this pdf given the packed data.  "scratch"
+  /// is used as temporary storage; it is resized to MaxGauss() if it is
+  /// smaller, so if you reuse it this function does no memory allocation.
+  /// "log_sum_exp_prune" is as for VectorBase::LogSumExp().
+  BaseFloat LogLikelihood(int32 pdf, const VectorBase<BaseFloat> &packed_data,
+                          BaseFloat log_sum_exp_prune,
+                          Vector<BaseFloat> *scratch) const;
+
+  /// Sets (*loglikes)[i] to the log-likelihood of pdfs[i] given the packed
+  /// data, resizing *loglikes.  This gives the same answer as calling
+  /// LogLikelihood() for each pdf, but the Gaussians of all the pdfs are
+  /// evaluated together, four at a time, so each load of the data is shared
+  /// by four Gaussians and there are fewer horizontal sums.  "scratch" is
+  /// resized if it is smaller than the total number of Gaussians in "pdfs".
+  void LogLikelihoods(const std::vector<int32> &pdfs,
+                      const VectorBase<BaseFloat> &packed_data,
+                      BaseFloat log_sum_exp_prune,
+                      Vector<BaseFloat> *scratch,
+                      std::vector<BaseFloat> *loglikes) const;
+
+ private:
+  int32 dim_;  // feature dimension.
+  int32 packed_dim_;  // 2 * dim_, rounded up to a multiple of 8.
+  int32 max_gauss_;
+  std::vector<int32> offsets_;  // offsets_[pdf] is the row index in params_
+                                // of the first Gaussian of "pdf"; it has
+                                // dimension NumPdfs() + 1.
+  Matrix<BaseFloat> params_;  // The interleaved parameters, one row per
+                              // Gaussian; dimension total-gauss by
+                              // packed_dim_.
+  Vector<BaseFloat> gconsts_;  // gconsts for all Gaussians, indexed like the
+                               // rows of params_.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(AmDiagGmmPacked);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_GMM_AM_DIAG_GMM_PACKED_H_
@@ -18,6 +18,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <vector>
 using std::vector;
 
@@ -34,39 +35,177 @@ BaseFloat DecodableAmDiagGmmUnmapped::LogLikelihoodZeroBased(
     return log_like_cache_[state].log_like;  // return cached value, if found
   }
 
+  const VectorBase<BaseFloat> &data = feature_matrix_.Row(frame);
   if (frame != previous_frame_) {  // cache the squared stats.
-    data_squared_.CopyFromVec(feature_matrix_.Row(frame));
-    data_squared_.ApplyPow(2.0);
+    if (packed_model_ != NULL && gselect_ == NULL) {
+      packed_model_->PackData(data, &packed_data_);
+    } else {
+      data_squared_.CopyFromVec(data);
+      data_squared_.ApplyPow(2.0);
+    }
+    if (gselect_ != NULL) {
+      for (size_t i = 0; i < ubm_gauss_.size(); i++)
+        ubm_mask_[ubm_gauss_[i]] = false;
+      gselect_->SelectUbmGauss(data, &ubm_gauss_);
+      for (size_t i = 0; i < ubm_gauss_.size(); i++)
+        ubm_mask_[ubm_gauss_[i]] = true;
+    }
     previous_frame_ = frame;
   }
 
-  const DiagGmm &pdf = acoustic_model_.GetPdf(state);
-  const VectorBase<BaseFloat> &data = feature_matrix_.Row(frame);
+  BaseFloat log_sum;
+  if (gselect_ != NULL) {
+    const DiagGmm &pdf = acoustic_model_.GetPdf(state);
+    gselect_->SelectGauss(state, ubm_mask_, &gauss_);
+    gselect_stats_.num_evals++;
+    gselect_stats_.num_gauss_total += pdf.NumGauss();
+    if (gauss_.empty()) {
+      // None of the Gaussians were selected; evaluate all of them, because
+      // we'd rather not return a very approximate value.
+      gselect_stats_.num_fallback++;
+      gselect_stats_.num_gauss_evaluated += pdf.NumGauss();
+      log_sum = FullLogLikelihood(pdf, data);
+    } else {
+      gselect_stats_.num_gauss_evaluated += gauss_.size();
+      log_sum = GselectLogLikelihood(pdf, data);
+      if (gselect_->CheckAccuracy()) {
+        BaseFloat diff = FullLogLikelihood(pdf, data) - log_sum;
+        gselect_stats_.num_checked++;
+        gselect_stats_.tot_diff += diff;
+        gselect_stats_.max_diff = std::max<double>(gselect_stats_.max_diff,
+                                                   diff);
+      }
+    }
+  } else if (packed_model_ != NULL) {
+    // The packed model does the whole computation in one fused pass, using
+    // loglikes_ as scratch space.
+    log_sum = packed_model_->LogLikelihood(state, packed_data_,
+                                           log_sum_exp_prune_, &loglikes_);
+  } else {
+    log_sum = FullLogLikelihood(acoustic_model_.GetPdf(state), data);
+  }
+  if (KALDI_ISNAN(log_sum) || KALDI_ISINF(log_sum))
+    KALDI_ERR << "Invalid answer (overflow or invalid variances/features?)";
 
+  log_like_cache_[state].log_like = log_sum;
+  log_like_cache_[state].hit_time = frame;
+
+  return log_sum;
+}
+
+BaseFloat DecodableAmDiagGmmUnmapped::FullLogLikelihood(
+    const DiagGmm &pdf, const VectorBase<BaseFloat> &data) {
   // check if everything is in order
   if (pdf.Dim() != data.Dim()) {
     KALDI_ERR << "Dim mismatch: data dim = "  << data.Dim()
-        << " vs. model dim = " << pdf.Dim();
+              << " vs. model dim = " << pdf.Dim();
   }
   if (!pdf.valid_gconsts()) {
-    KALDI_ERR << "State "  << (state)  << ": Must call ComputeGconsts() "
-        "before computing likelihood.";
+    KALDI_ERR << "Must call ComputeGconsts() before computing likelihood.";
   }
-
-  Vector<BaseFloat> loglikes(pdf.gconsts());  // need to recreate for each pdf
+  // Use the storage in loglikes_ rather than allocating a vector per pdf.
+  int32 num_gauss = pdf.NumGauss();
+  if (loglikes_.Dim() < num_gauss)
+    loglikes_.Resize(num_gauss, kUndefined);
+  SubVector<BaseFloat> loglikes(loglikes_.Data(), num_gauss);
+  loglikes.CopyFromVec(pdf.gconsts());
   // loglikes +=  means * inv(vars) * data.
   loglikes.AddMatVec(1.0, pdf.means_invvars(), kNoTrans, data, 1.0);
   // loglikes += -0.5 * inv(vars) * data_sq.
   loglikes.AddMatVec(-0.5, pdf.inv_vars(), kNoTrans, data_squared_, 1.0);
+  return loglikes.LogSumExp(log_sum_exp_prune_);
+}
 
-  BaseFloat log_sum = loglikes.LogSumExp(log_sum_exp_prune_);
-  if (KALDI_ISNAN(log_sum) || KALDI_ISINF(log_sum))
-    KALDI_ERR << "Invalid answer (overflow or invalid variances/features?)";
+BaseFloat DecodableAmDiagGmmUnmapped::GselectLogLikelihood(
+    const DiagGmm &pdf, const VectorBase<BaseFloat> &data) {
+  if (!pdf.valid_gconsts()) {
+    KALDI_ERR << "Must call ComputeGconsts() before computing likelihood.";
+  }
+  int32 num_selected = gauss_.size();
+  if (loglikes_.Dim() < num_selected)
+    loglikes_.Resize(num_selected, kUndefined);
+  SubVector<BaseFloat> loglikes(loglikes_.Data(), num_selected);
+  const Vector<BaseFloat> &gconsts = pdf.gconsts();
+  const Matrix<BaseFloat> &means_invvars = pdf.means_invvars(),
+      &inv_vars = pdf.inv_vars();
+  for (int32 i = 0; i < num_selected; i++) {
+    int32 g = gauss_[i];
+    loglikes(i) = gconsts(g) + VecVec(means_invvars.Row(g), data)
+        - 0.5 * VecVec(inv_vars.Row(g), data_squared_);
+  }
+  return loglikes.LogSumExp(log_sum_exp_prune_);
+}
 
-  log_like_cache_[state].log_like = log_sum;
-  log_like_cache_[state].hit_time = frame;
+void DecodableAmDiagGmmUnmapped::LogLikelihoodsZeroBased(
+    int32 frame, const std::vector<int32> &pdfs,
+    std::vector<BaseFloat> *loglikes) {
+  loglikes->resize(pdfs.size());
+  if (packed_model_ == NULL || gselect_ != NULL) {
+    for (size_t i = 0; i < pdfs.size(); i++)
+      (*loglikes)[i] = LogLikelihoodZeroBased(frame, pdfs[i]);
+    return;
+  }
+  KALDI_ASSERT(static_cast<size_t>(frame) < static_cast<size_t>(NumFrames()));
+  if (frame != previous_frame_) {
+    packed_model_->PackData(feature_matrix_.Row(frame), &packed_data_);
+    previous_frame_ = frame;
+  }
+  // Work out which pdfs are not in the cache for this frame; we mark them as
+  // cached straight away, so that repeats in "pdfs" are only computed once.
+  new_pdfs_.clear();
+  for (size_t i = 0; i < pdfs.size(); i++) {
+    int32 pdf = pdfs[i];
+    KALDI_ASSERT(static_cast<size_t>(pdf) <
+                 static_cast<size_t>(acoustic_model_.NumPdfs()));
+    if (log_like_cache_[pdf].hit_time != frame) {
+      log_like_cache_[pdf].hit_time = frame;
+      new_pdfs_.push_back(pdf);
+    }
+  }
+  packed_model_->LogLikelihoods(new_pdfs_, packed_data_, log_sum_exp_prune_,
+                                &loglikes_, &new_loglikes_);
+  for (size_t i = 0; i < new_pdfs_.size(); i++) {
+    BaseFloat log_sum = new_loglikes_[i];
+    if (KALDI_ISNAN(log_sum) || KALDI_ISINF(log_sum))
+      KALDI_ERR << "Invalid answer (overflow or invalid variances/features?)";
+    log_like_cache_[new_pdfs_[i]].log_like = log_sum;
+  }
+  for (size_t i = 0; i < pdfs.size(); i++)
+    (*loglikes)[i] = log_like_cache_[pdfs[i]].log_like;
+}
 
-  return log_sum;
+void DecodableAmDiagGmmUnmapped::LogLikelihoods(
+    int32 frame, const std::vector<int32> &indices,
+    std::vector<BaseFloat> *loglikes) {
+  if (!HasBatchLogLikelihoods()) {
+    // E.g. a derived class that computes the likelihoods differently.
+    DecodableInterface::LogLikelihoods(frame, indices, loglikes);
+    return;
+  }
+  pdfs_.resize(indices.size());
+  for (size_t i = 0; i < indices.size(); i++)
+    pdfs_[i] = indices[i] - 1;
+  LogLikelihoodsZeroBased(frame, pdfs_, loglikes);
+}
+
+void DecodableAmDiagGmm::LogLikelihoods(
+    int32 frame, const std::vector<int32> &indices,
+    std::vector<BaseFloat> *loglikes) {
+  pdfs_.resize(indices.size());
+  for (size_t i = 0; i < indices.size(); i++)
+    pdfs_[i] = trans_model_.TransitionIdToPdf(indices[i]);
+  LogLikelihoodsZeroBased(frame, pdfs_, loglikes);
+}
+
+void DecodableAmDiagGmmScaled::LogLikelihoods(
+    int32 frame, const std::vector<int32> &indices,
+    std::vector<BaseFloat> *loglikes) {
+  pdfs_.resize(indices.size());
+  for (size_t i = 0; i < indices.size(); i++)
+    pdfs_[i] = trans_model_.TransitionIdToPdf(indices[i]);
+  LogLikelihoodsZeroBased(frame, pdfs_, loglikes);
+  for (size_t i = 0; i < loglikes->size(); i++)
+    (*loglikes)[i] *= scale_;
 }
 
 void DecodableAmDiagGmmUnmapped::ResetLogLikeCache() {
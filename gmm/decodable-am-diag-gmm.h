@@ -26,6 +26,8 @@
 
 #include "base/kaldi-common.h"
 #include "gmm/am-diag-gmm.h"
+#include "gmm/am-diag-gmm-gselect.h"
+#include "gmm/am-diag-gmm-packed.h"
 #include "hmm/transition-model.h"
 #include "itf/decodable-itf.h"
 #include "transform/regression-tree.h"
@@ -53,15 +55,60 @@ class DecodableAmDiagGmmUnmapped : public DecodableInterface {
                              BaseFloat log_sum_exp_prune = -1.0):
     acoustic_model_(am), feature_matrix_(feats),
     previous_frame_(-1), log_sum_exp_prune_(log_sum_exp_prune), 
-    data_squared_(feats.NumCols()) {
+    data_squared_(feats.NumCols()), packed_model_(NULL), gselect_(NULL) {
     ResetLogLikeCache();
   }
 
+  /// Makes the likelihood computation use a packed copy of the acoustic model
+  /// (see am-diag-gmm-packed.h), which is faster.  "packed" must have been
+  /// initialized from the same AmDiagGmm, and is not owned here; it would
+  /// typically be created once in the program and shared by all the decodable
+  /// objects.  Only affects this class's LogLikelihoodZeroBased(), not that of
+  /// derived classes that override it.
+  void SetPackedModel(const AmDiagGmmPacked *packed) {
+    KALDI_ASSERT(packed == NULL ||
+                 (packed->NumPdfs() == acoustic_model_.NumPdfs() &&
+                  packed->Dim() == acoustic_model_.Dim()));
+    packed_model_ = packed;
+    previous_frame_ = -1;
+  }
+
+  /// Makes the likelihood computation use Gaussian selection (see
+  /// am-diag-gmm-gselect.h), which is faster but approximate.  "gselect" must
+  /// have been initialized from the same AmDiagGmm, and is not owned here.
+  /// If set, this takes precedence over SetPackedModel().  Like that
+  /// function, it only affects this class's LogLikelihoodZeroBased().
+  void SetGselect(const AmDiagGmmGselect *gselect) {
+    KALDI_ASSERT(gselect == NULL ||
+                 (gselect->NumPdfs() == acoustic_model_.NumPdfs() &&
+                  gselect->Ubm().Dim() == acoustic_model_.Dim()));
+    gselect_ = gselect;
+    if (gselect != NULL)
+      ubm_mask_.assign(gselect->NumUbmGauss(), false);
+    ubm_gauss_.clear();
+    previous_frame_ = -1;
+    ResetLogLikeCache();
+  }
+
+  /// Statistics on Gaussian selection (only if SetGselect() was called).
+  const AmDiagGmmGselectStats &GselectStats() const { return gselect_stats_; }
+
   // Note, frames are numbered from zero.  But state_index is numbered
   // from one (this routine is called by FSTs).
   virtual BaseFloat LogLikelihood(int32 frame, int32 state_index) {
     return LogLikelihoodZeroBased(frame, state_index - 1);
   }
+
+  // Batch version of LogLikelihood(); the indices are one-based pdf indices.
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &indices,
+                              std::vector<BaseFloat> *loglikes);
+  // The batch computation is only faster than one pdf at a time with the
+  // packed model (see AmDiagGmmPacked::LogLikelihoods()), and Gaussian
+  // selection is done per pdf.
+  virtual bool HasBatchLogLikelihoods() {
+    return (packed_model_ != NULL && gselect_ == NULL);
+  }
+
   int32 NumFrames() { return feature_matrix_.NumRows(); }
   
   // Indices are one-based!  This is for compatibility with OpenFst.
@@ -76,6 +123,16 @@ class DecodableAmDiagGmmUnmapped : public DecodableInterface {
   void ResetLogLikeCache();
   virtual BaseFloat LogLikelihoodZeroBased(int32 frame, int32 state_index);
 
+  /// Computes the log-likelihoods of the zero-based pdf indices "pdfs" on
+  /// this frame, and puts them in *loglikes (which is resized); the pdfs may
+  /// contain repeats.  This is called by the batch LogLikelihoods() functions
+  /// of this class and of the derived classes.  With the packed model, the
+  /// pdfs not already cached for this frame are computed together by
+  /// AmDiagGmmPacked::LogLikelihoods(); otherwise this just calls
+  /// LogLikelihoodZeroBased() for each pdf.
+  void LogLikelihoodsZeroBased(int32 frame, const std::vector<int32> &pdfs,
+                               std::vector<BaseFloat> *loglikes);
+
   const AmDiagGmm &acoustic_model_;
   const Matrix<BaseFloat> &feature_matrix_;
   int32 previous_frame_;
@@ -87,8 +144,27 @@ class DecodableAmDiagGmmUnmapped : public DecodableInterface {
     int32 hit_time;     ///< Frame for which this value is relevant
   };
   std::vector<LikelihoodCacheRecord> log_like_cache_;
+  std::vector<int32> pdfs_;  // temporary used in the batch LogLikelihoods().
  private:
   Vector<BaseFloat> data_squared_;  ///< Cache for fast likelihood calculation
+  const AmDiagGmmPacked *packed_model_;  ///< If non-NULL, use this to compute
+                                         ///< likelihoods.
+  Vector<BaseFloat> packed_data_;  ///< Current frame, packed for packed_model_.
+  Vector<BaseFloat> loglikes_;  ///< Scratch space for per-Gaussian likelihoods.
+  std::vector<int32> new_pdfs_;  ///< Used in LogLikelihoodsZeroBased().
+  std::vector<BaseFloat> new_loglikes_;  ///< Used in LogLikelihoodsZeroBased().
+  const AmDiagGmmGselect *gselect_;  ///< If non-NULL, use Gaussian selection.
+  std::vector<int32> ubm_gauss_;  ///< UBM Gaussians selected on this frame.
+  std::vector<bool> ubm_mask_;  ///< Indexed by UBM Gaussian: true if selected.
+  std::vector<int32> gauss_;  ///< Gaussians of the current pdf to evaluate.
+  AmDiagGmmGselectStats gselect_stats_;
+
+  /// Computes the log-likelihood of all the Gaussians of "pdf".
+  BaseFloat FullLogLikelihood(const DiagGmm &pdf,
+                              const VectorBase<BaseFloat> &data);
+  /// Computes the log-likelihood using only the Gaussians in gauss_.
+  BaseFloat GselectLogLikelihood(const DiagGmm &pdf,
+                                 const VectorBase<BaseFloat> &data);
 
 
   KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmDiagGmmUnmapped);
@@ -109,6 +185,9 @@ class DecodableAmDiagGmm: public DecodableAmDiagGmmUnmapped {
     return LogLikelihoodZeroBased(frame,
                                   trans_model_.TransitionIdToPdf(tid));
   }
+  // Batch version of LogLikelihood(); the indices are transition-ids.
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &indices,
+                              std::vector<BaseFloat> *loglikes);
   // Indices are one-based!  This is for compatibility with OpenFst.
   virtual int32 NumIndices() { return trans_model_.NumTransitionIds(); }
 
@@ -144,6 +223,9 @@ class DecodableAmDiagGmmScaled: public DecodableAmDiagGmmUnmapped {
     return scale_*LogLikelihoodZeroBased(frame,
                                          trans_model_.TransitionIdToPdf(tid));
   }
+  // Batch version of LogLikelihood(); the indices are transition-ids.
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &indices,
+                              std::vector<BaseFloat> *loglikes);
   // Indices are one-based!  This is for compatibility with OpenFst.
   virtual int32 NumIndices() { return trans_model_.NumTransitionIds(); }
 
@@ -290,10 +290,20 @@ void UpdateEbwAmDiagGmm(const AccumAmDiagGmm &num_stats, // with I-smoothing, if
   if (count_out) *count_out = 0.0;
   if (num_floored_out) *num_floored_out = 0.0;
 
-  for (int32 pdf = 0; pdf < num_stats.NumAccs(); pdf++)
-    UpdateEbwDiagGmm(num_stats.GetAcc(pdf), den_stats.GetAcc(pdf), flags,
+  AccumDiagGmm zero_num_acc, zero_den_acc;  // Used for pdfs with no stats.
+  for (int32 pdf = 0; pdf < num_stats.NumAccs(); pdf++) {
+    int32 num_gauss = am_gmm->GetPdf(pdf).NumGauss();
+    if (!num_stats.IsAllocated(pdf))
+      zero_num_acc.Resize(num_gauss, num_stats.Dim(), num_stats.Flags());
+    if (!den_stats.IsAllocated(pdf))
+      zero_den_acc.Resize(num_gauss, den_stats.Dim(), den_stats.Flags());
+    UpdateEbwDiagGmm((num_stats.IsAllocated(pdf) ?
+                      num_stats.GetAcc(pdf) : zero_num_acc),
+                     (den_stats.IsAllocated(pdf) ?
+                      den_stats.GetAcc(pdf) : zero_den_acc), flags,
                      opts, &(am_gmm->GetPdf(pdf)), auxf_change_out,
                      count_out, num_floored_out);
+  }
 }                     
 
 
@@ -309,10 +319,20 @@ void UpdateEbwWeightsAmDiagGmm(const AccumAmDiagGmm &num_stats, // with I-smooth
   if (auxf_change_out) *auxf_change_out = 0.0;
   if (count_out) *count_out = 0.0;
   
-  for (int32 pdf = 0; pdf < num_stats.NumAccs(); pdf++)
-    UpdateEbwWeightsDiagGmm(num_stats.GetAcc(pdf), den_stats.GetAcc(pdf),
+  AccumDiagGmm zero_num_acc, zero_den_acc;  // Used for pdfs with no stats.
+  for (int32 pdf = 0; pdf < num_stats.NumAccs(); pdf++) {
+    int32 num_gauss = am_gmm->GetPdf(pdf).NumGauss();
+    if (!num_stats.IsAllocated(pdf))
+      zero_num_acc.Resize(num_gauss, num_stats.Dim(), num_stats.Flags());
+    if (!den_stats.IsAllocated(pdf))
+      zero_den_acc.Resize(num_gauss, den_stats.Dim(), den_stats.Flags());
+    UpdateEbwWeightsDiagGmm((num_stats.IsAllocated(pdf) ?
+                             num_stats.GetAcc(pdf) : zero_num_acc),
+                            (den_stats.IsAllocated(pdf) ?
+                             den_stats.GetAcc(pdf) : zero_den_acc),
                             opts, &(am_gmm->GetPdf(pdf)), auxf_change_out,
                             count_out);
+  }
 }                     
 
 void IsmoothStatsDiagGmm(const AccumDiagGmm &src_stats,
@@ -361,7 +381,9 @@ void IsmoothStatsAmDiagGmm(const AccumAmDiagGmm &src_stats,
   int num_pdfs = src_stats.NumAccs();
   KALDI_ASSERT(num_pdfs == dst_stats->NumAccs());
   for (int32 pdf = 0; pdf < num_pdfs; pdf++)
-    IsmoothStatsDiagGmm(src_stats.GetAcc(pdf), tau, &(dst_stats->GetAcc(pdf)));
+    if (src_stats.IsAllocated(pdf))  // else zero stats, which would add nothing.
+      IsmoothStatsDiagGmm(src_stats.GetAcc(pdf), tau,
+                          &(dst_stats->GetAcc(pdf)));
 }
 
 void IsmoothStatsAmDiagGmmFromModel(const AmDiagGmm &src_model,
@@ -166,10 +166,26 @@ void GetStatsDerivative(const AmDiagGmm &gmm,
   KALDI_ASSERT(num_accs.NumAccs() == num_pdfs);
   KALDI_ASSERT(den_accs.NumAccs() == num_pdfs);
   KALDI_ASSERT(ml_accs.NumAccs() == num_pdfs);
-  for (int32 pdf = 0; pdf < num_pdfs; pdf++)
-    GetStatsDerivative(gmm.GetPdf(pdf), num_accs.GetAcc(pdf), den_accs.GetAcc(pdf),
-                       ml_accs.GetAcc(pdf), min_variance, min_gaussian_occupancy,
+  // Used for pdfs with no stats; the const GetAcc() does not allocate.
+  AccumDiagGmm zero_num_acc, zero_den_acc, zero_ml_acc;
+  for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+    int32 num_gauss = gmm.GetPdf(pdf).NumGauss();
+    if (!num_accs.IsAllocated(pdf))
+      zero_num_acc.Resize(num_gauss, num_accs.Dim(), num_accs.Flags());
+    if (!den_accs.IsAllocated(pdf))
+      zero_den_acc.Resize(num_gauss, den_accs.Dim(), den_accs.Flags());
+    if (!ml_accs.IsAllocated(pdf))
+      zero_ml_acc.Resize(num_gauss, ml_accs.Dim(), ml_accs.Flags());
+    GetStatsDerivative(gmm.GetPdf(pdf),
+                       (num_accs.IsAllocated(pdf) ?
+                        num_accs.GetAcc(pdf) : zero_num_acc),
+                       (den_accs.IsAllocated(pdf) ?
+                        den_accs.GetAcc(pdf) : zero_den_acc),
+                       (ml_accs.IsAllocated(pdf) ?
+                        ml_accs.GetAcc(pdf) : zero_ml_acc),
+                       min_variance, min_gaussian_occupancy,
                        &(out_accs->GetAcc(pdf)));
+  }
   
 }
 
@@ -238,10 +254,20 @@ void DoRescalingUpdate(const AccumAmDiagGmm &old_ml_accs,
   KALDI_ASSERT(old_ml_accs.NumAccs() == num_pdfs);
   KALDI_ASSERT(new_ml_accs.NumAccs() == num_pdfs);
   double tot_count = 0.0, tot_divergence = 0.0;
-  for (int32 pdf = 0; pdf < num_pdfs; pdf++)
-    DoRescalingUpdate(old_ml_accs.GetAcc(pdf), new_ml_accs.GetAcc(pdf),
+  AccumDiagGmm zero_old_acc, zero_new_acc;  // Used for pdfs with no stats.
+  for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+    int32 num_gauss = am_gmm->GetPdf(pdf).NumGauss();
+    if (!old_ml_accs.IsAllocated(pdf))
+      zero_old_acc.Resize(num_gauss, old_ml_accs.Dim(), old_ml_accs.Flags());
+    if (!new_ml_accs.IsAllocated(pdf))
+      zero_new_acc.Resize(num_gauss, new_ml_accs.Dim(), new_ml_accs.Flags());
+    DoRescalingUpdate((old_ml_accs.IsAllocated(pdf) ?
+                       old_ml_accs.GetAcc(pdf) : zero_old_acc),
+                      (new_ml_accs.IsAllocated(pdf) ?
+                       new_ml_accs.GetAcc(pdf) : zero_new_acc),
                       min_variance, min_gaussian_occupancy, &am_gmm->GetPdf(pdf),
                       &tot_count, &tot_divergence);
+  }
   KALDI_LOG << "K-L divergence from old to new model is "
             << (tot_divergence/tot_count) << " over "
             << tot_count << " frames.";
@@ -88,6 +88,98 @@ void TestAmDiagGmmAccsIO(const AmDiagGmm &am_gmm,
   delete accs2;
 }
 
+// Tests that accumulators are only allocated for the pdfs that are touched,
+// and that the sparse format written in that case can be read back, both
+// on its own and added to the dense format.
+void TestAmDiagGmmAccsSparse(const AmDiagGmm &am_gmm,
+                             const Matrix<BaseFloat> &feats) {
+  kaldi::GmmFlagsType flags = kaldi::kGmmAll;
+  int32 num_pdfs = am_gmm.NumPdfs(), num_used = RandInt(1, num_pdfs - 1);
+  AccumAmDiagGmm accs;
+  accs.Init(am_gmm, flags);
+  KALDI_ASSERT(accs.NumAllocated() == 0 && accs.Dim() == am_gmm.Dim());
+  for (int32 i = 0; i < feats.NumRows(); i++)
+    accs.AccumulateForGmm(am_gmm, feats.Row(i), RandInt(0, num_used - 1), 1.0);
+  KALDI_ASSERT(accs.NumAllocated() <= num_used &&
+               !accs.IsAllocated(num_pdfs - 1));
+
+  for (int32 b = 0; b < 2; b++) {
+    bool binary = (b == 0), binary_in;
+    accs.Write(kaldi::Output("tmpf", binary).Stream(), binary);
+    AccumAmDiagGmm accs1;
+    {
+      kaldi::Input ki("tmpf", &binary_in);
+      accs1.Read(ki.Stream(), binary_in, false);
+    }
+    KALDI_ASSERT(accs1.NumAllocated() == accs.NumAllocated() &&
+                 accs1.NumAccs() == num_pdfs && accs1.Dim() == accs.Dim() &&
+                 accs1.Flags() == accs.Flags());
+    AssertEqual(accs1.TotStatsCount(), accs.TotStatsCount(), 1e-5);
+    // Add the sparse stats to the dense stats of a fully touched accumulator.
+    AccumAmDiagGmm accs2;
+    accs2.Init(am_gmm, flags);
+    for (int32 pdf = 0; pdf < num_pdfs; pdf++)
+      accs2.AccumulateForGmm(am_gmm, feats.Row(pdf % feats.NumRows()), pdf,
+                             1.0);
+    BaseFloat count2 = accs2.TotStatsCount();
+    accs2.Write(kaldi::Output("tmpf", binary).Stream(), binary);
+    {
+      kaldi::Input ki("tmpf", &binary_in);
+      accs1.Read(ki.Stream(), binary_in, true);
+    }
+    KALDI_ASSERT(accs1.NumAllocated() == num_pdfs);
+    AssertEqual(accs1.TotStatsCount(), accs.TotStatsCount() + count2, 1e-5);
+  }
+  // The update should work with unallocated accumulators, and not allocate
+  // them.
+  AmDiagGmm am_gmm1;
+  am_gmm1.CopyFromAmDiagGmm(am_gmm);
+  MleDiagGmmOptions config;
+  MleAmDiagGmmUpdate(config, accs, flags, &am_gmm1, NULL, NULL);
+  KALDI_ASSERT(!accs.IsAllocated(num_pdfs - 1));
+}
+
+// Tests that AccumAmDiagGmmMultiThreaded gives the same stats as accumulating
+// on a single thread.
+void TestAmDiagGmmAccsMultiThreaded(const AmDiagGmm &am_gmm,
+                                    const Matrix<BaseFloat> &feats) {
+  kaldi::GmmFlagsType flags = kaldi::kGmmAll;
+  AccumAmDiagGmm accs, accs_mt;
+  accs.Init(am_gmm, flags);
+  accs_mt.Init(am_gmm, flags);
+  int32 num_threads = RandInt(1, 4);
+  {
+    AccumAmDiagGmmMultiThreaded accumulator(am_gmm, num_threads, &accs_mt);
+    for (int32 start = 0; start < feats.NumRows(); ) {
+      int32 num_frames = std::min(RandInt(1, 100), feats.NumRows() - start);
+      Matrix<BaseFloat> utt_feats(feats.RowRange(start, num_frames));
+      std::vector<std::vector<std::pair<int32, BaseFloat> > > pdf_post(
+          num_frames);
+      for (int32 t = 0; t < num_frames; t++) {
+        int32 num_pdfs = RandInt(0, 2);
+        for (int32 i = 0; i < num_pdfs; i++) {
+          int32 pdf_id = RandInt(0, am_gmm.NumPdfs() - 1);
+          BaseFloat weight = RandUniform();
+          pdf_post[t].push_back(std::make_pair(pdf_id, weight));
+          accs.AccumulateForGmm(am_gmm, feats.Row(start + t), pdf_id, weight);
+        }
+      }
+      accumulator.AccumulateForUtterance(&utt_feats, &pdf_post);
+      KALDI_ASSERT(utt_feats.NumRows() == 0 && pdf_post.empty());
+      start += num_frames;
+    }
+  }
+  AssertEqual(accs.TotLogLike(), accs_mt.TotLogLike(), 1e-4);
+  AssertEqual(accs.TotCount(), accs_mt.TotCount(), 1e-4);
+  for (int32 i = 0; i < accs.NumAccs(); i++) {
+    const AccumDiagGmm &acc = accs.GetAcc(i), &acc_mt = accs_mt.GetAcc(i);
+    KALDI_ASSERT(acc.occupancy().ApproxEqual(acc_mt.occupancy()) &&
+                 acc.mean_accumulator().ApproxEqual(acc_mt.mean_accumulator()) &&
+                 acc.variance_accumulator().ApproxEqual(
+                     acc_mt.variance_accumulator()));
+  }
+}
+
 void UnitTestMleAmDiagGmm() {
   int32 dim = 1 + kaldi::RandInt(0, 9),  // random dimension of the gmm
       num_pdfs = 5 + kaldi::RandInt(0, 9);  // random number of states
@@ -123,6 +215,8 @@ void UnitTestMleAmDiagGmm() {
     }
   }
   TestAmDiagGmmAccsIO(am_gmm, feats);
+  TestAmDiagGmmAccsMultiThreaded(am_gmm, feats);
+  TestAmDiagGmmAccsSparse(am_gmm, feats);
 }
 
 
@@ -25,44 +25,53 @@
 namespace kaldi {
 
 const AccumDiagGmm& AccumAmDiagGmm::GetAcc(int32 index) const {
-  KALDI_ASSERT(index >= 0 && index < static_cast<int32>(gmm_accumulators_.size()));
+  KALDI_ASSERT(IsAllocated(index) && "Check IsAllocated() before GetAcc() const");
   return *(gmm_accumulators_[index]);
 }
 
 AccumDiagGmm& AccumAmDiagGmm::GetAcc(int32 index) {
   KALDI_ASSERT(index >= 0 && index < static_cast<int32>(gmm_accumulators_.size()));
+  if (gmm_accumulators_[index] == NULL) {  // allocate it on first touch.
+    gmm_accumulators_[index] = new AccumDiagGmm();
+    gmm_accumulators_[index]->Resize(num_gauss_[index], dim_, flags_);
+  }
   return *(gmm_accumulators_[index]);
 }
 
+int32 AccumAmDiagGmm::NumAllocated() const {
+  int32 ans = 0;
+  for (size_t i = 0; i < gmm_accumulators_.size(); i++)
+    if (gmm_accumulators_[i] != NULL) ans++;
+  return ans;
+}
+
 AccumAmDiagGmm::~AccumAmDiagGmm() {
   DeletePointers(&gmm_accumulators_);
 }
 
 void AccumAmDiagGmm::Init(const AmDiagGmm &model,
                               GmmFlagsType flags) {
-  DeletePointers(&gmm_accumulators_);  // in case was non-empty when called.
-  gmm_accumulators_.resize(model.NumPdfs(), NULL);
-  for (int32 i = 0; i < model.NumPdfs(); i++) {
-    gmm_accumulators_[i] = new AccumDiagGmm();
-    gmm_accumulators_[i]->Resize(model.GetPdf(i), flags);
-  }
+  Init(model, model.Dim(), flags);
 }
 
 void AccumAmDiagGmm::Init(const AmDiagGmm &model,
                               int32 dim, GmmFlagsType flags) {
   KALDI_ASSERT(dim > 0);
   DeletePointers(&gmm_accumulators_);  // in case was non-empty when called.
+  // The accumulators themselves are allocated in GetAcc(), when first used.
+  gmm_accumulators_.clear();
   gmm_accumulators_.resize(model.NumPdfs(), NULL);
-  for (int32 i = 0; i < model.NumPdfs(); i++) {
-    gmm_accumulators_[i] = new AccumDiagGmm();
-    gmm_accumulators_[i]->Resize(model.GetPdf(i).NumGauss(),
-                                 dim, flags);
-  }
+  num_gauss_.resize(model.NumPdfs());
+  for (int32 i = 0; i < model.NumPdfs(); i++)
+    num_gauss_[i] = model.GetPdf(i).NumGauss();
+  dim_ = dim;
+  flags_ = AugmentGmmFlags(flags);
 }
 
 void AccumAmDiagGmm::SetZero(GmmFlagsType flags) {
   for (size_t i = 0; i < gmm_accumulators_.size(); i++) {
-    gmm_accumulators_[i]->SetZero(flags);
+    if (gmm_accumulators_[i] != NULL)
+      gmm_accumulators_[i]->SetZero(flags);
   }
 }
 
@@ -71,8 +80,8 @@ BaseFloat AccumAmDiagGmm::AccumulateForGmm(
     int32 gmm_index, BaseFloat weight) {
   KALDI_ASSERT(static_cast<size_t>(gmm_index) < gmm_accumulators_.size());
   BaseFloat log_like =
-      gmm_accumulators_[gmm_index]->AccumulateFromDiag(model.GetPdf(gmm_index),
-                                                       data, weight);
+      GetAcc(gmm_index).AccumulateFromDiag(model.GetPdf(gmm_index),
+                                           data, weight);
   total_log_like_ += log_like * weight;
   total_frames_ += weight;
   return log_like;
@@ -86,7 +95,7 @@ BaseFloat AccumAmDiagGmm::AccumulateForGmmTwofeats(
     BaseFloat weight) {
   KALDI_ASSERT(static_cast<size_t>(gmm_index) < gmm_accumulators_.size());
   const DiagGmm &gmm = model.GetPdf(gmm_index);
-  AccumDiagGmm &acc = *(gmm_accumulators_[gmm_index]);
+  AccumDiagGmm &acc = GetAcc(gmm_index);
   Vector<BaseFloat> posteriors;
   BaseFloat log_like = gmm.ComponentPosteriors(data1, &posteriors);
   posteriors.Scale(weight);
@@ -101,7 +110,7 @@ void AccumAmDiagGmm::AccumulateFromPosteriors(
     const AmDiagGmm &model, const VectorBase<BaseFloat> &data,
     int32 gmm_index, const VectorBase<BaseFloat> &posteriors) {
   KALDI_ASSERT(gmm_index >= 0 && gmm_index < NumAccs());
-  gmm_accumulators_[gmm_index]->AccumulateFromPosteriors(data, posteriors);
+  GetAcc(gmm_index).AccumulateFromPosteriors(data, posteriors);
   total_frames_ += posteriors.Sum();
 }
 
@@ -111,7 +120,32 @@ void AccumAmDiagGmm::AccumulateForGaussian(
   KALDI_ASSERT(gmm_index >= 0 && gmm_index < NumAccs());
   KALDI_ASSERT(gauss_index >= 0
       && gauss_index < am.GetPdf(gmm_index).NumGauss());
-  gmm_accumulators_[gmm_index]->AccumulateForComponent(data, gauss_index, weight);
+  GetAcc(gmm_index).AccumulateForComponent(data, gauss_index, weight);
+}
+
+void AccumAmDiagGmm::ReadAcc(std::istream &in_stream, bool binary,
+                             int32 index) {
+  KALDI_ASSERT(index >= 0 && index < NumAccs());
+  AccumDiagGmm *&acc = gmm_accumulators_[index];
+  if (acc == NULL) {
+    acc = new AccumDiagGmm();
+    acc->Read(in_stream, binary, false);
+  } else {
+    acc->Read(in_stream, binary, true);  // add to what's there; this checks
+                                         // the sizes and flags match.
+  }
+  if (num_gauss_[index] == 0) {  // reading the dense format into a new object.
+    num_gauss_[index] = acc->NumGauss();
+    if (dim_ == 0) {
+      dim_ = acc->Dim();
+      flags_ = acc->Flags();
+    }
+  }
+  if (acc->NumGauss() != num_gauss_[index] || acc->Dim() != dim_)
+    KALDI_ERR << "Accumulator for pdf " << index << " has unexpected size "
+              << acc->NumGauss() << " x " << acc->Dim() << " vs. "
+              << num_gauss_[index] << " x " << dim_
+              << " (mixing accs from different models?)";
 }
 
 void AccumAmDiagGmm::Read(std::istream &in_stream, bool binary,
@@ -121,21 +155,50 @@ void AccumAmDiagGmm::Read(std::istream &in_stream, bool binary,
   ReadBasicType(in_stream, binary, &num_pdfs);
   KALDI_ASSERT(num_pdfs > 0);
   if (!add || (add && gmm_accumulators_.empty())) {
+    DeletePointers(&gmm_accumulators_);
+    gmm_accumulators_.clear();
     gmm_accumulators_.resize(num_pdfs, NULL);
-    for (std::vector<AccumDiagGmm*>::iterator it = gmm_accumulators_.begin(),
-             end = gmm_accumulators_.end(); it != end; ++it) {
-      if (*it != NULL) delete *it;
-      *it = new AccumDiagGmm();
-      (*it)->Read(in_stream, binary, add);
+    num_gauss_.clear();
+    num_gauss_.resize(num_pdfs, 0);  // zeros mean "not known yet".
+    dim_ = 0;
+    flags_ = 0;
+  } else if (gmm_accumulators_.size() != static_cast<size_t> (num_pdfs)) {
+    KALDI_ERR << "Adding accumulators but num-pdfs do not match: "
+              << (gmm_accumulators_.size()) << " vs. "
+              << (num_pdfs);
+  }
+  if (PeekToken(in_stream, binary) == 'S') {
+    // The sparse format written by Write() if some pdfs had no stats.
+    ExpectToken(in_stream, binary, "<SPARSE>");
+    int32 dim;
+    GmmFlagsType flags;
+    std::vector<int32> num_gauss;
+    ExpectToken(in_stream, binary, "<DIM>");
+    ReadBasicType(in_stream, binary, &dim);
+    ExpectToken(in_stream, binary, "<FLAGS>");
+    ReadBasicType(in_stream, binary, &flags);
+    ExpectToken(in_stream, binary, "<NUMGAUSS>");
+    ReadIntegerVector(in_stream, binary, &num_gauss);
+    if (dim_ == 0) {  // we did not know the sizes yet.
+      KALDI_ASSERT(num_gauss.size() == static_cast<size_t>(num_pdfs));
+      num_gauss_ = num_gauss;
+      dim_ = dim;
+      flags_ = flags;
+    } else if (dim != dim_ || flags != flags_ || num_gauss != num_gauss_) {
+      KALDI_ERR << "Adding accumulators but sizes or flags do not match "
+                << "(mixing accs from different models?)";
+    }
+    int32 num_allocated;
+    ExpectToken(in_stream, binary, "<NUMALLOCATED>");
+    ReadBasicType(in_stream, binary, &num_allocated);
+    for (int32 i = 0; i < num_allocated; i++) {
+      int32 index;
+      ReadBasicType(in_stream, binary, &index);
+      ReadAcc(in_stream, binary, index);
     }
   } else {
-    if (gmm_accumulators_.size() != static_cast<size_t> (num_pdfs))
-      KALDI_ERR << "Adding accumulators but num-pdfs do not match: "
-                << (gmm_accumulators_.size()) << " vs. "
-                << (num_pdfs);
-    for (std::vector<AccumDiagGmm*>::iterator it = gmm_accumulators_.begin(),
-             end = gmm_accumulators_.end(); it != end; ++it)
-      (*it)->Read(in_stream, binary, add);
+    for (int32 i = 0; i < num_pdfs; i++)
+      ReadAcc(in_stream, binary, i);
   }
   // TODO(arnab): Bad hack! Need to make this self-delimiting.
   in_stream.peek();  // This will set the EOF bit for older accs.
@@ -151,12 +214,33 @@ void AccumAmDiagGmm::Read(std::istream &in_stream, bool binary,
 }
 
 void AccumAmDiagGmm::Write(std::ostream &out_stream, bool binary) const {
-  int32 num_pdfs = gmm_accumulators_.size();
+  int32 num_pdfs = gmm_accumulators_.size(),
+      num_allocated = NumAllocated();
   WriteToken(out_stream, binary, "<NUMPDFS>");
   WriteBasicType(out_stream, binary, num_pdfs);
-  for (std::vector<AccumDiagGmm*>::const_iterator it =
-      gmm_accumulators_.begin(), end = gmm_accumulators_.end(); it != end; ++it) {
-    (*it)->Write(out_stream, binary);
+  if (num_allocated == num_pdfs) {
+    for (std::vector<AccumDiagGmm*>::const_iterator it =
+        gmm_accumulators_.begin(), end = gmm_accumulators_.end(); it != end; ++it) {
+      (*it)->Write(out_stream, binary);
+    }
+  } else {
+    // Sparse format: we write the sizes of all the pdfs, so the reader can
+    // allocate them later, and the stats only of those that were touched.
+    WriteToken(out_stream, binary, "<SPARSE>");
+    WriteToken(out_stream, binary, "<DIM>");
+    WriteBasicType(out_stream, binary, dim_);
+    WriteToken(out_stream, binary, "<FLAGS>");
+    WriteBasicType(out_stream, binary, flags_);
+    WriteToken(out_stream, binary, "<NUMGAUSS>");
+    WriteIntegerVector(out_stream, binary, num_gauss_);
+    WriteToken(out_stream, binary, "<NUMALLOCATED>");
+    WriteBasicType(out_stream, binary, num_allocated);
+    for (int32 i = 0; i < num_pdfs; i++) {
+      if (gmm_accumulators_[i] != NULL) {
+        WriteBasicType(out_stream, binary, i);
+        gmm_accumulators_[i]->Write(out_stream, binary);
+      }
+    }
   }
   WriteToken(out_stream, binary, "<total_like>");
   WriteBasicType(out_stream, binary, total_log_like_);
@@ -206,8 +290,13 @@ void MleAmDiagGmmUpdate (const MleDiagGmmOptions &config,
   BaseFloat *p_obj = (obj_change_out != NULL) ? &tmp_obj_change : NULL,
             *p_count   = (count_out != NULL) ? &tmp_count : NULL;
 
+  AccumDiagGmm zero_acc;  // Used for pdfs that have no stats.
   for (int32 i = 0; i < am_diag_gmm_acc.NumAccs(); i++) {
-    MleDiagGmmUpdate(config, am_diag_gmm_acc.GetAcc(i), flags,
+    if (!am_diag_gmm_acc.IsAllocated(i))  // Avoid allocating all of them.
+      zero_acc.Resize(am_gmm->GetPdf(i).NumGauss(), am_diag_gmm_acc.Dim(),
+                      am_diag_gmm_acc.Flags());
+    MleDiagGmmUpdate(config, (am_diag_gmm_acc.IsAllocated(i) ?
+                              am_diag_gmm_acc.GetAcc(i) : zero_acc), flags,
                      &(am_gmm->GetPdf(i)), p_obj, p_count);
 
     if (obj_change_out != NULL) *obj_change_out += tmp_obj_change;
@@ -230,8 +319,13 @@ void MapAmDiagGmmUpdate (const MapDiagGmmOptions &config,
   BaseFloat *p_obj = (obj_change_out != NULL) ? &tmp_obj_change : NULL,
       *p_count   = (count_out != NULL) ? &tmp_count : NULL;
 
+  AccumDiagGmm zero_acc;  // Used for pdfs that have no stats.
   for (int32 i = 0; i < am_diag_gmm_acc.NumAccs(); i++) {
-    MapDiagGmmUpdate(config, am_diag_gmm_acc.GetAcc(i), flags,
+    if (!am_diag_gmm_acc.IsAllocated(i))  // Avoid allocating all of them.
+      zero_acc.Resize(am_gmm->GetPdf(i).NumGauss(), am_diag_gmm_acc.Dim(),
+                      am_diag_gmm_acc.Flags());
+    MapDiagGmmUpdate(config, (am_diag_gmm_acc.IsAllocated(i) ?
+                              am_diag_gmm_acc.GetAcc(i) : zero_acc), flags,
                      &(am_gmm->GetPdf(i)), p_obj, p_count);
 
     if (obj_change_out != NULL) *obj_change_out += tmp_obj_change;
@@ -243,16 +337,18 @@ void MapAmDiagGmmUpdate (const MapDiagGmmOptions &config,
 BaseFloat AccumAmDiagGmm::TotStatsCount() const {
   double ans = 0.0;
   for (int32 i = 0; i < NumAccs(); i++) {
-    const AccumDiagGmm &acc = GetAcc(i);
-    ans += acc.occupancy().Sum();
+    if (IsAllocated(i))
+      ans += GetAcc(i).occupancy().Sum();
   }
   return ans;
 }
 
 void AccumAmDiagGmm::Scale(BaseFloat scale) {
   for (int32 i = 0; i < NumAccs(); i++) {
-    AccumDiagGmm &acc = GetAcc(i);
-    acc.Scale(scale, acc.Flags());
+    if (IsAllocated(i)) {
+      AccumDiagGmm &acc = GetAcc(i);
+      acc.Scale(scale, acc.Flags());
+    }
   }
   total_frames_ *= scale;
   total_log_like_ *= scale;
@@ -265,7 +361,108 @@ void AccumAmDiagGmm::Add(BaseFloat scale, const AccumAmDiagGmm &other) {
   int32 num_accs = NumAccs();
   KALDI_ASSERT(num_accs == other.NumAccs());
   for (int32 i = 0; i < num_accs; i++)
-    gmm_accumulators_[i]->Add(scale, *(other.gmm_accumulators_[i]));
+    if (other.IsAllocated(i))  // Only touch the pdfs that have stats.
+      GetAcc(i).Add(scale, other.GetAcc(i));
+}
+
+
+class AccumAmDiagGmmMultiThreaded::AccumulateClass: public MultiThreadable {
+ public:
+  // This constructor is only called for a temporary object that we pass to
+  // the MultiThreader.
+  AccumulateClass(const AmDiagGmm &model,
+                  AccumAmDiagGmmMultiThreaded *repository,
+                  AccumAmDiagGmm *dest_accs):
+      model_(&model), repository_(repository), dest_accs_(dest_accs),
+      accs_(NULL) { }
+
+  // The following constructor is called once for each thread, inside the
+  // MultiThreader.  We don't allocate the accumulator here because
+  // thread_id_ is not set yet.
+  AccumulateClass(const AccumulateClass &other):
+      model_(other.model_), repository_(other.repository_),
+      dest_accs_(other.dest_accs_), accs_(NULL) { }
+
+  void operator () () {
+    if (thread_id_ == 0) {
+      accs_ = dest_accs_;  // No need for a separate accumulator.
+    } else {
+      accs_ = new AccumAmDiagGmm();
+      accs_->Init(*model_, dest_accs_->Dim(), dest_accs_->Flags());
+    }
+    Matrix<BaseFloat> feats;
+    std::vector<std::vector<std::pair<int32, BaseFloat> > > pdf_post;
+    while (repository_->ProvideUtterance(&feats, &pdf_post)) {
+      KALDI_ASSERT(static_cast<int32>(pdf_post.size()) == feats.NumRows());
+      for (size_t t = 0; t < pdf_post.size(); t++) {
+        for (size_t i = 0; i < pdf_post[t].size(); i++)
+          accs_->AccumulateForGmm(*model_, feats.Row(t), pdf_post[t][i].first,
+                                  pdf_post[t][i].second);
+      }
+    }
+    KALDI_VLOG(2) << "Thread " << thread_id_ << " saw average likelihood/frame "
+                  << (accs_->TotLogLike() / accs_->TotCount()) << " over "
+                  << accs_->TotCount() << " (weighted) frames.";
+  }
+
+  // The destructors are called sequentially, after the threads have been
+  // re-joined.
+  ~AccumulateClass() {
+    if (accs_ != NULL && accs_ != dest_accs_) {
+      dest_accs_->Add(1.0, *accs_);
+      delete accs_;
+    }
+  }
+ private:
+  const AmDiagGmm *model_;
+  AccumAmDiagGmmMultiThreaded *repository_;
+  AccumAmDiagGmm *dest_accs_;
+  AccumAmDiagGmm *accs_;  // Equals dest_accs_ for thread zero.
+};
+
+AccumAmDiagGmmMultiThreaded::AccumAmDiagGmmMultiThreaded(
+    const AmDiagGmm &model, int32 num_threads, AccumAmDiagGmm *accs):
+    done_(false), empty_semaphore_(1) {
+  KALDI_ASSERT(num_threads > 0 && accs->NumAccs() == model.NumPdfs());
+  AccumulateClass c(model, this, accs);
+  // This spawns the threads.
+  threader_ = new MultiThreader<AccumulateClass>(num_threads, c);
+}
+
+void AccumAmDiagGmmMultiThreaded::AccumulateForUtterance(
+    Matrix<BaseFloat> *feats,
+    std::vector<std::vector<std::pair<int32, BaseFloat> > > *pdf_post) {
+  KALDI_ASSERT(static_cast<int32>(pdf_post->size()) == feats->NumRows());
+  empty_semaphore_.Wait();
+  KALDI_ASSERT(!done_);
+  feats_.Swap(feats);
+  pdf_post_.swap(*pdf_post);
+  full_semaphore_.Signal();
+}
+
+bool AccumAmDiagGmmMultiThreaded::ProvideUtterance(
+    Matrix<BaseFloat> *feats,
+    std::vector<std::vector<std::pair<int32, BaseFloat> > > *pdf_post) {
+  full_semaphore_.Wait();
+  if (done_) {
+    full_semaphore_.Signal();  // So the next thread's call won't block.
+    return false;
+  }
+  feats->Swap(&feats_);
+  pdf_post->swap(pdf_post_);
+  feats_.Resize(0, 0);
+  pdf_post_.clear();
+  empty_semaphore_.Signal();
+  return true;
+}
+
+AccumAmDiagGmmMultiThreaded::~AccumAmDiagGmmMultiThreaded() {
+  empty_semaphore_.Wait();
+  done_ = true;
+  full_semaphore_.Signal();
+  // The destructor of the MultiThreader re-joins the threads, and the
+  // destructors of the AccumulateClass objects add up the stats.
+  delete threader_;
 }
 
 }  // namespace kaldi
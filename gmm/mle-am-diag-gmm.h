@@ -28,19 +28,29 @@
 #include "gmm/am-diag-gmm.h"
 #include "gmm/mle-diag-gmm.h"
 #include "util/common-utils.h"
+#include "thread/kaldi-semaphore.h"
+#include "thread/kaldi-thread.h"
 
 namespace kaldi {
 
+/// Accumulators for an AmDiagGmm.  The accumulator for each pdf is only
+/// allocated when it is first touched (by accumulating stats for it, by
+/// calling the non-const GetAcc() for it, or by reading stats for it), so
+/// that for large tied-state models a job that sees only some of the pdfs
+/// uses memory only for those.  If some pdfs were never touched, Write()
+/// writes a sparse format that omits them; Read() accepts both this and the
+/// dense format.
 class AccumAmDiagGmm {
  public:
-  AccumAmDiagGmm() : total_frames_(0.0), total_log_like_(0.0) {}
+  AccumAmDiagGmm() : dim_(0), flags_(0), total_frames_(0.0),
+                     total_log_like_(0.0) {}
   ~AccumAmDiagGmm();
 
   void Read(std::istream &in_stream, bool binary, bool add = false);
   void Write(std::ostream &out_stream, bool binary) const;
 
   /// Initializes accumulators for each GMM based on the number of components
-  /// and dimension.
+  /// and dimension (they are actually allocated on first use).
   void Init(const AmDiagGmm &model, GmmFlagsType flags);
   /// Initialization using different dimension than model.
   void Init(const AmDiagGmm &model, int32 dim, GmmFlagsType flags);
@@ -83,23 +93,47 @@ class AccumAmDiagGmm {
   BaseFloat TotCount() const { return total_frames_; }
   BaseFloat TotLogLike() const { return total_log_like_; }
 
+  /// Returns the accumulator for this pdf, which must have been allocated:
+  /// check IsAllocated() first (if it is not, its stats are all zero).
   const AccumDiagGmm& GetAcc(int32 index) const;
 
+  /// Returns the accumulator for this pdf, allocating it (with zero stats) if
+  /// it was not allocated yet.
   AccumDiagGmm& GetAcc(int32 index);
 
+  /// Returns true if the accumulator for this pdf has been allocated; if
+  /// not, its stats are all zero.
+  bool IsAllocated(int32 index) const {
+    KALDI_ASSERT(static_cast<size_t>(index) < gmm_accumulators_.size());
+    return (gmm_accumulators_[index] != NULL);
+  }
+
+  /// Returns the number of pdfs whose accumulators have been allocated.
+  int32 NumAllocated() const;
+
   void Add(BaseFloat scale, const AccumAmDiagGmm &other);
 
   void Scale(BaseFloat scale);
 
-  int32 Dim() const {
-    return (gmm_accumulators_.empty() || !gmm_accumulators_[0] ?
-            0 : gmm_accumulators_[0]->Dim());
-  }
+  int32 Dim() const { return dim_; }
+
+  /// The flags that the accumulators were initialized with.
+  GmmFlagsType Flags() const { return flags_; }
 
  private:
-  /// MLE accumulators and update methods for the GMMs
+  /// MLE accumulators and update methods for the GMMs; NULL for pdfs that
+  /// have not been touched yet.
   std::vector<AccumDiagGmm*> gmm_accumulators_;
 
+  /// The number of Gaussians in each pdf, and the dimension and flags, which
+  /// we need to allocate accumulators when they are first touched.
+  std::vector<int32> num_gauss_;
+  int32 dim_;
+  GmmFlagsType flags_;
+
+  // Reads the stats for one pdf, adding them to any that are already there.
+  void ReadAcc(std::istream &in_stream, bool binary, int32 index);
+
   /// Total counts & likelihood (for diagnostics)
   double total_frames_, total_log_like_;
 
@@ -107,6 +141,56 @@ class AccumAmDiagGmm {
   KALDI_DISALLOW_COPY_AND_ASSIGN(AccumAmDiagGmm);
 };
 
+/// This class is for accumulating stats for an AmDiagGmm from many utterances
+/// using multiple threads, as in gmm-acc-stats-ali and gmm-acc-stats.  The
+/// calling thread reads the data and passes it in one utterance at a time
+/// using AccumulateForUtterance(), and the worker threads take the utterances
+/// as they become free.  Each worker thread except the first accumulates into
+/// its own AccumAmDiagGmm, and these are added to the output accumulator when
+/// the threads are re-joined in the destructor; so the output accumulator
+/// must not be accessed until this object has been destroyed.
+class AccumAmDiagGmmMultiThreaded {
+ public:
+  /// "accs" must already have been initialized by calling Init(); its
+  /// dimension and flags are used for the per-thread accumulators.
+  AccumAmDiagGmmMultiThreaded(const AmDiagGmm &model,
+                              int32 num_threads,
+                              AccumAmDiagGmm *accs);
+
+  /// Gives one utterance to the worker threads; this will block until one of
+  /// them is ready to take it.  "pdf_post" is a list of (pdf-id, weight)
+  /// pairs for each frame of "feats" (it has the same type as Posterior
+  /// in hmm/posterior.h, but with pdf-ids instead of transition-ids).  To
+  /// avoid copying, "feats" and "pdf_post" are swapped with empty objects.
+  void AccumulateForUtterance(
+      Matrix<BaseFloat> *feats,
+      std::vector<std::vector<std::pair<int32, BaseFloat> > > *pdf_post);
+
+  /// Waits for the worker threads to finish and adds their stats to the
+  /// output accumulator.
+  ~AccumAmDiagGmmMultiThreaded();
+
+ private:
+  class AccumulateClass;  // Runs in each thread; defined in the .cc file.
+
+  // Called by the worker threads; returns false when there are no utterances
+  // left.
+  bool ProvideUtterance(
+      Matrix<BaseFloat> *feats,
+      std::vector<std::vector<std::pair<int32, BaseFloat> > > *pdf_post);
+
+  // The single utterance waiting to be taken by a worker thread, and the
+  // semaphores that guard it, as in class ExamplesRepository in nnet2.
+  Matrix<BaseFloat> feats_;
+  std::vector<std::vector<std::pair<int32, BaseFloat> > > pdf_post_;
+  bool done_;
+  Semaphore full_semaphore_;
+  Semaphore empty_semaphore_;
+
+  MultiThreader<AccumulateClass> *threader_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(AccumAmDiagGmmMultiThreaded);
+};
+
 /// for computing the maximum-likelihood estimates of the parameters of
 /// an acoustic model that uses diagonal Gaussian mixture models as emission densities.
 void MleAmDiagGmmUpdate(const MleDiagGmmOptions &config,
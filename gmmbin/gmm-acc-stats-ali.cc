@@ -39,7 +39,10 @@ int main(int argc, char *argv[]) {
 
     ParseOptions po(usage);
     bool binary = true;
+    int32 num_threads = 1;
     po.Register("binary", &binary, "Write output in binary mode");
+    po.Register("num-threads", &num_threads, "Number of threads used for "
+                "statistics accumulation");
     po.Read(argc, argv);
 
     if (po.NumArgs() != 4) {
@@ -66,21 +69,23 @@ int main(int argc, char *argv[]) {
     AccumAmDiagGmm gmm_accs;
     gmm_accs.Init(am_gmm, kGmmAll);
 
-    double tot_like = 0.0;
-    kaldi::int64 tot_t = 0;
-
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
     RandomAccessInt32VectorReader alignments_reader(alignments_rspecifier);
 
     int32 num_done = 0, num_err = 0;
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      std::string key = feature_reader.Key();
-      if (!alignments_reader.HasKey(key)) {
-        KALDI_WARN << "No alignment for utterance " << key;
-        num_err++;
-      } else {
-        const Matrix<BaseFloat> &mat = feature_reader.Value();
+    {
+      // The worker threads accumulate the GMM stats; the transition stats
+      // are cheap, so we accumulate them here.
+      AccumAmDiagGmmMultiThreaded accumulator(am_gmm, num_threads, &gmm_accs);
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        std::string key = feature_reader.Key();
+        if (!alignments_reader.HasKey(key)) {
+          KALDI_WARN << "No alignment for utterance " << key;
+          num_err++;
+          continue;
+        }
         const std::vector<int32> &alignment = alignments_reader.Value(key);
+        Matrix<BaseFloat> mat(feature_reader.Value());
 
         if (alignment.size() != mat.NumRows()) {
           KALDI_WARN << "Alignments has wrong size " << (alignment.size())
@@ -89,31 +94,28 @@ int main(int argc, char *argv[]) {
           continue;
         }
 
-        num_done++;
-        BaseFloat tot_like_this_file = 0.0;
-
+        std::vector<std::vector<std::pair<int32, BaseFloat> > > pdf_post(
+            alignment.size());
         for (size_t i = 0; i < alignment.size(); i++) {
           int32 tid = alignment[i],  // transition identifier.
               pdf_id = trans_model.TransitionIdToPdf(tid);
           trans_model.Accumulate(1.0, tid, &transition_accs);
-          tot_like_this_file += gmm_accs.AccumulateForGmm(am_gmm, mat.Row(i),
-                                                          pdf_id, 1.0);
-        }
-        tot_like += tot_like_this_file;
-        tot_t += alignment.size();
-        if (num_done % 50 == 0) {
-          KALDI_LOG << "Processed " << num_done << " utterances; for utterance "
-                    << key << " avg. like is "
-                    << (tot_like_this_file/alignment.size())
-                    << " over " << alignment.size() <<" frames.";
+          pdf_post[i].push_back(std::make_pair(pdf_id, 1.0));
         }
+        accumulator.AccumulateForUtterance(&mat, &pdf_post);
+        num_done++;
+        if (num_done % 50 == 0)
+          KALDI_LOG << "Processed " << num_done << " utterances.";
       }
+      // The destructor of "accumulator" waits for the threads to finish and
+      // sums their stats into gmm_accs.
     }
     KALDI_LOG << "Done " << num_done << " files, " << num_err
               << " with errors.";
 
     KALDI_LOG << "Overall avg like per frame (Gaussian only) = "
-              << (tot_like/tot_t) << " over " << tot_t << " frames.";
+              << (gmm_accs.TotLogLike() / gmm_accs.TotCount()) << " over "
+              << gmm_accs.TotCount() << " frames.";
 
     {
       Output ko(accs_wxfilename, binary);
@@ -42,9 +42,12 @@ int main(int argc, char *argv[]) {
     bool binary = true;
     std::string update_flags_str = "mvwt"; // note: t is ignored, we acc
     // transition stats regardless.
+    int32 num_threads = 1;
     po.Register("binary", &binary, "Write output in binary mode");
     po.Register("update-flags", &update_flags_str, "Which GMM parameters will be "
                 "updated: subset of mvwt.");
+    po.Register("num-threads", &num_threads, "Number of threads used for "
+                "statistics accumulation");
     po.Read(argc, argv);
 
     if (po.NumArgs() != 4) {
@@ -72,21 +75,23 @@ int main(int argc, char *argv[]) {
     AccumAmDiagGmm gmm_accs;
     gmm_accs.Init(am_gmm, StringToGmmFlags(update_flags_str));
 
-    double tot_like = 0.0;
-    double tot_t = 0.0;
-
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
     RandomAccessPosteriorReader posteriors_reader(posteriors_rspecifier);
 
     int32 num_done = 0, num_err = 0;
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      std::string key = feature_reader.Key();
-      if (!posteriors_reader.HasKey(key)) {
-        KALDI_WARN << "Could not find posteriors for utterance " << key;
-        num_err++;
-      } else {
-        const Matrix<BaseFloat> &mat = feature_reader.Value();
+    {
+      // The worker threads accumulate the GMM stats; the transition stats
+      // are cheap, so we accumulate them here.
+      AccumAmDiagGmmMultiThreaded accumulator(am_gmm, num_threads, &gmm_accs);
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        std::string key = feature_reader.Key();
+        if (!posteriors_reader.HasKey(key)) {
+          KALDI_WARN << "Could not find posteriors for utterance " << key;
+          num_err++;
+          continue;
+        }
         const Posterior &posterior = posteriors_reader.Value(key);
+        Matrix<BaseFloat> mat(feature_reader.Value());
 
         if (static_cast<int32>(posterior.size()) != mat.NumRows()) {
           KALDI_WARN << "Posterior vector has wrong size " 
@@ -96,43 +101,32 @@ int main(int argc, char *argv[]) {
           continue;
         }
 
-        num_done++;
-        BaseFloat tot_like_this_file = 0.0, tot_weight = 0.0;
-
-        Posterior pdf_posterior;
-        ConvertPosteriorToPdfs(trans_model, posterior, &pdf_posterior);
+        // Accumulates for transitions.
         for (size_t i = 0; i < posterior.size(); i++) {
-          // Accumulates for GMM.
-          for (size_t j = 0; j < pdf_posterior[i].size(); j++) {
-            int32 pdf_id = pdf_posterior[i][j].first;
-            BaseFloat weight = pdf_posterior[i][j].second;
-            tot_like_this_file += gmm_accs.AccumulateForGmm(am_gmm, mat.Row(i), pdf_id, weight)
-                * weight;
-            tot_weight += weight;
-          }
-
-          // Accumulates for transitions.
           for (size_t j = 0; j < posterior[i].size(); j++) {
             int32 tid = posterior[i][j].first;
             BaseFloat weight = posterior[i][j].second;
             trans_model.Accumulate(weight, tid, &transition_accs);
           }
         }
-        if (num_done % 50 == 0) {
-          KALDI_LOG << "Processed " << num_done << " utterances; for utterance "
-                    << key << " avg. like is " << (tot_like_this_file/tot_weight)
-                    << " over " << tot_weight <<" frames.";
-        }
-        tot_like += tot_like_this_file;
-        tot_t += tot_weight;
+        // Accumulates for GMM.
+        Posterior pdf_posterior;
+        ConvertPosteriorToPdfs(trans_model, posterior, &pdf_posterior);
+        accumulator.AccumulateForUtterance(&mat, &pdf_posterior);
+        num_done++;
+        if (num_done % 50 == 0)
+          KALDI_LOG << "Processed " << num_done << " utterances.";
       }
+      // The destructor of "accumulator" waits for the threads to finish and
+      // sums their stats into gmm_accs.
     }
 
     KALDI_LOG << "Done " << num_done << " files, " << num_err
               << " with errors.";
     
     KALDI_LOG << "Overall avg like per frame (Gaussian only) = "
-              << (tot_like/tot_t) << " over " << tot_t << " frames.";
+              << (gmm_accs.TotLogLike() / gmm_accs.TotCount()) << " over "
+              << gmm_accs.TotCount() << " frames.";
 
     {
       Output ko(accs_wxfilename, binary);
@@ -75,6 +75,10 @@ int main(int argc, char *argv[]) {
         "Note: lattices, if output, will just be linear sequences; use gmm-latgen-faster\n"
         "  if you want \"real\" lattices.\n";
     ParseOptions po(usage);
+    bool packed_model = false, use_gselect = false;
+    std::string gselect_ubm_rxfilename;
+    AmDiagGmmGselectOptions gselect_opts;
+    UbmClusteringOptions ubm_opts;
     bool allow_partial = true;
     BaseFloat acoustic_scale = 0.1;
     
@@ -87,6 +91,17 @@ int main(int argc, char *argv[]) {
                 "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial,
                 "Produce output even when final state was not reached");
+    po.Register("packed-model", &packed_model,
+                "If true, compute likelihoods with a packed copy of the model "
+                "(faster, same results up to roundoff).");
+    po.Register("gselect", &use_gselect,
+                "If true, use Gaussian selection with a UBM to speed up "
+                "likelihood computation (approximate).");
+    po.Register("gselect-ubm", &gselect_ubm_rxfilename,
+                "UBM to use for Gaussian selection (e.g. from init-ubm); if "
+                "not supplied, it is obtained by clustering the model.");
+    gselect_opts.Register(&po);
+    ubm_opts.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() < 4 || po.NumArgs() > 6) {
@@ -109,6 +124,20 @@ int main(int argc, char *argv[]) {
       trans_model.Read(ki.Stream(), binary);
       am_gmm.Read(ki.Stream(), binary);
     }
+    AmDiagGmmPacked packed_gmm;
+    if (packed_model)
+      packed_gmm.Init(am_gmm);
+    AmDiagGmmGselect gselect;
+    AmDiagGmmGselectStats gselect_stats;
+    if (use_gselect) {
+      if (gselect_ubm_rxfilename != "") {
+        DiagGmm ubm;
+        ReadKaldiObject(gselect_ubm_rxfilename, &ubm);
+        gselect.Init(am_gmm, ubm, gselect_opts);
+      } else {
+        gselect.Init(am_gmm, ubm_opts, gselect_opts);
+      }
+    }
 
     Int32VectorWriter words_writer(words_wspecifier);
 
@@ -150,7 +179,13 @@ int main(int argc, char *argv[]) {
 
       DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
                                              acoustic_scale);
+      if (packed_model)
+        gmm_decodable.SetPackedModel(&packed_gmm);
+      if (use_gselect)
+        gmm_decodable.SetGselect(&gselect);
       decoder.Decode(&gmm_decodable);
+      if (use_gselect)
+        gselect_stats.Add(gmm_decodable.GselectStats());
 
       fst::VectorFst<LatticeArc> decoded;  // linear FST.
 
@@ -213,6 +248,8 @@ int main(int argc, char *argv[]) {
               << num_fail;
     KALDI_LOG << "Overall log-likelihood per frame is " << (tot_like/frame_count) << " over "
               << frame_count<<" frames.";
+    if (use_gselect)
+      gselect_stats.Print();
 
     if (word_syms) delete word_syms;    
     delete decode_fst;
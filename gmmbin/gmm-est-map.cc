@@ -107,7 +107,8 @@ int main(int argc, char *argv[]) {
       Vector<BaseFloat> state_occs;
       state_occs.Resize(gmm_accs.NumAccs());
       for (int i = 0; i < gmm_accs.NumAccs(); i++)
-        state_occs(i) = gmm_accs.GetAcc(i).occupancy().Sum();
+        state_occs(i) = (gmm_accs.IsAllocated(i) ?
+                         gmm_accs.GetAcc(i).occupancy().Sum() : 0.0);
       bool binary = false;
       WriteKaldiObject(state_occs, occs_out_filename, binary);
     }
@@ -122,7 +122,8 @@ int main(int argc, char *argv[]) {
       Vector<BaseFloat> pdf_occs;
       pdf_occs.Resize(gmm_accs.NumAccs());
       for (int i = 0; i < gmm_accs.NumAccs(); i++)
-        pdf_occs(i) = gmm_accs.GetAcc(i).occupancy().Sum();
+        pdf_occs(i) = (gmm_accs.IsAllocated(i) ?
+                      gmm_accs.GetAcc(i).occupancy().Sum() : 0.0);
 
       if (mixdown != 0)
         am_gmm.MergeByCount(pdf_occs, mixdown, power, min_count);
@@ -45,6 +45,10 @@ int main(int argc, char *argv[]) {
         " lattice-wspecifier [ words-wspecifier [alignments-wspecifier] ]\n";
     ParseOptions po(usage);
     Timer timer;
+    bool packed_model = false, use_gselect = false;
+    std::string gselect_ubm_rxfilename;
+    AmDiagGmmGselectOptions gselect_opts;
+    UbmClusteringOptions ubm_opts;
     bool allow_partial = false;
     BaseFloat acoustic_scale = 0.1;
     LatticeFasterDecoderConfig config;
@@ -57,6 +61,17 @@ int main(int argc, char *argv[]) {
                 "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial,
                 "If true, produce output even if end state was not reached.");
+    po.Register("packed-model", &packed_model,
+                "If true, compute likelihoods with a packed copy of the model "
+                "(faster, same results up to roundoff).");
+    po.Register("gselect", &use_gselect,
+                "If true, use Gaussian selection with a UBM to speed up "
+                "likelihood computation (approximate).");
+    po.Register("gselect-ubm", &gselect_ubm_rxfilename,
+                "UBM to use for Gaussian selection (e.g. from init-ubm); if "
+                "not supplied, it is obtained by clustering the model.");
+    gselect_opts.Register(&po);
+    ubm_opts.Register(&po);
     
     po.Read(argc, argv);
 
@@ -80,6 +95,20 @@ int main(int argc, char *argv[]) {
       trans_model.Read(ki.Stream(), binary);
       am_gmm.Read(ki.Stream(), binary);
     }
+    AmDiagGmmPacked packed_gmm;
+    if (packed_model)
+      packed_gmm.Init(am_gmm);
+    AmDiagGmmGselect gselect;
+    AmDiagGmmGselectStats gselect_stats;
+    if (use_gselect) {
+      if (gselect_ubm_rxfilename != "") {
+        DiagGmm ubm;
+        ReadKaldiObject(gselect_ubm_rxfilename, &ubm);
+        gselect.Init(am_gmm, ubm, gselect_opts);
+      } else {
+        gselect.Init(am_gmm, ubm_opts, gselect_opts);
+      }
+    }
 
     bool determinize = config.determinize_lattice;
     CompactLatticeWriter compact_lattice_writer;
@@ -106,7 +135,8 @@ int main(int argc, char *argv[]) {
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
       SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
       // Input FST is just one FST, not a table of FSTs.
-      VectorFst<StdArc> *decode_fst = fst::ReadFstKaldi(fst_in_str);
+      // It may be of type "vector", "const" or "decode" (see fstmakedecodefst).
+      Fst<StdArc> *decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
       
       {
         LatticeFasterDecoder decoder(*decode_fst, config);
@@ -123,6 +153,10 @@ int main(int argc, char *argv[]) {
           
           DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
                                                  acoustic_scale);
+          if (packed_model)
+            gmm_decodable.SetPackedModel(&packed_gmm);
+          if (use_gselect)
+            gmm_decodable.SetGselect(&gselect);
 
           double like;
           if (DecodeUtteranceLatticeFaster(
@@ -134,6 +168,8 @@ int main(int argc, char *argv[]) {
             frame_count += features.NumRows();
             num_done++;
           } else num_err++;
+          if (use_gselect)
+            gselect_stats.Add(gmm_decodable.GselectStats());
         }
       }
       delete decode_fst; // delete this only after decoder goes out of scope.
@@ -158,6 +194,10 @@ int main(int argc, char *argv[]) {
         LatticeFasterDecoder decoder(fst_reader.Value(), config);
         DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
                                                acoustic_scale);
+        if (packed_model)
+          gmm_decodable.SetPackedModel(&packed_gmm);
+        if (use_gselect)
+          gmm_decodable.SetGselect(&gselect);
         double like;
         if (DecodeUtteranceLatticeFaster(
                 decoder, gmm_decodable, trans_model, word_syms, utt,
@@ -168,6 +208,8 @@ int main(int argc, char *argv[]) {
           frame_count += features.NumRows();
           num_done++;
         } else num_err++;
+        if (use_gselect)
+          gselect_stats.Add(gmm_decodable.GselectStats());
       }
     }
       
@@ -179,6 +221,8 @@ int main(int argc, char *argv[]) {
               << num_err;
     KALDI_LOG << "Overall log-likelihood per frame is " << (tot_like/frame_count) << " over "
               << frame_count << " frames.";
+    if (use_gselect)
+      gselect_stats.Print();
 
     if (word_syms) delete word_syms;
     if (num_done != 0) return 0;
@@ -44,6 +44,25 @@ class DecodableInterface {
   /// Returns the log likelihood, which will be negated in the decoder.
   virtual BaseFloat LogLikelihood(int32 frame, int32 index) = 0;
 
+  /// Batch version of LogLikelihood(): sets (*loglikes)[i] to
+  /// LogLikelihood(frame, indices[i]) for each i, resizing *loglikes to
+  /// indices.size().  The decoders call this with the distinct indices that
+  /// are active on a frame.  The default implementation just calls
+  /// LogLikelihood() for each index; decodable objects that can do better by
+  /// computing many likelihoods together (e.g. by vectorizing over pdfs)
+  /// should override it, and should also override HasBatchLogLikelihoods().
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &indices,
+                              std::vector<BaseFloat> *loglikes) {
+    loglikes->resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+      (*loglikes)[i] = LogLikelihood(frame, indices[i]);
+  }
+
+  /// Returns true if this object overrides LogLikelihoods() with something
+  /// more efficient than the default; the decoders only go to the trouble of
+  /// collecting the active indices for a frame if this returns true.
+  virtual bool HasBatchLogLikelihoods() { return false; }
+
   /// Returns true if this is the last frame.  Frames are one-based.
   virtual bool IsLastFrame(int32 frame) = 0;
 
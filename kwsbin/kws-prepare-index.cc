@@ -0,0 +1,83 @@
+// kwsbin/kws-prepare-index.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "fstext/decode-fst.h"
+#include "lat/kaldi-kws.h"
+#include "lat/kws-functions.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Prepare an index for search, once, in the way that kws-search does\n"
+        "it each time it is run (moving the disambiguation symbols on the final\n"
+        "arcs to the output side and sorting the arcs), and write it as a\n"
+        "single FST of type \"decode\", which kws-search-server memory-maps.\n"
+        "The output should be a file, not a pipe, for the memory-mapping to be\n"
+        "possible.  Note that the index archive has a only key \"global\".\n"
+        "\n"
+        "Usage: kws-prepare-index [options]  index-rspecifier prepared-index-wxfilename\n"
+        " e.g.: kws-prepare-index ark:index.idx index.pidx\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string index_rspecifier = po.GetArg(1),
+        index_wxfilename = po.GetArg(2);
+
+    RandomAccessTableReader< VectorFstTplHolder<KwsLexicographicArc> >
+        index_reader(index_rspecifier);
+
+    // Index has key "global"
+    KwsLexicographicFst index = index_reader.Value("global");
+    std::vector<int32> label_to_uid;
+    PrepareKwsIndexForSearch(&index, &label_to_uid);
+    // The utterance ids are stored as the output symbol table of the index.
+    SymbolTable *symtab = KwsLabelsToSymbolTable(label_to_uid);
+    index.SetOutputSymbols(symtab);
+    delete symtab;
+
+    DecodeFstTpl<KwsLexicographicArc> prepared_index(index);
+
+    bool binary = true, write_header = false;
+    Output ko(index_wxfilename, binary, write_header);
+    if (!prepared_index.Write(ko.Stream(),
+                              FstWriteOptions(PrintableWxfilename(
+                                  index_wxfilename))))
+      KALDI_ERR << "Error writing prepared index to "
+                << PrintableWxfilename(index_wxfilename);
+    KALDI_LOG << "Wrote prepared index with " << prepared_index.NumStates()
+              << " states and " << (label_to_uid.size() - 1)
+              << " final-arc labels.";
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,260 @@
+// kwsbin/kws-search-server.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "fstext/decode-fst.h"
+#include "lat/kaldi-kws.h"
+#include "lat/kws-functions.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+typedef fst::DecodeFstTpl<KwsLexicographicArc> KwsDecodeFst;
+
+// Reads an index written by kws-prepare-index; it is memory-mapped if it is
+// in a file.
+KwsDecodeFst *ReadPreparedKwsIndex(const std::string &rxfilename) {
+  KwsDecodeFst *index = NULL;
+  if (ClassifyRxfilename(rxfilename) == kFileInput) {
+    index = KwsDecodeFst::Read(rxfilename);
+  } else {
+    Input ki(rxfilename);
+    index = KwsDecodeFst::Read(ki.Stream(),
+                               fst::FstReadOptions(rxfilename));
+  }
+  if (index == NULL)
+    KALDI_ERR << "Could not read prepared index from "
+              << PrintableRxfilename(rxfilename)
+              << " (was it written by kws-prepare-index?)";
+  return index;
+}
+
+// A prepared index shard, with its table from labels to utterance ids.
+// Compose() makes copies of the index, and the reference count of its
+// implementation is not thread-safe, so the tasks that search the shard at the
+// same time must not share an index object.  We keep a pool of handles on the
+// index, one per thread, and each task borrows one while it searches.  If the
+// index is in a file, each handle maps the file separately (the pages are still
+// shared in memory); otherwise the first handle is copied.
+class KwsIndexShard {
+ public:
+  KwsIndexShard(const std::string &rxfilename, int32 num_handles) {
+    KwsDecodeFst *index = ReadPreparedKwsIndex(rxfilename);
+    if (index->OutputSymbols() == NULL ||
+        !KwsLabelsFromSymbolTable(*(index->OutputSymbols()), &label_to_uid_))
+      KALDI_ERR << "Index in " << PrintableRxfilename(rxfilename)
+                << " does not have the utterance-id table; was it written "
+                << "by kws-prepare-index?";
+    KALDI_LOG << "Read prepared index with " << index->NumStates()
+              << " states from " << PrintableRxfilename(rxfilename);
+    handles_.push_back(index);
+    bool is_file = (ClassifyRxfilename(rxfilename) == kFileInput);
+    for (int32 i = 1; i < num_handles; i++) {
+      if (is_file) {
+        handles_.push_back(ReadPreparedKwsIndex(rxfilename));
+      } else {  // Use the Fst constructor, not the copy constructor, as the
+                // copy would share the implementation.
+        const fst::Fst<KwsLexicographicArc> &fst = *index;
+        handles_.push_back(new KwsDecodeFst(fst));
+      }
+    }
+  }
+
+  ~KwsIndexShard() { DeletePointers(&handles_); }
+
+  // Takes a handle on the index from the pool; give it back with Release().
+  KwsDecodeFst *Acquire() {
+    mutex_.Lock();
+    KALDI_ASSERT(!handles_.empty());
+    KwsDecodeFst *index = handles_.back();
+    handles_.pop_back();
+    mutex_.Unlock();
+    return index;
+  }
+
+  void Release(KwsDecodeFst *index) {
+    mutex_.Lock();
+    handles_.push_back(index);
+    mutex_.Unlock();
+  }
+
+  const std::vector<int32> &LabelToUid() const { return label_to_uid_; }
+
+ private:
+  std::vector<KwsDecodeFst*> handles_;  // The handles not in use.
+  Mutex mutex_;  // Protects handles_.
+  std::vector<int32> label_to_uid_;
+};
+
+// The state shared by the tasks that search for the same keyword in the
+// different shards; it is only accessed from their destructors.
+struct KwsKeyword {
+  std::string key;
+  bool found;  // True if found in any shard.
+};
+
+// Searches for a keyword in one shard of the index.
+class KwsSearchTask {
+ public:
+  // The task for the last shard takes ownership of "keyword" (the tasks for
+  // the same keyword are destroyed in order, so it is the last to use it).
+  // Each task makes its own copy of "keyword_fst", as the tasks for the
+  // different shards of a keyword run at the same time.
+  KwsSearchTask(const KwsSearchOptions &opts,
+                KwsIndexShard *shard,
+                bool is_last_shard,
+                KwsKeyword *keyword,
+                const fst::VectorFst<fst::StdArc> &keyword_fst,
+                TableWriter<BasicVectorHolder<double> > *result_writer,
+                int32 *n_done,
+                int32 *n_fail):
+      opts_(opts), shard_(shard), is_last_shard_(is_last_shard),
+      keyword_(keyword), found_(false), num_bad_(0),
+      result_writer_(result_writer), n_done_(n_done), n_fail_(n_fail) {
+    CopyKeywordFst(keyword_fst, &keyword_fst_);
+  }
+
+  void operator () () {
+    KwsDecodeFst *index = shard_->Acquire();
+    found_ = SearchKwsIndex(opts_, *index, shard_->LabelToUid(),
+                            keyword_->key, keyword_fst_,
+                            &results_, &num_bad_);
+    shard_->Release(index);
+  }
+
+  // The destructor is called sequentially, in the order the tasks were
+  // given to the TaskSequencer, so this is where we write the output.
+  ~KwsSearchTask() {
+    for (size_t i = 0; i < results_.size(); i++)
+      result_writer_->Write(keyword_->key, results_[i]);
+    keyword_->found = keyword_->found || found_;
+    (*n_fail_) += num_bad_;
+    if (is_last_shard_) {
+      if (keyword_->found)
+        (*n_done_)++;
+      delete keyword_;
+    }
+  }
+ private:
+  const KwsSearchOptions &opts_;
+  KwsIndexShard *shard_;
+  bool is_last_shard_;
+  KwsKeyword *keyword_;
+  fst::VectorFst<fst::StdArc> keyword_fst_;
+  bool found_;
+  int32 num_bad_;
+  std::vector<std::vector<double> > results_;
+  TableWriter<BasicVectorHolder<double> > *result_writer_;
+  int32 *n_done_;
+  int32 *n_fail_;
+};
+
+} // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Search for keywords in an index that was prepared by kws-prepare-index;\n"
+        "the output is the same as that of kws-search.  The prepared index is\n"
+        "memory-mapped, so it is loaded almost instantly and shared between\n"
+        "processes; and the keywords are searched for in parallel (see\n"
+        "--num-threads), writing the results in the order of the input.  This\n"
+        "program can be left running as a search server, reading keyword FSTs\n"
+        "as they arrive on the standard input (or a named pipe) and writing\n"
+        "the results for each one as soon as it is done, if you use the ,f\n"
+        "(flush) option on the output, as in the second example.\n"
+        "The index may consist of several shards, each prepared separately from\n"
+        "the index of a different set of utterances; they are searched in\n"
+        "parallel, and the results are written in the order of the shards.  So\n"
+        "to add new utterances you just need to index them (lattice-to-kws-index,\n"
+        "kws-index-union and kws-prepare-index) and add the new shard, without\n"
+        "rebuilding the rest of the index.\n"
+        "\n"
+        "Usage: kws-search-server [options]  prepared-index-rxfilename-1 "
+        "[prepared-index-rxfilename-2 ...] keywords-rspecifier results-wspecifier\n"
+        " e.g.: kws-search-server --num-threads=8 index.pidx ark:keywords.fsts ark:results\n"
+        "       kws-search-server index.1.pidx index.2.pidx ark:- ark,t,f:-\n";
+
+    ParseOptions po(usage);
+
+    bool strict = true;
+    KwsSearchOptions search_opts;
+    TaskSequencerConfig sequencer_config; // has --num-threads option
+
+    po.Register("strict", &strict, "Affects the return status of the program.");
+    search_opts.Register(&po);
+    sequencer_config.Register(&po);
+
+    po.Read(argc, argv);
+    search_opts.Check();
+
+    if (po.NumArgs() < 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    int32 num_shards = po.NumArgs() - 2;
+    std::string keyword_rspecifier = po.GetArg(num_shards + 1),
+        result_wspecifier = po.GetArg(num_shards + 2);
+
+    // Each worker thread needs its own handle on each shard.
+    int32 num_handles = std::max(sequencer_config.num_threads, 1);
+    std::vector<KwsIndexShard*> shards(num_shards);
+    for (int32 i = 0; i < num_shards; i++)
+      shards[i] = new KwsIndexShard(po.GetArg(i + 1), num_handles);
+
+    SequentialTableReader<VectorFstHolder> keyword_reader(keyword_rspecifier);
+    TableWriter< BasicVectorHolder<double> > result_writer(result_wspecifier);
+
+    int32 n_done = 0, n_fail = 0, n_keywords = 0;
+    {
+      TaskSequencer<KwsSearchTask> sequencer(sequencer_config);
+      for (; !keyword_reader.Done(); keyword_reader.Next()) {
+        KwsKeyword *keyword = new KwsKeyword();
+        keyword->key = keyword_reader.Key();
+        keyword->found = false;
+        const VectorFst<StdArc> &keyword_fst = keyword_reader.Value();
+        for (int32 i = 0; i < num_shards; i++)
+          sequencer.Run(new KwsSearchTask(search_opts, shards[i],
+                                          (i + 1 == num_shards), keyword,
+                                          keyword_fst,
+                                          &result_writer, &n_done, &n_fail));
+        n_keywords++;
+      }
+      sequencer.Wait();
+    }
+    DeletePointers(&shards);
+
+    KALDI_LOG << "Done " << n_done << " keywords out of " << n_keywords
+              << "; " << n_fail << " hits had unexpected structure.";
+    if (strict == true)
+      return (n_done != 0 ? 0 : 1);
+    else
+      return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
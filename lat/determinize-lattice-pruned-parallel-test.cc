@@ -0,0 +1,115 @@
+// lat/determinize-lattice-pruned-parallel-test.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lat/determinize-lattice-pruned-parallel.h"
+#include "fstext/lattice-utils.h"
+#include "fstext/fst-test-utils.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/lattice-functions.h"
+
+namespace kaldi {
+
+// Creates a random lattice that is the concatenation of several random
+// acyclic lattices, so it has cut states where it can be split.
+static void CreateRandomLongLattice(int32 num_pieces, Lattice *lat) {
+  using namespace fst;
+  lat->DeleteStates();
+  for (int32 i = 0; i < num_pieces; i++) {
+    RandFstOptions opts;
+    opts.n_states = 4;
+    opts.n_arcs = 10;
+    opts.n_final = 2;
+    opts.allow_empty = false;
+    opts.weight_multiplier = 0.5; // so the weights are exactly representable.
+    opts.acyclic = true;
+    VectorFst<LatticeArc> *piece = RandPairFst<LatticeArc>(opts);
+    Connect(piece);
+    if (piece->Start() != kNoStateId) {
+      if (lat->Start() == kNoStateId) *lat = *piece;
+      else Concat(lat, *piece);
+    }
+    delete piece;
+  }
+  bool sorted = TopSort(lat);
+  KALDI_ASSERT(sorted);
+  ArcSort(lat, ILabelCompare<LatticeArc>());
+}
+
+void TestDeterminizeLatticePrunedParallel() {
+  int32 num_pieces = 1 + rand() % 8;
+  Lattice lat;
+  CreateRandomLongLattice(num_pieces, &lat);
+  if (lat.Start() == fst::kNoStateId)
+    return;
+
+  std::vector<int32> cut_states;
+  GetLatticeCutStates(lat, &cut_states);
+  KALDI_ASSERT(!cut_states.empty() && cut_states[0] == 0);
+
+  double beam = 10.0;
+  fst::DeterminizeLatticePrunedOptions opts;
+  DeterminizeLatticePrunedParallelOptions par_opts;
+  par_opts.num_threads = 1 + rand() % 4;
+  par_opts.min_segment_arcs = 1 + rand() % 10;
+  CompactLattice det_clat;
+  bool ans = DeterminizeLatticePrunedParallel(lat, beam, &det_clat, opts,
+                                              par_opts);
+  KALDI_ASSERT(det_clat.Properties(fst::kIDeterministic, true) &
+               fst::kIDeterministic);
+
+  // Compare with the pruned, non-determinized lattice, as in
+  // determinize-lattice-pruned-test.cc.
+  Lattice pruned_lat(lat);
+  PruneLattice(beam, &pruned_lat);
+  CompactLattice pruned_clat;
+  ConvertLattice(pruned_lat, &pruned_clat, false);
+  if (ans)
+    KALDI_ASSERT(fst::RandEquivalent(det_clat, pruned_clat, 5/*paths*/,
+                                     0.01/*delta*/, rand()/*seed*/,
+                                     100/*path length, max*/));
+  KALDI_LOG << "Lattice with " << lat.NumStates() << " states and "
+            << cut_states.size() << " cut states determinized to "
+            << det_clat.NumStates() << " states with "
+            << par_opts.num_threads << " threads.";
+}
+
+// Checks that a state that no arc reaches is not treated as a cut state.
+void TestGetLatticeCutStatesUnreachable() {
+  Lattice lat;
+  for (int32 s = 0; s < 4; s++)
+    lat.AddState();
+  lat.SetStart(0);
+  lat.AddArc(0, LatticeArc(1, 1, LatticeWeight::One(), 1));
+  lat.AddArc(2, LatticeArc(2, 2, LatticeWeight::One(), 3));  // 2 unreachable.
+  lat.SetFinal(3, LatticeWeight::One());
+  std::vector<int32> cut_states;
+  GetLatticeCutStates(lat, &cut_states);
+  KALDI_ASSERT(std::find(cut_states.begin(), cut_states.end(), 2) ==
+               cut_states.end());
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  TestGetLatticeCutStatesUnreachable();
+  for (int32 i = 0; i < 100; i++)
+    TestDeterminizeLatticePrunedParallel();
+  std::cout << "Tests succeeded\n";
+}
@@ -0,0 +1,232 @@
+// lat/determinize-lattice-pruned-parallel.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lat/determinize-lattice-pruned-parallel.h"
+#include "thread/kaldi-thread.h"
+
+namespace kaldi {
+
+void GetLatticeCutStates(const Lattice &lat, std::vector<int32> *cut_states) {
+  typedef LatticeArc::StateId StateId;
+  cut_states->clear();
+  if (lat.Start() != 0 ||
+      lat.Properties(fst::kTopSorted, true) == 0)
+    return;
+  StateId num_states = lat.NumStates(),
+      max_nextstate = 0;  // Highest destination of arcs from states before s.
+  bool seen_final = false;  // True if a state before s is final.
+  for (StateId s = 0; s < num_states; s++) {
+    // For s > 0 we need max_nextstate == s, not just <= s: a state that no
+    // earlier arc reaches is not on any successful path, and cutting there
+    // would leave the previous segment with no arcs into its final state.
+    if ((s == 0 || max_nextstate == s) && !seen_final)
+      cut_states->push_back(s);
+    if (lat.Final(s) != LatticeWeight::Zero())
+      seen_final = true;
+    for (fst::ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next())
+      max_nextstate = std::max(max_nextstate, aiter.Value().nextstate);
+  }
+}
+
+// Gets the first state of each segment that the lattice will be split into;
+// the first one is always zero.  Each segment has at least
+// "min_segment_arcs" arcs, and we aim for about one segment per thread.
+static void GetLatticeSegments(
+    const Lattice &lat,
+    const DeterminizeLatticePrunedParallelOptions &par_opts,
+    std::vector<int32> *segment_begin) {
+  typedef LatticeArc::StateId StateId;
+  segment_begin->clear();
+  std::vector<int32> cut_states;
+  GetLatticeCutStates(lat, &cut_states);
+  if (cut_states.empty())
+    return;
+  StateId num_states = lat.NumStates();
+  // arcs_before[s] is the number of arcs leaving states before s.
+  std::vector<int64> arcs_before(num_states + 1, 0);
+  for (StateId s = 0; s < num_states; s++)
+    arcs_before[s + 1] = arcs_before[s] + lat.NumArcs(s);
+  int64 num_arcs = arcs_before[num_states],
+      target_arcs = std::max<int64>(par_opts.min_segment_arcs,
+                                    num_arcs / par_opts.num_threads);
+  segment_begin->push_back(0);
+  for (size_t i = 0; i < cut_states.size(); i++) {
+    StateId s = cut_states[i];
+    if (arcs_before[s] - arcs_before[segment_begin->back()] >= target_arcs &&
+        num_arcs - arcs_before[s] >= par_opts.min_segment_arcs)
+      segment_begin->push_back(s);
+  }
+}
+
+// Creates segment "segment" of the lattice.  The last segment contains the
+// states from segment_begin.back() to the end; the others end at the first
+// state of the next segment, which is made final with unit weight (its arcs
+// and its original final-prob belong to the next segment).
+static void CreateLatticeSegment(const Lattice &lat,
+                                 const std::vector<int32> &segment_begin,
+                                 int32 segment,
+                                 Lattice *seg_lat) {
+  typedef LatticeArc::StateId StateId;
+  bool is_last = (segment + 1 == static_cast<int32>(segment_begin.size()));
+  StateId begin = segment_begin[segment],
+      end = (is_last ? lat.NumStates() - 1 : segment_begin[segment + 1]);
+  seg_lat->DeleteStates();
+  for (StateId s = begin; s <= end; s++)
+    seg_lat->AddState();
+  seg_lat->SetStart(0);
+  for (StateId s = begin; s <= end; s++) {
+    if (s == end && !is_last) {
+      seg_lat->SetFinal(s - begin, LatticeWeight::One());
+      continue;
+    }
+    seg_lat->SetFinal(s - begin, lat.Final(s));
+    for (fst::ArcIterator<Lattice> aiter(lat, s); !aiter.Done();
+         aiter.Next()) {
+      LatticeArc arc = aiter.Value();
+      KALDI_ASSERT(arc.nextstate > s && arc.nextstate <= end);
+      arc.nextstate -= begin;
+      seg_lat->AddArc(s - begin, arc);
+    }
+  }
+}
+
+class DeterminizeLatticeSegmentsClass: public MultiThreadable {
+ public:
+  DeterminizeLatticeSegmentsClass(
+      const Lattice &lat,
+      const std::vector<int32> &segment_begin,
+      double prune,
+      const fst::DeterminizeLatticePrunedOptions &opts,
+      std::vector<CompactLattice> *det_segments,
+      std::vector<char> *success):
+      lat_(&lat), segment_begin_(&segment_begin), prune_(prune), opts_(opts),
+      det_segments_(det_segments), success_(success) { }
+
+  void operator () () {
+    // Each thread extracts the segments it works on from the (read-only)
+    // input, so we never have more than num_threads_ of them in memory.
+    for (size_t i = thread_id_; i < segment_begin_->size(); i += num_threads_) {
+      Lattice seg_lat;
+      CreateLatticeSegment(*lat_, *segment_begin_, i, &seg_lat);
+      (*success_)[i] = fst::DeterminizeLatticePruned(seg_lat, prune_,
+                                                     &((*det_segments_)[i]),
+                                                     opts_);
+    }
+  }
+ private:
+  const Lattice *lat_;
+  const std::vector<int32> *segment_begin_;
+  double prune_;
+  fst::DeterminizeLatticePrunedOptions opts_;
+  std::vector<CompactLattice> *det_segments_;
+  std::vector<char> *success_;
+};
+
+bool DeterminizeLatticePrunedParallel(
+    const Lattice &ifst,
+    double prune,
+    CompactLattice *ofst,
+    const fst::DeterminizeLatticePrunedOptions &opts,
+    const DeterminizeLatticePrunedParallelOptions &par_opts) {
+  typedef CompactLatticeArc::StateId StateId;
+  std::vector<int32> segment_begin;
+  if (par_opts.num_threads > 1)
+    GetLatticeSegments(ifst, par_opts, &segment_begin);
+  int32 num_segments = segment_begin.size();
+  if (num_segments <= 1)
+    return fst::DeterminizeLatticePruned(ifst, prune, ofst, opts);
+
+  int32 num_threads = std::min(par_opts.num_threads, num_segments);
+  // The segments don't have a limit on the size of their output, which
+  // applies to the final determinization; the memory limit is shared by the
+  // segments that are processed at the same time.
+  fst::DeterminizeLatticePrunedOptions seg_opts(opts);
+  seg_opts.max_states = -1;
+  seg_opts.max_arcs = -1;
+  if (opts.max_mem > 0)
+    seg_opts.max_mem = std::max(1, opts.max_mem / num_threads);
+
+  std::vector<CompactLattice> det_segments(num_segments);
+  std::vector<char> success(num_segments, 0);
+  {
+    DeterminizeLatticeSegmentsClass c(ifst, segment_begin, prune, seg_opts,
+                                      &det_segments, &success);
+    MultiThreader<DeterminizeLatticeSegmentsClass> m(num_threads, c);
+  }
+  bool ans = true;
+  for (int32 i = 0; i < num_segments; i++)
+    if (!success[i]) ans = false;
+
+  // Concatenate the determinized segments: the final-probs of each segment
+  // become epsilon arcs to the start state of the next one.
+  CompactLattice concat;
+  StateId prev_offset = -1;
+  for (int32 i = 0; i < num_segments; i++) {
+    const CompactLattice &seg = det_segments[i];
+    if (seg.Start() == fst::kNoStateId) {  // Empty result: nothing survives.
+      ofst->DeleteStates();
+      return false;
+    }
+    StateId offset = concat.NumStates();
+    for (StateId s = 0; s < seg.NumStates(); s++)
+      concat.AddState();
+    if (i == 0) {
+      concat.SetStart(offset + seg.Start());
+    } else {
+      const CompactLattice &prev_seg = det_segments[i - 1];
+      for (StateId s = 0; s < prev_seg.NumStates(); s++) {
+        CompactLatticeWeight final = prev_seg.Final(s);
+        if (final != CompactLatticeWeight::Zero())
+          concat.AddArc(prev_offset + s,
+                        CompactLatticeArc(0, 0, final, offset + seg.Start()));
+      }
+    }
+    bool is_last = (i + 1 == num_segments);
+    for (StateId s = 0; s < seg.NumStates(); s++) {
+      if (is_last)
+        concat.SetFinal(offset + s, seg.Final(s));
+      for (fst::ArcIterator<CompactLattice> aiter(seg, s); !aiter.Done();
+           aiter.Next()) {
+        CompactLatticeArc arc = aiter.Value();
+        arc.nextstate += offset;
+        concat.AddArc(offset + s, arc);
+      }
+    }
+    prev_offset = offset;
+  }
+  det_segments.clear();
+
+  // Convert back to the input format (the words were on the input side and
+  // the determinization put the transition-ids in the strings), and
+  // determinize the concatenation.
+  Lattice concat_lat;
+  ConvertLattice(concat, &concat_lat, false);
+  concat.DeleteStates();
+  TopSort(&concat_lat);
+  fst::ArcSort(&concat_lat, fst::ILabelCompare<LatticeArc>());
+  KALDI_VLOG(2) << "Determinized " << num_segments << " segments with "
+                << num_threads << " threads; final determinization is on "
+                << concat_lat.NumStates() << " states, versus "
+                << ifst.NumStates() << " originally.";
+  if (!fst::DeterminizeLatticePruned(concat_lat, prune, ofst, opts))
+    ans = false;
+  return ans;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,97 @@
+// lat/determinize-lattice-pruned-parallel.h
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_LAT_DETERMINIZE_LATTICE_PRUNED_PARALLEL_H_
+#define KALDI_LAT_DETERMINIZE_LATTICE_PRUNED_PARALLEL_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/determinize-lattice-pruned.h"
+
+namespace kaldi {
+
+/*
+   This header provides a version of DeterminizeLatticePruned() that uses
+   several threads to determinize a single (long) lattice.
+
+   The lattice is split at "cut states": states that every successful path
+   goes through (with the states in topological order, these are the states
+   s such that no arc goes from a state before s to a state after s, and no
+   state before s is final).  These typically occur at points in the
+   utterance, like silences, where the lattice narrows down to one state.  If
+   the lattice is split into segments at such states, it is the concatenation
+   of the segments, so we can determinize the segments in parallel,
+   concatenate the results, and determinize once more; this last
+   determinization is on a much smaller lattice than the original one so it
+   is fast.  The result is equivalent to that of DeterminizeLatticePruned():
+   since every path goes through all the cut states, a path that is within
+   "prune" of the best path overall is within "prune" of the best path in each
+   segment, so the pruning of the segments does not remove anything that
+   would have been kept, and the final determinization applies the beam to
+   the whole lattice.
+ */
+
+struct DeterminizeLatticePrunedParallelOptions {
+  int32 num_threads;  // Number of threads used for a single lattice.
+  int32 min_segment_arcs;  // We don't split the lattice into segments with
+                           // fewer than this many arcs.
+  DeterminizeLatticePrunedParallelOptions(): num_threads(1),
+                                             min_segment_arcs(20000) { }
+  void Register(OptionsItf *po) {
+    po->Register("num-threads-per-lattice", &num_threads, "Number of threads "
+                 "used to determinize a single lattice, which is split into "
+                 "segments at states that all paths pass through.  Note: the "
+                 "--max-mem limit is shared between the threads.");
+    po->Register("min-segment-arcs", &min_segment_arcs, "When determinizing "
+                 "with --num-threads-per-lattice > 1, the minimum number of "
+                 "arcs in a segment of the lattice.");
+  }
+};
+
+/// Returns, in topological order, the "cut states" of "lat": states that all
+/// successful paths pass through.  Apart from the start state, a cut state
+/// must be reached by at least one arc, and no arc from an earlier state may
+/// go beyond it.  "lat" is expected to be topologically sorted, with start
+/// state zero; if it is not, this returns an empty list.
+void GetLatticeCutStates(const Lattice &lat, std::vector<int32> *cut_states);
+
+/// This is like DeterminizeLatticePruned() [with CompactLattice output], but
+/// it splits the lattice into segments at cut states and determinizes them in
+/// parallel, using up to par_opts.num_threads threads; see the comment at the
+/// top of this file.  As for DeterminizeLatticePruned(), "ifst" must be
+/// topologically sorted, and it is recommended to sort on ilabel.  The
+/// --max-mem limit in "opts" is divided between the segments that are being
+/// determinized at the same time, so the total memory stays bounded as it
+/// does with one thread.  If the lattice cannot be usefully split, this just
+/// calls DeterminizeLatticePruned().  Returns false if the determinization of
+/// any segment, or the final one, terminated early (see
+/// DeterminizeLatticePruned()).
+bool DeterminizeLatticePrunedParallel(
+    const Lattice &ifst,
+    double prune,
+    CompactLattice *ofst,
+    const fst::DeterminizeLatticePrunedOptions &opts,
+    const DeterminizeLatticePrunedParallelOptions &par_opts);
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_DETERMINIZE_LATTICE_PRUNED_PARALLEL_H_
@@ -193,7 +193,8 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   LatticeDeterminizerPruned(const ExpandedFst<Arc> &ifst,
                             double beam,
                             DeterminizeLatticePrunedOptions opts):
-      num_arcs_(0), num_elems_(0), ifst_(ifst.Copy()), beam_(beam), opts_(opts),
+      num_arcs_(0), num_elems_(0), peak_mem_(0), ifst_(ifst.Copy()),
+      beam_(beam), opts_(opts),
       equal_(opts_.delta), determinized_(false),
       minimal_hash_(3, hasher_, equal_), initial_hash_(3, hasher_, equal_) {
     KALDI_ASSERT(Weight::Properties() & kIdempotent); // this algorithm won't
@@ -223,7 +224,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     
     for (typename InitialSubsetHash::iterator iter = initial_hash_.begin();
          iter != initial_hash_.end(); ++iter)
-      delete iter->first;
+      delete iter->first.subset;
     { InitialSubsetHash tmp; tmp.swap(initial_hash_); }
     for (size_t i = 0; i < output_states_.size(); i++) {
       vector<Element> tmp;
@@ -277,7 +278,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     for (typename InitialSubsetHash::const_iterator
              iter = initial_hash_.begin();
          iter != initial_hash_.end(); ++iter) {
-      const vector<Element> &vec = *(iter->first);
+      const vector<Element> &vec = *(iter->first.subset);
       Element elem = iter->second;
       AddStrings(vec, &needed_strings);
       needed_strings.push_back(elem.string);
@@ -291,11 +292,21 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     repository_.Rebuild(needed_strings);
   }
   
+  // Returns the (approximate) memory used by the algorithm in bytes, as
+  // compared with opts_.max_mem, and keeps track of the peak.  This is cheap
+  // (the sizes are all kept as counts).
+  int32 MemoryUsage(int32 *repo_size, int32 *arcs_size, int32 *elems_size) {
+    *repo_size = repository_.MemSize();
+    *arcs_size = num_arcs_ * sizeof(TempArc);
+    *elems_size = num_elems_ * sizeof(Element);
+    int32 total_size = *repo_size + *arcs_size + *elems_size;
+    peak_mem_ = std::max(peak_mem_, total_size);
+    return total_size;
+  }
+
   bool CheckMemoryUsage() {
-    int32 repo_size = repository_.MemSize(),
-        arcs_size = num_arcs_ * sizeof(TempArc),
-        elems_size = num_elems_ * sizeof(Element),
-        total_size = repo_size + arcs_size + elems_size;
+    int32 repo_size, arcs_size, elems_size,
+        total_size = MemoryUsage(&repo_size, &arcs_size, &elems_size);
     if (opts_.max_mem > 0 && total_size > opts_.max_mem) { // We passed the memory threshold.
       // This is usually due to the repository getting large, so we
       // clean this out.
@@ -339,6 +350,8 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     // output, call one of the Output routines.
 
     InitializeDeterminization(); // some start-up tasks.
+    int32 repo_size, arcs_size, elems_size;
+    MemoryUsage(&repo_size, &arcs_size, &elems_size);  // update peak_mem_.
     while (!queue_.empty()) {
       Task *task = queue_.top();
       // Note: the queue contains only tasks that are "within the beam".
@@ -369,8 +382,19 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
       queue_.pop();
       ProcessTransition(task->state, task->label, &(task->subset));
       delete task;
+      // The memory usage only grows in InitializeDeterminization() and
+      // ProcessTransition(), and only shrinks when CheckMemoryUsage() rebuilds
+      // the repository, which it does after calling MemoryUsage(); so
+      // measuring it here makes peak_mem_ the exact peak.
+      MemoryUsage(&repo_size, &arcs_size, &elems_size);
     }
     determinized_ = true;
+    int32 total_size = MemoryUsage(&repo_size, &arcs_size, &elems_size);
+    KALDI_VLOG(1) << "Determinized lattice to " << output_states_.size()
+                  << " states and " << num_arcs_ << " arcs; approximate memory "
+                  << "used was " << total_size << " bytes at the end (repo,arcs,"
+                  << "elems) = (" << repo_size << "," << arcs_size << ","
+                  << elems_size << "), peak was " << peak_mem_ << " bytes.";
     if (effective_beam != NULL) {
       if (queue_.empty()) *effective_beam = beam_;
       else
@@ -419,7 +443,9 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   };
 
   // Hashing function used in hash of subsets.
-  // A subset is a pointer to vector<Element>.
+  // A subset is a pointer to vector<Element>; the keys of our hashes are
+  // SubsetRef, which also contains the hash value, so we compute it only once
+  // per subset (not, for instance, each time the hash is resized).
   // The Elements are in sorted order on state id, and without repeated states.
   // Because the order of Elements is fixed, we can use a hashing function that is
   // order-dependent.  However the weights are not included in the hashing function--
@@ -431,24 +457,35 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   // Instead we apply the delta when comparing subsets for equality, and allow a small
   // difference.
 
+  static size_t HashSubset(const vector<Element> &subset) {  // hashes only the state and string.
+    size_t hash = 0, factor = 1;
+    for (typename vector<Element>::const_iterator iter= subset.begin(); iter != subset.end(); ++iter) {
+      hash *= factor;
+      hash += iter->state + reinterpret_cast<size_t>(iter->string);
+      factor *= 23531;  // these numbers are primes.
+    }
+    return hash;
+  }
+
+  struct SubsetRef {
+    const vector<Element> *subset;
+    size_t hash;
+    explicit SubsetRef(const vector<Element> *s): subset(s),
+                                                  hash(HashSubset(*s)) { }
+  };
+
   class SubsetKey {
    public:
-    size_t operator ()(const vector<Element> * subset) const {  // hashes only the state and string.
-      size_t hash = 0, factor = 1;
-      for (typename vector<Element>::const_iterator iter= subset->begin(); iter != subset->end(); ++iter) {
-        hash *= factor;
-        hash += iter->state + reinterpret_cast<size_t>(iter->string);
-        factor *= 23531;  // these numbers are primes.
-      }
-      return hash;
-    }
+    size_t operator ()(const SubsetRef &ref) const { return ref.hash; }
   };
 
   // This is the equality operator on subsets.  It checks for exact match on state-id
   // and string, and approximate match on weights.
   class SubsetEqual {
    public:
-    bool operator ()(const vector<Element> * s1, const vector<Element> * s2) const {
+    bool operator ()(const SubsetRef &r1, const SubsetRef &r2) const {
+      if (r1.hash != r2.hash) return false;
+      const vector<Element> *s1 = r1.subset, *s2 = r2.subset;
       size_t sz = s1->size();
       KALDI_ASSERT(sz>=0);
       if (sz != s2->size()) return false;
@@ -485,7 +522,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
 
   // Define the hash type we use to map subsets (in minimal
   // representation) to OutputStateId.
-  typedef unordered_map<const vector<Element>*, OutputStateId,
+  typedef unordered_map<SubsetRef, OutputStateId,
                         SubsetKey, SubsetEqual> MinimalSubsetHash;
 
   // Define the hash type we use to map subsets (in initial
@@ -493,7 +530,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   // extra weight. [note: we interpret the Element.state in here
   // as an OutputStateId even though it's declared as InputStateId;
   // these types are the same anyway].
-  typedef unordered_map<const vector<Element>*, Element,
+  typedef unordered_map<SubsetRef, Element,
                         SubsetKey, SubsetEqual> InitialSubsetHash;
   
 
@@ -522,7 +559,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   OutputStateId MinimalToStateId(const vector<Element> &subset,
                                  const double forward_cost) {
     typename MinimalSubsetHash::const_iterator iter
-        = minimal_hash_.find(&subset);
+        = minimal_hash_.find(SubsetRef(&subset));
     if (iter != minimal_hash_.end()) { // Found a matching subset.
       OutputStateId state_id = iter->second;
       const OutputState &state = *(output_states_[state_id]);
@@ -533,10 +570,11 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
                    << forward_cost << ", "
                    << state.forward_cost;
       }
+      return state_id;
     }
     OutputStateId state_id = static_cast<OutputStateId>(output_states_.size());
     OutputState *new_state = new OutputState(subset, forward_cost);
-    minimal_hash_[&(new_state->minimal_subset)] = state_id;
+    minimal_hash_[SubsetRef(&(new_state->minimal_subset))] = state_id;
     output_states_.push_back(new_state);
     num_elems_ += subset.size();
     // Note: in the previous algorithm, we pushed the new state-id onto the queue
@@ -555,7 +593,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
                                  Weight *remaining_weight,
                                  StringId *common_prefix) {
     typename InitialSubsetHash::const_iterator iter
-        = initial_hash_.find(&subset_in);
+        = initial_hash_.find(SubsetRef(&subset_in));
     if (iter != initial_hash_.end()) { // Found a matching subset.
       const Element &elem = iter->second;
       *remaining_weight = elem.weight;
@@ -591,7 +629,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     // we process the same initial subset.
     vector<Element> *initial_subset_ptr = new vector<Element>(subset_in);
     elem.state = ans;
-    initial_hash_[initial_subset_ptr] = elem;
+    initial_hash_[SubsetRef(initial_subset_ptr)] = elem;
     num_elems_ += initial_subset_ptr->size(); // keep track of memory usage.
     return ans;
   }
@@ -1089,7 +1127,8 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
       output_states_.push_back(initial_state);
       num_elems_ += subset.size();
       OutputStateId initial_state_id = 0;
-      minimal_hash_[&(initial_state->minimal_subset)] = initial_state_id;
+      minimal_hash_[SubsetRef(&(initial_state->minimal_subset))] =
+          initial_state_id;
       ProcessFinal(initial_state_id);
       ProcessTransitions(initial_state_id); // this will add tasks to
       // the queue, which we'll start processing in Determinize().
@@ -1119,7 +1158,10 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   int num_arcs_; // keep track of memory usage: number of arcs in output_states_[ ]->arcs
   int num_elems_; // keep track of memory usage: number of elems in output_states_ and
   // the keys of initial_hash_
-  
+  int32 peak_mem_; // the peak of the approximate memory usage, in bytes, as
+                   // measured by MemoryUsage(); see Determinize() for why this
+                   // is the exact peak of that measure.
+
   const ExpandedFst<Arc> *ifst_;
   std::vector<double> backward_costs_; // This vector stores, for every state in ifst_,
   // the minimal cost to the end-state (i.e. the sum of weights; they are guaranteed to
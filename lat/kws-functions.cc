@@ -19,6 +19,7 @@
 
 
 #include "lat/kws-functions.h"
+#include "lat/lattice-functions.h"
 #include "fstext/determinize-star.h"
 #include "fstext/epsilon-property.h"
 
@@ -558,6 +559,284 @@ void OptimizeFactorTransducer(KwsLexicographicFst *index_transducer,
   Decode(index_transducer, encoder);
 }
 
+bool CreateKwsIndexForLattice(const KwsIndexOptions &opts,
+                              const std::string &key,
+                              int32 utterance_id,
+                              CompactLattice *clat,
+                              KwsLexicographicFst *index_transducer) {
+  int32 max_states = -1;
+  if (opts.max_states_scale > 0) {
+    max_states = static_cast<int32>(
+        opts.max_states_scale * static_cast<BaseFloat>(clat->NumStates()));
+  }
+
+  // Topologically sort the lattice, if not already sorted.
+  uint64 props = clat->Properties(fst::kFstProperties, false);
+  if (!(props & fst::kTopSorted)) {
+    if (fst::TopSort(clat) == false) {
+      KALDI_WARN << "Cycles detected in lattice " << key;
+      return false;
+    }
+  }
+
+  // Get the alignments
+  vector<int32> state_times;
+  CompactLatticeStateTimes(*clat, &state_times);
+
+  // Cluster the arcs in the CompactLattice, write the cluster_id on the
+  // output label side.
+  // ClusterLattice() corresponds to the second part of the preprocessing in
+  // Dogan and Murat's paper -- clustering. Note that we do the first part
+  // of preprocessing (the weight pushing step) later when generating the
+  // factor transducer.
+  KALDI_VLOG(1) << "Arc clustering...";
+  if (!ClusterLattice(clat, state_times)) {
+    KALDI_WARN << "State id's and alignments do not match for lattice " << key;
+    return false;
+  }
+
+  // The next part is something new, not in the Dogan and Can paper.  It is
+  // necessary because we have epsilon arcs, due to silences, in our
+  // lattices.  We modify the factor transducer, while maintaining
+  // equivalence, to ensure that states don't have both epsilon *and*
+  // non-epsilon arcs entering them.  (and the same, with "entering"
+  // replaced with "leaving").  Later we will find out which states have
+  // non-epsilon arcs leaving/entering them and use it to be more selective
+  // in adding arcs to connect them with the initial/final states.  The goal
+  // here is to disallow silences at the beginning or ending of a keyword
+  // occurrence.
+  fst::EnsureEpsilonProperty(clat);
+  fst::TopSort(clat);
+  // We have to recompute the state times because they will have changed.
+  CompactLatticeStateTimes(*clat, &state_times);
+
+  // Generate factor transducer
+  // CreateFactorTransducer() corresponds to the "Factor Generation" part of
+  // Dogan and Murat's paper. But we also move the weight pushing step to
+  // this function as we have to compute the alphas and betas anyway.
+  KALDI_VLOG(1) << "Generating factor transducer...";
+  KwsProductFst factor_transducer;
+  if (!CreateFactorTransducer(*clat, state_times, utterance_id,
+                              &factor_transducer)) {
+    KALDI_WARN << "Cannot generate factor transducer for lattice " << key;
+    return false;
+  }
+
+  MaybeDoSanityCheck(factor_transducer);
+
+  // Remove long silence arc
+  // We add the filtering step in our implementation. This is because gap
+  // between two successive words in a query term should be less than 0.5s
+  KALDI_VLOG(1) << "Removing long silence...";
+  RemoveLongSilences(opts.max_silence_frames, state_times, &factor_transducer);
+
+  MaybeDoSanityCheck(factor_transducer);
+
+  // Do factor merging, and return a transducer in T*T*T semiring. This step
+  // corresponds to the "Factor Merging" part in Dogan and Murat's paper.
+  KALDI_VLOG(1) << "Merging factors...";
+  DoFactorMerging(&factor_transducer, index_transducer);
+
+  MaybeDoSanityCheck(*index_transducer);
+
+  // Do factor disambiguation. It corresponds to the "Factor Disambiguation"
+  // step in Dogan and Murat's paper.
+  KALDI_VLOG(1) << "Doing factor disambiguation...";
+  DoFactorDisambiguation(index_transducer);
+
+  MaybeDoSanityCheck(*index_transducer);
+
+  // Optimize the above factor transducer. It corresponds to the
+  // "Optimization" step in the paper.
+  KALDI_VLOG(1) << "Optimizing factor transducer...";
+  OptimizeFactorTransducer(index_transducer, max_states, opts.allow_partial);
+
+  MaybeDoSanityCheck(*index_transducer);
+  return true;
+}
+
+void PrepareKwsIndexForSearch(KwsLexicographicFst *index,
+                              std::vector<int32> *label_to_uid) {
+  using namespace fst;
+  using std::tr1::unordered_map;
+  typedef KwsLexicographicArc Arc;
+  typedef Arc::Weight Weight;
+  typedef Arc::StateId StateId;
+
+  // The key is (olabel << 32) + ilabel, i.e. the utterance id and the
+  // disambiguation symbol.
+  unordered_map<uint64, int32> label_encoder;
+  label_to_uid->clear();
+  label_to_uid->push_back(-1);  // label zero is epsilon.
+  for (StateIterator<KwsLexicographicFst> siter(*index); !siter.Done();
+       siter.Next()) {
+    StateId state_id = siter.Value();
+    for (MutableArcIterator<KwsLexicographicFst>
+             aiter(index, state_id); !aiter.Done(); aiter.Next()) {
+      Arc arc = aiter.Value();
+      // Skip the non-final arcs
+      if (index->Final(arc.nextstate) == Weight::Zero())
+        continue;
+      // Encode the input and output label of the final arc, and this is the
+      // new output label for this arc; set the input label to <epsilon>
+      uint64 osymbol = (static_cast<uint64>(arc.olabel) << 32) +
+          static_cast<uint64>(arc.ilabel);
+      unordered_map<uint64, int32>::iterator iter =
+          label_encoder.find(osymbol);
+      if (iter == label_encoder.end()) {
+        int32 label = label_to_uid->size();
+        label_encoder[osymbol] = label;
+        label_to_uid->push_back(arc.olabel);
+        arc.olabel = label;
+      } else {
+        arc.olabel = iter->second;
+      }
+      arc.ilabel = 0;
+      aiter.SetValue(arc);
+    }
+  }
+  ArcSort(index, ILabelCompare<Arc>());
+}
+
+fst::SymbolTable *KwsLabelsToSymbolTable(const std::vector<int32> &label_to_uid) {
+  fst::SymbolTable *symtab = new fst::SymbolTable("kws-labels");
+  for (size_t label = 1; label < label_to_uid.size(); label++) {
+    std::ostringstream os;
+    os << label_to_uid[label] << '_' << label;
+    symtab->AddSymbol(os.str(), label);
+  }
+  return symtab;
+}
+
+bool KwsLabelsFromSymbolTable(const fst::SymbolTable &symtab,
+                              std::vector<int32> *label_to_uid) {
+  label_to_uid->clear();
+  label_to_uid->resize(symtab.AvailableKey(), -1);
+  for (fst::SymbolTableIterator iter(symtab); !iter.Done(); iter.Next()) {
+    int64 label = iter.Value();
+    const std::string &symbol = iter.Symbol();
+    size_t pos = symbol.find('_');
+    int32 uid;
+    if (label <= 0 || label >= static_cast<int64>(label_to_uid->size()) ||
+        pos == std::string::npos ||
+        !ConvertStringToInteger(symbol.substr(0, pos), &uid))
+      return false;
+    (*label_to_uid)[label] = uid;
+  }
+  return true;
+}
+
+class VectorFstToKwsLexicographicFstMapper {
+ public:
+  typedef fst::StdArc FromArc;
+  typedef FromArc::Weight FromWeight;
+  typedef KwsLexicographicArc ToArc;
+  typedef KwsLexicographicWeight ToWeight;
+
+  VectorFstToKwsLexicographicFstMapper() {}
+
+  ToArc operator()(const FromArc &arc) const {
+    return ToArc(arc.ilabel,
+                 arc.olabel,
+                 (arc.weight == FromWeight::Zero() ?
+                  ToWeight::Zero() :
+                  ToWeight(arc.weight.Value(),
+                           StdLStdWeight::One())),
+                 arc.nextstate);
+  }
+
+  fst::MapFinalAction FinalAction() const { return fst::MAP_NO_SUPERFINAL; }
+
+  fst::MapSymbolsAction InputSymbolsAction() const { return fst::MAP_COPY_SYMBOLS; }
+
+  fst::MapSymbolsAction OutputSymbolsAction() const { return fst::MAP_COPY_SYMBOLS;}
+
+  uint64 Properties(uint64 props) const { return props; }
+};
+
+void CopyKeywordFst(const fst::VectorFst<fst::StdArc> &in,
+                    fst::VectorFst<fst::StdArc> *out) {
+  using namespace fst;
+  typedef StdArc::StateId StateId;
+  out->DeleteStates();
+  StateId num_states = in.NumStates();
+  out->ReserveStates(num_states);
+  for (StateId s = 0; s < num_states; s++)
+    out->AddState();
+  for (StateId s = 0; s < num_states; s++) {
+    out->SetFinal(s, in.Final(s));
+    out->ReserveArcs(s, in.NumArcs(s));
+    for (ArcIterator<VectorFst<StdArc> > aiter(in, s); !aiter.Done();
+         aiter.Next())
+      out->AddArc(s, aiter.Value());
+  }
+  out->SetStart(in.Start());
+}
+
+bool SearchKwsIndex(const KwsSearchOptions &opts,
+                    const fst::Fst<KwsLexicographicArc> &index,
+                    const std::vector<int32> &label_to_uid,
+                    const std::string &key,
+                    const fst::VectorFst<fst::StdArc> &keyword_in,
+                    std::vector<std::vector<double> > *results,
+                    int32 *num_bad) {
+  using namespace fst;
+  typedef KwsLexicographicArc Arc;
+  typedef Arc::Weight Weight;
+
+  VectorFst<StdArc> keyword;
+  CopyKeywordFst(keyword_in, &keyword);
+  // Process the case where we have confusion for keywords
+  if (opts.keyword_beam != -1)
+    Prune(&keyword, opts.keyword_beam);
+  if (opts.keyword_nbest != -1) {
+    VectorFst<StdArc> tmp;
+    ShortestPath(keyword, &tmp, opts.keyword_nbest, true, true);
+    keyword = tmp;
+  }
+
+  KwsLexicographicFst keyword_fst;
+  KwsLexicographicFst result_fst;
+  Map(keyword, &keyword_fst, VectorFstToKwsLexicographicFstMapper());
+  Compose(keyword_fst, index, &result_fst);
+  Project(&result_fst, PROJECT_OUTPUT);
+  Minimize(&result_fst);
+  ShortestPath(result_fst, &result_fst, opts.n_best);
+  RmEpsilon(&result_fst);
+
+  // No result found
+  if (result_fst.Start() == kNoStateId)
+    return false;
+
+  for (ArcIterator<KwsLexicographicFst>
+           aiter(result_fst, result_fst.Start()); !aiter.Done(); aiter.Next()) {
+    const Arc &arc = aiter.Value();
+
+    // We're expecting a two-state FST
+    if (result_fst.Final(arc.nextstate) != Weight::One()) {
+      KALDI_WARN << "The resulting FST does not have the expected structure "
+                 << "for key " << key;
+      (*num_bad)++;
+      continue;
+    }
+    KALDI_ASSERT(arc.olabel > 0 && arc.olabel < label_to_uid.size());
+    double score = arc.weight.Value1().Value();
+    if (score < 0) {
+      if (score < opts.negative_tolerance)
+        KALDI_WARN << "Score out of expected range: " << score;
+      score = 0.0;
+    }
+    std::vector<double> result;
+    result.push_back(label_to_uid[arc.olabel]);
+    // The times are stored as int32 in the output.
+    result.push_back(static_cast<int32>(arc.weight.Value2().Value1().Value()));
+    result.push_back(static_cast<int32>(arc.weight.Value2().Value2().Value()));
+    result.push_back(score);
+    results->push_back(result);
+  }
+  return true;
+}
+
 
 
 } // end namespace kaldi
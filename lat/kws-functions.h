@@ -21,6 +21,7 @@
 #ifndef KALDI_LAT_KWS_FUNCTIONS_H_
 #define KALDI_LAT_KWS_FUNCTIONS_H_
 
+#include "itf/options-itf.h"
 #include "lat/kaldi-lattice.h"
 #include "lat/kaldi-kws.h"
 
@@ -119,6 +120,120 @@ void OptimizeFactorTransducer(KwsLexicographicFst *index_transducer,
 void MaybeDoSanityCheck(const KwsProductFst &factor_transducer);
 void MaybeDoSanityCheck(const KwsLexicographicFst &index_transducer);
 
+struct KwsIndexOptions {
+  int32 max_silence_frames;
+  BaseFloat max_states_scale;
+  bool allow_partial;
+
+  KwsIndexOptions(): max_silence_frames(50), max_states_scale(4),
+                     allow_partial(true) { }
+
+  void Register(OptionsItf *po) {
+    po->Register("max-silence-frames", &max_silence_frames, "Maximum #frames "
+                 "for silence arc.");
+    po->Register("max-states-scale", &max_states_scale, "Number of states in "
+                 "the original lattice times this scale is the number of "
+                 "states allowed when optimizing the index. Negative number "
+                 "means no limit on the number of states.");
+    po->Register("allow-partial", &allow_partial, "Allow partial output if "
+                 "fails to determinize, otherwise skip determinization if it "
+                 "fails.");
+  }
+};
+
+// This function does all the steps of creating the index for a single
+// lattice, as done by lattice-to-kws-index: clustering, factor generation,
+// removal of long silences, factor merging, factor disambiguation and
+// optimization.  It modifies "clat".  Returns false (after printing a
+// warning that mentions "key") if the index could not be created.  It does
+// not use any global state, so it can be called from multiple threads at
+// once.
+bool CreateKwsIndexForLattice(const KwsIndexOptions &opts,
+                              const std::string &key,
+                              int32 utterance_id,
+                              CompactLattice *clat,
+                              KwsLexicographicFst *index_transducer);
+
+// This function prepares an index (as output by kws-index-union) for search.
+// Rather than removing the disambiguation symbols on the final arcs, we move
+// them from the input side to the output side, making the output label a
+// "combined" symbol of the disambiguation symbol and the utterance id (which
+// lets us do epsilon removal after composition with the keyword FST); then
+// we sort the arcs on input label, as needed for composition.  The combined
+// symbols are numbered from 1, and label_to_uid is set so that
+// (*label_to_uid)[label] is the utterance id for combined symbol "label".
+void PrepareKwsIndexForSearch(KwsLexicographicFst *index,
+                              std::vector<int32> *label_to_uid);
+
+// The following two functions are for storing the label_to_uid table output
+// by PrepareKwsIndexForSearch() inside the prepared index itself, as its
+// output symbol table, so that a prepared index can be written to disk in a
+// single file (see kws-prepare-index).  Label "label" gets the symbol
+// "<uid>_<label>", as symbols have to be unique.
+fst::SymbolTable *KwsLabelsToSymbolTable(const std::vector<int32> &label_to_uid);
+
+// Does the reverse of KwsLabelsToSymbolTable(); returns false if the symbol
+// table does not have the expected format.
+bool KwsLabelsFromSymbolTable(const fst::SymbolTable &symtab,
+                              std::vector<int32> *label_to_uid);
+
+struct KwsSearchOptions {
+  int32 n_best;
+  int32 keyword_nbest;
+  double keyword_beam;
+  double negative_tolerance;
+
+  KwsSearchOptions(): n_best(-1), keyword_nbest(-1), keyword_beam(-1),
+                      negative_tolerance(-0.1) { }
+
+  void Register(OptionsItf *po) {
+    po->Register("nbest", &n_best, "Return the best n hypotheses.");
+    po->Register("keyword-nbest", &keyword_nbest, "Pick the best n keywords "
+                 "if the FST contains multiple keywords.");
+    po->Register("keyword-beam", &keyword_beam, "Prune the FST with the given "
+                 "beam if the FST contains multiple keywords.");
+    po->Register("negative-tolerance", &negative_tolerance, "The program will "
+                 "print a warning if we get negative score smaller than this "
+                 "tolerance.");
+  }
+  void Check() const {
+    if (n_best < 0 && n_best != -1)
+      KALDI_ERR << "Bad number for nbest";
+    if (keyword_nbest < 0 && keyword_nbest != -1)
+      KALDI_ERR << "Bad number for keyword-nbest";
+    if (keyword_beam < 0 && keyword_beam != -1)
+      KALDI_ERR << "Bad number for keyword-beam";
+  }
+};
+
+// Copies the keyword FST "in" to "out" state by state and arc by arc, so that
+// unlike with the copy constructor or operator = of VectorFst, "out" does not
+// share its implementation with "in" (the symbol tables are not copied).  The
+// reference count of the shared implementation is not thread-safe, so this is
+// how to make a copy that is to be used in a different thread.
+void CopyKeywordFst(const fst::VectorFst<fst::StdArc> &in,
+                    fst::VectorFst<fst::StdArc> *out);
+
+// This function searches for the keyword FST "keyword" in an index that has
+// been prepared by PrepareKwsIndexForSearch() [the index may be of any FST
+// type, e.g. a memory-mapped DecodeFstTpl<KwsLexicographicArc>].  Each hit is
+// appended to "results" as a vector (utterance-id, begin-frame, end-frame,
+// score).  Returns false if nothing was found.  "key" is only used in
+// warnings; *num_bad is incremented for each hit that is skipped because
+// the result FST did not have the expected structure.  "keyword" is copied
+// with CopyKeywordFst() before it is used, so several threads may search for
+// the same keyword at once.  But the index must not be used by any other
+// thread while this function runs (Compose() makes copies of it, and the
+// reference counts of OpenFst are not thread-safe), so to search in parallel
+// each thread needs its own handle on the index.
+bool SearchKwsIndex(const KwsSearchOptions &opts,
+                    const fst::Fst<KwsLexicographicArc> &index,
+                    const std::vector<int32> &label_to_uid,
+                    const std::string &key,
+                    const fst::VectorFst<fst::StdArc> &keyword,
+                    std::vector<std::vector<double> > *results,
+                    int32 *num_bad);
+
 
 } // namespace kaldi
 
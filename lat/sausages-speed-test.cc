@@ -0,0 +1,98 @@
+// lat/sausages-speed-test.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lat/sausages.h"
+#include "util/timer.h"
+
+namespace kaldi {
+
+// Creates a random word lattice that looks a bit like a large, word-aligned
+// lattice: states are in topological order, each state has arcs to the next
+// state and to a few of the following states, and the arcs between states s and s' have
+// (s' - s) * frames_per_state transition-ids so the state times are
+// consistent.
+static void CreateRandomWordLattice(int32 num_states, int32 num_words,
+                                    int32 frames_per_state,
+                                    CompactLattice *clat) {
+  clat->DeleteStates();
+  for (int32 s = 0; s < num_states; s++)
+    clat->AddState();
+  clat->SetStart(0);
+  for (int32 s = 0; s + 1 < num_states; s++) {
+    int32 num_arcs = 1 + rand() % 3;
+    for (int32 i = 0; i < num_arcs; i++) {
+      // The first arc goes to the next state, so all states are reachable.
+      int32 next_state = (i == 0 ? s + 1 :
+                          std::min(num_states - 1, s + 1 + rand() % 4)),
+          word = (rand() % 4 == 0 ? 0 : 1 + rand() % num_words);
+      std::vector<int32> string((next_state - s) * frames_per_state, 1);
+      LatticeWeight weight(RandUniform(), 5.0 * RandUniform());
+      clat->AddArc(s, CompactLatticeArc(word, word,
+                                        CompactLatticeWeight(weight, string),
+                                        next_state));
+    }
+  }
+  clat->SetFinal(num_states - 1, CompactLatticeWeight::One());
+}
+
+void TestMinimumBayesRiskSpeed(int32 num_states, int32 num_words) {
+  CompactLattice clat;
+  CreateRandomWordLattice(num_states, num_words, 3, &clat);
+
+  Timer timer;
+  MinimumBayesRisk mbr(clat);
+  double elapsed = timer.Elapsed();
+
+  const std::vector<std::vector<std::pair<int32, BaseFloat> > > &stats =
+      mbr.GetSausageStats();
+  size_t num_entries = 0;
+  for (size_t q = 0; q < stats.size(); q++) {
+    BaseFloat sum = 0.0;
+    for (size_t j = 0; j < stats[q].size(); j++) {
+      sum += stats[q][j].second;
+      if (j > 0)  // Check they are sorted from most to least likely.
+        KALDI_ASSERT(stats[q][j].second <= stats[q][j-1].second);
+    }
+    KALDI_ASSERT(fabs(sum - 1.0) < 0.1);  // as checked in AccStats().
+    num_entries += stats[q].size();
+  }
+  KALDI_ASSERT(mbr.GetOneBestConfidences().size() == mbr.GetOneBest().size());
+  KALDI_LOG << "For lattice with " << num_states << " states and vocabulary "
+            << "size " << num_words << ", MBR decoding "
+            << "took " << elapsed << " seconds; " << stats.size()
+            << " sausage bins, with on average "
+            << (num_entries / std::max<size_t>(stats.size(), 1))
+            << " words per bin; Bayes risk is " << mbr.GetBayesRisk();
+}
+
+} // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  // The computation needs O(num_states^2) memory, so we don't go much larger.
+  int32 sizes[] = { 10, 100, 1000, 3000 };
+  for (int32 i = 0; i < 4; i++) {
+    // AccStats() uses a dense gamma accumulator unless there are more distinct
+    // words than states, so try a small and a large vocabulary.
+    TestMinimumBayesRiskSpeed(sizes[i], 1000);
+    TestMinimumBayesRiskSpeed(sizes[i], 100000);
+  }
+  std::cout << "Test OK.\n";
+  return 0;
+}
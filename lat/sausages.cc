@@ -105,10 +105,14 @@ double MinimumBayesRisk::EditDistance(int32 N, int32 Q,
     }
     alpha(n) = alpha_n; // Line 10.
     // Line 11 omitted: matrix was initialized to zero.
+    double *alpha_dash_n = alpha_dash.RowData(n);
     for (size_t i = 0; i < pre_[n].size(); i++) {
       const Arc &arc = arcs_[pre_[n][i]];
       int32 s_a = arc.start_node, w_a = arc.word;
       BaseFloat p_a = arc.loglike;
+      // The arc posterior given that we are in state n; this is the same for
+      // all q so we compute it outside the loop.
+      double arc_post = exp(alpha(s_a) + p_a - alpha(n));
       for (int32 q = 0; q <= Q; q++) {
         if (q == 0) {
           alpha_dash_arc(q) = // line 15.
@@ -121,17 +125,40 @@ double MinimumBayesRisk::EditDistance(int32 N, int32 Q,
           alpha_dash_arc(q) = std::min(a1, std::min(a2, a3));
         }
         // line 19:
-        alpha_dash(n, q) += exp(alpha(s_a) + p_a - alpha(n)) * alpha_dash_arc(q);
+        alpha_dash_n[q] += arc_post * alpha_dash_arc(q);
       }
     }
   }
   return alpha_dash(N, Q); // line 23.
 }
 
+MinimumBayesRisk::GammaAccumulator::GammaAccumulator(int32 num_bins,
+                                                    int32 num_words,
+                                                    bool dense):
+    dense_(dense) {
+  if (dense) {
+    dense_gamma_.Resize(num_bins + 1, num_words);
+    nonzero_.resize(num_bins + 1);
+  } else {
+    sparse_gamma_.resize(num_bins + 1);
+  }
+}
+
+void MinimumBayesRisk::GammaAccumulator::GetBin(
+    int32 q, std::vector<std::pair<int32, double> > *bin) const {
+  bin->clear();
+  if (dense_) {
+    const std::vector<int32> &nonzero = nonzero_[q];
+    for (size_t i = 0; i < nonzero.size(); i++)
+      bin->push_back(std::make_pair(nonzero[i],
+                                    dense_gamma_(q, nonzero[i])));
+  } else {
+    bin->insert(bin->end(), sparse_gamma_[q].begin(), sparse_gamma_[q].end());
+  }
+}
+
 // Figure 5 in the paper.
 void MinimumBayesRisk::AccStats() {
-  using std::map;
-  
   int32 N = static_cast<int32>(pre_.size()) - 1,
       Q = static_cast<int32>(R_.size());
 
@@ -141,8 +168,9 @@ void MinimumBayesRisk::AccStats() {
   Matrix<double> beta_dash(N+1, Q+1); // index (1...N, 0...Q)
   Vector<double> beta_dash_arc(Q+1); // index 0...Q
   vector<char> b_arc(Q+1); // integer in {1,2,3}; index 1...Q
-  vector<map<int32, double> > gamma(Q+1); // temp. form of gamma.
-  // index 1...Q [word] -> occ.
+  GammaAccumulator gamma(Q, words_.size(), // temp. form of gamma.
+                         words_.size() <= static_cast<size_t>(N) + 1);
+  // index 1...Q [word index] -> occ.
 
   // The tau arrays below are the sums over words of the tau_b
   // and tau_e timing quantities mentioned in Appendix C of
@@ -162,8 +190,9 @@ void MinimumBayesRisk::AccStats() {
   for (int32 n = N; n >= 2; n--) {
     for (size_t i = 0; i < pre_[n].size(); i++) {
       const Arc &arc = arcs_[pre_[n][i]];
-      int32 s_a = arc.start_node, w_a = arc.word;
+      int32 s_a = arc.start_node, w_a = arc.word, wi_a = arc.word_index;
       BaseFloat p_a = arc.loglike;
+      double arc_post = exp(alpha(s_a) + p_a - alpha(n)); // same for all q.
       alpha_dash_arc(0) = alpha_dash(s_a, 0) + l(w_a, 0) + delta(); // line 14.
       for (int32 q = 1; q <= Q; q++) { // this loop == lines 15-18.
         int32 r_q = r(q);
@@ -181,12 +210,12 @@ void MinimumBayesRisk::AccStats() {
       beta_dash_arc.SetZero(); // line 19.
       for (int32 q = Q; q >= 1; q--) {
         // line 21:
-        beta_dash_arc(q) += exp(alpha(s_a) + p_a - alpha(n)) * beta_dash(n, q);
+        beta_dash_arc(q) += arc_post * beta_dash(n, q);
         switch (static_cast<int>(b_arc[q])) { // lines 22 and 23:
           case 1:
             beta_dash(s_a, q-1) += beta_dash_arc(q);
             // next: gamma(q, w(a)) += beta_dash_arc(q)
-            AddToMap(w_a, beta_dash_arc(q), &(gamma[q]));
+            gamma.Add(q, wi_a, beta_dash_arc(q));
             // next: accumulating times, see decl for tau_b,tau_e
             tau_b(q) += state_times_[s_a] * beta_dash_arc(q);
             tau_e(q) += state_times_[n] * beta_dash_arc(q);
@@ -197,7 +226,7 @@ void MinimumBayesRisk::AccStats() {
           case 3:
             beta_dash_arc(q-1) += beta_dash_arc(q);
             // next: gamma(q, epsilon) += beta_dash_arc(q)
-            AddToMap(0, beta_dash_arc(q), &(gamma[q]));
+            gamma.Add(q, 0, beta_dash_arc(q));  // words_[0] is epsilon.
             // next: accumulating times, see decl for tau_b,tau_e
             // WARNING: there was an error in Appendix C.  If we followed
             // the instructions there the next line would say state_times_[sa], but
@@ -209,7 +238,7 @@ void MinimumBayesRisk::AccStats() {
             KALDI_ERR << "Invalid b_arc value"; // error in code.
         }
       }
-      beta_dash_arc(0) += exp(alpha(s_a) + p_a - alpha(n)) * beta_dash(n, 0);
+      beta_dash_arc(0) += arc_post * beta_dash(n, 0);
       beta_dash(s_a, 0) += beta_dash_arc(0); // line 26.
     }
   }
@@ -217,28 +246,28 @@ void MinimumBayesRisk::AccStats() {
   for (int32 q = Q; q >= 1; q--) {
     beta_dash_arc(q) += beta_dash(1, q);
     beta_dash_arc(q-1) += beta_dash_arc(q);
-    AddToMap(0, beta_dash_arc(q), &(gamma[q]));
+    gamma.Add(q, 0, beta_dash_arc(q));
     // the statements below are actually redundant because
     // state_times_[1] is zero.
     tau_b(q) += state_times_[1] * beta_dash_arc(q);
     tau_e(q) += state_times_[1] * beta_dash_arc(q);
   }
-  for (int32 q = 1; q <= Q; q++) { // a check (line 35)
-    double sum = 0.0;
-    for (map<int32, double>::iterator iter = gamma[q].begin();
-         iter != gamma[q].end(); ++iter) sum += iter->second;
-    if (fabs(sum - 1.0) > 0.1)
-      KALDI_WARN << "sum of gamma[" << q << ",s] is " << sum;
-  }
   // The next part is where we take gamma, and convert
   // to the class member gamma_, which is using a different
   // data structure and indexed from zero, not one.
   gamma_.clear();
   gamma_.resize(Q);
+  std::vector<std::pair<int32, double> > bin;
   for (int32 q = 1; q <= Q; q++) {
-    for (map<int32, double>::iterator iter = gamma[q].begin();
-         iter != gamma[q].end(); ++iter)
-      gamma_[q-1].push_back(std::make_pair(iter->first, static_cast<BaseFloat>(iter->second)));
+    gamma.GetBin(q, &bin);
+    double sum = 0.0;
+    for (size_t i = 0; i < bin.size(); i++) {
+      sum += bin[i].second;
+      gamma_[q-1].push_back(std::make_pair(words_[bin[i].first],
+                                           static_cast<BaseFloat>(bin[i].second)));
+    }
+    if (fabs(sum - 1.0) > 0.1) // a check (line 35)
+      KALDI_WARN << "sum of gamma[" << q << ",s] is " << sum;
     // sort gamma_[q-1] from largest to smallest posterior.
     GammaCompare comp;
     std::sort(gamma_[q-1].begin(), gamma_[q-1].end(), comp);
@@ -301,6 +330,7 @@ MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in, bool do_mbr):
       const CompactLatticeArc &carc = aiter.Value();
       Arc arc; // in our local format.
       arc.word = carc.ilabel; // == carc.olabel
+      words_.push_back(arc.word);
       arc.start_node = n;
       arc.end_node = carc.nextstate + 1; // convert to 1-based.
       arc.loglike = - (carc.weight.Weight().Value1() +
@@ -313,6 +343,14 @@ MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in, bool do_mbr):
     }
   }
 
+  // Number the words, for GammaAccumulator.
+  words_.push_back(0);
+  SortAndUniq(&words_);
+  KALDI_ASSERT(words_[0] == 0);
+  for (size_t i = 0; i < arcs_.size(); i++)
+    arcs_[i].word_index = std::lower_bound(words_.begin(), words_.end(),
+                                           arcs_[i].word) - words_.begin();
+
   // We don't need to look at clat.Start() or clat.Final(state):
   // we know clat.Start() == 0 since it's topologically sorted,
   // and clat.Final(state) is Zero() except for One() at the last-
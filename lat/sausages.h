@@ -26,6 +26,7 @@
 
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
+#include "util/stl-utils.h"
 #include "fstext/fstext-lib.h"
 #include "lat/kaldi-lattice.h"
 
@@ -125,17 +126,39 @@ class MinimumBayesRisk {
   static inline BaseFloat delta() { return 1.0e-05; } // A constant
   // used in the algorithm.
 
-  /// Function used to increment map.
-  static inline void AddToMap(int32 i, double d, std::map<int32, double> *gamma) {
-    if (d == 0) return;
-    std::pair<const int32, double> pr(i, d);
-    std::pair<std::map<int32, double>::iterator, bool> ret = gamma->insert(pr);
-    if (!ret.second) // not inserted, so add to contents.
-      ret.first->second += d;
-  }
-    
+  /// The temporary form of gamma used in AccStats(): gamma(q, w) for bins
+  /// q = 1...Q, with the words given as indexes into words_.  If there are no
+  /// more distinct words than lattice states, this is a dense matrix (so no
+  /// larger than alpha_dash) with a list of the nonzero entries of each bin;
+  /// otherwise it is a hash per bin.  Either is much faster than a std::map
+  /// per bin when the bins have many words.
+  class GammaAccumulator {
+   public:
+    GammaAccumulator(int32 num_bins, int32 num_words, bool dense);
+
+    void Add(int32 q, int32 word_index, double d) {
+      if (d == 0) return;
+      if (dense_) {
+        double &gamma = dense_gamma_(q, word_index);
+        if (gamma == 0.0) nonzero_[q].push_back(word_index);
+        gamma += d;
+      } else {
+        sparse_gamma_[q][word_index] += d;
+      }
+    }
+
+    /// Outputs the nonzero entries of bin q as (word-index, gamma) pairs.
+    void GetBin(int32 q, std::vector<std::pair<int32, double> > *bin) const;
+   private:
+    bool dense_;
+    Matrix<double> dense_gamma_;  // used if dense_.
+    std::vector<std::vector<int32> > nonzero_;  // used if dense_.
+    std::vector<unordered_map<int32, double> > sparse_gamma_;  // if !dense_.
+  };
+
   struct Arc {
     int32 word;
+    int32 word_index;  // index of "word" in words_.
     int32 start_node;
     int32 end_node;
     BaseFloat loglike;
@@ -151,6 +174,9 @@ class MinimumBayesRisk {
   /// negated cost).  Indexed from zero.
   std::vector<Arc> arcs_;
 
+  /// The distinct words on arcs_, plus epsilon, sorted (so words_[0] == 0).
+  std::vector<int32> words_;
+
   /// For each node in the lattice, a list of arcs entering that node. Indexed
   /// from 1 (first node == 1).
   std::vector<std::vector<int32> > pre_;
@@ -20,6 +20,7 @@
 #include "util/common-utils.h"
 #include "lat/kaldi-lattice.h"
 #include "lat/determinize-lattice-pruned.h"
+#include "lat/determinize-lattice-pruned-parallel.h"
 #include "lat/lattice-functions.h"
 #include "lat/push-lattice.h"
 #include "lat/minimize-lattice.h"
@@ -32,6 +33,7 @@ class DeterminizeLatticeTask {
   // Initializer takes ownership of "lat".
   DeterminizeLatticeTask(
       fst::DeterminizeLatticePrunedOptions &opts,
+      const DeterminizeLatticePrunedParallelOptions &par_opts,
       std::string key,
       BaseFloat acoustic_scale,
       BaseFloat beam,
@@ -39,7 +41,8 @@ class DeterminizeLatticeTask {
       Lattice *lat,
       CompactLatticeWriter *clat_writer,
       int32 *num_warn):
-      opts_(opts), key_(key), acoustic_scale_(acoustic_scale), beam_(beam),
+      opts_(opts), par_opts_(par_opts), key_(key),
+      acoustic_scale_(acoustic_scale), beam_(beam),
       minimize_(minimize), lat_(lat), clat_writer_(clat_writer),
       num_warn_(num_warn) { }
 
@@ -55,7 +58,8 @@ class DeterminizeLatticeTask {
       (*num_warn_)++;
     }
     fst::ArcSort(lat_, fst::ILabelCompare<LatticeArc>());
-    if (!DeterminizeLatticePruned(*lat_, beam_, &det_clat_, opts_)) {
+    if (!DeterminizeLatticePrunedParallel(*lat_, beam_, &det_clat_, opts_,
+                                          par_opts_)) {
       KALDI_WARN << "For key " << key_ << ", determinization did not succeed"
           "(partial output will be pruned tighter than the specified beam.)";
       (*num_warn_)++;
@@ -78,6 +82,7 @@ class DeterminizeLatticeTask {
   }
  private:
   const fst::DeterminizeLatticePrunedOptions &opts_;
+  const DeterminizeLatticePrunedParallelOptions &par_opts_;
   std::string key_;
   BaseFloat acoustic_scale_;
   BaseFloat beam_;
@@ -101,8 +106,11 @@ int main(int argc, char *argv[]) {
     const char *usage =
         "Determinize lattices, keeping only the best path (sequence of acoustic states)\n"
         "for each input-symbol sequence.  This is a version of lattice-determnize-pruned\n"
-        "that accepts the --num-threads option.  These programs do pruning as part of the\n"
-        "determinization algorithm, which is more efficient and prevents blowup.\n"
+        "that accepts the --num-threads option; and with --num-threads-per-lattice > 1\n"
+        "it also uses several threads for each lattice (useful for long utterances),\n"
+        "so the total number of threads is the product of the two.  These programs\n"
+        "do pruning as part of the determinization algorithm, which is more\n"
+        "efficient and prevents blowup.\n"
         "See http://kaldi.sourceforge.net/lattices.html for more information on lattices.\n"
         "\n"
         "Usage: lattice-determinize-pruned-parallel [options] lattice-rspecifier lattice-wspecifier\n"
@@ -113,6 +121,8 @@ int main(int argc, char *argv[]) {
     BaseFloat beam = 10.0;
     bool minimize = false;
     TaskSequencerConfig sequencer_config; // has --num-threads option
+    // has --num-threads-per-lattice option
+    DeterminizeLatticePrunedParallelOptions par_config;
     fst::DeterminizeLatticePrunedOptions determinize_config; // Options used in DeterminizeLatticePruned--
     // this options class does not have its own Register function as it's viewed as
     // being more part of "fst world", so we register its elements independently.
@@ -126,6 +136,7 @@ int main(int argc, char *argv[]) {
                 "If true, push and minimize after determinization");
     determinize_config.Register(&po);
     sequencer_config.Register(&po);
+    par_config.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() != 2) {
@@ -159,7 +170,7 @@ int main(int argc, char *argv[]) {
       KALDI_VLOG(2) << "Processing lattice " << key;
 
       DeterminizeLatticeTask *task = new DeterminizeLatticeTask(
-          determinize_config, key, acoustic_scale, beam, minimize,
+          determinize_config, par_config, key, acoustic_scale, beam, minimize,
           lat, &compact_lat_writer, &n_warn);
       sequencer.Run(task);
       n_done++;
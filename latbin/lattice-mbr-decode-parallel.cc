@@ -0,0 +1,185 @@
+// latbin/lattice-mbr-decode-parallel.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/common-utils.h"
+#include "lat/sausages.h"
+#include "hmm/posterior.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+class MbrDecodeTask {
+ public:
+  // Initializer takes ownership of "clat".
+  MbrDecodeTask(std::string key,
+                BaseFloat acoustic_scale,
+                BaseFloat lm_scale,
+                bool one_best_times,
+                CompactLattice *clat,
+                Int32VectorWriter *trans_writer,
+                BaseFloatWriter *bayes_risk_writer,
+                PosteriorWriter *sausage_stats_writer,
+                BaseFloatPairVectorWriter *times_writer,
+                int32 *n_done,
+                int32 *n_words,
+                double *tot_bayes_risk):
+      key_(key), acoustic_scale_(acoustic_scale), lm_scale_(lm_scale),
+      one_best_times_(one_best_times), clat_(clat), mbr_(NULL),
+      trans_writer_(trans_writer), bayes_risk_writer_(bayes_risk_writer),
+      sausage_stats_writer_(sausage_stats_writer),
+      times_writer_(times_writer), n_done_(n_done), n_words_(n_words),
+      tot_bayes_risk_(tot_bayes_risk) { }
+
+  void operator () () {
+    fst::ScaleLattice(fst::LatticeScale(lm_scale_, acoustic_scale_), clat_);
+    mbr_ = new MinimumBayesRisk(*clat_);
+    delete clat_; // This is no longer needed so we can delete it now.
+    clat_ = NULL;
+  }
+
+  // The destructor is called sequentially, in the order the tasks were
+  // given to the TaskSequencer, so this is where we write the output.
+  ~MbrDecodeTask() {
+    if (trans_writer_->IsOpen())
+      trans_writer_->Write(key_, mbr_->GetOneBest());
+    if (bayes_risk_writer_->IsOpen())
+      bayes_risk_writer_->Write(key_, mbr_->GetBayesRisk());
+    if (sausage_stats_writer_->IsOpen())
+      sausage_stats_writer_->Write(key_, mbr_->GetSausageStats());
+    if (times_writer_->IsOpen())
+      times_writer_->Write(key_, one_best_times_ ? mbr_->GetOneBestTimes() :
+                           mbr_->GetSausageTimes());
+    (*n_done_)++;
+    (*n_words_) += mbr_->GetOneBest().size();
+    (*tot_bayes_risk_) += mbr_->GetBayesRisk();
+    delete mbr_;
+  }
+ private:
+  std::string key_;
+  BaseFloat acoustic_scale_;
+  BaseFloat lm_scale_;
+  bool one_best_times_;
+  CompactLattice *clat_; // The lattice we're working on.  Owned locally.
+  MinimumBayesRisk *mbr_; // The result.  Owned locally.
+  Int32VectorWriter *trans_writer_;
+  BaseFloatWriter *bayes_risk_writer_;
+  PosteriorWriter *sausage_stats_writer_;
+  BaseFloatPairVectorWriter *times_writer_;
+  int32 *n_done_;
+  int32 *n_words_;
+  double *tot_bayes_risk_;
+};
+
+} // namespace kaldi
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Do Minimum Bayes Risk decoding (decoding that aims to minimize the \n"
+        "expected word error rate).  This is a version of lattice-mbr-decode\n"
+        "that accepts the --num-threads option; the output is the same, and\n"
+        "in the same order.  See lattice-mbr-decode for more information.\n"
+        "\n"
+        "Usage: lattice-mbr-decode-parallel [options]  lattice-rspecifier "
+        "transcriptions-wspecifier [ bayes-risk-wspecifier "
+        "[ sausage-stats-wspecifier [ times-wspecifier] ] ] \n"
+        " e.g.: lattice-mbr-decode-parallel --num-threads=8 --acoustic-scale=0.1 "
+        "ark:1.lats ark:1.tra ark:/dev/null ark:1.sau\n";
+
+    ParseOptions po(usage);
+    BaseFloat acoustic_scale = 1.0;
+    BaseFloat lm_scale = 1.0;
+    bool one_best_times = false;
+    std::string word_syms_filename;
+    TaskSequencerConfig sequencer_config; // has --num-threads option
+
+    po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for "
+                "acoustic likelihoods");
+    po.Register("lm-scale", &lm_scale, "Scaling factor for language model "
+                "probabilities");
+    po.Register("word-symbol-table", &word_syms_filename, "Symbol table for "
+                "words [for debug output]");
+    po.Register("one-best-times", &one_best_times, "If true, output times "
+                "corresponding to one-best, not whole sausage.");
+    sequencer_config.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() < 2 || po.NumArgs() > 5) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string lats_rspecifier = po.GetArg(1),
+        trans_wspecifier = po.GetArg(2),
+        bayes_risk_wspecifier = po.GetOptArg(3),
+        sausage_stats_wspecifier = po.GetOptArg(4),
+        times_wspecifier = po.GetOptArg(5);
+
+    // Read as compact lattice.
+    SequentialCompactLatticeReader clat_reader(lats_rspecifier);
+
+    Int32VectorWriter trans_writer(trans_wspecifier);
+    BaseFloatWriter bayes_risk_writer(bayes_risk_wspecifier);
+    // Note: type Posterior = vector<vector<pair<int32,BaseFloat> > >
+    // happens to be the same as needed for the sausage stats.
+    PosteriorWriter sausage_stats_writer(sausage_stats_wspecifier);
+
+    BaseFloatPairVectorWriter times_writer(times_wspecifier);
+
+    fst::SymbolTable *word_syms = NULL;
+    if (word_syms_filename != "")
+      if (!(word_syms = fst::SymbolTable::ReadText(word_syms_filename)))
+        KALDI_ERR << "Could not read symbol table from file "
+                   << word_syms_filename;
+
+    int32 n_done = 0, n_words = 0;
+    double tot_bayes_risk = 0.0;
+
+    {
+      TaskSequencer<MbrDecodeTask> sequencer(sequencer_config);
+      for (; !clat_reader.Done(); clat_reader.Next()) {
+        std::string key = clat_reader.Key();
+        CompactLattice *clat = new CompactLattice(clat_reader.Value());
+        clat_reader.FreeCurrent();
+        sequencer.Run(new MbrDecodeTask(key, acoustic_scale, lm_scale,
+                                        one_best_times, clat, &trans_writer,
+                                        &bayes_risk_writer,
+                                        &sausage_stats_writer, &times_writer,
+                                        &n_done, &n_words, &tot_bayes_risk));
+      }
+      sequencer.Wait();
+    }
+
+    KALDI_LOG << "Done " << n_done << " lattices.";
+    KALDI_LOG << "Average Bayes Risk per sentence is "
+              << (tot_bayes_risk / n_done) << " and per word, "
+              << (tot_bayes_risk / n_words);
+
+    if (word_syms) delete word_syms;
+    return (n_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,169 @@
+// latbin/lattice-to-ctm-conf-parallel.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/common-utils.h"
+#include "lat/sausages.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+class LatticeToCtmConfTask {
+ public:
+  // Initializer takes ownership of "clat".
+  LatticeToCtmConfTask(std::string key,
+                       BaseFloat acoustic_scale,
+                       BaseFloat lm_scale,
+                       bool decode_mbr,
+                       BaseFloat frame_shift,
+                       CompactLattice *clat,
+                       std::ostream *ctm_os,
+                       int32 *n_done,
+                       int32 *n_words,
+                       double *tot_bayes_risk):
+      key_(key), acoustic_scale_(acoustic_scale), lm_scale_(lm_scale),
+      decode_mbr_(decode_mbr), frame_shift_(frame_shift), clat_(clat),
+      mbr_(NULL), ctm_os_(ctm_os), n_done_(n_done), n_words_(n_words),
+      tot_bayes_risk_(tot_bayes_risk) { }
+
+  void operator () () {
+    fst::ScaleLattice(fst::LatticeScale(lm_scale_, acoustic_scale_), clat_);
+    mbr_ = new MinimumBayesRisk(*clat_, decode_mbr_);
+    delete clat_; // This is no longer needed so we can delete it now.
+    clat_ = NULL;
+  }
+
+  // The destructor is called sequentially, in the order the tasks were
+  // given to the TaskSequencer, so this is where we write the output.
+  ~LatticeToCtmConfTask() {
+    const std::vector<BaseFloat> &conf = mbr_->GetOneBestConfidences();
+    const std::vector<int32> &words = mbr_->GetOneBest();
+    const std::vector<std::pair<BaseFloat, BaseFloat> > &times =
+        mbr_->GetOneBestTimes();
+    KALDI_ASSERT(conf.size() == words.size() && words.size() == times.size());
+    for (size_t i = 0; i < words.size(); i++) {
+      KALDI_ASSERT(words[i] != 0); // Should not have epsilons.
+      (*ctm_os_) << key_ << " 1 " << (frame_shift_ * times[i].first) << ' '
+                 << (frame_shift_ * (times[i].second-times[i].first)) << ' '
+                 << words[i] << ' ' << conf[i] << '\n';
+    }
+    (*n_done_)++;
+    (*n_words_) += words.size();
+    (*tot_bayes_risk_) += mbr_->GetBayesRisk();
+    delete mbr_;
+  }
+ private:
+  std::string key_;
+  BaseFloat acoustic_scale_;
+  BaseFloat lm_scale_;
+  bool decode_mbr_;
+  BaseFloat frame_shift_;
+  CompactLattice *clat_; // The lattice we're working on.  Owned locally.
+  MinimumBayesRisk *mbr_; // The result.  Owned locally.
+  std::ostream *ctm_os_;
+  int32 *n_done_;
+  int32 *n_words_;
+  double *tot_bayes_risk_;
+};
+
+} // namespace kaldi
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Generate 1-best from lattices and convert into ctm with confidences.\n"
+        "This is a version of lattice-to-ctm-conf that accepts the\n"
+        "--num-threads option; the output is the same, and in the same order.\n"
+        "See lattice-to-ctm-conf for more information.\n"
+        "\n"
+        "Usage: lattice-to-ctm-conf-parallel [options]  lattice-rspecifier "
+        "ctm-wxfilename\n"
+        " e.g.: lattice-to-ctm-conf-parallel --num-threads=8 "
+        "--acoustic-scale=0.1 ark:1.lats 1.ctm\n";
+
+    ParseOptions po(usage);
+    BaseFloat acoustic_scale = 1.0, inv_acoustic_scale = 1.0, lm_scale = 1.0;
+    bool decode_mbr = true;
+    BaseFloat frame_shift = 0.01;
+    TaskSequencerConfig sequencer_config; // has --num-threads option
+
+    po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for "
+                "acoustic likelihoods");
+    po.Register("inv-acoustic-scale", &inv_acoustic_scale, "An alternative way "
+                "of setting the acoustic scale: you can set its inverse.");
+    po.Register("lm-scale", &lm_scale, "Scaling factor for language model "
+                "probabilities");
+    po.Register("decode-mbr", &decode_mbr, "If true, do Minimum Bayes Risk "
+                "decoding (else, Maximum a Posteriori)");
+    po.Register("frame-shift", &frame_shift, "Time in seconds between frames.\n");
+    sequencer_config.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    KALDI_ASSERT(acoustic_scale == 1.0 || inv_acoustic_scale == 1.0);
+    if (inv_acoustic_scale != 1.0)
+      acoustic_scale = 1.0 / inv_acoustic_scale;
+
+    std::string lats_rspecifier = po.GetArg(1),
+        ctm_wxfilename = po.GetArg(2);
+
+    // Read as compact lattice.
+    SequentialCompactLatticeReader clat_reader(lats_rspecifier);
+
+    Output ko(ctm_wxfilename, false); // false == non-binary writing mode.
+    ko.Stream() << std::fixed;  // Set to "fixed" floating point model, where precision() specifies
+    // the #digits after the decimal point.
+    ko.Stream().precision(2);
+
+    int32 n_done = 0, n_words = 0;
+    double tot_bayes_risk = 0.0;
+
+    {
+      TaskSequencer<LatticeToCtmConfTask> sequencer(sequencer_config);
+      for (; !clat_reader.Done(); clat_reader.Next()) {
+        std::string key = clat_reader.Key();
+        CompactLattice *clat = new CompactLattice(clat_reader.Value());
+        clat_reader.FreeCurrent();
+        sequencer.Run(new LatticeToCtmConfTask(key, acoustic_scale, lm_scale,
+                                               decode_mbr, frame_shift, clat,
+                                               &(ko.Stream()), &n_done,
+                                               &n_words, &tot_bayes_risk));
+      }
+      sequencer.Wait();
+    }
+
+    KALDI_LOG << "Done " << n_done << " lattices.";
+    KALDI_LOG << "Overall average Bayes Risk per sentence is "
+              << (tot_bayes_risk / n_done) << " and per word, "
+              << (tot_bayes_risk / n_words);
+
+    return (n_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,129 @@
+// matrix/compressed-matrix-speed-test.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <sstream>
+
+#include "matrix/compressed-matrix.h"
+#include "util/timer.h"
+
+namespace kaldi {
+
+// This is the decompression code as it was before it was vectorized, for
+// comparison.  It works from the binary form of a column-major
+// CompressedMatrix, as we can't get at its internals.
+static void OldCopyToMat(const std::string &cmat_binary,
+                         MatrixBase<float> *mat) {
+  struct GlobalHeader { float min_value, range; int32 num_rows, num_cols; };
+  KALDI_ASSERT(cmat_binary.compare(0, 3, "CM ") == 0);
+  const char *data = cmat_binary.data() + 3;
+  GlobalHeader h;
+  memcpy(&h, data, sizeof(h));
+  // The per-column headers are the 0th, 25th, 75th and 100th percentiles.
+  std::vector<uint16> col_headers(4 * h.num_cols);
+  memcpy(&(col_headers[0]), data + sizeof(h), 4 * h.num_cols * sizeof(uint16));
+  const unsigned char *byte_data = reinterpret_cast<const unsigned char*>(
+      data + sizeof(h) + 4 * h.num_cols * sizeof(uint16));
+  for (int32 i = 0; i < h.num_cols; i++) {
+    float p[4];
+    for (int32 k = 0; k < 4; k++)
+      p[k] = h.min_value +
+          h.range * 1.52590218966964e-05 * col_headers[4 * i + k];
+    for (int32 j = 0; j < h.num_rows; j++, byte_data++) {
+      unsigned char value = *byte_data;
+      float f;
+      if (value <= 64) f = p[0] + (p[1] - p[0]) * value * (1/64.0);
+      else if (value <= 192) f = p[1] + (p[2] - p[1]) * (value - 64) * (1/128.0);
+      else f = p[2] + (p[3] - p[2]) * (value - 192) * (1/63.0);
+      (*mat)(j, i) = f;
+    }
+  }
+}
+
+// Compares the speed of decompressing the whole matrix, and of extracting a
+// range of rows (as when training nnet2 models), for the old code and for
+// the current code with both layouts.
+void TestCompressedMatrixSpeed(int32 num_rows, int32 num_cols) {
+  BaseFloat time_in_secs = 0.05;
+  Matrix<float> mat(num_rows, num_cols);
+  mat.SetRandn();
+  CompressedMatrix cmat(mat), cmat_row_major(mat, true);
+  std::string cmat_binary;
+  {
+    std::ostringstream os;
+    cmat.Write(os, true);
+    cmat_binary = os.str();
+  }
+  Matrix<float> old_mat(num_rows, num_cols), new_mat(num_rows, num_cols);
+  OldCopyToMat(cmat_binary, &old_mat);
+  cmat_row_major.CopyToMat(&new_mat);
+  KALDI_ASSERT(old_mat.ApproxEqual(new_mat, 1.0e-05));
+
+  BaseFloat elements_per_iter = num_rows * num_cols;
+  {
+    Timer tim;
+    int32 iter = 0;
+    for (; tim.Elapsed() < time_in_secs; iter++)
+      OldCopyToMat(cmat_binary, &old_mat);
+    BaseFloat rate = (elements_per_iter * iter) / (tim.Elapsed() * 1.0e+06);
+    KALDI_LOG << "For old CopyToMat, " << num_rows << " x " << num_cols
+              << ", speed was " << rate << " million elements per second.";
+  }
+  for (int32 row_major = 0; row_major < 2; row_major++) {
+    const CompressedMatrix &this_cmat = (row_major ? cmat_row_major : cmat);
+    const char *layout = (row_major ? "row-major" : "column-major");
+    {
+      Timer tim;
+      int32 iter = 0;
+      for (; tim.Elapsed() < time_in_secs; iter++)
+        this_cmat.CopyToMat(&new_mat);
+      BaseFloat rate = (elements_per_iter * iter) / (tim.Elapsed() * 1.0e+06);
+      KALDI_LOG << "For " << layout << " CopyToMat, " << num_rows << " x "
+                << num_cols << ", speed was " << rate
+                << " million elements per second.";
+    }
+    {
+      // Extract 9 rows at a time, as for an nnet with +-4 frames of context.
+      int32 num_sub_rows = std::min<int32>(9, num_rows);
+      Matrix<float> sub_mat(num_sub_rows, num_cols);
+      Timer tim;
+      int32 iter = 0;
+      for (; tim.Elapsed() < time_in_secs; iter++)
+        this_cmat.CopyToMat(iter % (num_rows - num_sub_rows + 1), 0,
+                            &sub_mat);
+      BaseFloat rate = (num_sub_rows * num_cols * static_cast<BaseFloat>(iter))
+          / (tim.Elapsed() * 1.0e+06);
+      KALDI_LOG << "For " << layout << " CopyToMat of " << num_sub_rows
+                << " rows, " << num_rows << " x " << num_cols
+                << ", speed was " << rate << " million elements per second.";
+    }
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  int32 num_rows[] = { 9, 100, 1000 }, num_cols[] = { 13, 40, 440 };
+  for (int32 i = 0; i < 3; i++)
+    for (int32 j = 0; j < 3; j++)
+      TestCompressedMatrixSpeed(num_rows[i], num_cols[j]);
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -20,16 +20,25 @@
 
 #include "matrix/compressed-matrix.h"
 #include <algorithm>
+#include <cstring>
+
+// We vectorize the decompression with SSE2 if the compiler flags allow it
+// (the default flags in kaldi.mk include -msse -msse2).
+#if defined(__SSE2__)
+#define KALDI_COMPRESSED_MATRIX_SSE2 1
+#include <emmintrin.h>
+#endif
 
 namespace kaldi {
 
 template<typename Real>
 void CompressedMatrix::CopyFromMat(
-    const MatrixBase<Real> &mat) {
+    const MatrixBase<Real> &mat, bool row_major) {
   if (data_ != NULL) {
     delete [] static_cast<float*>(data_);  // call delete [] because was allocated with new float[]
     data_ = NULL;
   }
+  row_major_ = row_major;
   if (mat.NumRows() == 0) { return; }  // Zero-size matrix stored as zero pointer.
 
   GlobalHeader global_header;
@@ -79,21 +88,28 @@ void CompressedMatrix::CopyFromMat(
   const Real *matrix_data = mat.Data();
 
   for (int32 col = 0; col < global_header.num_cols; col++) {
-    CompressColumn(global_header,
-                   matrix_data + col, mat.Stride(),
-                   global_header.num_rows,
-                   header_data, byte_data);
+    if (row_major)
+      CompressColumn(global_header,
+                     matrix_data + col, mat.Stride(),
+                     global_header.num_rows,
+                     header_data, byte_data + col, global_header.num_cols);
+    else
+      CompressColumn(global_header,
+                     matrix_data + col, mat.Stride(),
+                     global_header.num_rows,
+                     header_data, byte_data + col * global_header.num_rows, 1);
     header_data++;
-    byte_data += global_header.num_rows;
   }
 }
 
 // Instantiate the template for float and double.
 template
-void CompressedMatrix::CopyFromMat(const MatrixBase<float> &mat);
+void CompressedMatrix::CopyFromMat(const MatrixBase<float> &mat,
+                                   bool row_major);
 
 template
-void CompressedMatrix::CopyFromMat(const MatrixBase<double> &mat);
+void CompressedMatrix::CopyFromMat(const MatrixBase<double> &mat,
+                                   bool row_major);
 
 
 template<typename Real>
@@ -230,15 +246,125 @@ inline unsigned char CompressedMatrix::FloatToChar(
 
 
 // static
-inline float CompressedMatrix::CharToFloat(
-    float p0, float p25, float p75, float p100,
-    unsigned char value) {
+inline void CompressedMatrix::GetColInfo(const GlobalHeader &global_header,
+                                         const PerColHeader &header,
+                                         ColInfo *info) {
+  float p0 = Uint16ToFloat(global_header, header.percentile_0),
+      p25 = Uint16ToFloat(global_header, header.percentile_25),
+      p75 = Uint16ToFloat(global_header, header.percentile_75),
+      p100 = Uint16ToFloat(global_header, header.percentile_100);
+  info->p0 = p0;
+  info->p25 = p25;
+  info->p75 = p75;
+  info->s0 = (p25 - p0) * (1/64.0);
+  info->s1 = (p75 - p25) * (1/128.0);
+  info->s2 = (p100 - p75) * (1/63.0);
+}
+
+// static
+inline float CompressedMatrix::CharToFloat(const ColInfo &info,
+                                           unsigned char value) {
+  // Note: the vectorized code in DecompressCol() and DecompressRow() must give
+  // exactly the same answer as this.
   if (value <= 64) {
-    return p0 + (p25 - p0) * value * (1/64.0);
+    return info.p0 + info.s0 * static_cast<float>(value);
   } else if (value <= 192) {
-    return p25 + (p75 - p25) * (value - 64) * (1/128.0);
+    return info.p25 + info.s1 * static_cast<float>(value - 64);
   } else {
-    return p75 + (p100 - p75) * (value - 192) * (1/63.0);
+    return info.p75 + info.s2 * static_cast<float>(value - 192);
+  }
+}
+
+#ifdef KALDI_COMPRESSED_MATRIX_SSE2
+// Converts 4 bytes to 4 floats.
+static inline __m128 LoadBytesAsFloats(const unsigned char *bytes) {
+  int32 i;
+  memcpy(&i, bytes, 4);
+  __m128i zero = _mm_setzero_si128(),
+      x = _mm_unpacklo_epi8(_mm_cvtsi32_si128(i), zero);
+  return _mm_cvtepi32_ps(_mm_unpacklo_epi16(x, zero));
+}
+
+// Returns a where mask is set, else b.
+static inline __m128 SelectFloats(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Decompresses 4 bytes given the constants for each of them.
+static inline __m128 DecompressFloats(__m128 c, __m128 p0, __m128 p25,
+                                      __m128 p75, __m128 s0, __m128 s1,
+                                      __m128 s2) {
+  __m128 le64 = _mm_cmple_ps(c, _mm_set1_ps(64.0)),
+      le192 = _mm_cmple_ps(c, _mm_set1_ps(192.0)),
+      offset = SelectFloats(le64, _mm_setzero_ps(),
+                            SelectFloats(le192, _mm_set1_ps(64.0),
+                                         _mm_set1_ps(192.0))),
+      base = SelectFloats(le64, p0, SelectFloats(le192, p25, p75)),
+      scale = SelectFloats(le64, s0, SelectFloats(le192, s1, s2));
+  return _mm_add_ps(base, _mm_mul_ps(scale, _mm_sub_ps(c, offset)));
+}
+#endif
+
+// static
+void CompressedMatrix::DecompressCol(const ColInfo &info,
+                                     const unsigned char *bytes,
+                                     int32 n, float *out) {
+  int32 i = 0;
+#ifdef KALDI_COMPRESSED_MATRIX_SSE2
+  __m128 p0 = _mm_set1_ps(info.p0), p25 = _mm_set1_ps(info.p25),
+      p75 = _mm_set1_ps(info.p75), s0 = _mm_set1_ps(info.s0),
+      s1 = _mm_set1_ps(info.s1), s2 = _mm_set1_ps(info.s2);
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(out + i, DecompressFloats(LoadBytesAsFloats(bytes + i),
+                                            p0, p25, p75, s0, s1, s2));
+#endif
+  for (; i < n; i++)
+    out[i] = CharToFloat(info, bytes[i]);
+}
+
+// static
+void CompressedMatrix::DecompressRow(const float *info, int32 info_stride,
+                                     const unsigned char *bytes,
+                                     int32 n, float *out) {
+  const float *p0 = info, *p25 = info + info_stride,
+      *p75 = info + 2 * info_stride, *s0 = info + 3 * info_stride,
+      *s1 = info + 4 * info_stride, *s2 = info + 5 * info_stride;
+  int32 i = 0;
+#ifdef KALDI_COMPRESSED_MATRIX_SSE2
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(out + i, DecompressFloats(
+        LoadBytesAsFloats(bytes + i), _mm_loadu_ps(p0 + i),
+        _mm_loadu_ps(p25 + i), _mm_loadu_ps(p75 + i), _mm_loadu_ps(s0 + i),
+        _mm_loadu_ps(s1 + i), _mm_loadu_ps(s2 + i)));
+#endif
+  for (; i < n; i++) {
+    ColInfo this_info;
+    this_info.p0 = p0[i];
+    this_info.p25 = p25[i];
+    this_info.p75 = p75[i];
+    this_info.s0 = s0[i];
+    this_info.s1 = s1[i];
+    this_info.s2 = s2[i];
+    out[i] = CharToFloat(this_info, bytes[i]);
+  }
+}
+
+void CompressedMatrix::GetRowInfo(int32 col_offset, int32 num_cols,
+                                  std::vector<float> *info) const {
+  const GlobalHeader *h = reinterpret_cast<const GlobalHeader*>(data_);
+  const PerColHeader *per_col_header =
+      reinterpret_cast<const PerColHeader*>(h + 1) + col_offset;
+  info->resize(6 * num_cols);
+  float *p = &((*info)[0]);
+  for (int32 i = 0; i < num_cols; i++) {
+    ColInfo col_info;
+    GetColInfo(*h, per_col_header[i], &col_info);
+    p[i] = col_info.p0;
+    p[i + num_cols] = col_info.p25;
+    p[i + 2 * num_cols] = col_info.p75;
+    p[i + 3 * num_cols] = col_info.s0;
+    p[i + 4 * num_cols] = col_info.s1;
+    p[i + 5 * num_cols] = col_info.s2;
   }
 }
 
@@ -248,7 +374,7 @@ void CompressedMatrix::CompressColumn(
     const GlobalHeader &global_header,
     const Real *data, MatrixIndexT stride,
     int32 num_rows, CompressedMatrix::PerColHeader *header,
-    unsigned char *byte_data) {
+    unsigned char *byte_data, MatrixIndexT byte_stride) {
   ComputeColHeader(global_header, data, stride,
                    num_rows, header);
   
@@ -259,7 +385,7 @@ void CompressedMatrix::CompressColumn(
 
   for (int32 i = 0; i < num_rows; i++) {
     Real this_data = data[i * stride];
-    byte_data[i] = FloatToChar(p0, p25, p75, p100, this_data);
+    byte_data[i * byte_stride] = FloatToChar(p0, p25, p75, p100, this_data);
   }
 }
 
@@ -276,7 +402,7 @@ void* CompressedMatrix::AllocateData(int32 num_bytes) {
 
 void CompressedMatrix::Write(std::ostream &os, bool binary) const {
   if (binary) {  // Binary-mode write:
-    WriteToken(os, binary, "CM");
+    WriteToken(os, binary, row_major_ ? "CMR" : "CM");
     if (data_ != NULL) {
       GlobalHeader &h = *reinterpret_cast<GlobalHeader*>(data_);
       MatrixIndexT size = DataSize(h);  // total size of data in data_
@@ -328,13 +454,19 @@ void CompressedMatrix::Read(std::istream &is, bool binary) {
     delete [] (static_cast<float*>(data_));
     data_ = NULL;
   }
+  row_major_ = false;
   if (binary) {  // Binary-mode read.
     // Caution: the following is not back compatible, if you were using
     // CompressedMatrix before, the old format will not be readable.
 
     int peekval = Peek(is, binary);
     if (peekval == 'C') {
-      ExpectToken(is, binary, "CM"); 
+      std::string token;
+      ReadToken(is, binary, &token);
+      if (token == "CMR")
+        row_major_ = true;
+      else if (token != "CM")
+        KALDI_ERR << "Unexpected token " << token << ", expecting CM or CMR";
       GlobalHeader h;
       is.read(reinterpret_cast<char*>(&h), sizeof(h));
       if (is.fail())
@@ -403,23 +535,9 @@ void CompressedMatrix::CopyToMat(MatrixBase<Real> *mat) const {
     KALDI_ASSERT(mat->NumRows() == 0);
     KALDI_ASSERT(mat->NumCols() == 0);
   } else {
-    GlobalHeader *h = reinterpret_cast<GlobalHeader*>(data_);
-    PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
-    unsigned char *byte_data = reinterpret_cast<unsigned char*>(per_col_header +
-                                                                h->num_cols);
-    int32 num_cols = h->num_cols, num_rows = h->num_rows;
-    KALDI_ASSERT(mat->NumRows() == num_rows);
-    KALDI_ASSERT(mat->NumCols() == num_cols);
-    for (int32 i = 0; i < num_cols; i++, per_col_header++) {
-      float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
-          p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
-          p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
-          p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
-      for (int32 j = 0; j < num_rows; j++, byte_data++) {
-        float f = CharToFloat(p0, p25, p75, p100, *byte_data);
-        (*mat)(j, i) = f;
-      }
-    }
+    KALDI_ASSERT(mat->NumRows() == NumRows());
+    KALDI_ASSERT(mat->NumCols() == NumCols());
+    CopyToMat(0, 0, mat);
   }
 }
 
@@ -440,17 +558,25 @@ void CompressedMatrix::CopyRowToVec(MatrixIndexT row,
   PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
   unsigned char *byte_data = reinterpret_cast<unsigned char*>(per_col_header +
                                                               h->num_cols);
-  byte_data += row;  // point to first value we are interested in
-  for (int32 i = 0; i < h->num_cols;
-       i++, per_col_header++, byte_data+=h->num_rows) {
-    float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
-          p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
-          p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
-          p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
-    float f = CharToFloat(p0, p25, p75, p100, *byte_data);
-    (*v)(i) = f;
+  int32 num_cols = h->num_cols;
+  // Point to the first value we are interested in, and work out the distance
+  // between consecutive values in this row.
+  MatrixIndexT byte_stride;
+  if (row_major_) {
+    byte_data += row * num_cols;
+    byte_stride = 1;
+  } else {
+    byte_data += row;
+    byte_stride = h->num_rows;
+  }
+  Real *v_data = v->Data();
+  for (int32 i = 0; i < num_cols; i++, per_col_header++) {
+    ColInfo info;
+    GetColInfo(*h, *per_col_header, &info);
+    v_data[i] = CharToFloat(info, byte_data[i * byte_stride]);
   }
 }
+
 template<typename Real>
 void CompressedMatrix::CopyColToVec(MatrixIndexT col,
                                     VectorBase<Real> *v) const {
@@ -462,15 +588,23 @@ void CompressedMatrix::CopyColToVec(MatrixIndexT col,
   PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
   unsigned char *byte_data = reinterpret_cast<unsigned char*>(per_col_header +
                                                               h->num_cols);
-  byte_data += col*h->num_rows;  // point to first value in the column we want
-  per_col_header += col;
-  float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
-        p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
-        p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
-        p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
-  for (int32 i = 0; i < h->num_rows; i++, byte_data++) {
-    float f = CharToFloat(p0, p25, p75, p100, *byte_data);
-    (*v)(i) = f;
+  int32 num_rows = h->num_rows, num_cols = h->num_cols;
+  ColInfo info;
+  GetColInfo(*h, per_col_header[col], &info);
+  Real *v_data = v->Data();
+  if (row_major_) {
+    byte_data += col;
+    for (int32 i = 0; i < num_rows; i++)
+      v_data[i] = CharToFloat(info, byte_data[i * num_cols]);
+  } else {
+    byte_data += col * num_rows;  // point to first value in the column we want
+    if (sizeof(Real) == sizeof(float)) {
+      DecompressCol(info, byte_data, num_rows,
+                    reinterpret_cast<float*>(v_data));
+    } else {
+      for (int32 i = 0; i < num_rows; i++)
+        v_data[i] = CharToFloat(info, byte_data[i]);
+    }
   }
 }
 
@@ -492,33 +626,52 @@ void CompressedMatrix::CopyToMat(int32 row_offset,
   KALDI_PARANOID_ASSERT(column_offset < this->NumCols());
   KALDI_PARANOID_ASSERT(row_offset >= 0);
   KALDI_PARANOID_ASSERT(column_offset >= 0);
-  KALDI_ASSERT(row_offset+dest->NumRows() < this->NumRows());
-  KALDI_ASSERT(column_offset+dest->NumCols() < this->NumCols());
+  KALDI_ASSERT(row_offset+dest->NumRows() <= this->NumRows());
+  KALDI_ASSERT(column_offset+dest->NumCols() <= this->NumCols());
   // everything is OK
+  int32 tgt_cols = dest->NumCols(), tgt_rows = dest->NumRows();
+  if (tgt_cols == 0 || tgt_rows == 0) return;
   GlobalHeader *h = reinterpret_cast<GlobalHeader*>(data_);
   PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
   unsigned char *byte_data = reinterpret_cast<unsigned char*>(per_col_header +
                                                               h->num_cols);
-  int32 num_rows = h->num_rows;
-  int32 tgt_cols = dest->NumCols(), tgt_rows = dest->NumRows();
-
-  unsigned char *start_of_subcol = byte_data+row_offset;  // skip appropriate
-  // number of columns
-  start_of_subcol += column_offset*num_rows;  // skip appropriate number of rows
-
-  per_col_header += column_offset;  // skip the appropriate number of headers
-
-  for (int32 i = 0;
-       i < tgt_cols;
-       i++, per_col_header++, start_of_subcol+=num_rows) {
-    byte_data = start_of_subcol;
-    float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
-          p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
-          p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
-          p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
-    for (int32 j = 0; j < tgt_rows; j++, byte_data++) {
-      float f = CharToFloat(p0, p25, p75, p100, *byte_data);
-      (*dest)(j, i) = f;
+  int32 num_rows = h->num_rows, num_cols = h->num_cols;
+  bool is_float = (sizeof(Real) == sizeof(float));
+
+  if (row_major_) {
+    // Decompress row by row, directly into "dest" if it is float.
+    std::vector<float> info, temp(is_float ? 0 : tgt_cols);
+    GetRowInfo(column_offset, tgt_cols, &info);
+    unsigned char *row_data = byte_data + row_offset * num_cols +
+        column_offset;
+    for (int32 j = 0; j < tgt_rows; j++, row_data += num_cols) {
+      Real *dest_row = dest->RowData(j);
+      if (is_float) {
+        DecompressRow(&(info[0]), tgt_cols, row_data, tgt_cols,
+                      reinterpret_cast<float*>(dest_row));
+      } else {
+        DecompressRow(&(info[0]), tgt_cols, row_data, tgt_cols, &(temp[0]));
+        for (int32 i = 0; i < tgt_cols; i++)
+          dest_row[i] = temp[i];
+      }
+    }
+  } else {
+    // Decompress each column into a temporary buffer and copy it into
+    // the column of "dest".
+    std::vector<float> temp(tgt_rows);
+    unsigned char *col_data = byte_data + column_offset * num_rows +
+        row_offset;
+    per_col_header += column_offset;  // skip the appropriate number of headers
+    Real *dest_data = dest->Data();
+    MatrixIndexT dest_stride = dest->Stride();
+    for (int32 i = 0; i < tgt_cols;
+         i++, per_col_header++, col_data += num_rows) {
+      ColInfo info;
+      GetColInfo(*h, *per_col_header, &info);
+      DecompressCol(info, col_data, tgt_rows, &(temp[0]));
+      Real *dest_col = dest_data + i;
+      for (int32 j = 0; j < tgt_rows; j++)
+        dest_col[j * dest_stride] = temp[j];
     }
   }
 }
@@ -538,12 +691,14 @@ void CompressedMatrix::Destroy() {
   }
 }
 
-CompressedMatrix::CompressedMatrix(const CompressedMatrix &mat): data_(NULL) {
+CompressedMatrix::CompressedMatrix(const CompressedMatrix &mat): data_(NULL),
+                                                                 row_major_(false) {
   *this = mat; // use assignment operator.
 }
 
 CompressedMatrix &CompressedMatrix::operator = (const CompressedMatrix &mat) {
   Destroy(); // now this->data_ == NULL.
+  row_major_ = mat.row_major_;
   if (mat.data_ != NULL) {
     MatrixIndexT data_size = DataSize(*static_cast<GlobalHeader*>(mat.data_));
     data_ = AllocateData(data_size);
@@ -40,19 +40,29 @@ namespace kaldi {
 /// the column as a single byte, in 3 separate ranges with different
 /// linear encodings (0-25th, 25-50th, 50th-100th).
 
+/// The bytes are normally stored column by column, but they may be stored
+/// row by row instead (the "row-major" layout), which makes CopyRowToVec()
+/// and copying a range of rows (as when we extract frames from the
+/// input_frames of an nnet2 NnetExample) faster.  The row-major layout is
+/// written to disk with a different token ("CMR" instead of "CM"), which
+/// older code will not be able to read.  Decompression is vectorized with
+/// SSE2 where available.
+
 class CompressedMatrix {
  public:
-  CompressedMatrix(): data_(NULL) { }
+  CompressedMatrix(): data_(NULL), row_major_(false) { }
 
   ~CompressedMatrix() { Destroy(); }
   
   template<typename Real>
-  CompressedMatrix(const MatrixBase<Real> &mat): data_(NULL) { CopyFromMat(mat); }
+  CompressedMatrix(const MatrixBase<Real> &mat, bool row_major = false):
+      data_(NULL), row_major_(false) { CopyFromMat(mat, row_major); }
 
 
-  /// This will resize *this and copy the contents of mat to *this.
+  /// This will resize *this and copy the contents of mat to *this.  If
+  /// row_major == true, the bytes will be stored row by row (see above).
   template<typename Real>
-  void CopyFromMat(const MatrixBase<Real> &mat);
+  void CopyFromMat(const MatrixBase<Real> &mat, bool row_major = false);
   
   CompressedMatrix(const CompressedMatrix &mat);
   
@@ -78,6 +88,9 @@ class CompressedMatrix {
   inline MatrixIndexT NumCols() const { return (data_ == NULL) ? 0 :
       (*reinterpret_cast<GlobalHeader*>(data_)).num_cols; }
 
+  /// Returns true if the bytes are stored row by row.
+  bool IsRowMajor() const { return row_major_; }
+
   /// Copies row #row of the matrix into vector v.
   /// Note: v must have same size as #cols.
   template<typename Real>
@@ -96,7 +109,10 @@ class CompressedMatrix {
                  int32 column_offset,
                  MatrixBase<Real> *dest) const;
 
-  void Swap(CompressedMatrix *other) { std::swap(data_, other->data_); }
+  void Swap(CompressedMatrix *other) {
+    std::swap(data_, other->data_);
+    std::swap(row_major_, other->row_major_);
+  }
   
   friend class Matrix<float>;
   friend class Matrix<double>;
@@ -126,11 +142,13 @@ class CompressedMatrix {
     uint16 percentile_100;
   };
 
+  // Compresses a column; the bytes are written to byte_data[i * byte_stride].
   template<typename Real>
   static void CompressColumn(const GlobalHeader &global_header,
                              const Real *data, MatrixIndexT stride,
                              int32 num_rows, PerColHeader *header,
-                             unsigned char *byte_data);
+                             unsigned char *byte_data,
+                             MatrixIndexT byte_stride);
   template<typename Real>
   static void ComputeColHeader(const GlobalHeader &global_header,
                                const Real *data, MatrixIndexT stride,
@@ -144,15 +162,42 @@ class CompressedMatrix {
   static inline unsigned char FloatToChar(float p0, float p25,
                                           float p75, float p100,
                                           float value);
-  static inline float CharToFloat(float p0, float p25,
-                                  float p75, float p100,
-                                  unsigned char value);
+
+  // The constants we need to decompress the bytes of one column: byte value c
+  // becomes p0 + s0 * c if c <= 64, p25 + s1 * (c - 64) if c <= 192, and
+  // p75 + s2 * (c - 192) otherwise.
+  struct ColInfo {
+    float p0, p25, p75;
+    float s0, s1, s2;
+  };
+  static inline void GetColInfo(const GlobalHeader &global_header,
+                                const PerColHeader &header, ColInfo *info);
+  static inline float CharToFloat(const ColInfo &info, unsigned char value);
+
+  // Decompresses "n" bytes that all belong to the same column.
+  static void DecompressCol(const ColInfo &info, const unsigned char *bytes,
+                            int32 n, float *out);
+
+  // Decompresses "n" bytes that belong to consecutive columns; "info" holds
+  // the constants for those columns as an array of ColInfo with all the
+  // p0's first, then all the p25's, and so on, each with stride
+  // "info_stride" (this is the layout we need for vectorization).
+  static void DecompressRow(const float *info, int32 info_stride,
+                            const unsigned char *bytes, int32 n, float *out);
+
+  // Puts the ColInfo for columns col_offset ... col_offset + num_cols - 1 into
+  // "info" in the layout that DecompressRow() needs, with info_stride equal
+  // to num_cols.
+  void GetRowInfo(int32 col_offset, int32 num_cols,
+                  std::vector<float> *info) const;
   
   void Destroy();
   
   void *data_; // first GlobalHeader, then PerColHeader (repeated), then
-  // the byte data for each column (repeated).  Note: don't intersperse
-  // the byte data with the PerColHeaders, because of alignment issues.
+  // the byte data for each column (repeated), or for each row if row_major_.
+  // Note: don't intersperse the byte data with the PerColHeaders, because of
+  // alignment issues.
+  bool row_major_;  // True if the byte data is stored row by row.
 
 };
 
@@ -0,0 +1,236 @@
+// matrix/elementwise-functions.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include "base/kaldi-math.h"
+#include "matrix/elementwise-functions.h"
+
+// We vectorize with SSE2 if the compiler flags allow it (the default flags in
+// kaldi.mk include -msse -msse2).
+#if defined(__SSE2__)
+#define KALDI_ELEMENTWISE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace kaldi {
+
+// The scalar versions.  These are used for double precision, for the last
+// (dim % 4) elements, and if we don't have SSE2.  Sigmoid and tanh are written
+// without branches on the sign of x: with inputs of random sign, as in neural
+// nets, such branches are mispredicted about half the time.
+
+template<typename Real>
+static inline void SigmoidElementsScalar(MatrixIndexT dim, const Real *x,
+                                         Real *y) {
+  // With e = exp(-|x|), which can't overflow, sigmoid(x) is 1 / (1 + e) for
+  // x >= 0 and e / (1 + e) for x < 0.
+  for (MatrixIndexT i = 0; i < dim; i++) {
+    Real xi = x[i], e = Exp(-std::abs(xi));
+    y[i] = (xi >= 0.0 ? static_cast<Real>(1.0) : e) /
+        (static_cast<Real>(1.0) + e);
+  }
+}
+
+template<typename Real>
+static inline void TanhElementsScalar(MatrixIndexT dim, const Real *x,
+                                      Real *y) {
+  // tanh(x) = 2 sigmoid(2x) - 1, with the sigmoid computed as above.
+  for (MatrixIndexT i = 0; i < dim; i++) {
+    Real xi = x[i], e = Exp(static_cast<Real>(-2.0) * std::abs(xi));
+    y[i] = static_cast<Real>(2.0) * (xi >= 0.0 ? static_cast<Real>(1.0) : e) /
+        (static_cast<Real>(1.0) + e) - static_cast<Real>(1.0);
+  }
+}
+
+template<typename Real>
+static inline Real ExpElementsAndSumScalar(MatrixIndexT dim, const Real *x,
+                                           Real offset, Real *y) {
+  Real sum = 0.0;
+  for (MatrixIndexT i = 0; i < dim; i++)
+    sum += (y[i] = Exp(x[i] - offset));
+  return sum;
+}
+
+#ifdef KALDI_ELEMENTWISE_SSE2
+// Returns exp(x) for each element of x, to within about 2e-7 relative error.
+// This is the Cephes single-precision algorithm: exp(x) = 2^n exp(g) with
+// n = round(x / log(2)), where exp(g) for |g| <= log(2)/2 is a polynomial.
+// x is clamped to [-88.38, 88.38], so results below about 1e-38 come out as
+// zero rather than as denormals.  NaNs are propagated.
+static inline __m128 ExpPs(__m128 x) {
+  // _mm_min_ps and _mm_max_ps return their second argument if either is a
+  // NaN, so putting x second propagates it.
+  x = _mm_min_ps(_mm_set1_ps(88.3762626647949f), x);
+  x = _mm_max_ps(_mm_set1_ps(-88.3762626647949f), x);
+
+  // n = floor(x / log(2) + 0.5).  _mm_cvttps_epi32 truncates toward zero, so
+  // we subtract 1 where that rounded up.
+  __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)),
+                         _mm_set1_ps(0.5f));
+  __m128 tmp = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+  __m128 too_big = _mm_and_ps(_mm_cmpgt_ps(tmp, fx), _mm_set1_ps(1.0f));
+  fx = _mm_sub_ps(tmp, too_big);
+
+  // g = x - n log(2), with log(2) split in two for accuracy.
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(0.693359375f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(-2.12194440e-4f)));
+
+  __m128 z = _mm_mul_ps(x, x),
+      y = _mm_set1_ps(1.9875691500e-4f);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, z), x);
+  y = _mm_add_ps(y, _mm_set1_ps(1.0f));
+
+  // Multiply by 2^n, building the float directly from its exponent bits.
+  __m128i n = _mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(0x7f));
+  return _mm_mul_ps(y, _mm_castsi128_ps(_mm_slli_epi32(n, 23)));
+}
+#endif
+
+void SigmoidElements(MatrixIndexT dim, const float *x, float *y) {
+  MatrixIndexT i = 0;
+#ifdef KALDI_ELEMENTWISE_SSE2
+  const __m128 one = _mm_set1_ps(1.0f), sign_bit = _mm_set1_ps(-0.0f);
+  for (; i + 4 <= dim; i += 4) {
+    __m128 xi = _mm_loadu_ps(x + i),
+        e = ExpPs(_mm_or_ps(xi, sign_bit)),  // exp(-|x|)
+        nonneg = _mm_cmpge_ps(xi, _mm_setzero_ps()),
+        num = _mm_or_ps(_mm_and_ps(nonneg, one), _mm_andnot_ps(nonneg, e));
+    _mm_storeu_ps(y + i, _mm_div_ps(num, _mm_add_ps(one, e)));
+  }
+#endif
+  SigmoidElementsScalar(dim - i, x + i, y + i);
+}
+
+void SigmoidElements(MatrixIndexT dim, const double *x, double *y) {
+  SigmoidElementsScalar(dim, x, y);
+}
+
+void TanhElements(MatrixIndexT dim, const float *x, float *y) {
+  MatrixIndexT i = 0;
+#ifdef KALDI_ELEMENTWISE_SSE2
+  // tanh(|x|) = (1 - e) / (1 + e) with e = exp(-2|x|), and we copy the sign
+  // of x onto that.
+  const __m128 one = _mm_set1_ps(1.0f), sign_bit = _mm_set1_ps(-0.0f);
+  for (; i + 4 <= dim; i += 4) {
+    __m128 xi = _mm_loadu_ps(x + i),
+        neg_abs_x = _mm_or_ps(xi, sign_bit),
+        e = ExpPs(_mm_add_ps(neg_abs_x, neg_abs_x)),
+        t = _mm_div_ps(_mm_sub_ps(one, e), _mm_add_ps(one, e));
+    _mm_storeu_ps(y + i, _mm_or_ps(t, _mm_and_ps(xi, sign_bit)));
+  }
+#endif
+  TanhElementsScalar(dim - i, x + i, y + i);
+}
+
+void TanhElements(MatrixIndexT dim, const double *x, double *y) {
+  TanhElementsScalar(dim, x, y);
+}
+
+float ExpElementsAndSum(MatrixIndexT dim, const float *x, float offset,
+                        float *y) {
+  MatrixIndexT i = 0;
+  float sum = 0.0;
+#ifdef KALDI_ELEMENTWISE_SSE2
+  if (dim >= 4) {
+    const __m128 offset4 = _mm_set1_ps(offset);
+    __m128 sum4 = _mm_setzero_ps();
+    for (; i + 4 <= dim; i += 4) {
+      __m128 e = ExpPs(_mm_sub_ps(_mm_loadu_ps(x + i), offset4));
+      _mm_storeu_ps(y + i, e);
+      sum4 = _mm_add_ps(sum4, e);
+    }
+    sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+    sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+    sum = _mm_cvtss_f32(sum4);
+  }
+#endif
+  return sum + ExpElementsAndSumScalar(dim - i, x + i, offset, y + i);
+}
+
+double ExpElementsAndSum(MatrixIndexT dim, const double *x, double offset,
+                         double *y) {
+  return ExpElementsAndSumScalar(dim, x, offset, y);
+}
+
+void DiffSigmoidElements(MatrixIndexT dim, const float *value,
+                         const float *diff, float *y) {
+  MatrixIndexT i = 0;
+#ifdef KALDI_ELEMENTWISE_SSE2
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (; i + 4 <= dim; i += 4) {
+    __m128 v = _mm_loadu_ps(value + i);
+    _mm_storeu_ps(y + i, _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(diff + i), v),
+                                    _mm_sub_ps(one, v)));
+  }
+#endif
+  for (; i < dim; i++)
+    y[i] = diff[i] * value[i] * (1.0f - value[i]);
+}
+
+void DiffSigmoidElements(MatrixIndexT dim, const double *value,
+                         const double *diff, double *y) {
+  MatrixIndexT i = 0;
+#ifdef KALDI_ELEMENTWISE_SSE2
+  const __m128d one = _mm_set1_pd(1.0);
+  for (; i + 2 <= dim; i += 2) {
+    __m128d v = _mm_loadu_pd(value + i);
+    _mm_storeu_pd(y + i, _mm_mul_pd(_mm_mul_pd(_mm_loadu_pd(diff + i), v),
+                                    _mm_sub_pd(one, v)));
+  }
+#endif
+  for (; i < dim; i++)
+    y[i] = diff[i] * value[i] * (1.0 - value[i]);
+}
+
+void DiffTanhElements(MatrixIndexT dim, const float *value,
+                      const float *diff, float *y) {
+  MatrixIndexT i = 0;
+#ifdef KALDI_ELEMENTWISE_SSE2
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (; i + 4 <= dim; i += 4) {
+    __m128 v = _mm_loadu_ps(value + i);
+    _mm_storeu_ps(y + i, _mm_mul_ps(_mm_loadu_ps(diff + i),
+                                    _mm_sub_ps(one, _mm_mul_ps(v, v))));
+  }
+#endif
+  for (; i < dim; i++)
+    y[i] = diff[i] * (1.0f - value[i] * value[i]);
+}
+
+void DiffTanhElements(MatrixIndexT dim, const double *value,
+                      const double *diff, double *y) {
+  MatrixIndexT i = 0;
+#ifdef KALDI_ELEMENTWISE_SSE2
+  const __m128d one = _mm_set1_pd(1.0);
+  for (; i + 2 <= dim; i += 2) {
+    __m128d v = _mm_loadu_pd(value + i);
+    _mm_storeu_pd(y + i, _mm_mul_pd(_mm_loadu_pd(diff + i),
+                                    _mm_sub_pd(one, _mm_mul_pd(v, v))));
+  }
+#endif
+  for (; i < dim; i++)
+    y[i] = diff[i] * (1.0 - value[i] * value[i]);
+}
+
+}  // namespace kaldi
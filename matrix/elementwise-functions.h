@@ -0,0 +1,73 @@
+// matrix/elementwise-functions.h
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_ELEMENTWISE_FUNCTIONS_H_
+#define KALDI_MATRIX_ELEMENTWISE_FUNCTIONS_H_
+
+#include "matrix/matrix-common.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_funcs_misc
+/// @{
+
+/// The functions below are the inner loops of the elementwise nonlinearities
+/// of VectorBase and MatrixBase (Sigmoid(), Tanh(), SoftMaxPerRow(),
+/// DiffSigmoid(), DiffTanh()), which the CuMatrix code uses when there is no
+/// GPU.  They operate on "dim" contiguous elements.  Where the compiler flags
+/// allow it (the default flags in kaldi.mk include -msse -msse2) they are
+/// vectorized with SSE2: the exponential-based ones in single precision only,
+/// using a polynomial approximation to exp() that is accurate to about 2e-7
+/// relative; the Diff* ones in both precisions.  The output may be the same
+/// array as an input.
+
+/// Sets y[i] = 1 / (1 + exp(-x[i])).
+void SigmoidElements(MatrixIndexT dim, const float *x, float *y);
+void SigmoidElements(MatrixIndexT dim, const double *x, double *y);
+
+/// Sets y[i] = tanh(x[i]).
+void TanhElements(MatrixIndexT dim, const float *x, float *y);
+void TanhElements(MatrixIndexT dim, const double *x, double *y);
+
+/// Sets y[i] = exp(x[i] - offset) and returns the sum of the y[i]; used in
+/// softmax, with "offset" the max of x.
+float ExpElementsAndSum(MatrixIndexT dim, const float *x, float offset,
+                        float *y);
+double ExpElementsAndSum(MatrixIndexT dim, const double *x, double offset,
+                         double *y);
+
+/// Sets y[i] = diff[i] * value[i] * (1 - value[i]); this backpropagates
+/// through the sigmoid, if "value" is its output.
+void DiffSigmoidElements(MatrixIndexT dim, const float *value,
+                         const float *diff, float *y);
+void DiffSigmoidElements(MatrixIndexT dim, const double *value,
+                         const double *diff, double *y);
+
+/// Sets y[i] = diff[i] * (1 - value[i]^2); this backpropagates through tanh,
+/// if "value" is its output.
+void DiffTanhElements(MatrixIndexT dim, const float *value,
+                      const float *diff, float *y);
+void DiffTanhElements(MatrixIndexT dim, const double *value,
+                      const double *diff, double *y);
+
+/// @} end of "addtogroup matrix_funcs_misc"
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_ELEMENTWISE_FUNCTIONS_H_
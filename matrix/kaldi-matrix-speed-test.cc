@@ -0,0 +1,186 @@
+// matrix/kaldi-matrix-speed-test.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "matrix/matrix-lib.h"
+#include "util/timer.h"
+
+namespace kaldi {
+
+// The functions below are the elementwise nonlinearities and their derivatives
+// as they were before they were made branch-free and vectorized, for
+// comparison.
+
+template<typename Real>
+static void OldSigmoid(const MatrixBase<Real> &src, MatrixBase<Real> *dest) {
+  for (MatrixIndexT r = 0; r < src.NumRows(); r++) {
+    for (MatrixIndexT c = 0; c < src.NumCols(); c++) {
+      Real x = src(r, c);
+      if (x > 0.0) {
+        x = 1.0 / (1.0 + Exp(-x));
+      } else {
+        Real ex = Exp(x);
+        x = ex / (ex + 1.0);
+      }
+      (*dest)(r, c) = x;
+    }
+  }
+}
+
+template<typename Real>
+static void OldTanh(const MatrixBase<Real> &src, MatrixBase<Real> *dest) {
+  for (MatrixIndexT r = 0; r < src.NumRows(); r++) {
+    for (MatrixIndexT c = 0; c < src.NumCols(); c++) {
+      Real x = src(r, c);
+      if (x > 0.0) {
+        Real inv_expx = Exp(-x);
+        x = -1.0 + 2.0 / (1.0 + inv_expx * inv_expx);
+      } else {
+        Real inv_expx = Exp(x);
+        x = 1.0 - 2.0 / (1.0 + inv_expx * inv_expx);
+      }
+      (*dest)(r, c) = x;
+    }
+  }
+}
+
+template<typename Real>
+static void OldSoftHinge(const MatrixBase<Real> &src, MatrixBase<Real> *dest) {
+  for (MatrixIndexT r = 0; r < src.NumRows(); r++) {
+    for (MatrixIndexT c = 0; c < src.NumCols(); c++) {
+      Real x = src(r, c);
+      (*dest)(r, c) = (x > 10.0 ? x : Log1p(Exp(x)));
+    }
+  }
+}
+
+template<typename Real>
+static void OldSoftMaxPerRow(const MatrixBase<Real> &src,
+                             MatrixBase<Real> *dest) {
+  dest->CopyFromMat(src);
+  for (MatrixIndexT r = 0; r < dest->NumRows(); r++)
+    dest->Row(r).ApplySoftMax();
+}
+
+template<typename Real>
+static void OldDiffSigmoid(const MatrixBase<Real> &value,
+                           const MatrixBase<Real> &diff,
+                           MatrixBase<Real> *dest) {
+  for (MatrixIndexT r = 0; r < value.NumRows(); r++) {
+    const Real *value_data = value.RowData(r), *diff_data = diff.RowData(r);
+    Real *data = dest->RowData(r);
+    for (MatrixIndexT c = 0; c < value.NumCols(); c++)
+      data[c] = diff_data[c] * value_data[c] * (1.0 - value_data[c]);
+  }
+}
+
+template<typename Real>
+static void OldDiffTanh(const MatrixBase<Real> &value,
+                        const MatrixBase<Real> &diff,
+                        MatrixBase<Real> *dest) {
+  for (MatrixIndexT r = 0; r < value.NumRows(); r++) {
+    const Real *value_data = value.RowData(r), *diff_data = diff.RowData(r);
+    Real *data = dest->RowData(r);
+    for (MatrixIndexT c = 0; c < value.NumCols(); c++)
+      data[c] = diff_data[c] * (1.0 - value_data[c] * value_data[c]);
+  }
+}
+
+enum NonlinearityType { kSigmoid, kTanh, kSoftHinge, kSoftMaxPerRow,
+                        kDiffSigmoid, kDiffTanh };
+
+static const char *NonlinearityName(NonlinearityType type) {
+  switch (type) {
+    case kSigmoid: return "Sigmoid";
+    case kTanh: return "Tanh";
+    case kSoftHinge: return "SoftHinge";
+    case kSoftMaxPerRow: return "SoftMaxPerRow";
+    case kDiffSigmoid: return "DiffSigmoid";
+    default: return "DiffTanh";
+  }
+}
+
+template<typename Real>
+static void ApplyNonlinearity(NonlinearityType type, bool old,
+                              const MatrixBase<Real> &src,
+                              MatrixBase<Real> *dest) {
+  switch (type) {
+    case kSigmoid:
+      if (old) OldSigmoid(src, dest); else dest->Sigmoid(src);
+      break;
+    case kTanh:
+      if (old) OldTanh(src, dest); else dest->Tanh(src);
+      break;
+    case kSoftHinge:
+      if (old) OldSoftHinge(src, dest); else dest->SoftHinge(src);
+      break;
+    case kSoftMaxPerRow:
+      if (old) OldSoftMaxPerRow(src, dest); else dest->SoftMaxPerRow(src);
+      break;
+    // For the derivatives, we just use src as both the value and the diff.
+    case kDiffSigmoid:
+      if (old) OldDiffSigmoid(src, src, dest); else dest->DiffSigmoid(src, src);
+      break;
+    default:
+      if (old) OldDiffTanh(src, src, dest); else dest->DiffTanh(src, src);
+  }
+}
+
+// Checks that the old and current versions agree, and compares their speed
+// on inputs of random sign, as in neural nets.
+template<typename Real>
+void TestNonlinearitySpeed(NonlinearityType type, int32 dim) {
+  BaseFloat time_in_secs = 0.05;
+  Matrix<Real> src(dim, dim), old_dest(dim, dim), new_dest(dim, dim);
+  src.SetRandn();
+  src.Scale(4.0);
+  ApplyNonlinearity(type, true, src, &old_dest);
+  ApplyNonlinearity(type, false, src, &new_dest);
+  KALDI_ASSERT(old_dest.ApproxEqual(new_dest, 1.0e-04));
+
+  BaseFloat rate[2];
+  for (int32 old = 1; old >= 0; old--) {
+    Timer tim;
+    int32 iter = 0;
+    for (; tim.Elapsed() < time_in_secs; iter++)
+      ApplyNonlinearity(type, (old == 1), src, &new_dest);
+    rate[old] = (static_cast<BaseFloat>(dim) * dim * iter) /
+        (tim.Elapsed() * 1.0e+06);
+  }
+  KALDI_LOG << "For " << NonlinearityName(type)
+            << (sizeof(Real) == sizeof(float) ? "<float>" : "<double>")
+            << ", dim = " << dim << ", speed was " << rate[1] << " (old) vs. "
+            << rate[0] << " (new) million elements per second.";
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  NonlinearityType types[] = { kSigmoid, kTanh, kSoftHinge, kSoftMaxPerRow,
+                               kDiffSigmoid, kDiffTanh };
+  int32 dims[] = { 16, 128, 512 };
+  for (int32 i = 0; i < 6; i++) {
+    for (int32 j = 0; j < 3; j++) {
+      TestNonlinearitySpeed<float>(types[i], dims[j]);
+      TestNonlinearitySpeed<double>(types[i], dims[j]);
+    }
+  }
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -25,6 +25,7 @@
 #include "matrix/jama-svd.h"
 #include "matrix/jama-eig.h"
 #include "matrix/compressed-matrix.h"
+#include "matrix/elementwise-functions.h"
 
 namespace kaldi {
 
@@ -2395,6 +2396,25 @@ Real MatrixBase<Real>::ApplySoftMax() {
   return max + Log(sum);
 }
 
+template<typename Real>
+void MatrixBase<Real>::SoftMaxPerRow(const MatrixBase<Real> &src) {
+  KALDI_ASSERT(SameDim(*this, src));
+  MatrixIndexT num_rows = num_rows_, num_cols = num_cols_,
+      stride = stride_, src_stride = src.stride_;
+  if (num_cols == 0) return;
+  Real *data = data_;
+  const Real *src_data = src.data_;
+  // Unlike calling Row(r).ApplySoftMax() after copying src to *this, this
+  // reads each row of src once for the max and once for the exponentiation,
+  // writing straight into *this.
+  for (MatrixIndexT r = 0; r < num_rows;
+       r++, data += stride, src_data += src_stride) {
+    Real max = SubVector<Real>(const_cast<Real*>(src_data), num_cols).Max(),
+        sum = ExpElementsAndSum(num_cols, src_data, max, data);
+    cblas_Xscal(num_cols, static_cast<Real>(1.0) / sum, data, 1);
+  }
+}
+
 template<typename Real>
 void MatrixBase<Real>::Tanh(const MatrixBase<Real> &src) {
   KALDI_ASSERT(SameDim(*this, src));
@@ -2418,12 +2438,12 @@ void MatrixBase<Real>::SoftHinge(const MatrixBase<Real> &src) {
   for (MatrixIndexT r = 0; r < num_rows; r++) {
     Real *row_data = this->RowData(r);
     const Real *src_row_data = src.RowData(r);
+    // log(1 + exp(x)) = max(x, 0) + log(1 + exp(-|x|)); this form can't
+    // overflow and has no data-dependent branches.
     for (MatrixIndexT c = 0; c < num_cols; c++) {
-      Real x = src_row_data[c], y;
-      if (x > 10.0) y = x; // avoid exponentiating large numbers; function
-      // approaches y=x.
-      else y = Log1p(Exp(x)); // these defined in kaldi-math.h
-      row_data[c] = y;
+      Real x = src_row_data[c];
+      row_data[c] = (x > 0.0 ? x : static_cast<Real>(0.0)) +
+          Log1p(Exp(-std::abs(x)));  // these defined in kaldi-math.h
     }
   }
 }
@@ -2505,8 +2525,7 @@ void MatrixBase<Real>::DiffSigmoid(const MatrixBase<Real> &value,
   Real *data = data_;
   const Real *value_data = value.data_, *diff_data = diff.data_;
   for (MatrixIndexT r = 0; r < num_rows; r++) {
-    for (MatrixIndexT c = 0; c < num_cols; c++)
-      data[c] = diff_data[c] * value_data[c] * (1.0 - value_data[c]);
+    DiffSigmoidElements(num_cols, value_data, diff_data, data);
     data += stride;
     value_data += value_stride;
     diff_data += diff_stride;
@@ -2522,8 +2541,7 @@ void MatrixBase<Real>::DiffTanh(const MatrixBase<Real> &value,
   Real *data = data_;
   const Real *value_data = value.data_, *diff_data = diff.data_;
   for (MatrixIndexT r = 0; r < num_rows; r++) {
-    for (MatrixIndexT c = 0; c < num_cols; c++)
-      data[c] = diff_data[c] * (1.0 - (value_data[c] * value_data[c]));
+    DiffTanhElements(num_cols, value_data, diff_data, data);
     data += stride;
     value_data += value_stride;
     diff_data += diff_stride;
@@ -411,8 +411,17 @@ class MatrixBase {
   /// Apply soft-max to the collection of all elements of the
   /// matrix and return normalizer (log sum of exponentials).
   Real ApplySoftMax();
+
+  /// Set each row of *this to the soft-max of the corresponding row of "src";
+  /// "src" may be the same matrix as *this.  Unlike copying and calling
+  /// Row(r).ApplySoftMax(), this does not make a separate pass for the copy.
+  /// See also ParallelSoftMaxPerRow() in thread/parallel-matrix-functions.h.
+  void SoftMaxPerRow(const MatrixBase<Real> &src);
   
   /// Set each element to the sigmoid of the corresponding element of "src".
+  /// Like Tanh(), SoftMaxPerRow(), DiffSigmoid() and DiffTanh(), this is
+  /// vectorized with SSE2 where possible (see elementwise-functions.h);
+  /// kaldi-matrix-speed-test compares these with the older scalar code.
   void Sigmoid(const MatrixBase<Real> &src);
 
   /// Set each element to y = log(1 + exp(x))
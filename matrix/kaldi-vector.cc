@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <string>
 #include "matrix/cblas-wrappers.h"
+#include "matrix/elementwise-functions.h"
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
 #include "matrix/sp-matrix.h"
@@ -835,17 +836,7 @@ void VectorBase<double>::Tanh(const VectorBase<double> &src) {
 template<typename Real>
 void VectorBase<Real>::Tanh(const VectorBase<Real> &src) {
   KALDI_ASSERT(dim_ == src.dim_);
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    Real x = src.data_[i];
-    if (x > 0.0) {
-      Real inv_expx = Exp(-x);
-      x = -1.0 + 2.0 / (1.0 + inv_expx * inv_expx);
-    } else {
-      Real inv_expx = Exp(x);
-      x = 1.0 - 2.0 / (1.0 + inv_expx * inv_expx);
-    }
-    data_[i] = x;
-  }
+  TanhElements(dim_, src.data_, data_);  // see elementwise-functions.h
 }
 #endif
 
@@ -873,17 +864,7 @@ void VectorBase<double>::Sigmoid(const VectorBase<double> &src) {
 template<typename Real>
 void VectorBase<Real>::Sigmoid(const VectorBase<Real> &src) {
   KALDI_ASSERT(dim_ == src.dim_);
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    Real x = src.data_[i];
-    // We aim to avoid floating-point overflow here.
-    if (x > 0.0) {
-      x = 1.0 / (1.0 + Exp(-x));
-    } else {
-      Real ex = Exp(x);
-      x = ex / (ex + 1.0);
-    }
-    data_[i] = x;
-  }
+  SigmoidElements(dim_, src.data_, data_);  // see elementwise-functions.h
 }
 #endif
 
@@ -2284,6 +2284,74 @@ template<typename Real> static void  UnitTestSigmoid() {
   }
 }
 
+template<typename Real> static void  UnitTestSoftMaxPerRow() {
+  for (MatrixIndexT i = 0; i < 10; i++) {
+    MatrixIndexT dimM = 5 + rand() % 10, dimN = 5 + rand() % 10;
+    Matrix<Real> M(dimM, dimN), N(dimM, dimN);
+    M.SetRandn();
+    M.Scale(10.0);
+    Matrix<Real> O(M);
+    for (int32 r = 0; r < dimM; r++)
+      O.Row(r).ApplySoftMax();
+    N.SoftMaxPerRow(M);
+    AssertEqual(N, O);
+    M.SoftMaxPerRow(M);  // check it works in-place.
+    AssertEqual(M, O);
+  }
+}
+
+// Checks the (possibly SSE) functions in elementwise-functions.h closely
+// against double-precision math, including at extreme inputs and for
+// dimensions that aren't a multiple of 4.  Results that would be denormal
+// in float are allowed to be flushed to zero.
+template<typename Real> static void  UnitTestElementwiseFunctions() {
+  for (MatrixIndexT i = 0; i < 20; i++) {
+    MatrixIndexT dim = rand() % 40;
+    Vector<Real> x(dim), value(dim), diff(dim), y(dim);
+    x.SetRandn();
+    x.Scale(RandInt(0, 1) == 0 ? 1.0 : 30.0);
+    if (dim > 2) {
+      x(0) = 100.0;
+      x(1) = -100.0;
+      x(2) = 0.0;
+    }
+    value.SetRandn();
+    diff.SetRandn();
+    Real max = (dim == 0 ? 0.0 : x.Max()), tol = 1.0e-06;
+    Real sum = ExpElementsAndSum(dim, x.Data(), max, y.Data()), ref_sum = 0.0;
+    for (MatrixIndexT j = 0; j < dim; j++) {
+      Real shifted_x = x(j) - max;  // as rounded in ExpElementsAndSum().
+      double ref = exp(static_cast<double>(shifted_x));
+      ref_sum += ref;
+      KALDI_ASSERT(std::abs(y(j) - ref) <= tol * (ref + 1.0e-30));
+    }
+    KALDI_ASSERT(std::abs(sum - ref_sum) <= tol * dim * ref_sum);
+    SigmoidElements(dim, x.Data(), y.Data());
+    for (MatrixIndexT j = 0; j < dim; j++) {
+      double ref = 1.0 / (1.0 + exp(-static_cast<double>(x(j))));
+      KALDI_ASSERT(std::abs(y(j) - ref) <= tol * (ref + 1.0e-30));
+    }
+    TanhElements(dim, x.Data(), y.Data());
+    for (MatrixIndexT j = 0; j < dim; j++) {
+      double ref = tanh(static_cast<double>(x(j)));
+      // Near zero, tanh computed via exp() is only accurate in absolute terms.
+      KALDI_ASSERT(std::abs(y(j) - ref) <= tol);
+      KALDI_ASSERT(y(j) * x(j) >= 0.0);  // same sign.
+    }
+    DiffSigmoidElements(dim, value.Data(), diff.Data(), y.Data());
+    for (MatrixIndexT j = 0; j < dim; j++)
+      AssertEqual(y(j), diff(j) * value(j) * (1.0 - value(j)));
+    DiffTanhElements(dim, value.Data(), diff.Data(), y.Data());
+    for (MatrixIndexT j = 0; j < dim; j++)
+      AssertEqual(y(j), diff(j) * (1.0 - value(j) * value(j)));
+    y.CopyFromVec(x);  // check it works in-place.
+    SigmoidElements(dim, y.Data(), y.Data());
+    Vector<Real> z(dim);
+    z.Sigmoid(x);
+    AssertEqual(y, z);
+  }
+}
+
 template<typename Real> static void  UnitTestSoftHinge() {
   for (MatrixIndexT i = 0; i < 10; i++) {
     MatrixIndexT dimM = 5 + rand() % 10, dimN = 5 + rand() % 10;
@@ -3907,13 +3975,22 @@ template<typename Real> static void UnitTestCompressedMatrix() {
       for (MatrixIndexT c = 0; c < num_cols; c++)
         if (rand() % modulus == 0) M(r, c) = rand_val;
 
-    CompressedMatrix cmat(M);
+    bool row_major = (rand() % 2 == 0);
+    CompressedMatrix cmat(M, row_major);
     KALDI_ASSERT(cmat.NumRows() == num_rows);
     KALDI_ASSERT(cmat.NumCols() == num_cols);
+    KALDI_ASSERT(cmat.IsRowMajor() == row_major);
 
     Matrix<Real> M2(cmat.NumRows(), cmat.NumCols());
     cmat.CopyToMat(&M2);
 
+    { // Check that the other layout gives exactly the same answer.
+      CompressedMatrix cmat_other(M, !row_major);
+      Matrix<Real> M3(cmat.NumRows(), cmat.NumCols());
+      cmat_other.CopyToMat(&M3);
+      KALDI_ASSERT(M2.Equal(M3));
+    }
+
     Matrix<Real> diff(M2);
     diff.AddMat(-1.0, M);
 
@@ -3986,6 +4063,8 @@ template<typename Real> static void UnitTestCompressedMatrix() {
         InitKaldiInputStream(ins, &binary_in);
         cmat2.Read(ins, binary_in);
       }
+      if (binary && num_rows != 0)  // text mode does not keep the layout.
+        KALDI_ASSERT(cmat2.IsRowMajor() == row_major);
 #if 1
       { // check that compressed-matrix can be read as matrix.
         bool binary_in;
@@ -4214,6 +4293,8 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   UnitTestSimpleForMat<Real>();
   UnitTestTanh<Real>();
   UnitTestSigmoid<Real>();
+  UnitTestSoftMaxPerRow<Real>();
+  UnitTestElementwiseFunctions<Real>();
   UnitTestSoftHinge<Real>();
   UnitTestNorm<Real>();
   UnitTestCopyCols<Real>();
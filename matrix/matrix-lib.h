@@ -32,6 +32,7 @@
 #include "matrix/srfft.h"
 #include "matrix/compressed-matrix.h"
 #include "matrix/optimization.h"
+#include "matrix/elementwise-functions.h"
 
 #endif
 
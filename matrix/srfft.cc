@@ -127,6 +127,20 @@ template<typename Real>
 void SplitRadixComplexFft<Real>::Compute(Real *x, bool forward) {
   if (temp_buffer == NULL)
     temp_buffer = new Real[N_];
+  ComputeInterleaved(x, forward, temp_buffer);
+}
+
+template<typename Real>
+void SplitRadixComplexFft<Real>::Compute(Real *x, bool forward,
+                                         std::vector<Real> *temp_buffer) const {
+  if (temp_buffer->size() < static_cast<size_t>(N_))
+    temp_buffer->resize(N_);
+  ComputeInterleaved(x, forward, &((*temp_buffer)[0]));
+}
+
+template<typename Real>
+void SplitRadixComplexFft<Real>::ComputeInterleaved(Real *x, bool forward,
+                                                    Real *temp_buffer) const {
   for (MatrixIndexT i = 0; i < N_; i++) {
     x[i] = x[i*2];  // put the real part in the first half of x.
     temp_buffer[i] = x[i*2 + 1];  // put the imaginary part in temp_buffer.
@@ -323,10 +337,16 @@ void SplitRadixComplexFft<Real>::ComputeRecursive(Real *xr, Real *xi, MatrixInde
 // possible to replace it with more efficient code from Rico's book.
 template<typename Real>
 void SplitRadixRealFft<Real>::Compute(Real *data, bool forward) {
+  Compute(data, forward, &temp_buffer_);
+}
+
+template<typename Real>
+void SplitRadixRealFft<Real>::Compute(Real *data, bool forward,
+                                      std::vector<Real> *temp_buffer) const {
   MatrixIndexT N = N_, N2 = N/2;
   KALDI_ASSERT(N%2 == 0);
   if (forward) // call to base class
-    SplitRadixComplexFft<Real>::Compute(data, true);
+    SplitRadixComplexFft<Real>::Compute(data, true, temp_buffer);
 
   Real rootN_re, rootN_im;  // exp(-2pi/N), forward; exp(2pi/N), backward
   int forward_sign = forward ? -1 : 1;
@@ -382,7 +402,7 @@ void SplitRadixRealFft<Real>::Compute(Real *data, bool forward) {
     }
   }
   if (!forward) {  // call to base class
-    SplitRadixComplexFft<Real>::Compute(data, false);
+    SplitRadixComplexFft<Real>::Compute(data, false, temp_buffer);
     for (MatrixIndexT i = 0; i < N; i++)
       data[i] *= 2.0;
     // This is so we get a factor of N increase, rather than N/2 which we would
@@ -26,6 +26,8 @@
 #ifndef KALDI_MATRIX_SRFFT_H_
 #define KALDI_MATRIX_SRFFT_H_
 
+#include <vector>
+
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
 
@@ -63,8 +65,17 @@ class SplitRadixComplexFft {
   // same as the version above.
   void Compute(Real *x, bool forward);
 
+  /// This version of Compute is const, so it may be called from several
+  /// threads at once on the same object; it uses "temp_buffer" (which it
+  /// resizes as needed) instead of the buffer owned by this class.
+  void Compute(Real *x, bool forward, std::vector<Real> *temp_buffer) const;
+
   ~SplitRadixComplexFft();
  private:
+  // Does the work of the one- and three-argument versions of Compute;
+  // temp_buffer must have space for N_ elements.
+  void ComputeInterleaved(Real *x, bool forward, Real *temp_buffer) const;
+
   void ComputeTables();
   void ComputeRecursive(Real *xr, Real *xi, Integer logm) const;
   void BitReversePermute(Real *x, Integer logm) const;
@@ -97,8 +108,14 @@ class SplitRadixRealFft: private SplitRadixComplexFft<Real> {
   /// is a sequence of complex numbers C_n of length N/2 with (real, im) format,
   /// i.e. [real0, real_{N/2}, real1, im1, real2, im2, real3, im3, ...].
   void Compute(Real *x, bool forward);
+
+  /// This version of Compute is const, so it may be called from several
+  /// threads at once on the same object; it uses "temp_buffer" (which it
+  /// resizes as needed) as temporary storage.
+  void Compute(Real *x, bool forward, std::vector<Real> *temp_buffer) const;
  private:
   int N_;
+  std::vector<Real> temp_buffer_;
 };
 
 
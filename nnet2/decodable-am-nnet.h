@@ -28,6 +28,7 @@
 #include "itf/decodable-itf.h"
 #include "nnet2/am-nnet.h"
 #include "nnet2/nnet-compute.h"
+#include "nnet2/nnet-batch-compute.h"
 
 namespace kaldi {
 namespace nnet2 {
@@ -45,9 +46,8 @@ class DecodableAmNnet: public DecodableInterface {
                   // will be < feats.NumRows().
                   BaseFloat prob_scale = 1.0):
       trans_model_(trans_model) {
-    // Note: we could make this more memory-efficient by doing the
-    // computation in smaller chunks than the whole utterance, and not
-    // storing the whole thing.  We'll leave this for later.
+    // Note: for very long utterances, DecodableAmNnetChunked (below) is more
+    // memory-efficient as it does not store the output for the whole thing.
     CuMatrix<BaseFloat> log_probs(feats.NumRows(), trans_model.NumPdfs());
     // the following function is declared in nnet-compute.h
     NnetComputation(am_nnet.GetNnet(), feats, spk_info, pad_input, &log_probs);
@@ -73,6 +73,16 @@ class DecodableAmNnet: public DecodableInterface {
                       trans_model_.TransitionIdToPdf(transition_id));
   }
 
+  // Batch version of LogLikelihood(); the indices are transition-ids.
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &indices,
+                              std::vector<BaseFloat> *loglikes) {
+    const BaseFloat *row = log_probs_.RowData(frame);
+    loglikes->resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+      (*loglikes)[i] = row[trans_model_.TransitionIdToPdf(indices[i])];
+  }
+  virtual bool HasBatchLogLikelihoods() { return true; }
+
   int32 NumFrames() { return log_probs_.NumRows(); }
   
   // Indices are one-based!  This is for compatibility with OpenFst.
@@ -91,10 +101,108 @@ class DecodableAmNnet: public DecodableInterface {
   KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmNnet);
 };
 
+/// DecodableAmNnetChunked gives the same log-likelihoods as DecodableAmNnet
+/// with pad_input == true, but it does the neural net computation lazily, in
+/// chunks of frames_per_chunk frames, as the decoder asks for them, and only
+/// stores the output for the current chunk.  This bounds the memory used for
+/// long recordings, and lets decoding start before the whole forward pass is
+/// done.  Each chunk needs the frames of context of the network
+/// (nnet.LeftContext() + nnet.RightContext()), so there is some extra
+/// computation if frames_per_chunk is small.  The features are not copied and
+/// must exist as long as this object.  The decoders access the frames in
+/// order; random access would be slow.
+
+class DecodableAmNnetChunked: public DecodableInterface {
+ public:
+  DecodableAmNnetChunked(const TransitionModel &trans_model,
+                         const AmNnet &am_nnet,
+                         const CuMatrixBase<BaseFloat> &feats,
+                         const CuVectorBase<BaseFloat> &spk_info,
+                         int32 frames_per_chunk,
+                         BaseFloat prob_scale = 1.0):
+      trans_model_(trans_model), am_nnet_(am_nnet), feats_(feats),
+      spk_info_(spk_info), frames_per_chunk_(frames_per_chunk),
+      prob_scale_(prob_scale), log_priors_(am_nnet.Priors()),
+      chunk_start_(0) {
+    KALDI_ASSERT(frames_per_chunk_ > 0 && feats_.NumRows() > 0);
+    KALDI_ASSERT(log_priors_.Dim() == trans_model.NumPdfs() &&
+                 "Priors in neural network not set up.");
+    log_priors_.ApplyLog();
+  }
+
+  // Note, frames are numbered from zero.  But state_index is numbered
+  // from one (this routine is called by FSTs).
+  virtual BaseFloat LogLikelihood(int32 frame, int32 transition_id) {
+    EnsureFrameIsComputed(frame);
+    return log_probs_(frame - chunk_start_,
+                      trans_model_.TransitionIdToPdf(transition_id));
+  }
+
+  // Batch version of LogLikelihood(); the indices are transition-ids.
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &indices,
+                              std::vector<BaseFloat> *loglikes) {
+    EnsureFrameIsComputed(frame);
+    const BaseFloat *row = log_probs_.RowData(frame - chunk_start_);
+    loglikes->resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+      (*loglikes)[i] = row[trans_model_.TransitionIdToPdf(indices[i])];
+  }
+  virtual bool HasBatchLogLikelihoods() { return true; }
+
+  int32 NumFrames() { return feats_.NumRows(); }
+
+  // Indices are one-based!  This is for compatibility with OpenFst.
+  virtual int32 NumIndices() { return trans_model_.NumTransitionIds(); }
+
+  virtual bool IsLastFrame(int32 frame) {
+    KALDI_ASSERT(frame < NumFrames());
+    return (frame == NumFrames() - 1);
+  }
+
+ private:
+  // Makes sure log_probs_ is the output for the chunk containing "frame".
+  void EnsureFrameIsComputed(int32 frame) {
+    if (frame >= chunk_start_ && frame < chunk_start_ + log_probs_.NumRows())
+      return;
+    KALDI_ASSERT(frame >= 0 && frame < NumFrames());
+    int32 chunk_start = frame - frame % frames_per_chunk_,
+        chunk_frames = std::min(frames_per_chunk_, NumFrames() - chunk_start);
+    CuMatrix<BaseFloat> log_probs(chunk_frames, trans_model_.NumPdfs(),
+                                  kUndefined);
+    // the following function is declared in nnet-compute.h
+    NnetComputationChunk(am_nnet_.GetNnet(), feats_, spk_info_,
+                         chunk_start, &log_probs);
+    log_probs.ApplyFloor(1.0e-20); // Avoid log of zero which leads to NaN.
+    log_probs.ApplyLog();
+    // subtract log-prior (divide by prior)
+    log_probs.AddVecToRows(-1.0, log_priors_);
+    // apply probability scale.
+    log_probs.Scale(prob_scale_);
+    log_probs_.Swap(&log_probs);
+    chunk_start_ = chunk_start;
+  }
+
+  const TransitionModel &trans_model_;
+  const AmNnet &am_nnet_;
+  const CuMatrixBase<BaseFloat> &feats_;
+  const CuVectorBase<BaseFloat> &spk_info_;
+  int32 frames_per_chunk_;
+  BaseFloat prob_scale_;
+  CuVector<BaseFloat> log_priors_;
+  int32 chunk_start_;  // the first frame whose output is in log_probs_.
+  Matrix<BaseFloat> log_probs_;  // the scaled log-likelihoods for frames
+                                 // chunk_start_, chunk_start_ + 1, ...
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmNnetChunked);
+};
+
 /// This version of DecodableAmNnet is intended for a version of the decoder
 /// that processes different utterances with multiple threads.  It needs to do
 /// the computation in a different place than the initializer, since the
-/// initializer gets called in the main thread of the program.
+/// initializer gets called in the main thread of the program.  If
+/// batch_computer is non-NULL, the neural net computation is done by it,
+/// together with that of the utterances being decoded in other threads (see
+/// nnet-batch-compute.h); it must have been initialized with am_nnet.GetNnet().
 
 class DecodableAmNnetParallel: public DecodableInterface {
  public:
@@ -104,17 +212,26 @@ class DecodableAmNnetParallel: public DecodableInterface {
       const CuMatrix<BaseFloat> *feats,
       const CuVector<BaseFloat> *spk_info,
       bool pad_input = true,
-      BaseFloat prob_scale = 1.0):
+      BaseFloat prob_scale = 1.0,
+      NnetBatchComputer *batch_computer = NULL):
       trans_model_(trans_model), am_nnet_(am_nnet), feats_(feats),
-      spk_info_(spk_info), pad_input_(pad_input), prob_scale_(prob_scale) {
+      spk_info_(spk_info), pad_input_(pad_input), prob_scale_(prob_scale),
+      batch_computer_(batch_computer) {
     KALDI_ASSERT(feats_ != NULL && spk_info_ != NULL);
+    KALDI_ASSERT(batch_computer_ == NULL ||
+                 (pad_input_ && &(batch_computer_->GetNnet()) ==
+                  &(am_nnet_.GetNnet())));
   }
 
   void Compute() {
     log_probs_.Resize(feats_->NumRows(), trans_model_.NumPdfs());
-    // the following function is declared in nnet-compute.h
-    NnetComputation(am_nnet_.GetNnet(), *feats_,
-                    *spk_info_, pad_input_, &log_probs_);
+    if (batch_computer_ != NULL) {
+      batch_computer_->Compute(*feats_, *spk_info_, &log_probs_);
+    } else {
+      // the following function is declared in nnet-compute.h
+      NnetComputation(am_nnet_.GetNnet(), *feats_,
+                      *spk_info_, pad_input_, &log_probs_);
+    }
     log_probs_.ApplyFloor(1.0e-20); // Avoid log of zero which leads to NaN.
     log_probs_.ApplyLog();
     CuVector<BaseFloat> priors(am_nnet_.Priors());
@@ -139,6 +256,19 @@ class DecodableAmNnetParallel: public DecodableInterface {
                       trans_model_.TransitionIdToPdf(transition_id));
   }
 
+  // Batch version of LogLikelihood(); the indices are transition-ids.  We copy
+  // the whole row, which is one transfer if the log-probs are on the GPU.
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &indices,
+                              std::vector<BaseFloat> *loglikes) {
+    if (feats_) Compute(); // this function sets feats_ to NULL.
+    row_.Resize(log_probs_.NumCols(), kUndefined);
+    log_probs_.Row(frame).CopyToVec(&row_);
+    loglikes->resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+      (*loglikes)[i] = row_(trans_model_.TransitionIdToPdf(indices[i]));
+  }
+  virtual bool HasBatchLogLikelihoods() { return true; }
+
   int32 NumFrames() {
     if (feats_) Compute();
     return log_probs_.NumRows();
@@ -164,6 +294,8 @@ class DecodableAmNnetParallel: public DecodableInterface {
   const CuVector<BaseFloat> *spk_info_;
   bool pad_input_;
   BaseFloat prob_scale_;
+  NnetBatchComputer *batch_computer_; // not owned; may be NULL.
+  Vector<BaseFloat> row_; // temporary used in LogLikelihoods().
   KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmNnetParallel);
 };
 
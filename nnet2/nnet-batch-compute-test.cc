@@ -0,0 +1,110 @@
+// nnet2/nnet-batch-compute-test.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "nnet2/nnet-batch-compute.h"
+#include "nnet2/nnet-compute.h"
+#include "thread/kaldi-thread.h"
+
+namespace kaldi {
+namespace nnet2 {
+
+// Each thread computes the nnet output for every num_threads_'th utterance.
+class BatchComputeTester: public MultiThreadable {
+ public:
+  BatchComputeTester(NnetBatchComputer *computer,
+                     const std::vector<CuMatrix<BaseFloat> > *feats,
+                     const CuVector<BaseFloat> *spk_info,
+                     std::vector<CuMatrix<BaseFloat> > *outputs):
+      computer_(computer), feats_(feats), spk_info_(spk_info),
+      outputs_(outputs) { }
+  void operator() () {
+    for (size_t i = thread_id_; i < feats_->size(); i += num_threads_)
+      computer_->Compute((*feats_)[i], *spk_info_, &((*outputs_)[i]));
+  }
+ private:
+  NnetBatchComputer *computer_;
+  const std::vector<CuMatrix<BaseFloat> > *feats_;
+  const CuVector<BaseFloat> *spk_info_;
+  std::vector<CuMatrix<BaseFloat> > *outputs_;
+};
+
+void UnitTestNnetBatchComputer() {
+  int32 feat_dim = 5 + rand() % 5, spk_dim = rand() % 3,
+      left_context = rand() % 4, right_context = rand() % 4,
+      hidden_dim = 20, output_dim = 10 + rand() % 10;
+  std::ostringstream config;
+  config << "SpliceComponent input-dim=" << (feat_dim + spk_dim)
+         << " left-context=" << left_context << " right-context="
+         << right_context << " const-component-dim=" << spk_dim << "\n"
+         << "AffineComponent input-dim="
+         << (feat_dim * (1 + left_context + right_context) + spk_dim)
+         << " output-dim=" << hidden_dim << "\n"
+         << "TanhComponent dim=" << hidden_dim << "\n"
+         << "SpliceComponent input-dim=" << hidden_dim
+         << " left-context=1 right-context=1\n"
+         << "AffineComponent input-dim=" << (3 * hidden_dim)
+         << " output-dim=" << output_dim << "\n"
+         << "SoftmaxComponent dim=" << output_dim << "\n";
+  std::istringstream config_is(config.str());
+  Nnet nnet;
+  nnet.Init(config_is);
+
+  int32 num_utts = 1 + rand() % 20;
+  std::vector<CuMatrix<BaseFloat> > feats(num_utts), outputs(num_utts);
+  CuVector<BaseFloat> spk_info(spk_dim);
+  spk_info.SetRandn();
+  for (int32 i = 0; i < num_utts; i++) {
+    int32 num_frames = 1 + rand() % 100;
+    feats[i].Resize(num_frames, feat_dim);
+    feats[i].SetRandn();
+    outputs[i].Resize(num_frames, output_dim);
+  }
+
+  NnetBatchComputerOptions opts;
+  opts.chunk_size = 1 + rand() % 20;
+  opts.batch_size = rand() % 100;
+  opts.max_batch_delay = 0.001 * (rand() % 10);
+  NnetBatchComputer computer(opts, nnet);
+  {
+    int32 num_threads = 1 + rand() % 4;
+    BatchComputeTester tester(&computer, &feats, &spk_info, &outputs);
+    MultiThreader<BatchComputeTester> m(num_threads, tester);
+  }
+  computer.PrintStats();
+
+  for (int32 i = 0; i < num_utts; i++) {
+    CuMatrix<BaseFloat> ref_output(feats[i].NumRows(), output_dim);
+    NnetComputation(nnet, feats[i], spk_info, true, &ref_output);
+    AssertEqual(ref_output, outputs[i]);
+  }
+}
+
+} // namespace nnet2
+} // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet2;
+  for (int32 i = 0; i < 10; i++)
+    UnitTestNnetBatchComputer();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
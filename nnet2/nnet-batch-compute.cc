@@ -0,0 +1,158 @@
+// nnet2/nnet-batch-compute.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sys/time.h>
+#include <cerrno>
+
+#include "nnet2/nnet-batch-compute.h"
+#include "nnet2/nnet-compute.h"
+
+namespace kaldi {
+namespace nnet2 {
+
+NnetBatchComputer::NnetBatchComputer(const NnetBatchComputerOptions &opts,
+                                     const Nnet &nnet):
+    opts_(opts), nnet_(nnet), num_batches_(0), num_chunks_computed_(0),
+    num_frames_computed_(0) {
+  KALDI_ASSERT(opts_.chunk_size > 0 && opts_.max_batch_delay >= 0.0);
+  chunks_per_batch_ = std::max<int32>(1, opts_.batch_size / opts_.chunk_size);
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_cond_init(&cond_, NULL);
+}
+
+NnetBatchComputer::~NnetBatchComputer() {
+  KALDI_ASSERT(queue_.empty());
+  pthread_mutex_destroy(&mutex_);
+  pthread_cond_destroy(&cond_);
+}
+
+void NnetBatchComputer::Compute(const CuMatrixBase<BaseFloat> &input,
+                                const CuVectorBase<BaseFloat> &spk_info,
+                                CuMatrixBase<BaseFloat> *output) {
+  KALDI_ASSERT(input.NumRows() > 0 &&
+               input.NumCols() + spk_info.Dim() == nnet_.InputDim() &&
+               output->NumRows() == input.NumRows() &&
+               output->NumCols() == nnet_.OutputDim());
+  Request request;
+  request.input = &input;
+  request.spk_info = &spk_info;
+  request.output = output;
+  request.num_chunks = (input.NumRows() + opts_.chunk_size - 1) /
+      opts_.chunk_size;
+  request.num_chunks_done = 0;
+
+  // Work out the time after which we stop waiting for a full batch.
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  int64 deadline_usec = static_cast<int64>(now.tv_usec) +
+      static_cast<int64>(opts_.max_batch_delay * 1.0e+06);
+  struct timespec deadline;
+  deadline.tv_sec = now.tv_sec + deadline_usec / 1000000;
+  deadline.tv_nsec = (deadline_usec % 1000000) * 1000;
+
+  std::vector<Chunk> batch;
+  bool timed_out = false;
+  pthread_mutex_lock(&mutex_);
+  for (int32 c = 0; c < request.num_chunks; c++)
+    queue_.push_back(Chunk(&request, c));
+  pthread_cond_broadcast(&cond_);  // Idle threads may now have a full batch.
+  while (request.num_chunks_done < request.num_chunks) {
+    int32 num_queued = queue_.size();
+    if (num_queued >= chunks_per_batch_ || (timed_out && num_queued > 0)) {
+      int32 num_chunks = std::min(num_queued, chunks_per_batch_);
+      batch.assign(queue_.begin(), queue_.begin() + num_chunks);
+      queue_.erase(queue_.begin(), queue_.begin() + num_chunks);
+      pthread_mutex_unlock(&mutex_);
+      ComputeBatch(batch);
+      pthread_mutex_lock(&mutex_);
+      for (int32 i = 0; i < num_chunks; i++) {
+        const Chunk &chunk = batch[i];
+        num_frames_computed_ += std::min(opts_.chunk_size,
+                                         chunk.request->input->NumRows() -
+                                         chunk.chunk_index * opts_.chunk_size);
+        chunk.request->num_chunks_done++;
+      }
+      num_batches_++;
+      num_chunks_computed_ += num_chunks;
+      pthread_cond_broadcast(&cond_);
+    } else if (timed_out) {
+      // Our remaining chunks are being computed by other threads.
+      pthread_cond_wait(&cond_, &mutex_);
+    } else if (pthread_cond_timedwait(&cond_, &mutex_,
+                                      &deadline) == ETIMEDOUT) {
+      timed_out = true;
+    }
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void NnetBatchComputer::ComputeBatch(const std::vector<Chunk> &batch) const {
+  int32 num_chunks = batch.size(),
+      chunk_size = opts_.chunk_size,
+      left_context = nnet_.LeftContext(),
+      right_context = nnet_.RightContext(),
+      input_chunk_size = left_context + chunk_size + right_context;
+
+  CuMatrix<BaseFloat> input(num_chunks * input_chunk_size, nnet_.InputDim(),
+                            kUndefined);
+  for (int32 i = 0; i < num_chunks; i++) {
+    const Request &request = *(batch[i].request);
+    const CuMatrixBase<BaseFloat> &feats = *(request.input);
+    int32 feat_dim = feats.NumCols(),
+        spk_dim = request.spk_info->Dim();
+    CuSubMatrix<BaseFloat> input_chunk(input.Range(i * input_chunk_size,
+                                                   input_chunk_size,
+                                                   0, feat_dim));
+    GetPaddedChunk(feats, batch[i].chunk_index * chunk_size, left_context,
+                   right_context, &input_chunk);
+    if (spk_dim != 0)
+      input.Range(i * input_chunk_size, input_chunk_size,
+                  feat_dim, spk_dim).CopyRowsFromVec(*(request.spk_info));
+  }
+
+  CuMatrix<BaseFloat> output;
+  for (int32 c = 0; c < nnet_.NumComponents(); c++) {
+    nnet_.GetComponent(c).Propagate(input, num_chunks, &output);
+    input.Swap(&output);
+  }
+  KALDI_ASSERT(input.NumRows() == num_chunks * chunk_size);
+
+  int32 output_dim = input.NumCols();
+  for (int32 i = 0; i < num_chunks; i++) {
+    const Request &request = *(batch[i].request);
+    int32 start_frame = batch[i].chunk_index * chunk_size,
+        num_frames = std::min(chunk_size,
+                              request.input->NumRows() - start_frame);
+    request.output->Range(start_frame, num_frames, 0, output_dim).CopyFromMat(
+        input.Range(i * chunk_size, num_frames, 0, output_dim));
+  }
+}
+
+void NnetBatchComputer::PrintStats() const {
+  double n = std::max<int64>(num_batches_, 1);
+  KALDI_LOG << "NnetBatchComputer: computed " << num_batches_
+            << " batches; average batch had " << (num_chunks_computed_ / n)
+            << " chunks and " << (num_frames_computed_ / n) << " frames "
+            << "(maximum is " << chunks_per_batch_ << " chunks of "
+            << opts_.chunk_size << " frames).";
+}
+
+
+} // namespace nnet2
+} // namespace kaldi
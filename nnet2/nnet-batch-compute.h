@@ -0,0 +1,148 @@
+// nnet2/nnet-batch-compute.h
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET2_NNET_BATCH_COMPUTE_H_
+#define KALDI_NNET2_NNET_BATCH_COMPUTE_H_
+
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/kaldi-io.h"
+#include "nnet2/nnet-nnet.h"
+
+namespace kaldi {
+namespace nnet2 {
+
+/* This header provides a class that does the neural net computation for
+   several utterances at once, for programs that decode several utterances in
+   parallel threads.  The per-utterance computation in nnet-compute.h does
+   matrix multiplies whose size is the number of frames in the utterance; on
+   the CPU these are too small to make good use of BLAS.  Here, the threads
+   give their utterances to a shared NnetBatchComputer, which splits them into
+   fixed-size chunks (with the frames of context needed by the network) and
+   does the computation for chunks from different utterances together, so the
+   matrix multiplies are larger.
+*/
+
+struct NnetBatchComputerOptions {
+  int32 batch_size;
+  int32 chunk_size;
+  BaseFloat max_batch_delay;
+
+  NnetBatchComputerOptions(): batch_size(1024), chunk_size(64),
+                              max_batch_delay(0.02) { }
+
+  void Register(OptionsItf *po) {
+    po->Register("batch-size", &batch_size, "Number of frames for which we "
+                 "compute the neural net output at one time, summed over the "
+                 "utterances in the batch (rounded down to a multiple of "
+                 "--batch-chunk-size).");
+    po->Register("batch-chunk-size", &chunk_size, "Utterances are split into "
+                 "chunks of this many frames for batched computation.  "
+                 "Smaller chunks mean more computation of the context frames.");
+    po->Register("max-batch-delay", &max_batch_delay, "Maximum time in seconds "
+                 "that an utterance waits for other utterances to fill up a "
+                 "batch before a partial batch is computed.");
+  }
+};
+
+/**
+   NnetBatchComputer does the same computation as NnetComputation() with
+   pad_input == true, but is shared by multiple threads and computes frames
+   from the utterances of all the threads together.  Compute() may be called
+   from any number of threads at the same time.  It puts the chunks of the
+   utterance in a queue, and whenever the queue has enough chunks for a full
+   batch, the calling thread takes a batch (which may contain chunks of other
+   utterances) and computes it.  A thread whose chunks are still queued after
+   max_batch_delay seconds computes a partial batch, which bounds the latency
+   when there are not enough utterances in flight.  Compute() returns when all
+   chunks of its utterance have been computed, by whichever thread.
+
+   The output is the same as that of NnetComputation() up to roundoff, because
+   the only components that look at more than one frame (e.g. SpliceComponent)
+   respect the chunk boundaries, and each chunk has the frames of context it
+   needs, with the first and last frames of the utterance duplicated as
+   NnetComputation() does.
+*/
+class NnetBatchComputer {
+ public:
+  /// The nnet is not copied and must outlive this object.
+  NnetBatchComputer(const NnetBatchComputerOptions &opts, const Nnet &nnet);
+
+  ~NnetBatchComputer();
+
+  /// Computes the neural net output for one utterance, like NnetComputation()
+  /// with pad_input == true; "output" must already have the right size,
+  /// i.e. input.NumRows() by nnet.OutputDim().  Thread-safe; blocks until the
+  /// computation is done.
+  void Compute(const CuMatrixBase<BaseFloat> &input,
+               const CuVectorBase<BaseFloat> &spk_info,
+               CuMatrixBase<BaseFloat> *output);
+
+  const Nnet &GetNnet() const { return nnet_; }
+
+  /// Prints the number and average size of the batches, with KALDI_LOG.
+  /// Call this when no thread is in Compute().
+  void PrintStats() const;
+
+ private:
+  // An utterance that was given to Compute().
+  struct Request {
+    const CuMatrixBase<BaseFloat> *input;
+    const CuVectorBase<BaseFloat> *spk_info;
+    CuMatrixBase<BaseFloat> *output;
+    int32 num_chunks;
+    int32 num_chunks_done;  // protected by mutex_.
+  };
+  // A chunk of chunk_size frames of an utterance (the last one of each
+  // utterance may have fewer real frames).
+  struct Chunk {
+    Request *request;
+    int32 chunk_index;  // the chunk covers frames starting from
+                        // chunk_index * chunk_size.
+    Chunk(Request *request, int32 chunk_index): request(request),
+                                                chunk_index(chunk_index) { }
+  };
+
+  // Does the neural net computation for a batch of chunks and writes the
+  // output for each chunk to its request's output.  Called without the lock.
+  void ComputeBatch(const std::vector<Chunk> &batch) const;
+
+  NnetBatchComputerOptions opts_;
+  const Nnet &nnet_;
+  int32 chunks_per_batch_;
+
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;  // signaled when chunks are queued or computed.
+  std::deque<Chunk> queue_;  // chunks not yet taken by any thread.
+
+  int64 num_batches_;  // statistics, protected by mutex_.
+  int64 num_chunks_computed_;
+  int64 num_frames_computed_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(NnetBatchComputer);
+};
+
+
+} // namespace nnet2
+} // namespace kaldi
+
+#endif // KALDI_NNET2_NNET_BATCH_COMPUTE_H_
@@ -0,0 +1,80 @@
+// nnet2/nnet-compute-test.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "nnet2/nnet-compute.h"
+
+namespace kaldi {
+namespace nnet2 {
+
+void UnitTestNnetComputationChunk() {
+  int32 feat_dim = 5 + rand() % 5, spk_dim = rand() % 3,
+      left_context = rand() % 4, right_context = rand() % 4,
+      hidden_dim = 20, output_dim = 10 + rand() % 10;
+  std::ostringstream config;
+  config << "SpliceComponent input-dim=" << (feat_dim + spk_dim)
+         << " left-context=" << left_context << " right-context="
+         << right_context << " const-component-dim=" << spk_dim << "\n"
+         << "AffineComponent input-dim="
+         << (feat_dim * (1 + left_context + right_context) + spk_dim)
+         << " output-dim=" << hidden_dim << "\n"
+         << "SigmoidComponent dim=" << hidden_dim << "\n"
+         << "SpliceComponent input-dim=" << hidden_dim
+         << " left-context=2 right-context=0\n"
+         << "AffineComponent input-dim=" << (3 * hidden_dim)
+         << " output-dim=" << output_dim << "\n"
+         << "SoftmaxComponent dim=" << output_dim << "\n";
+  std::istringstream config_is(config.str());
+  Nnet nnet;
+  nnet.Init(config_is);
+
+  int32 num_frames = 1 + rand() % 100;
+  CuMatrix<BaseFloat> feats(num_frames, feat_dim);
+  feats.SetRandn();
+  CuVector<BaseFloat> spk_info(spk_dim);
+  spk_info.SetRandn();
+
+  CuMatrix<BaseFloat> output(num_frames, output_dim);
+  NnetComputation(nnet, feats, spk_info, true, &output);
+
+  // Compute the same thing in chunks of random size.
+  CuMatrix<BaseFloat> chunked_output(num_frames, output_dim);
+  for (int32 first_frame = 0; first_frame < num_frames; ) {
+    int32 chunk_frames = std::min(1 + rand() % 20, num_frames - first_frame);
+    CuSubMatrix<BaseFloat> chunk(chunked_output.Range(first_frame,
+                                                      chunk_frames,
+                                                      0, output_dim));
+    NnetComputationChunk(nnet, feats, spk_info, first_frame, &chunk);
+    first_frame += chunk_frames;
+  }
+  AssertEqual(output, chunked_output);
+}
+
+} // namespace nnet2
+} // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet2;
+  for (int32 i = 0; i < 10; i++)
+    UnitTestNnetComputationChunk();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
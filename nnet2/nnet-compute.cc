@@ -172,6 +172,47 @@ void NnetComputation(const Nnet &nnet,
   output->CopyFromMat(nnet_computer.GetOutput());
 }
 
+void NnetComputationChunk(const Nnet &nnet,
+                          const CuMatrixBase<BaseFloat> &input,
+                          const CuVectorBase<BaseFloat> &spk_info,
+                          int32 first_frame,
+                          CuMatrixBase<BaseFloat> *output) {
+  int32 chunk_frames = output->NumRows(),
+      left_context = nnet.LeftContext(),
+      right_context = nnet.RightContext();
+  KALDI_ASSERT(first_frame >= 0 && chunk_frames > 0 &&
+               first_frame + chunk_frames <= input.NumRows());
+  CuMatrix<BaseFloat> chunk_input(left_context + chunk_frames + right_context,
+                                  input.NumCols(), kUndefined);
+  GetPaddedChunk(input, first_frame, left_context, right_context,
+                 &chunk_input);
+  NnetComputation(nnet, chunk_input, spk_info, false, output);
+}
+
+void GetPaddedChunk(const CuMatrixBase<BaseFloat> &input,
+                    int32 first_frame,
+                    int32 left_context,
+                    int32 right_context,
+                    CuMatrixBase<BaseFloat> *out) {
+  int32 num_frames = input.NumRows(),
+      num_rows = out->NumRows(),
+      feat_dim = input.NumCols();
+  KALDI_ASSERT(first_frame >= 0 && first_frame < num_frames &&
+               num_rows > left_context + right_context &&
+               out->NumCols() == feat_dim);
+  // Row t of *out is frame t + offset of the input.  Rows [begin, end) are
+  // inside the input, and this range is never empty.
+  int32 offset = first_frame - left_context,
+      begin = std::max<int32>(0, -offset),
+      end = std::min<int32>(num_rows, num_frames - offset);
+  out->Range(begin, end - begin, 0, feat_dim).CopyFromMat(
+      input.Range(offset + begin, end - begin, 0, feat_dim));
+  for (int32 t = 0; t < begin; t++)
+    out->Row(t).CopyFromVec(input.Row(0));
+  for (int32 t = end; t < num_rows; t++)
+    out->Row(t).CopyFromVec(input.Row(num_frames - 1));
+}
+
 BaseFloat NnetGradientComputation(const Nnet &nnet,
                                   const CuMatrixBase<BaseFloat> &input,
                                   const CuVectorBase<BaseFloat> &spk_info,
@@ -47,6 +47,37 @@ void NnetComputation(const Nnet &nnet,
                      bool pad_input,
                      CuMatrixBase<BaseFloat> *output); // posteriors.
 
+/**
+  Does the same computation as NnetComputation() with pad_input == true, but
+  only for frames first_frame ... first_frame + output->NumRows() - 1 of the
+  utterance, using just the rows of "input" that those frames depend on.  This
+  is for computing the output for long utterances piece by piece, without
+  storing the output for the whole utterance; the cost is the extra
+  computation for the nnet.LeftContext() + nnet.RightContext() frames of
+  context at each piece.
+*/
+void NnetComputationChunk(const Nnet &nnet,
+                          const CuMatrixBase<BaseFloat> &input,  // features
+                          const CuVectorBase<BaseFloat> &spk_info,
+                          int32 first_frame,
+                          CuMatrixBase<BaseFloat> *output); // posteriors.
+
+/**
+  Gets the input features needed to compute the output for a chunk of frames
+  starting at first_frame: sets row t of "out" to row
+  first_frame - left_context + t of "input", where rows before the start or
+  after the end of "input" are replaced by its first or last row (the same
+  padding as NnetComputation() with pad_input == true).  The chunk has
+  out->NumRows() - left_context - right_context frames, which may extend past
+  the end of the input; first_frame must be inside it.  "out" must have the
+  same number of columns as "input".
+*/
+void GetPaddedChunk(const CuMatrixBase<BaseFloat> &input,
+                    int32 first_frame,
+                    int32 left_context,
+                    int32 right_context,
+                    CuMatrixBase<BaseFloat> *out);
+
 /** Does the neural net computation and backprop, given input and labels.
     Note: if pad_input==true the number of rows of input should be the
     same as the number of labels, and if false, you should omit
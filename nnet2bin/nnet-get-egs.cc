@@ -48,6 +48,7 @@ static void ProcessFile(const MatrixBase<BaseFloat> &feats,
                         int32 left_context,
                         int32 right_context,
                         BaseFloat keep_proportion,
+                        bool row_major_compression,
                         int64 *num_frames_written,
                         NnetExampleWriter *example_writer) {
   KALDI_ASSERT(feats.NumRows() == static_cast<int32>(pdf_post.size()));
@@ -70,7 +71,7 @@ static void ProcessFile(const MatrixBase<BaseFloat> &feats,
         dest.CopyFromVec(src);
       }
       eg.labels = pdf_post[i];
-      eg.input_frames = input_frames;
+      eg.input_frames.CopyFromMat(input_frames, row_major_compression);
       std::ostringstream os;
       os << ((*num_frames_written)++);
       std::string key = os.str(); // key in the archive is the number of the
@@ -116,6 +117,7 @@ int main(int argc, char *argv[]) {
     int32 left_context = 0, right_context = 0;
     int32 srand_seed = 0;
     BaseFloat keep_proportion = 1.0;
+    bool row_major_compression = false;
     
     std::string spk_vecs_rspecifier, utt2spk_rspecifier;
     
@@ -133,6 +135,10 @@ int main(int argc, char *argv[]) {
                 "of times equal to floor(keep-proportion) or ceil(keep-proportion).");
     po.Register("srand", &srand_seed, "Seed for random number generator "
                 "(only relevant if --keep-proportion != 1.0)");
+    po.Register("row-major-compression", &row_major_compression, "If true, "
+                "compress the input features row by row, which makes the "
+                "examples faster to use in training (but older versions of "
+                "the programs can't read them).");
     
     po.Read(argc, argv);
 
@@ -193,7 +199,8 @@ int main(int argc, char *argv[]) {
         }
         ProcessFile(feats, pdf_post, spk_info,
                     left_context, right_context, keep_proportion,
-                    &num_frames_written, &example_writer);
+                    row_major_compression, &num_frames_written,
+                    &example_writer);
         num_done++;
       }
     }
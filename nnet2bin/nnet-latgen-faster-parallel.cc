@@ -49,11 +49,18 @@ int main(int argc, char *argv[]) {
     BaseFloat acoustic_scale = 0.1;
     LatticeFasterDecoderConfig config;
     TaskSequencerConfig sequencer_config; // has --num-threads option
+    NnetBatchComputerOptions batch_opts;
+    bool batch_compute = true;
     std::string spkvecs_rspecifier, utt2spk_rspecifier;
     
     std::string word_syms_filename;
     sequencer_config.Register(&po);
+    batch_opts.Register(&po);
     config.Register(&po);
+    po.Register("batch-compute", &batch_compute, "If true and --num-threads > 1, "
+                "do the neural net computation for the utterances being decoded "
+                "by different threads together, in larger batches (see "
+                "--batch-size, --batch-chunk-size, --max-batch-delay).");
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for acoustic likelihoods");
     po.Register("word-symbol-table", &word_syms_filename, "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial, "If true, produce output even if end state was not reached.");
@@ -85,6 +92,10 @@ int main(int argc, char *argv[]) {
       am_nnet.Read(ki.Stream(), binary);
     }
 
+    NnetBatchComputer *batch_computer = NULL;
+    if (batch_compute && sequencer_config.num_threads > 1)
+      batch_computer = new NnetBatchComputer(batch_opts, am_nnet.GetNnet());
+
     bool determinize = config.determinize_lattice;
     CompactLatticeWriter compact_lattice_writer;
     LatticeWriter lattice_writer;
@@ -113,11 +124,11 @@ int main(int argc, char *argv[]) {
     double tot_like = 0.0;
     kaldi::int64 frame_count = 0;
     int num_done = 0, num_err = 0;
-    VectorFst<StdArc> *decode_fst = NULL;
+    Fst<StdArc> *decode_fst = NULL;
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
       SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
 
-      decode_fst = fst::ReadFstKaldi(fst_in_str);
+      decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
 
       {
     
@@ -144,7 +155,8 @@ int main(int argc, char *argv[]) {
               trans_model, am_nnet,
               new CuMatrix<BaseFloat>(features),
               new CuVector<BaseFloat>(spk_info),
-              pad_input, acoustic_scale);
+              pad_input, acoustic_scale,
+              batch_computer);
 
           LatticeFasterDecoder *decoder = new LatticeFasterDecoder(*decode_fst,
                                                                    config);
@@ -198,7 +210,8 @@ int main(int argc, char *argv[]) {
             trans_model, am_nnet,
             new CuMatrix<BaseFloat>(features),
             new CuVector<BaseFloat>(spk_info),
-            pad_input, acoustic_scale);
+            pad_input, acoustic_scale,
+            batch_computer);
 
         DecodeUtteranceLatticeFasterClass *task =
             new DecodeUtteranceLatticeFasterClass(
@@ -214,6 +227,10 @@ int main(int argc, char *argv[]) {
     }
     sequencer.Wait(); // Waits for all tasks to be done.
     if (decode_fst != NULL) delete decode_fst;   
+    if (batch_computer != NULL) {
+      batch_computer->PrintStats();
+      delete batch_computer;
+    }
     
     double elapsed = timer.Elapsed();
     KALDI_LOG << "Time taken "<< elapsed
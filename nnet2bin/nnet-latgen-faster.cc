@@ -48,6 +48,7 @@ int main(int argc, char *argv[]) {
     bool allow_partial = false;
     BaseFloat acoustic_scale = 0.1;
     LatticeFasterDecoderConfig config;
+    int32 frames_per_chunk = 0;
     std::string spkvecs_rspecifier, utt2spk_rspecifier;
     
     std::string word_syms_filename;
@@ -59,6 +60,10 @@ int main(int argc, char *argv[]) {
                 "only needed if the neural net was trained this way.");
     po.Register("utt2spk", &utt2spk_rspecifier, "Rspecifier for map from utterance to speaker; only relevant "
                 "in conjunction with the --spk-vecs option.");
+    po.Register("frames-per-chunk", &frames_per_chunk, "If >0, do the neural net "
+                "computation in chunks of this many frames as decoding proceeds, "
+                "instead of for the whole utterance at once; this bounds memory "
+                "use for long recordings.");
     
     po.Read(argc, argv);
     
@@ -115,7 +120,8 @@ int main(int argc, char *argv[]) {
       SequentialBaseFloatCuMatrixReader feature_reader(feature_rspecifier);
       
       // Input FST is just one FST, not a table of FSTs.
-      VectorFst<StdArc> *decode_fst = fst::ReadFstKaldi(fst_in_str);
+      // It may be of type "vector", "const" or "decode" (see fstmakedecodefst).
+      Fst<StdArc> *decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
 
       {
         LatticeFasterDecoder decoder(*decode_fst, config);
@@ -138,16 +144,21 @@ int main(int argc, char *argv[]) {
               continue;
             }
           }
-          bool pad_input = true;
-          DecodableAmNnet nnet_decodable(trans_model,
-                                         am_nnet,
-                                         features,
-                                         spk_info,
-                                         pad_input,
-                                         acoustic_scale);
+          DecodableInterface *nnet_decodable;
+          if (frames_per_chunk > 0) {
+            nnet_decodable = new DecodableAmNnetChunked(trans_model, am_nnet,
+                                                        features, spk_info,
+                                                        frames_per_chunk,
+                                                        acoustic_scale);
+          } else {
+            bool pad_input = true;
+            nnet_decodable = new DecodableAmNnet(trans_model, am_nnet,
+                                                 features, spk_info,
+                                                 pad_input, acoustic_scale);
+          }
           double like;
           if (DecodeUtteranceLatticeFaster(
-                  decoder, nnet_decodable, trans_model, word_syms, utt,
+                  decoder, *nnet_decodable, trans_model, word_syms, utt,
                   acoustic_scale, determinize, allow_partial, &alignment_writer,
                   &words_writer, &compact_lattice_writer, &lattice_writer,
                   &like)) {
@@ -155,6 +166,7 @@ int main(int argc, char *argv[]) {
             frame_count += features.NumRows();
             num_success++;
           } else num_fail++;
+          delete nnet_decodable;
         }
       }
       delete decode_fst; // delete this only after decoder goes out of scope.
@@ -188,16 +200,21 @@ int main(int argc, char *argv[]) {
             continue;
           }
         }
-        bool pad_input = true;
-        DecodableAmNnet nnet_decodable(trans_model,
-                                       am_nnet,
-                                       features,
-                                       spk_info,
-                                       pad_input,
-                                       acoustic_scale);
+        DecodableInterface *nnet_decodable;
+        if (frames_per_chunk > 0) {
+          nnet_decodable = new DecodableAmNnetChunked(trans_model, am_nnet,
+                                                      features, spk_info,
+                                                      frames_per_chunk,
+                                                      acoustic_scale);
+        } else {
+          bool pad_input = true;
+          nnet_decodable = new DecodableAmNnet(trans_model, am_nnet,
+                                               features, spk_info,
+                                               pad_input, acoustic_scale);
+        }
         double like;
         if (DecodeUtteranceLatticeFaster(
-                decoder, nnet_decodable, trans_model, word_syms, utt,
+                decoder, *nnet_decodable, trans_model, word_syms, utt,
                 acoustic_scale, determinize, allow_partial, &alignment_writer,
                 &words_writer, &compact_lattice_writer, &lattice_writer,
                 &like)) {
@@ -205,6 +222,7 @@ int main(int argc, char *argv[]) {
           frame_count += features.NumRows();
           num_success++;
         } else num_fail++;
+        delete nnet_decodable;
       }
     }
       
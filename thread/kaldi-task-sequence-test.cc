@@ -21,6 +21,7 @@
 
 #include "base/kaldi-common.h"
 #include "thread/kaldi-task-sequence.h"
+#include "thread/kaldi-mutex.h"
 
 namespace kaldi {
 
@@ -66,11 +67,61 @@ void TestTaskSequencer() {
     KALDI_ASSERT(task_output[i] == i);
 }
 
+// This class checks that no more than the configured number of tasks are in
+// flight (constructed but not yet destroyed) at any one time.
+class MyCountingTaskClass {
+ public:
+  MyCountingTaskClass(int32 max_alive): max_alive_(max_alive) {
+    mutex_.Lock();
+    num_alive_++;
+    KALDI_ASSERT(num_alive_ <= max_alive_);
+    mutex_.Unlock();
+  }
+  void operator() () {
+    int32 spin = 1000 * (rand() % 100);
+    for (int32 i = 0; i < spin; i++);
+  }
+  ~MyCountingTaskClass() {
+    mutex_.Lock();
+    num_alive_--;
+    mutex_.Unlock();
+  }
+  static int32 NumAlive() { return num_alive_; }
+ private:
+  int32 max_alive_;
+  static int32 num_alive_;
+  static Mutex mutex_;
+};
+
+int32 MyCountingTaskClass::num_alive_ = 0;
+Mutex MyCountingTaskClass::mutex_;
+
+void TestTaskSequencerBounded() {
+  TaskSequencerConfig config;
+  config.num_threads = 1 + rand() % 5;
+  config.num_threads_total = config.num_threads + rand() % 3;
+  int32 num_tasks = rand() % 200;
+  TaskSequencer<MyCountingTaskClass> sequencer(config);
+  // The object is constructed before Run() is called, so one more than
+  // num_threads_total may be alive.
+  for (int32 i = 0; i < num_tasks; i++)
+    sequencer.Run(new MyCountingTaskClass(config.num_threads_total + 1));
+  sequencer.Wait();
+  KALDI_ASSERT(MyCountingTaskClass::NumAlive() == 0);
+  const TaskSequencerStats &stats = sequencer.Stats();
+  KALDI_ASSERT(stats.num_tasks == num_tasks && stats.tot_run_time >= 0.0 &&
+               stats.max_run_time <= stats.tot_run_time);
+  // The sequencer can still be used after Wait().
+  sequencer.Run(new MyCountingTaskClass(config.num_threads_total + 1));
+}
+
 }  // end namespace kaldi.
 
 int main() {
   using namespace kaldi;
   for (int32 i = 0; i < 1000; i++)
     TestTaskSequencer();
+  for (int32 i = 0; i < 100; i++)
+    TestTaskSequencerBounded();
 }
 
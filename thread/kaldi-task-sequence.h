@@ -21,9 +21,14 @@
 #define KALDI_THREAD_KALDI_TASK_SEQUENCE_H_ 1
 
 #include <pthread.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
 #include "thread/kaldi-thread.h"
 #include "itf/options-itf.h"
+#include "thread/kaldi-mutex.h"
 #include "thread/kaldi-semaphore.h"
+#include "util/timer.h"
 
 
 namespace kaldi {
@@ -45,16 +50,22 @@ namespace kaldi {
    something (typically the constructor just sets variables, and the destructor
    does some kind of output).  We have a templated class TaskSequencer<C> which
    is responsible for running the jobs in parallel.  It has a function Run()
-   that will accept a new object of class C; this will block until a thread is
-   free, at which time it will spawn a thread that starts running the operator
-   () of the class.  When classes are finished running, the objects will be
-   deleted.  Class TaskSequencer guarantees that the destructors will be called
-   sequentially (not in parallel) and in the same order the objects were given
-   to the Run() function, so that it is safe for the destructor to have side
-   effects such as outputting data.
+   that will accept a new object of class C; this puts it in a queue, from
+   which a fixed pool of num_threads worker threads (created once, in the
+   constructor) take jobs and run the operator () of the class.  When objects
+   are finished running, they will be deleted.  Class TaskSequencer guarantees
+   that the destructors will be called sequentially (not in parallel) and in
+   the same order the objects were given to the Run() function, so that it is
+   safe for the destructor to have side effects such as outputting data.  The
+   destructors are called from a separate output thread.
+
+   The number of objects that have been given to Run() but not yet deleted is
+   limited to num_threads_total; Run() blocks when this limit is reached.
+   This bounds the memory use, while letting the calling thread read ahead
+   while the worker threads are busy.
 
    Note: the destructor of TaskSequencer will wait for any remaining jobs that
-   are still running and will call the destructors.   
+   are still running and will call the destructors.
  */
 
 struct TaskSequencerConfig {
@@ -64,11 +75,34 @@ struct TaskSequencerConfig {
   void Register(OptionsItf *po) {
     po->Register("num-threads", &num_threads, "Number of actively processing "
                  "threads to run in parallel");
-    po->Register("num-threads-total", &num_threads_total, "Total number of "
-                 "threads, including those that are waiting on other threads "
-                 "to produce their output.  Controls memory use.  If <= 0, "
-                 "defaults to --num-threads plus 20.  Otherwise, must "
-                 "be >= num-threads.");
+    po->Register("num-threads-total", &num_threads_total, "Maximum number of "
+                 "tasks in flight, including those that are queued or are "
+                 "waiting for earlier tasks to produce their output.  "
+                 "Controls memory use.  If <= 0, defaults to --num-threads "
+                 "plus 20.  Otherwise, must be >= num-threads.");
+  }
+};
+
+/// Timing statistics for the tasks run by class TaskSequencer.  All times are
+/// in seconds and are summed over tasks.
+struct TaskSequencerStats {
+  int64 num_tasks;
+  double tot_queue_time;  // time from Run() until a worker started the task.
+  double tot_run_time;  // time spent in the operator () of the tasks.
+  double tot_output_wait_time;  // time from the end of operator () until the
+                                // destructor was called.
+  double max_run_time;  // the longest time spent in any operator ().
+
+  TaskSequencerStats(): num_tasks(0), tot_queue_time(0.0), tot_run_time(0.0),
+                        tot_output_wait_time(0.0), max_run_time(0.0) { }
+  /// Prints the stats with KALDI_LOG.
+  void Print() const {
+    double n = std::max<int64>(num_tasks, 1);
+    KALDI_LOG << "TaskSequencer: ran " << num_tasks << " tasks; average "
+              << "time per task was " << (tot_queue_time / n) << "s queued, "
+              << (tot_run_time / n) << "s running (max " << max_run_time
+              << "s), " << (tot_output_wait_time / n) << "s waiting for "
+              << "output.";
   }
 };
 
@@ -79,117 +113,152 @@ template<class C>
 class TaskSequencer {
  public:
   TaskSequencer(const TaskSequencerConfig &config):
-      threads_avail_(config.num_threads),
-      tot_threads_avail_(config.num_threads_total > 0 ? config.num_threads_total :
-                         config.num_threads + 20),
-      thread_list_(NULL) {
-    KALDI_ASSERT((config.num_threads_total <= 0 ||
+      num_threads_(config.num_threads),
+      max_in_flight_(config.num_threads_total > 0 ? config.num_threads_total :
+                     config.num_threads + 20),
+      in_flight_avail_(max_in_flight_) {
+    KALDI_ASSERT(config.num_threads > 0 &&
+                 (config.num_threads_total <= 0 ||
                   config.num_threads_total >= config.num_threads) &&
                  "num-threads-total, if specified, must be >= num-threads");
+    threads_.resize(num_threads_ + 1);
+    for (int32 i = 0; i <= num_threads_; i++) {
+      // The last thread is the output thread; the others are the workers.
+      int32 ret;
+      if ((ret = pthread_create(&(threads_[i]),
+                                NULL, // default attributes
+                                (i < num_threads_ ? TaskSequencer<C>::RunWorker
+                                 : TaskSequencer<C>::RunOutput),
+                                static_cast<void*>(this)))) {
+        const char *c = strerror(ret);
+        KALDI_ERR << "Error creating thread, errno was: " << (c ? c : "[NULL]");
+      }
+    }
   }
 
   /// This function takes ownership of the pointer "c", and will delete it
   /// in the same sequence as Run was called on the jobs.
   void Run(C *c) {
-    threads_avail_.Wait(); // wait till we have a thread for computation free.
-    tot_threads_avail_.Wait(); // this ensures we don't have too many threads
-    // waiting on I/O, and consume too much memory.
-    
-    // put the new RunTaskArgsList object at head of the singly
-    // linked list thread_list_.
-    thread_list_ = new RunTaskArgsList(this, c, thread_list_);
-    int32 ret;
-    if ((ret=pthread_create(&(thread_list_->thread),
-                            NULL, // default attributes
-                            TaskSequencer<C>::RunTask,
-                            static_cast<void*>(thread_list_)))) {
-      const char *c = strerror(ret);
-      KALDI_ERR << "Error creating thread, errno was: " << (c ? c : "[NULL]");
-    }
+    KALDI_ASSERT(c != NULL);
+    in_flight_avail_.Wait(); // this ensures we don't have too many tasks
+    // queued or waiting for output, and consume too much memory.
+    TaskInfo *task = new TaskInfo(c);
+    output_queue_.Push(task);  // Push this first so the output thread sees
+                               // the tasks in order.
+    job_queue_.Push(task);
   }
 
   void Wait() { // You call this at the end if it's more convenient
-    // than waiting for the destructor.  It waits for all tasks to finish.
-    if (thread_list_ != NULL) {
-      int ret = pthread_join(thread_list_->thread, NULL);
+    // than waiting for the destructor.  It waits for all tasks to finish
+    // and their destructors to be called.
+    for (int32 i = 0; i < max_in_flight_; i++)
+      in_flight_avail_.Wait();
+    for (int32 i = 0; i < max_in_flight_; i++)
+      in_flight_avail_.Signal();
+  }
+
+  /// Returns timing statistics for the tasks that have been deleted so far;
+  /// only call this after Wait().
+  const TaskSequencerStats &Stats() const { return stats_; }
+
+  /// The destructor waits for the remaining tasks and stops the threads.
+  ~TaskSequencer() {
+    Wait();
+    for (int32 i = 0; i < num_threads_; i++)
+      job_queue_.Push(NULL);  // tells a worker thread to exit.
+    output_queue_.Push(NULL);  // tells the output thread to exit.
+    for (size_t i = 0; i < threads_.size(); i++) {
+      int ret = pthread_join(threads_[i], NULL);
       if (ret != 0) {
         const char *c = strerror(ret);
         KALDI_ERR << "Error joining thread, errno was: " << (c ? c : "[NULL]");
       }
-      KALDI_ASSERT(thread_list_->tail == NULL); // thread would not
-      // have exited without setting tail to NULL.
-      delete thread_list_;
-      thread_list_ = NULL;
     }
-  }
-  
-  /// The destructor waits for the last thread to exit.
-  ~TaskSequencer() {
-    Wait();      
+    if (stats_.num_tasks > 0 && GetVerboseLevel() >= 1)
+      stats_.Print();
   }
  private:
-  struct RunTaskArgsList {
-    TaskSequencer *me; // Think of this as a "this" pointer.
-    C *c; // Clist element of the task we're expected
-    pthread_t thread;
-    RunTaskArgsList *tail;
-    RunTaskArgsList(TaskSequencer *me, C *c, RunTaskArgsList *tail):
-        me(me), c(c), tail(tail) {}
+  struct TaskInfo {
+    C *c;
+    Timer timer;  // started when the task was given to Run().
+    double start_time;  // time (relative to "timer") when operator () began
+    double end_time;  // time when operator () finished.
+    Semaphore done;  // signaled by the worker when operator () is done.
+    TaskInfo(C *c): c(c), start_time(0.0), end_time(0.0) { }
   };
-  // This static function gets run in the threads that we create.
-  static void* RunTask(void *input) {
-    RunTaskArgsList *args = static_cast<RunTaskArgsList*>(input);
-    
-    // (1) run the job.
-    (*(args->c))(); // call operator () on args->c, which does the computation.
-    args->me->threads_avail_.Signal(); // Signal that the compute-intensive
-    // part of the thread is done (we want to run no more than
-    // config_.num_threads of these.)
-    
-    // (2) we want to destroy the object "c" now, by deleting it.  But for
-    //     correct sequencing (this is the whole point of this class, it
-    //     is intended to ensure the output of the program is in correct order),
-    //     we first wait till the previous thread, whose details will be in "tail",
-    //     is finished.
-    if (args->tail != NULL) {
-      int ret = pthread_join(args->tail->thread, NULL);
-      if (ret != 0) {
-        const char *c = strerror(ret);
-        KALDI_ERR << "Error joining thread, errno was: " << (c ? c : "[NULL]");
-      }
+
+  // A simple queue of tasks, with a semaphore that counts the elements; Pop()
+  // blocks until there is something to pop.
+  class TaskQueue {
+   public:
+    void Push(TaskInfo *task) {
+      mutex_.Lock();
+      queue_.push_back(task);
+      mutex_.Unlock();
+      count_.Signal();
+    }
+    TaskInfo *Pop() {
+      count_.Wait();
+      mutex_.Lock();
+      TaskInfo *ans = queue_.front();
+      queue_.pop_front();
+      mutex_.Unlock();
+      return ans;
     }
+   private:
+    Mutex mutex_;
+    Semaphore count_;
+    std::deque<TaskInfo*> queue_;
+  };
 
-    delete args->c; // delete the object "c".  This may cause some output,
-    // e.g. to a stream.  We don't need to worry about concurrent access to
-    // the output stream, because each thread waits for the previous thread
-    // to be done, before doing this.  So there is no risk of concurrent
-    // access.
-    args->c = NULL;
-    
-    if (args->tail != NULL) {
-      KALDI_ASSERT(args->tail->tail == NULL); // Because we already
-      // did pthread_join on args->tail->thread, which means that
-      // thread was done, and before it exited, it would have
-      // deleted and set to NULL its tail (which is the next line of code).
-      delete args->tail;
-      args->tail = NULL;
+  // This static function is run by each of the worker threads.
+  static void* RunWorker(void *input) {
+    TaskSequencer *me = static_cast<TaskSequencer*>(input);
+    TaskInfo *task;
+    while ((task = me->job_queue_.Pop()) != NULL) {
+      task->start_time = task->timer.Elapsed();
+      (*(task->c))(); // call operator () on task->c, which does the
+                      // computation.
+      task->end_time = task->timer.Elapsed();
+      task->done.Signal();
     }
-    // At this point we are exiting from the thread.  Signal the
-    // "tot_threads_avail_" semaphore which is used to limit the total number of threads that are alive, including
-    // not onlhy those that are in active computation in c->operator (), but those
-    // that are waiting on I/O or other threads.
-    args->me->tot_threads_avail_.Signal();
-    // .. and exit the thread, by returning. 
     return NULL;
   }
 
-  Semaphore threads_avail_; // Initialized to the number of threads we are
-  // supposed to run with; the function Run() waits on this.
+  // This static function is run by the output thread, which deletes the
+  // objects in the order they were given to Run().  Because only this thread
+  // calls the destructors, there is no risk of concurrent access to the
+  // output streams.
+  static void* RunOutput(void *input) {
+    TaskSequencer *me = static_cast<TaskSequencer*>(input);
+    TaskInfo *task;
+    while ((task = me->output_queue_.Pop()) != NULL) {
+      task->done.Wait();
+      delete task->c; // delete the object "c".  This may cause some output,
+                      // e.g. to a stream.
+      TaskSequencerStats &stats = me->stats_;
+      double run_time = task->end_time - task->start_time;
+      stats.num_tasks++;
+      stats.tot_queue_time += task->start_time;
+      stats.tot_run_time += run_time;
+      stats.tot_output_wait_time += task->timer.Elapsed() - task->end_time;
+      stats.max_run_time = std::max(stats.max_run_time, run_time);
+      delete task;
+      me->in_flight_avail_.Signal();
+    }
+    return NULL;
+  }
 
-  Semaphore tot_threads_avail_; // We use this semaphore to ensure we don't
-  // consume too much memory...
-  RunTaskArgsList *thread_list_; 
-  
+  int32 num_threads_;  // The number of worker threads.
+  int32 max_in_flight_;  // The maximum number of tasks in flight.
+  Semaphore in_flight_avail_;  // Initialized to max_in_flight_; Run() waits
+                               // on this and the output thread signals it.
+  TaskQueue job_queue_;  // Tasks waiting for a worker thread.
+  TaskQueue output_queue_;  // All tasks not yet deleted, in order.
+  std::vector<pthread_t> threads_;  // The worker threads, then the output
+                                    // thread.
+  TaskSequencerStats stats_;  // Only modified by the output thread.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(TaskSequencer);
 };
 
 } // namespace kaldi
@@ -0,0 +1,101 @@
+// thread/parallel-matrix-functions-test.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "thread/parallel-matrix-functions.h"
+#include "util/timer.h"
+
+namespace kaldi {
+
+// Checks that the parallel versions give exactly the same output as the
+// serial ones, including in-place and on sizes that don't split evenly.
+template<typename Real>
+void TestParallelMatrixFunctions() {
+  for (int32 i = 0; i < 10; i++) {
+    int32 num_threads = RandInt(1, 5),
+        num_rows = RandInt(1, 300), num_cols = RandInt(100, 400);
+    Matrix<Real> src(num_rows, num_cols), diff(num_rows, num_cols),
+        serial(num_rows, num_cols), parallel(num_rows, num_cols);
+    src.SetRandn();
+    src.Scale(5.0);
+    diff.SetRandn();
+
+    serial.Sigmoid(src);
+    ParallelSigmoid(src, num_threads, &parallel);
+    KALDI_ASSERT(serial.ApproxEqual(parallel, 0.0));
+    serial.Tanh(src);
+    ParallelTanh(src, num_threads, &parallel);
+    KALDI_ASSERT(serial.ApproxEqual(parallel, 0.0));
+    serial.SoftMaxPerRow(src);
+    ParallelSoftMaxPerRow(src, num_threads, &parallel);
+    KALDI_ASSERT(serial.ApproxEqual(parallel, 0.0));
+    serial.DiffSigmoid(src, diff);
+    ParallelDiffSigmoid(src, diff, num_threads, &parallel);
+    KALDI_ASSERT(serial.ApproxEqual(parallel, 0.0));
+    serial.DiffTanh(src, diff);
+    ParallelDiffTanh(src, diff, num_threads, &parallel);
+    KALDI_ASSERT(serial.ApproxEqual(parallel, 0.0));
+
+    serial.Sigmoid(src);
+    parallel.CopyFromMat(src);
+    ParallelSigmoid(parallel, num_threads, &parallel);  // in-place.
+    KALDI_ASSERT(serial.ApproxEqual(parallel, 0.0));
+  }
+}
+
+// Prints the speed of ParallelSigmoid() and ParallelSoftMaxPerRow() for
+// various numbers of threads.  Of course this only shows a speedup on a
+// machine with several cores that aren't otherwise busy.
+template<typename Real>
+void TestParallelMatrixFunctionsSpeed(int32 num_rows, int32 num_cols) {
+  BaseFloat time_in_secs = 0.1;
+  Matrix<Real> src(num_rows, num_cols), dest(num_rows, num_cols);
+  src.SetRandn();
+  int32 thread_counts[] = { 1, 2, 4, 8 };
+  for (int32 i = 0; i < 4; i++) {
+    int32 num_threads = thread_counts[i];
+    BaseFloat rate[2];
+    for (int32 softmax = 0; softmax < 2; softmax++) {
+      Timer tim;
+      int32 iter = 0;
+      for (; tim.Elapsed() < time_in_secs; iter++) {
+        if (softmax) ParallelSoftMaxPerRow(src, num_threads, &dest);
+        else ParallelSigmoid(src, num_threads, &dest);
+      }
+      rate[softmax] = (static_cast<BaseFloat>(num_rows) * num_cols * iter) /
+          (tim.Elapsed() * 1.0e+06);
+    }
+    KALDI_LOG << "For " << num_rows << " x " << num_cols
+              << (sizeof(Real) == sizeof(float) ? " float" : " double")
+              << " matrix with " << num_threads << " threads, "
+              << "ParallelSigmoid did " << rate[0] << " and "
+              << "ParallelSoftMaxPerRow " << rate[1]
+              << " million elements per second.";
+  }
+}
+
+}  // end namespace kaldi.
+
+int main() {
+  using namespace kaldi;
+  TestParallelMatrixFunctions<float>();
+  TestParallelMatrixFunctions<double>();
+  TestParallelMatrixFunctionsSpeed<float>(512, 2048);
+  TestParallelMatrixFunctionsSpeed<double>(512, 2048);
+  std::cout << "Test OK.\n";
+}
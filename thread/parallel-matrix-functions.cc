@@ -0,0 +1,154 @@
+// thread/parallel-matrix-functions.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "thread/parallel-matrix-functions.h"
+
+namespace kaldi {
+
+enum RowFunctionType { kSigmoid, kTanh, kSoftMaxPerRow, kDiffSigmoid,
+                       kDiffTanh };
+
+// Below this many elements per thread, starting the threads costs more than
+// it saves.
+static const MatrixIndexT kMinElementsPerThread = 16384;
+
+// Applies one of the functions above to a range of rows.  "diff" is only
+// used for the Diff* functions.
+template<typename Real>
+static void ApplyRowFunction(RowFunctionType type,
+                             const MatrixBase<Real> &src,
+                             const MatrixBase<Real> *diff,
+                             MatrixBase<Real> *dest) {
+  switch (type) {
+    case kSigmoid: dest->Sigmoid(src); break;
+    case kTanh: dest->Tanh(src); break;
+    case kSoftMaxPerRow: dest->SoftMaxPerRow(src); break;
+    case kDiffSigmoid: dest->DiffSigmoid(src, *diff); break;
+    default: dest->DiffTanh(src, *diff);
+  }
+}
+
+template<typename Real>
+class RowFunctionClass: public MultiThreadable {
+ public:
+  RowFunctionClass(RowFunctionType type, const MatrixBase<Real> &src,
+                   const MatrixBase<Real> *diff, MatrixBase<Real> *dest):
+      type_(type), src_(src), diff_(diff), dest_(dest) { }
+  // Use default copy constructor.
+  void operator () () {
+    MatrixIndexT num_rows = src_.NumRows(),
+        block_size = (num_rows + num_threads_ - 1) / num_threads_,
+        start = block_size * thread_id_,
+        end = std::min(num_rows, start + block_size);
+    if (end <= start) return;
+    SubMatrix<Real> src_part(src_, start, end - start, 0, src_.NumCols()),
+        dest_part(*dest_, start, end - start, 0, dest_->NumCols());
+    if (diff_ == NULL) {
+      ApplyRowFunction<Real>(type_, src_part, NULL, &dest_part);
+    } else {
+      SubMatrix<Real> diff_part(*diff_, start, end - start,
+                                0, diff_->NumCols());
+      ApplyRowFunction<Real>(type_, src_part, &diff_part, &dest_part);
+    }
+  }
+ private:
+  RowFunctionType type_;
+  const MatrixBase<Real> &src_;
+  const MatrixBase<Real> *diff_;
+  MatrixBase<Real> *dest_;
+};
+
+template<typename Real>
+static void ParallelRowFunction(RowFunctionType type,
+                                const MatrixBase<Real> &src,
+                                const MatrixBase<Real> *diff,
+                                int32 num_threads,
+                                MatrixBase<Real> *dest) {
+  KALDI_ASSERT(SameDim(src, *dest) && (diff == NULL || SameDim(src, *diff)));
+  MatrixIndexT num_rows = src.NumRows(),
+      max_threads = src.NumRows() * src.NumCols() / kMinElementsPerThread;
+  num_threads = std::min<int32>(num_threads, std::min(num_rows, max_threads));
+  if (num_threads <= 1) {
+    ApplyRowFunction(type, src, diff, dest);
+  } else {
+    RowFunctionClass<Real> c(type, src, diff, dest);
+    MultiThreader<RowFunctionClass<Real> > m(num_threads, c);
+  }
+}
+
+template<typename Real>
+void ParallelSigmoid(const MatrixBase<Real> &src, int32 num_threads,
+                     MatrixBase<Real> *dest) {
+  ParallelRowFunction<Real>(kSigmoid, src, NULL, num_threads, dest);
+}
+
+template<typename Real>
+void ParallelTanh(const MatrixBase<Real> &src, int32 num_threads,
+                  MatrixBase<Real> *dest) {
+  ParallelRowFunction<Real>(kTanh, src, NULL, num_threads, dest);
+}
+
+template<typename Real>
+void ParallelSoftMaxPerRow(const MatrixBase<Real> &src, int32 num_threads,
+                           MatrixBase<Real> *dest) {
+  ParallelRowFunction<Real>(kSoftMaxPerRow, src, NULL, num_threads, dest);
+}
+
+template<typename Real>
+void ParallelDiffSigmoid(const MatrixBase<Real> &value,
+                         const MatrixBase<Real> &diff, int32 num_threads,
+                         MatrixBase<Real> *dest) {
+  ParallelRowFunction(kDiffSigmoid, value, &diff, num_threads, dest);
+}
+
+template<typename Real>
+void ParallelDiffTanh(const MatrixBase<Real> &value,
+                      const MatrixBase<Real> &diff, int32 num_threads,
+                      MatrixBase<Real> *dest) {
+  ParallelRowFunction(kDiffTanh, value, &diff, num_threads, dest);
+}
+
+// Instantiate the templates.
+template void ParallelSigmoid(const MatrixBase<float> &src, int32 num_threads,
+                              MatrixBase<float> *dest);
+template void ParallelTanh(const MatrixBase<float> &src, int32 num_threads,
+                           MatrixBase<float> *dest);
+template void ParallelSoftMaxPerRow(const MatrixBase<float> &src,
+                                    int32 num_threads, MatrixBase<float> *dest);
+template void ParallelDiffSigmoid(const MatrixBase<float> &value,
+                                  const MatrixBase<float> &diff,
+                                  int32 num_threads, MatrixBase<float> *dest);
+template void ParallelDiffTanh(const MatrixBase<float> &value,
+                               const MatrixBase<float> &diff,
+                               int32 num_threads, MatrixBase<float> *dest);
+template void ParallelSigmoid(const MatrixBase<double> &src, int32 num_threads,
+                              MatrixBase<double> *dest);
+template void ParallelTanh(const MatrixBase<double> &src, int32 num_threads,
+                           MatrixBase<double> *dest);
+template void ParallelSoftMaxPerRow(const MatrixBase<double> &src,
+                                    int32 num_threads,
+                                    MatrixBase<double> *dest);
+template void ParallelDiffSigmoid(const MatrixBase<double> &value,
+                                  const MatrixBase<double> &diff,
+                                  int32 num_threads, MatrixBase<double> *dest);
+template void ParallelDiffTanh(const MatrixBase<double> &value,
+                               const MatrixBase<double> &diff,
+                               int32 num_threads, MatrixBase<double> *dest);
+
+}  // namespace kaldi
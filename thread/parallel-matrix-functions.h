@@ -0,0 +1,59 @@
+// thread/parallel-matrix-functions.h
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_THREAD_PARALLEL_MATRIX_FUNCTIONS_H_
+#define KALDI_THREAD_PARALLEL_MATRIX_FUNCTIONS_H_
+
+#include "matrix/matrix-lib.h"
+#include "thread/kaldi-thread.h"
+
+namespace kaldi {
+
+/// The functions below do the same as the MatrixBase functions of the same
+/// names without the "Parallel" (e.g. dest->Sigmoid(src)), but split the rows
+/// into num_threads blocks that are processed in parallel.  They are for
+/// CPU-only programs with cores to spare; with num_threads <= 1, or when there
+/// are too few elements for threads to be worth starting, they just call the
+/// MatrixBase function.  The output may be the same matrix as an input.
+
+template<typename Real>
+void ParallelSigmoid(const MatrixBase<Real> &src, int32 num_threads,
+                     MatrixBase<Real> *dest);
+
+template<typename Real>
+void ParallelTanh(const MatrixBase<Real> &src, int32 num_threads,
+                  MatrixBase<Real> *dest);
+
+template<typename Real>
+void ParallelSoftMaxPerRow(const MatrixBase<Real> &src, int32 num_threads,
+                           MatrixBase<Real> *dest);
+
+template<typename Real>
+void ParallelDiffSigmoid(const MatrixBase<Real> &value,
+                         const MatrixBase<Real> &diff, int32 num_threads,
+                         MatrixBase<Real> *dest);
+
+template<typename Real>
+void ParallelDiffTanh(const MatrixBase<Real> &value,
+                      const MatrixBase<Real> &diff, int32 num_threads,
+                      MatrixBase<Real> *dest);
+
+}  // namespace kaldi
+
+#endif  // KALDI_THREAD_PARALLEL_MATRIX_FUNCTIONS_H_
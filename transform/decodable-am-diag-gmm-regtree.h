@@ -53,6 +53,9 @@ class DecodableAmDiagGmmRegtreeFmllr: public DecodableAmDiagGmmUnmapped {
     return scale_*LogLikelihoodZeroBased(frame,
                                          trans_model_.TransitionIdToPdf(tid));
   }
+  // We override LogLikelihoodZeroBased(), so the batch computation of the
+  // base class does not apply.
+  virtual bool HasBatchLogLikelihoods() { return false; }
 
   virtual int32 NumFrames() { return feature_matrix_.NumRows(); }
 
@@ -96,6 +99,9 @@ class DecodableAmDiagGmmRegtreeMllr: public DecodableAmDiagGmmUnmapped {
     return scale_*LogLikelihoodZeroBased(frame,
                                          trans_model_.TransitionIdToPdf(tid));
   }
+  // We override LogLikelihoodZeroBased(), so the batch computation of the
+  // base class does not apply.
+  virtual bool HasBatchLogLikelihoods() { return false; }
 
   virtual int32 NumFrames() { return feature_matrix_.NumRows(); }
 
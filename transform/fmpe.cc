@@ -569,7 +569,9 @@ BaseFloat ComputeAmGmmFeatureDeriv(const AmDiagGmm &am_gmm,
       // Note: we have to do some messing about with double-precision here
       // because the stats only come in double precision.
       this_direct_deriv.AddVecVec(-1.0, this_feat, temp_vec, 1.0);
-      if (model_diff != NULL && weight > 0.0) { // We need to get the indirect diff.
+      if (model_diff != NULL && weight > 0.0 &&
+          model_diff->IsAllocated(pdf_id)) { // We need to get the indirect diff
+        // (if the pdf has no stats in model_diff, this would be zero).
         // This "weight > 0.0" checks that this is the numerator stats, as the
         // fMPE indirect diff applies only to the ML stats-- CAUTION, this
         // code will only work as-is for fMMI (and the stats should not be
@@ -17,6 +17,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <sstream>
 #include "util/stl-utils.h"
 #include "tree/build-tree.h"
 
@@ -173,6 +174,18 @@ void TestBuildTree() {
       // Would have print-out & testing code here.
       std::cout << "Tree [default build] is:\n";
       tree->Write(std::cout, false);
+
+      // Building the tree with multiple threads should give exactly the same
+      // tree.
+      int32 num_threads = 2 + rand() % 3;
+      EventMap *tree_parallel = BuildTree(qopts, phone_sets, hmm_lengths,
+                                          share_roots, do_split, stats, thresh,
+                                          max_leaves, 0.0, P, num_threads);
+      std::ostringstream os, os_parallel;
+      tree->Write(os, false);
+      tree_parallel->Write(os_parallel, false);
+      KALDI_ASSERT(os.str() == os_parallel.str());
+      delete tree_parallel;
       delete tree;
     }
     DeleteBuildTreeStats(&stats);
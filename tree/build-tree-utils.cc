@@ -20,6 +20,7 @@
 #include <set>
 #include <queue>
 #include "util/stl-utils.h"
+#include "thread/kaldi-thread.h"
 #include "tree/build-tree-utils.h"
 
 
@@ -422,6 +423,41 @@ BaseFloat FindBestSplitForKey(const BuildTreeStatsType &stats,
 
 
 
+/*
+  FindBestSplitForKeyClass is used by DecisionTreeSplitter to evaluate
+  FindBestSplitForKey() for a list of (stats, key) pairs with multiple threads.
+  It is run by MultiThreader.
+*/
+
+class FindBestSplitForKeyClass: public MultiThreadable {
+ public:
+  struct Task {
+    const BuildTreeStatsType *stats;  // not owned here.
+    EventKeyType key;
+    BaseFloat improvement;  // output.
+    std::vector<EventValueType> yes_set;  // output.
+  };
+
+  FindBestSplitForKeyClass(const Questions &q_opts,
+                           std::vector<Task> *tasks):
+      q_opts_(&q_opts), tasks_(tasks) { }
+
+  void operator () () {
+    // Each task is computed by exactly one thread and does not depend on the
+    // others, so the results are the same for any number of threads.
+    for (size_t i = thread_id_; i < tasks_->size(); i += num_threads_) {
+      Task &task = (*tasks_)[i];
+      task.improvement = FindBestSplitForKey(*(task.stats), *q_opts_,
+                                             task.key, &(task.yes_set));
+    }
+  }
+
+ private:
+  const Questions *q_opts_;
+  std::vector<Task> *tasks_;
+};
+
+
 /*
   DecisionTreeBuilder is a class used in SplitDecisionTree
 */
@@ -444,15 +480,70 @@ class DecisionTreeSplitter {
       best_split_impr_ = std::max(yes_->BestSplit(), no_->BestSplit());  // may have changed.
     }
   }
+  // Note: the constructor does not find the best split; you have to call
+  // FindBestSplits() on the newly created object(s) before calling BestSplit()
+  // or DoSplit().
   DecisionTreeSplitter(EventAnswerType leaf, const BuildTreeStatsType &stats,
-                      const Questions &q_opts): q_opts_(q_opts), yes_(NULL), no_(NULL), leaf_(leaf), stats_(stats) {
-    // not, this must work when stats is empty too. [just gives zero improvement, non-splittable].
-    FindBestSplit();
-  }
+                       const Questions &q_opts, int32 num_threads):
+      q_opts_(q_opts), num_threads_(num_threads), best_split_impr_(0.0),
+      yes_(NULL), no_(NULL), leaf_(leaf), stats_(stats) { }
   ~DecisionTreeSplitter() {
     if (yes_) delete yes_;
     if (no_) delete no_;
   }
+
+  // This sets best_split_impr_, key_ and yes_set_ for each of the (unsplit)
+  // splitters.  May just pick best question, or may iterate a bit (depends on
+  // q_opts; see FindBestSplitForKey for details).  The calls to
+  // FindBestSplitForKey() for all the splitters and keys are done in parallel
+  // with up to "num_threads" threads; the results are combined in the same
+  // order as the serial algorithm, so they do not depend on num_threads.
+  // Note: this must work when stats is empty too [just gives zero
+  // improvement, non-splittable].
+  static void FindBestSplits(const std::vector<DecisionTreeSplitter*> &splitters,
+                             int32 num_threads) {
+    if (splitters.empty()) return;
+    const Questions &q_opts = splitters[0]->q_opts_;
+    std::vector<EventKeyType> all_keys, keys;
+    q_opts.GetKeysWithQuestions(&all_keys);
+    if (all_keys.size() == 0) {
+      KALDI_WARN << "DecisionTreeSplitter::FindBestSplits(), no keys available to split on (maybe no key covered all of your events, or there was a problem with your questions configuration?)";
+    }
+    for (size_t i = 0; i < all_keys.size(); i++)
+      if (q_opts.HasQuestionsForKey(all_keys[i]))
+        keys.push_back(all_keys[i]);
+
+    std::vector<FindBestSplitForKeyClass::Task> tasks(splitters.size() *
+                                                      keys.size());
+    for (size_t s = 0; s < splitters.size(); s++) {
+      KALDI_ASSERT(splitters[s]->yes_ == NULL);
+      for (size_t k = 0; k < keys.size(); k++) {
+        FindBestSplitForKeyClass::Task &task = tasks[s * keys.size() + k];
+        task.stats = &(splitters[s]->stats_);
+        task.key = keys[k];
+        task.improvement = 0.0;
+      }
+    }
+    {
+      // num_threads == 0 to MultiThreader means: run in this thread.
+      int32 num_threads_used = std::min<int32>(num_threads, tasks.size());
+      FindBestSplitForKeyClass c(q_opts, &tasks);
+      MultiThreader<FindBestSplitForKeyClass> m(
+          num_threads_used > 1 ? num_threads_used : 0, c);
+    }
+    for (size_t s = 0; s < splitters.size(); s++) {
+      DecisionTreeSplitter *splitter = splitters[s];
+      splitter->best_split_impr_ = 0;
+      for (size_t k = 0; k < keys.size(); k++) {
+        FindBestSplitForKeyClass::Task &task = tasks[s * keys.size() + k];
+        if (task.improvement > splitter->best_split_impr_) {
+          splitter->best_split_impr_ = task.improvement;
+          splitter->yes_set_.swap(task.yes_set);
+          splitter->key_ = task.key;
+        }
+      }
+    }
+  }
  private:
   void DoSplitInternal(int32 *next_leaf) {
     // Does the split; applicable only to leaf nodes.
@@ -481,38 +572,19 @@ class DecisionTreeSplitter {
       delete yes_clust; delete no_clust;
     }
 #endif
-    yes_ = new DecisionTreeSplitter(yes_leaf, yes_stats, q_opts_);
-    no_ = new DecisionTreeSplitter(no_leaf, no_stats, q_opts_);
+    yes_ = new DecisionTreeSplitter(yes_leaf, yes_stats, q_opts_, num_threads_);
+    no_ = new DecisionTreeSplitter(no_leaf, no_stats, q_opts_, num_threads_);
+    std::vector<DecisionTreeSplitter*> children(2);
+    children[0] = yes_;
+    children[1] = no_;
+    FindBestSplits(children, num_threads_);
     best_split_impr_ = std::max(yes_->BestSplit(), no_->BestSplit());
     stats_.clear();  // note: pointers in stats_ were not owned here.
   }
-  void FindBestSplit() {
-    // This sets best_split_impr_, key_ and yes_set_.
-    // May just pick best question, or may iterate a bit (depends on
-    // q_opts; see FindBestSplitForKey for details)
-    std::vector<EventKeyType> all_keys;
-    q_opts_.GetKeysWithQuestions(&all_keys);
-    if (all_keys.size() == 0) {
-      KALDI_WARN << "DecisionTreeSplitter::FindBestSplit(), no keys available to split on (maybe no key covered all of your events, or there was a problem with your questions configuration?)";
-    }
-    best_split_impr_ = 0;
-    for (size_t i = 0; i < all_keys.size(); i++) {
-      if (q_opts_.HasQuestionsForKey(all_keys[i])) {
-        std::vector<EventValueType> temp_yes_set;
-        BaseFloat split_improvement = FindBestSplitForKey(stats_, q_opts_, all_keys[i], &temp_yes_set);
-        if (split_improvement > best_split_impr_) {
-          best_split_impr_ = split_improvement;
-          yes_set_ = temp_yes_set;
-          key_ = all_keys[i];
-        }
-      }
-    }
-  }
-
-
 
   // Data members... Always used:
   const Questions &q_opts_;
+  int32 num_threads_;
   BaseFloat best_split_impr_;
 
   // If already split:
@@ -536,7 +608,8 @@ EventMap *SplitDecisionTree(const EventMap &input_map,
                             int32 max_leaves,  // max_leaves<=0 -> no maximum.
                             int32 *num_leaves,
                             BaseFloat *obj_impr_out,
-                            BaseFloat *smallest_split_change_out) {
+                            BaseFloat *smallest_split_change_out,
+                            int32 num_threads) {
   KALDI_ASSERT(num_leaves != NULL && *num_leaves > 0);  // can't be 0 or input_map would be empty.
   int32 num_empty_leaves = 0;
   BaseFloat like_impr = 0.0;
@@ -551,8 +624,12 @@ EventMap *SplitDecisionTree(const EventMap &input_map,
     for (size_t i = 0;i < split_stats.size();i++) {
       EventAnswerType leaf = static_cast<EventAnswerType>(i);
       if (split_stats[i].size() == 0) num_empty_leaves++;
-      builders[i] = new DecisionTreeSplitter(leaf, split_stats[i], q_opts);
+      builders[i] = new DecisionTreeSplitter(leaf, split_stats[i], q_opts,
+                                             num_threads);
     }
+    // Evaluate the questions for all the initial leaves at once; this is where
+    // most of the time goes, and it parallelizes well.
+    DecisionTreeSplitter::FindBestSplits(builders, num_threads);
   }
 
   {  // Do the splitting.
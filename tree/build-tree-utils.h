@@ -269,6 +269,9 @@ EventMap *ShareEventMapLeaves(const EventMap &e_in, EventKeyType key,
 /// @param smallest_split_change_out If non-NULL, will be set to the smallest objective-function
 ///         improvement that we got from splitting any leaf; useful to provide a threshold
 ///         for ClusterEventMap.
+/// @param num_threads [in] The number of threads used to evaluate the questions
+///         (the calls to FindBestSplitForKey); the tree we output does not
+///         depend on this.
 /// @return The EventMap after splitting is returned; pointer is owned by caller.
 EventMap *SplitDecisionTree(const EventMap &orig,
                             const BuildTreeStatsType &stats,
@@ -277,7 +280,8 @@ EventMap *SplitDecisionTree(const EventMap &orig,
                             int32 max_leaves,  // max_leaves<=0 -> no maximum.
                             int32 *num_leaves,
                             BaseFloat *objf_impr_out,
-                            BaseFloat *smallest_split_change_out);
+                            BaseFloat *smallest_split_change_out,
+                            int32 num_threads = 1);
 
 /// CreateRandomQuestions will initialize a Questions randomly, in a reasonable
 /// way [for testing purposes, or when hand-designed questions are not available].
@@ -75,6 +75,9 @@ namespace kaldi {
  
  * @param P [in] The central position of the phone context window, e.g. 1 for a
  *                triphone system.
+ * @param num_threads [in] Number of threads to use in evaluating the questions
+ *                during decision-tree splitting; the tree is the same
+ *                regardless of this value.
  * @return  Returns a pointer to an EventMap object that is the tree.
 
 */
@@ -88,7 +91,8 @@ EventMap *BuildTree(Questions &qopts,
                     BaseFloat thresh,
                     int32 max_leaves,
                     BaseFloat cluster_thresh,  // typically == thresh.  If negative, use smallest split.
-                    int32 P);
+                    int32 P,
+                    int32 num_threads = 1);
 
 
 /**
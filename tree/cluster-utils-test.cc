@@ -439,6 +439,26 @@ static void TestClusterTopDown() {
 
 
 
+static void TestClusterBottomUpMultiThreaded() {
+  // Enough points that the distances are computed with multiple threads,
+  // both initially and (for the first few merges) after each merge.
+  size_t n_points = 2000 + rand() % 100;
+  std::vector<Clusterable*> points;
+  for (size_t i = 0; i < n_points; i++)
+    points.push_back(new ScalarClusterable(RandGauss()));
+
+  int32 min_clust = n_points / 2, num_threads = 2 + rand() % 3;
+  std::vector<int32> assignments, assignments_threaded;
+  BaseFloat ans = ClusterBottomUp(points, 1.0e+10, min_clust, NULL,
+                                  &assignments),
+      ans_threaded = ClusterBottomUp(points, 1.0e+10, min_clust, NULL,
+                                     &assignments_threaded, num_threads);
+  // The output should not depend on the number of threads.
+  KALDI_ASSERT(ans == ans_threaded && assignments == assignments_threaded);
+  DeletePointers(&points);
+}
+
+
 } // end namespace kaldi
 
 int main() {
@@ -455,6 +475,7 @@ int main() {
   TestTreeCluster();
   TestClusterKMeans();
   TestClusterBottomUp();
+  TestClusterBottomUpMultiThreaded();
   TestRefineClusters();
 
   for (size_t i = 0;i < 2;i++)
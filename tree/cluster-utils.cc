@@ -25,6 +25,7 @@ using std::vector;
 
 #include "base/kaldi-math.h"
 #include "util/stl-utils.h"
+#include "thread/kaldi-thread.h"
 #include "tree/cluster-utils.h"
 
 namespace kaldi {
@@ -190,17 +191,62 @@ void AddToClustersOptimized(const std::vector<Clusterable*> &stats,
 // Bottom-up clustering routines
 // ============================================================================
 
+/// This class computes distances between clusters for BottomUpClusterer,
+/// and is run by MultiThreader.  Each distance is written to its own
+/// location in "dist_vec", so the threads do not interact.
+class BottomUpDistanceClass: public MultiThreadable {
+ public:
+  /// If "merged" is -1, computes the distances between all pairs of
+  /// clusters; otherwise, the distances between cluster "merged" and all the
+  /// other existing (non-NULL) clusters.
+  BottomUpDistanceClass(const std::vector<Clusterable*> &clusters,
+                        int32 merged, std::vector<BaseFloat> *dist_vec):
+      clusters_(&clusters), merged_(merged), dist_vec_(dist_vec) { }
+
+  void operator () () {
+    const std::vector<Clusterable*> &clusters = *clusters_;
+    int32 num_clusters = clusters.size();
+    if (merged_ == -1) {
+      // Rows of the triangular array are interleaved between threads, which
+      // balances the work as the rows get longer.
+      for (int32 i = thread_id_; i < num_clusters; i += num_threads_)
+        for (int32 j = 0; j < i; j++)
+          (*dist_vec_)[(i * (i - 1)) / 2 + j] =
+              clusters[i]->Distance(*(clusters[j]));
+    } else {
+      int32 i = merged_;
+      for (int32 k = thread_id_; k < num_clusters; k += num_threads_) {
+        if (k != i && clusters[k] != NULL) {
+          if (k < i)
+            (*dist_vec_)[(i * (i - 1)) / 2 + k] =
+                clusters[i]->Distance(*(clusters[k]));
+          else
+            (*dist_vec_)[(k * (k - 1)) / 2 + i] =
+                clusters[k]->Distance(*(clusters[i]));
+        }
+      }
+    }
+  }
+
+ private:
+  const std::vector<Clusterable*> *clusters_;
+  int32 merged_;
+  std::vector<BaseFloat> *dist_vec_;
+};
+
 class BottomUpClusterer {
  public:
   BottomUpClusterer(const std::vector<Clusterable*> &points,
                     BaseFloat max_merge_thresh,
                     int32 min_clust,
                     std::vector<Clusterable*> *clusters_out,
-                    std::vector<int32> *assignments_out)
+                    std::vector<int32> *assignments_out,
+                    int32 num_threads)
       : ans_(0.0), points_(points), max_merge_thresh_(max_merge_thresh),
         min_clust_(min_clust), clusters_(clusters_out != NULL? clusters_out
             : &tmp_clusters_), assignments_(assignments_out != NULL ?
-                assignments_out : &tmp_assignments_) {
+                assignments_out : &tmp_assignments_),
+        num_threads_(num_threads) {
     nclusters_ = npoints_ = points.size();
     dist_vec_.resize((npoints_ * (npoints_ - 1)) / 2);
   }
@@ -219,8 +265,11 @@ class BottomUpClusterer {
   void MergeClusters(int32 i, int32 j);
   /// Reconstructs the priority queue from the distances.
   void ReconstructQueue();
+  /// Computes the distances between cluster i and all other clusters (or, if
+  /// i == -1, between all pairs of clusters) and stores them in dist_vec_,
+  /// using up to num_threads_ threads.
+  void ComputeDistances(int32 i, size_t num_distances);
 
-  void SetDistance(int32 i, int32 j);
   BaseFloat& Distance(int32 i, int32 j) {
     KALDI_ASSERT(i < npoints_ && j < i);
     return dist_vec_[(i * (i - 1)) / 2 + j];
@@ -235,6 +284,7 @@ class BottomUpClusterer {
 
   std::vector<Clusterable*> tmp_clusters_;
   std::vector<int32> tmp_assignments_;
+  int32 num_threads_;
 
   std::vector<BaseFloat> dist_vec_;
   int32 nclusters_;
@@ -322,11 +372,22 @@ void BottomUpClusterer::InitializeAssignments() {
   }
 }
 
+void BottomUpClusterer::ComputeDistances(int32 i, size_t num_distances) {
+  // Starting a thread costs about as much as a few tens of calls to
+  // Distance(), so we only use threads if there is plenty of work for them.
+  // MultiThreader runs in the calling thread if given num_threads == 0.
+  const size_t min_distances_per_thread = 1000;
+  int32 num_threads = std::min<size_t>(num_threads_,
+                                       num_distances / min_distances_per_thread);
+  BottomUpDistanceClass c(*clusters_, i, &dist_vec_);
+  MultiThreader<BottomUpDistanceClass> m(num_threads > 1 ? num_threads : 0, c);
+}
+
 void BottomUpClusterer::SetInitialDistances() {
+  ComputeDistances(-1, dist_vec_.size());
   for (int32 i = 0; i < npoints_; i++) {
     for (int32 j = 0; j < i; j++) {
-      BaseFloat dist = (*clusters_)[i]->Distance(*((*clusters_)[j]));
-      dist_vec_[(i * (i - 1)) / 2 + j] = dist;
+      BaseFloat dist = dist_vec_[(i * (i - 1)) / 2 + j];
       if (dist <= max_merge_thresh_)
         queue_.push(std::make_pair(dist, std::make_pair(static_cast<uint_smaller>(i),
             static_cast<uint_smaller>(j))));
@@ -354,15 +415,22 @@ void BottomUpClusterer::MergeClusters(int32 i, int32 j) {
   // change.
   ans_ -= dist_vec_[(i * (i - 1)) / 2 + j];
   nclusters_--;
-  // Now update "distances".
+  // Now update "distances", and add the new ones to the queue.
+  ComputeDistances(i, nclusters_ - 1);
   for (int32 k = 0; k < npoints_; k++) {
     if (k != i && (*clusters_)[k] != NULL) {
-      if (k < i)
-        SetDistance(i, k);  // SetDistance requires k < i.
-      else
-        SetDistance(k, i);
+      int32 a = std::max(i, k), b = std::min(i, k);
+      BaseFloat dist = dist_vec_[(a * (a - 1)) / 2 + b];
+      if (dist < max_merge_thresh_)
+        queue_.push(std::make_pair(dist, std::make_pair(
+            static_cast<uint_smaller>(a), static_cast<uint_smaller>(b))));
     }
   }
+  // every time it's at least twice the maximum possible size.
+  if (queue_.size() >= static_cast<size_t> (npoints_ * npoints_)) {
+    // Control memory use by getting rid of orphaned queue entries
+    ReconstructQueue();
+  }
 }
 
 void BottomUpClusterer::ReconstructQueue() {
@@ -386,29 +454,14 @@ void BottomUpClusterer::ReconstructQueue() {
   }
 }
 
-void BottomUpClusterer::SetDistance(int32 i, int32 j) {
-  KALDI_ASSERT(i < npoints_ && j < i && (*clusters_)[i] != NULL
-         && (*clusters_)[j] != NULL);
-  BaseFloat dist = (*clusters_)[i]->Distance(*((*clusters_)[j]));
-  dist_vec_[(i * (i - 1)) / 2 + j] = dist;  // set the distance in the array.
-  if (dist < max_merge_thresh_) {
-    queue_.push(std::make_pair(dist, std::make_pair(static_cast<uint_smaller>(i),
-        static_cast<uint_smaller>(j))));
-  }
-  // every time it's at least twice the maximum possible size.
-  if (queue_.size() >= static_cast<size_t> (npoints_ * npoints_)) {
-    // Control memory use by getting rid of orphaned queue entries
-    ReconstructQueue();
-  }
-}
-
 
 
 BaseFloat ClusterBottomUp(const std::vector<Clusterable*> &points,
                           BaseFloat max_merge_thresh,
                           int32 min_clust,
                           std::vector<Clusterable*> *clusters_out,
-                          std::vector<int32> *assignments_out) {
+                          std::vector<int32> *assignments_out,
+                          int32 num_threads) {
   KALDI_ASSERT(max_merge_thresh >= 0.0 && min_clust >= 0);
   KALDI_ASSERT(!ContainsNullPointers(points));
   int32 npoints = points.size();
@@ -417,7 +470,8 @@ BaseFloat ClusterBottomUp(const std::vector<Clusterable*> &points,
                npoints < static_cast<int32>(static_cast<uint_smaller>(-1)));
 
   KALDI_VLOG(2) << "Initializing clustering object.";
-  BottomUpClusterer bc(points, max_merge_thresh, min_clust, clusters_out, assignments_out);
+  BottomUpClusterer bc(points, max_merge_thresh, min_clust, clusters_out,
+                       assignments_out, num_threads);
   BaseFloat ans = bc.Cluster();
   if (clusters_out) KALDI_ASSERT(!ContainsNullPointers(*clusters_out));
   return ans;
@@ -93,6 +93,10 @@ template<class KaldiType> class KaldiObjectHolder {
     return *t_;
   }
 
+  void Swap(KaldiObjectHolder *other) {
+    std::swap(t_, other->t_);
+  }
+
   ~KaldiObjectHolder() { if (t_) delete t_; }
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(KaldiObjectHolder);
@@ -175,6 +179,10 @@ template<class BasicType> class BasicHolder {
     return t_;
   }
 
+  void Swap(BasicHolder *other) {
+    std::swap(t_, other->t_);
+  }
+
   ~BasicHolder() { }
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(BasicHolder);
@@ -281,6 +289,10 @@ template<class BasicType> class BasicVectorHolder {
 
   const T &Value() const {  return t_; }
 
+  void Swap(BasicVectorHolder *other) {
+    t_.swap(other->t_);
+  }
+
   ~BasicVectorHolder() { }
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(BasicVectorHolder);
@@ -413,6 +425,10 @@ template<class BasicType> class BasicVectorVectorHolder {
 
   const T &Value() const {  return t_; }
 
+  void Swap(BasicVectorVectorHolder *other) {
+    t_.swap(other->t_);
+  }
+
   ~BasicVectorVectorHolder() { }
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(BasicVectorVectorHolder);
@@ -547,6 +563,10 @@ template<class BasicType> class BasicPairVectorHolder {
 
   const T &Value() const {  return t_; }
 
+  void Swap(BasicPairVectorHolder *other) {
+    t_.swap(other->t_);
+  }
+
   ~BasicPairVectorHolder() { }
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(BasicPairVectorHolder);
@@ -595,6 +615,10 @@ class TokenHolder {
 
   const T &Value() const { return t_; }
 
+  void Swap(TokenHolder *other) {
+    t_.swap(other->t_);
+  }
+
   ~TokenHolder() { }
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(TokenHolder);
@@ -647,6 +671,10 @@ class TokenVectorHolder {
 
   const T &Value() const { return t_; }
 
+  void Swap(TokenVectorHolder *other) {
+    t_.swap(other->t_);
+  }
+
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(TokenVectorHolder);
   T t_;
@@ -685,6 +713,10 @@ class HtkMatrixHolder {
 
   const T &Value() const { return t_; }
 
+  void Swap(HtkMatrixHolder *other) {
+    t_.first.Swap(&(other->t_.first));
+    std::swap(t_.second, other->t_.second);
+  }
 
   // No destructor.
  private:
@@ -785,6 +817,10 @@ template<int kFeatDim> class SphinxMatrixHolder {
 
   const T &Value() const { return feats_; }
 
+  void Swap(SphinxMatrixHolder *other) {
+    feats_.Swap(&(other->feats_));
+  }
+
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(SphinxMatrixHolder);
   T feats_;
@@ -123,6 +123,12 @@ template<class SomeType> class GenericHolder {
   /// true (so OK to throw exception if no object was read).
   const T &Value() const { return t_; } // if t is a pointer, would return *t_;
 
+  /// Swaps the contents of this holder with those of another holder of the
+  /// same type, without copying the objects (used by the prefetching
+  /// SequentialTableReader, see "prefetch=N" in kaldi-table.h, to hand
+  /// objects from the reading thread to the user).
+  void Swap(GenericHolder *other) { std::swap(t_, other->t_); }
+
   /// The Clear() function doesn't have to do anything.  Its purpose is to
   /// allow the object to free resources if they're no longer needed.
   void Clear() { }
@@ -0,0 +1,309 @@
+// util/kaldi-mmap.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "util/kaldi-mmap.h"
+#include "util/kaldi-io.h"
+#include "util/text-utils.h"
+
+namespace kaldi {
+
+bool MappedFile::Open(const std::string &filename) {
+  Close();
+#ifndef _MSC_VER
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    KALDI_WARN << "Could not open file " << filename << " for mapping: "
+               << strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    KALDI_WARN << "Could not stat file " << filename << ": "
+               << strerror(errno);
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  if (size > 0) {
+    void *addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+      KALDI_WARN << "Could not map file " << filename << ": "
+                 << strerror(errno);
+      close(fd);
+      return false;
+    }
+#ifdef MADV_RANDOM
+    // We expect to be accessing objects in random order.
+    madvise(addr, size, MADV_RANDOM);
+#endif
+    data_ = static_cast<const char*>(addr);
+  }
+  close(fd);  // The mapping stays valid after closing the file descriptor.
+  size_ = size;
+#else
+  std::ifstream is(filename.c_str(), std::ios_base::in|std::ios_base::binary);
+  if (!is.is_open()) {
+    KALDI_WARN << "Could not open file " << filename;
+    return false;
+  }
+  is.seekg(0, std::ios_base::end);
+  size_ = is.tellg();
+  is.seekg(0, std::ios_base::beg);
+  buffer_.resize(size_);
+  if (size_ > 0 && !is.read(&(buffer_[0]), size_)) {
+    KALDI_WARN << "Could not read file " << filename;
+    buffer_.clear();
+    size_ = 0;
+    return false;
+  }
+  data_ = (size_ > 0 ? &(buffer_[0]) : NULL);
+#endif
+  filename_ = filename;
+  return true;
+}
+
+void MappedFile::Close() {
+#ifndef _MSC_VER
+  if (data_ != NULL)
+    munmap(const_cast<char*>(data_), size_);
+#else
+  buffer_.clear();
+#endif
+  data_ = NULL;
+  size_ = 0;
+  filename_ = "";
+}
+
+
+MemoryInputBuf::MemoryInputBuf(const char *data, size_t size) {
+  char *begin = const_cast<char*>(data);  // we never write to it.
+  setg(begin, begin, begin + size);
+}
+
+MemoryInputBuf::pos_type MemoryInputBuf::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  off_type pos;
+  if (dir == std::ios_base::beg) pos = off;
+  else if (dir == std::ios_base::cur) pos = (gptr() - eback()) + off;
+  else pos = (egptr() - eback()) + off;
+  if (!(which & std::ios_base::in) || pos < 0 || pos > egptr() - eback())
+    return pos_type(off_type(-1));
+  setg(eback(), eback() + pos, egptr());
+  return pos_type(pos);
+}
+
+MemoryInputBuf::pos_type MemoryInputBuf::seekpos(
+    pos_type pos, std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+
+bool ArchiveIndex::Init(std::vector<std::pair<std::string, int64> > *entries) {
+  entries_.swap(*entries);
+  entries->clear();
+  std::sort(entries_.begin(), entries_.end());
+  for (size_t i = 0; i + 1 < entries_.size(); i++) {
+    if (entries_[i].first == entries_[i+1].first) {
+      KALDI_WARN << "Duplicate key " << entries_[i].first << " in archive";
+      entries_.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ArchiveIndex::Lookup(const std::string &key, int64 *offset) const {
+  std::pair<std::string, int64> pr(key, -1);  // -1 compares less than any
+                                              // offset.
+  std::vector<std::pair<std::string, int64> >::const_iterator iter =
+      std::lower_bound(entries_.begin(), entries_.end(), pr);
+  if (iter != entries_.end() && iter->first == key) {
+    *offset = iter->second;
+    return true;
+  } else {
+    return false;
+  }
+}
+
+// Gets the size and modification time of a file; returns false on error.
+static bool GetFileStatus(const std::string &filename, int64 *size,
+                          int64 *mtime) {
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0) return false;
+  *size = st.st_size;
+#ifdef __linux__
+  // Use the nanosecond part too, if we have it, in case the archive is
+  // rewritten quickly.
+  *mtime = static_cast<int64>(st.st_mtim.tv_sec) * 1000000000 +
+      st.st_mtim.tv_nsec;
+#else
+  *mtime = st.st_mtime;
+#endif
+  return true;
+}
+
+bool ArchiveIndex::Read(const std::string &index_filename,
+                        const std::string &archive_filename) {
+  entries_.clear();
+  int64 size, mtime;
+  if (!GetFileStatus(archive_filename, &size, &mtime)) return false;
+  std::ifstream is(index_filename.c_str());
+  if (!is.is_open()) return false;
+  std::string token;
+  int64 index_size, index_mtime;
+  if (!(is >> token >> index_size >> index_mtime) ||
+      token != "<ArchiveIndex>" || index_size != size ||
+      index_mtime != mtime) {
+    KALDI_VLOG(1) << "Index file " << index_filename << " is out of date or "
+                  << "invalid; will re-index " << archive_filename;
+    return false;
+  }
+  std::vector<std::pair<std::string, int64> > entries;
+  std::string key;
+  int64 offset;
+  while (is >> key >> offset) {
+    if (offset < 0 || offset > size) return false;
+    entries.push_back(std::make_pair(key, offset));
+  }
+  if (!is.eof()) return false;
+  return Init(&entries);
+}
+
+bool ArchiveIndex::Check(const char *data, size_t size,
+                         size_t num_keys) const {
+  size_t num_entries = entries_.size();
+  num_keys = std::min(num_keys, num_entries);
+  for (size_t n = 0; n < num_keys; n++) {
+    // Spread the checked keys evenly, including the first and last.
+    size_t i = (num_keys == 1 ? 0 : n * (num_entries - 1) / (num_keys - 1));
+    const std::string &key = entries_[i].first;
+    int64 offset = entries_[i].second;
+    if (offset <= 0 || offset > static_cast<int64>(size)) return false;
+    // In both modes the writer puts a space after the key; in binary mode it
+    // is followed by "\0B", and the previous object may end with any byte.
+    // When reading, a newline after the key is not consumed, so in that case
+    // the offset is just after the key.
+    bool binary = (offset + 2 <= static_cast<int64>(size) &&
+                   data[offset] == '\0' && data[offset + 1] == 'B');
+    int64 key_end;
+    if (data[offset - 1] == ' ' || data[offset - 1] == '\t')
+      key_end = offset - 1;
+    else if (!binary && offset < static_cast<int64>(size) &&
+             data[offset] == '\n')
+      key_end = offset;
+    else
+      return false;
+    int64 key_start = key_end - key.size();
+    if (key_start < 0 ||
+        memcmp(data + key_start, key.data(), key.size()) != 0 ||
+        (!binary && key_start > 0 && !isspace(data[key_start - 1])))
+      return false;
+  }
+  return true;
+}
+
+bool ArchiveIndex::Write(const std::string &index_filename,
+                         const std::string &archive_filename) const {
+  int64 size, mtime;
+  if (!GetFileStatus(archive_filename, &size, &mtime)) return false;
+  // Write to a temporary file and rename it, so that another process that
+  // opens the archive at the same time never sees a partly written index.
+  std::ostringstream tmp_filename;
+  tmp_filename << index_filename << ".tmp";
+#ifndef _MSC_VER
+  tmp_filename << '.' << getpid();
+#endif
+  std::ofstream os(tmp_filename.str().c_str());
+  if (!os.is_open()) return false;
+  os << "<ArchiveIndex> " << size << ' ' << mtime << '\n';
+  for (size_t i = 0; i < entries_.size(); i++)
+    os << entries_[i].first << ' ' << entries_[i].second << '\n';
+  os.close();
+#ifdef _MSC_VER
+  std::remove(index_filename.c_str());  // rename() does not overwrite here.
+#endif
+  if (os.fail() ||
+      std::rename(tmp_filename.str().c_str(), index_filename.c_str()) != 0) {
+    std::remove(tmp_filename.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+
+bool MappedFileCache::Lookup(const std::string &rxfilename,
+                             const MappedFile **file,
+                             size_t *offset) {
+  std::string filename;
+  InputType type = ClassifyRxfilename(rxfilename);
+  if (type == kFileInput) {
+    filename = rxfilename;
+    *offset = 0;
+  } else if (type == kOffsetFileInput) {
+    size_t pos = rxfilename.find_last_of(':');
+    KALDI_ASSERT(pos != std::string::npos);
+    filename = std::string(rxfilename, 0, pos);
+    if (!ConvertStringToInteger(std::string(rxfilename, pos + 1), offset)) {
+      KALDI_WARN << "Cannot get offset from filename " << rxfilename;
+      return false;
+    }
+  } else {
+    return false;
+  }
+  std::map<std::string, MappedFile*>::iterator iter = files_.find(filename);
+  if (iter == files_.end()) {
+    MappedFile *new_file = new MappedFile();
+    if (!new_file->Open(filename)) {
+      delete new_file;
+      return false;
+    }
+    iter = files_.insert(std::make_pair(filename, new_file)).first;
+  }
+  if (*offset > iter->second->Size()) {
+    KALDI_WARN << "Offset " << *offset << " is past the end of file "
+               << filename;
+    return false;
+  }
+  *file = iter->second;
+  return true;
+}
+
+void MappedFileCache::Clear() {
+  for (std::map<std::string, MappedFile*>::iterator iter = files_.begin();
+       iter != files_.end(); ++iter)
+    delete iter->second;
+  files_.clear();
+}
+
+}  // namespace kaldi
@@ -0,0 +1,159 @@
+// util/kaldi-mmap.h
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_KALDI_MMAP_H_
+#define KALDI_UTIL_KALDI_MMAP_H_
+
+#include <map>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// \addtogroup table_impl_types
+/// @{
+
+/// MappedFile gives read-only access to the contents of a file through
+/// memory-mapping (on Windows, where we don't have mmap, it just reads the
+/// file into memory).  It is used by the "mmap" option of
+/// RandomAccessTableReader (see kaldi-table.h).
+class MappedFile {
+ public:
+  MappedFile(): data_(NULL), size_(0) { }
+
+  /// Maps the file "filename" (which must be an actual file, not an
+  /// rxfilename).  Returns false and prints a warning on failure.
+  bool Open(const std::string &filename);
+
+  bool IsOpen() const { return !filename_.empty(); }
+
+  void Close();
+
+  const std::string &Filename() const { return filename_; }
+  const char *Data() const { return data_; }
+  size_t Size() const { return size_; }
+
+  ~MappedFile() { Close(); }
+ private:
+  std::string filename_;
+  const char *data_;
+  size_t size_;
+#ifdef _MSC_VER
+  std::vector<char> buffer_;
+#endif
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+
+/// A read-only stream buffer on a region of memory, e.g. part of a
+/// MappedFile.  Supports seeking, so tellg() works on an istream that uses
+/// it.  Reading from it involves no system calls.
+class MemoryInputBuf: public std::streambuf {
+ public:
+  MemoryInputBuf(const char *data, size_t size);
+ protected:
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which);
+  virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+};
+
+
+/// ArchiveIndex stores, for each key in an archive, the byte offset at which
+/// its object starts (i.e. just after the key and the space; the same
+/// offsets that appear in scp files written with "ark,scp:").  It can be
+/// written to and read from a "sidecar" file next to the archive, so that
+/// the archive only has to be scanned once.
+class ArchiveIndex {
+ public:
+  ArchiveIndex() { }
+
+  /// Sets up the index from a list of (key, offset) pairs in any order; this
+  /// function destroys the contents of "entries".  Returns false and prints a
+  /// warning if there are duplicate keys.
+  bool Init(std::vector<std::pair<std::string, int64> > *entries);
+
+  /// Looks up the offset of this key; returns false if not present.
+  bool Lookup(const std::string &key, int64 *offset) const;
+
+  size_t NumKeys() const { return entries_.size(); }
+
+  void Clear() { entries_.clear(); }
+
+  /// Reads the index from "index_filename"; returns false if it does not
+  /// exist, cannot be read, or was not written for the current contents of
+  /// "archive_filename" (we check its size and modification time).
+  bool Read(const std::string &index_filename,
+            const std::string &archive_filename);
+
+  /// Checks that, in the archive whose contents are given, the offsets of
+  /// num_keys keys spread evenly over the index (or of all keys, if there are
+  /// fewer) are preceded by their key and the separator the writer puts after
+  /// it (a space; in binary mode the object then starts with "\0B").  With a
+  /// small num_keys this is a cheap guard against an index that is out of
+  /// date although the archive's size and modification time have not
+  /// changed; it touches only num_keys pages of the archive.
+  bool Check(const char *data, size_t size, size_t num_keys) const;
+
+  /// Writes the index to a temporary file and renames it to
+  /// "index_filename"; returns false on failure (e.g. if the directory is
+  /// not writable).
+  bool Write(const std::string &index_filename,
+             const std::string &archive_filename) const;
+
+  /// Returns the name of the sidecar index file for this archive.
+  static std::string IndexFilename(const std::string &archive_filename) {
+    return archive_filename + ".idx";
+  }
+ private:
+  std::vector<std::pair<std::string, int64> > entries_;  // sorted on key.
+};
+
+
+/// MappedFileCache keeps a MappedFile for each distinct file it is asked
+/// for, so that when a script file has many entries like foo.ark:1234 that
+/// point into the same archive, the archive is only mapped once.
+class MappedFileCache {
+ public:
+  MappedFileCache() { }
+
+  /// If "rxfilename" is a plain file or a file with an offset, as in
+  /// foo.ark:1234, maps the file if it is not already mapped, and outputs the
+  /// file and the offset; returns true on success.  Returns false (without a
+  /// warning) for other types of rxfilename, and with a warning if the file
+  /// could not be mapped or the offset is not inside it.
+  bool Lookup(const std::string &rxfilename, const MappedFile **file,
+              size_t *offset);
+
+  void Clear();
+
+  ~MappedFileCache() { Clear(); }
+ private:
+  std::map<std::string, MappedFile*> files_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedFileCache);
+};
+
+/// @}
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_MMAP_H_
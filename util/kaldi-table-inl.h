@@ -22,8 +22,11 @@
 #ifndef KALDI_UTIL_KALDI_TABLE_INL_H_
 #define KALDI_UTIL_KALDI_TABLE_INL_H_
 
+#include <pthread.h>
 #include <algorithm>
+#include <deque>
 #include "util/kaldi-io.h"
+#include "util/kaldi-mmap.h"
 #include "util/text-utils.h"
 #include "util/stl-utils.h" // for StringHasher.
 
@@ -45,6 +48,11 @@ template<class Holder> class SequentialTableReaderImplBase {
   virtual void FreeCurrent() = 0;
   virtual void Next() = 0;
   virtual bool Close() = 0;
+  // Swaps the current object (loading it first if necessary) into "holder";
+  // afterwards the state is as if FreeCurrent() had been called.  Returns
+  // false if the object could not be loaded (this can only happen for scp
+  // files).  This is used by SequentialTableReaderPrefetchImpl.
+  virtual bool SwapHolder(Holder *holder) = 0;
   SequentialTableReaderImplBase() { }
   virtual ~SequentialTableReaderImplBase() { }
  private:
@@ -161,6 +169,14 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
       KALDI_WARN << "TableReader: FreeCurrent called at the wrong time.";
     }
   }
+  virtual bool SwapHolder(Holder *holder) {
+    if (state_ == kHaveScpLine) LoadCurrent();  // Prints a warning on failure.
+    if (state_ != kLoadSucceeded) return false;
+    holder_.Swap(holder);
+    holder_.Clear();
+    state_ = kLoadFailed;  // as for FreeCurrent().
+    return true;
+  }
   void Next() {
     while (1) {
       NextScpLine();
@@ -449,6 +465,14 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
     } else
       KALDI_WARN << "TableReader: FreeCurernt called at the wrong time.";
   }
+  virtual bool SwapHolder(Holder *holder) {
+    if (state_ != kHaveObject)
+      KALDI_ERR << "TableReader: SwapHolder() called at the wrong time.";
+    holder_.Swap(holder);
+    holder_.Clear();
+    state_ = kFreedObject;
+    return true;
+  }
 
   virtual bool Close() {
     if (! this->IsOpen())
@@ -503,6 +527,253 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
 };
 
 
+// This is the implementation for SequentialTableReader when the "prefetch=N"
+// option is given.  It wraps an archive or script implementation, which is
+// read by a background thread that keeps up to N objects (with their keys)
+// in a queue ahead of the one the user is looking at, so that the reading
+// overlaps with whatever the program does with the objects.  The objects are
+// moved between holders with Holder::Swap(), so they are not copied.
+//
+// We use pthreads directly rather than the classes in ../thread/, because
+// the util library does not depend on the thread library.
+template<class Holder>  class SequentialTableReaderPrefetchImpl:
+      public SequentialTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  SequentialTableReaderPrefetchImpl(): impl_(NULL), thread_running_(false),
+                                       current_(NULL), state_(kUninitialized) {
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&cond_, NULL);
+  }
+
+  virtual bool Open(const std::string &rspecifier) {
+    if (state_ != kUninitialized)
+      if (!Close())  // call Close() yourself to suppress this exception.
+        KALDI_ERR << "TableReader::Open, error closing previous input.";
+    RspecifierType rs = ClassifyRspecifier(rspecifier, NULL, &opts_);
+    KALDI_ASSERT(opts_.prefetch > 0);
+    if (rs == kArchiveRspecifier)
+      impl_ = new SequentialTableReaderArchiveImpl<Holder>();
+    else if (rs == kScriptRspecifier)
+      impl_ = new SequentialTableReaderScriptImpl<Holder>();
+    else
+      KALDI_ERR << "Invalid rspecifier " << rspecifier;
+    if (!impl_->Open(rspecifier)) {
+      delete impl_;
+      impl_ = NULL;
+      return false;
+    }
+    stop_ = false;
+    reader_done_ = false;
+    reader_error_ = false;
+    int32 ret;
+    if ((ret = pthread_create(&thread_, NULL, RunReader, this)) != 0)
+      KALDI_ERR << "TableReader: error creating thread, errno was: "
+                << ret;
+    thread_running_ = true;
+    state_ = kNeedObject;
+    return true;
+  }
+
+  virtual bool IsOpen() const { return state_ != kUninitialized; }
+
+  virtual bool Done() const {
+    // This is const in the interface, but may have to wait for the
+    // reading thread, which is not a change visible to the user.
+    SequentialTableReaderPrefetchImpl<Holder> *self =
+        const_cast<SequentialTableReaderPrefetchImpl<Holder>*>(this);
+    self->EnsureObject();
+    return (state_ == kEof);
+  }
+
+  virtual std::string Key() {
+    EnsureObject();
+    if (state_ == kEof || state_ == kUninitialized)
+      KALDI_ERR << "Key() called on TableReader object at the wrong time.";
+    return key_;
+  }
+
+  virtual const T &Value() {
+    EnsureObject();
+    switch (state_) {
+      case kHaveObject: break;
+      case kLoadFailed:
+        KALDI_ERR << "TableReader: failed to load object for key " << key_
+                  << " (see the warning above for details).";
+      case kFreedObject:
+        KALDI_ERR << "TableReader: you called Value() after FreeCurrent().";
+      default:
+        KALDI_ERR << "Value() called on TableReader object at the wrong time.";
+    }
+    return current_->Value();
+  }
+
+  virtual void FreeCurrent() {
+    EnsureObject();
+    if (state_ == kHaveObject) {
+      delete current_;
+      current_ = NULL;
+      state_ = kFreedObject;
+    } else {
+      KALDI_WARN << "TableReader: FreeCurrent called at the wrong time.";
+    }
+  }
+
+  virtual void Next() {
+    EnsureObject();
+    if (state_ == kEof || state_ == kUninitialized)
+      KALDI_ERR << "TableReader: Next() called wrongly.";
+    delete current_;
+    current_ = NULL;
+    state_ = kNeedObject;  // we get the next object lazily, so Next() never
+                           // waits for the reading thread.
+  }
+
+  virtual bool Close() {
+    if (!IsOpen())
+      KALDI_ERR << "Close() called on TableReader twice or otherwise wrongly.";
+    StopThread();
+    delete current_;
+    current_ = NULL;
+    bool ans = !reader_error_;
+    if (!impl_->Close()) ans = false;  // the wrapped object will have printed
+                                       // a warning in the permissive case.
+    delete impl_;
+    impl_ = NULL;
+    state_ = kUninitialized;
+    return ans;
+  }
+
+  virtual bool SwapHolder(Holder *holder) {
+    // We don't expect this to be called, but it's easy to implement.
+    EnsureObject();
+    if (state_ == kLoadFailed) return false;
+    if (state_ != kHaveObject)
+      KALDI_ERR << "TableReader: SwapHolder() called at the wrong time.";
+    holder->Swap(current_);
+    FreeCurrent();
+    return true;
+  }
+
+  virtual ~SequentialTableReaderPrefetchImpl() {
+    StopThread();
+    delete current_;
+    pthread_mutex_destroy(&mutex_);
+    pthread_cond_destroy(&cond_);
+    // The destructor of impl_ will throw if there was a read error and you
+    // did not call Close().
+    delete impl_;
+  }
+
+ private:
+  // Waits if necessary until the next object (or eof) is available from the
+  // reading thread, and takes it from the queue.
+  void EnsureObject() {
+    if (state_ != kNeedObject) return;
+    pthread_mutex_lock(&mutex_);
+    while (queue_.empty() && !reader_done_)
+      pthread_cond_wait(&cond_, &mutex_);
+    if (queue_.empty()) {
+      state_ = kEof;  // Error in the reading thread counts as eof, like
+                      // in the other implementations; Close() or the
+                      // destructor will report it.
+    } else {
+      key_ = queue_.front().first;
+      current_ = queue_.front().second;
+      queue_.pop_front();
+      state_ = (current_ != NULL ? kHaveObject : kLoadFailed);
+      pthread_cond_signal(&cond_);  // there is now space in the queue.
+    }
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  static void *RunReader(void *arg) {
+    static_cast<SequentialTableReaderPrefetchImpl<Holder>*>(arg)->ReadObjects();
+    return NULL;
+  }
+
+  // This is run by the reading thread.
+  void ReadObjects() {
+    try {
+      while (true) {
+        pthread_mutex_lock(&mutex_);
+        while (queue_.size() >= static_cast<size_t>(opts_.prefetch) && !stop_)
+          pthread_cond_wait(&cond_, &mutex_);
+        bool stop = stop_;
+        pthread_mutex_unlock(&mutex_);
+        if (stop || impl_->Done()) break;
+        std::string key = impl_->Key();
+        Holder *holder = new Holder();
+        if (!impl_->SwapHolder(holder)) {
+          // For scp files that are not in permissive mode, an object that
+          // can't be read is an error only if the user asks for it, so we
+          // pass it on as NULL and let Value() report the error.
+          delete holder;
+          holder = NULL;
+        }
+        impl_->Next();
+        pthread_mutex_lock(&mutex_);
+        queue_.push_back(std::make_pair(key, holder));
+        pthread_cond_signal(&cond_);
+        pthread_mutex_unlock(&mutex_);
+      }
+    } catch (...) {
+      KALDI_WARN << "TableReader: error in background reading thread.";
+      reader_error_ = true;  // read by the main thread after the join.
+    }
+    pthread_mutex_lock(&mutex_);
+    reader_done_ = true;
+    pthread_cond_signal(&cond_);
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  // Stops the reading thread, if it is running, and frees any objects
+  // it has read that the user has not seen.
+  void StopThread() {
+    if (!thread_running_) return;
+    pthread_mutex_lock(&mutex_);
+    stop_ = true;
+    pthread_cond_signal(&cond_);
+    pthread_mutex_unlock(&mutex_);
+    if (pthread_join(thread_, NULL) != 0)
+      KALDI_ERR << "TableReader: error joining thread.";
+    thread_running_ = false;
+    for (size_t i = 0; i < queue_.size(); i++)
+      delete queue_[i].second;
+    queue_.clear();
+  }
+
+  SequentialTableReaderImplBase<Holder> *impl_;  // The wrapped archive or
+                                                 // script implementation.
+  RspecifierOptions opts_;
+  pthread_t thread_;
+  bool thread_running_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;  // Signaled when the queue changes, or on stop_ or
+                         // reader_done_; only one thread ever waits on it.
+  // The following are protected by mutex_.
+  std::deque<std::pair<std::string, Holder*> > queue_;  // Holder* is NULL if
+                                                        // the load failed.
+  bool stop_;  // Set by the main thread to tell the reading thread to stop.
+  bool reader_done_;  // Set by the reading thread when it stops.
+
+  bool reader_error_;  // Set by the reading thread on an unexpected error.
+
+  std::string key_;  // The current key.
+  Holder *current_;  // The current object, or NULL.
+  enum {
+    kUninitialized,  // Uninitialized or closed.
+    kNeedObject,     // After Open() or Next(): we have not yet taken the
+                     // next object from the queue.
+    kHaveObject,     // current_ holds the object for key_.
+    kLoadFailed,     // The object for key_ could not be loaded.
+    kFreedObject,    // The user called FreeCurrent().
+    kEof             // No more objects (or an error).
+  } state_;
+};
+
+
 template<class Holder>
 SequentialTableReader<Holder>::SequentialTableReader(const std::string &rspecifier): impl_(NULL) {
   if (rspecifier != "" && !Open(rspecifier))
@@ -516,8 +787,11 @@ bool SequentialTableReader<Holder>::Open(const std::string &rspecifier) {
       KALDI_ERR << "SequentialTableReader<Holder>::Open(), could not close previously open object.";
   // now impl_ will be NULL.
 
-  RspecifierType wt = ClassifyRspecifier(rspecifier, NULL, NULL);
-  switch (wt) {
+  RspecifierOptions opts;
+  RspecifierType wt = ClassifyRspecifier(rspecifier, NULL, &opts);
+  if (wt != kNoRspecifier && opts.prefetch > 0)
+    impl_ = new SequentialTableReaderPrefetchImpl<Holder>();
+  else switch (wt) {
     case kArchiveRspecifier:
       impl_ = new SequentialTableReaderArchiveImpl<Holder>();
       break;
@@ -1280,6 +1554,7 @@ class RandomAccessTableReaderScriptImpl:
     state_ = kUninitialized;
     last_found_ = 0;
     script_.clear();
+    mapped_files_.Clear();
     current_key_ = "";
     // This one cannot fail because any errors of a "global"
     // nature would have been detected when we did Open().
@@ -1356,6 +1631,26 @@ class RandomAccessTableReaderScriptImpl:
       if (!preload)
         return true;  // we have the key.
       else {  // preload specified, so we have to pre-load the object before returning true.
+        const MappedFile *file;
+        size_t offset;
+        if (opts_.mmap &&
+            mapped_files_.Lookup(script_[key_pos].second, &file, &offset)) {
+          // Read the object directly from the mapped file.
+          if (state_ == kHaveObject || state_ == kGaveObject)
+            holder_.Clear();
+          MemoryInputBuf buf(file->Data() + offset, file->Size() - offset);
+          std::istream is(&buf);
+          if (holder_.Read(is)) {
+            state_ = kHaveObject;
+            current_key_ = key;
+            return true;
+          } else {
+            KALDI_WARN << "RandomAccessTableReader: error reading object from "
+                "mapped file " << PrintableRxfilename(script_[key_pos].second);
+            state_ = kNotHaveObject;
+            return false;
+          }
+        }
         if (!input_.Open(script_[key_pos].second)) {
           KALDI_WARN << "RandomAccessTableReader: error opening stream " << PrintableRxfilename(script_[key_pos].second);
           return false;
@@ -1415,6 +1710,8 @@ class RandomAccessTableReaderScriptImpl:
 
   Input input_;  // Use the same input_ object for reading each file, in case
   // the scp specifies offsets in an archive (so we can keep the same file open).
+  MappedFileCache mapped_files_;  // Used instead of input_ if the "mmap"
+  // option was given.
   RspecifierOptions opts_;
   std::string rspecifier_;  // rspecifier used to open it; used in debug messages
   std::string script_rxfilename_;  // filename of script.
@@ -2056,6 +2353,171 @@ template<class Holder>  class RandomAccessTableReaderUnsortedArchiveImpl:
 
 
 
+// RandomAccessTableReaderMappedArchiveImpl is used for archives when the
+// "mmap" option is given (e.g. "mmap, ark:foo.ark").  The archive must be an
+// actual file.  We memory-map it, and get the offset of each object from an
+// index.  If there is an up-to-date index in a "sidecar" file foo.ark.idx we
+// read it; otherwise we scan the archive once to create it, and, only if the
+// "idx" option was given (e.g. "mmap, idx, ark:foo.ark"), write it there.
+// (We check that the index is up to date from the archive's size and
+// modification time, and by looking at a few of the keys.)  Objects
+// are then read on demand, directly from the mapped memory, so lookups are in
+// any order and cost no system calls; only the most recently read object is
+// kept in memory.
+template<class Holder>  class RandomAccessTableReaderMappedArchiveImpl:
+      public RandomAccessTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  RandomAccessTableReaderMappedArchiveImpl(): is_open_(false),
+                                              have_object_(false) { }
+
+  virtual bool Open(const std::string &rspecifier) {
+    if (is_open_)
+      KALDI_ERR << "Opening already open RandomAccessTableReader: call Close "
+          "first.";
+    RspecifierType rs = ClassifyRspecifier(rspecifier, &archive_rxfilename_,
+                                           &opts_);
+    KALDI_ASSERT(rs == kArchiveRspecifier);
+    if (ClassifyRxfilename(archive_rxfilename_) != kFileInput) {
+      KALDI_WARN << "The mmap option requires the archive to be a file, "
+                 << "rspecifier is " << rspecifier;
+      return false;
+    }
+    if (!file_.Open(archive_rxfilename_))
+      return false;  // Warning will already have been printed.
+    std::string index_filename =
+        ArchiveIndex::IndexFilename(archive_rxfilename_);
+    if (!index_.Read(index_filename, archive_rxfilename_) ||
+        !index_.Check(file_.Data(), file_.Size(), kNumKeysToCheck)) {
+      if (!BuildIndex()) {
+        file_.Close();
+        return false;
+      }
+      if (opts_.idx && !index_.Write(index_filename, archive_rxfilename_))
+        KALDI_WARN << "Could not write index file " << index_filename
+                   << " (continuing, but the archive will have to be "
+                   << "indexed again next time).";
+    }
+    is_open_ = true;
+    return true;
+  }
+
+  virtual bool HasKey(const std::string &key) {
+    if (!is_open_)
+      KALDI_ERR << "HasKey called on RandomAccessTableReader object that is "
+          "not open.";
+    int64 offset;
+    if (!index_.Lookup(key, &offset)) return false;
+    if (opts_.permissive)  // Check that we can read the object.
+      return LoadObject(key, offset);
+    return true;
+  }
+
+  virtual const T &Value(const std::string &key) {
+    if (!is_open_)
+      KALDI_ERR << "RandomAccessTableReader: Value() called on not-open "
+          "object.";
+    if (!(have_object_ && key == current_key_)) {
+      int64 offset;
+      if (!index_.Lookup(key, &offset))
+        KALDI_ERR << "RandomAccessTableReader: Value() called but no such key "
+                  << key << " in archive "
+                  << PrintableRxfilename(archive_rxfilename_);
+      if (!LoadObject(key, offset))
+        KALDI_ERR << "RandomAccessTableReader: error reading object for key "
+                  << key << " from archive "
+                  << PrintableRxfilename(archive_rxfilename_);
+    }
+    return holder_.Value();
+  }
+
+  virtual bool Close() {
+    if (!is_open_)
+      KALDI_ERR << "Close() called on RandomAccessTableReader that was not "
+          "open.";
+    if (have_object_) holder_.Clear();
+    have_object_ = false;
+    current_key_ = "";
+    index_.Clear();
+    file_.Close();
+    is_open_ = false;
+    return true;
+  }
+
+  virtual ~RandomAccessTableReaderMappedArchiveImpl() {
+    if (have_object_) holder_.Clear();
+  }
+
+ private:
+  // Reads the object at this offset in the archive into holder_.
+  bool LoadObject(const std::string &key, int64 offset) {
+    if (have_object_) {
+      if (key == current_key_) return true;
+      holder_.Clear();
+      have_object_ = false;
+    }
+    MemoryInputBuf buf(file_.Data() + offset, file_.Size() - offset);
+    std::istream is(&buf);
+    if (!holder_.Read(is)) {
+      KALDI_WARN << "RandomAccessTableReader: error reading object from "
+                 << "archive " << PrintableRxfilename(archive_rxfilename_)
+                 << " at offset " << offset;
+      return false;
+    }
+    have_object_ = true;
+    current_key_ = key;
+    return true;
+  }
+
+  // Scans the whole archive to set up index_.  The format handling is the
+  // same as in RandomAccessTableReaderArchiveImplBase::ReadNextObject().
+  bool BuildIndex() {
+    KALDI_LOG << "Indexing archive " << archive_rxfilename_;
+    MemoryInputBuf buf(file_.Data(), file_.Size());
+    std::istream is(&buf);
+    std::vector<std::pair<std::string, int64> > entries;
+    std::string key;
+    while (true) {
+      is >> key;
+      if (is.eof()) break;
+      int c;
+      if (is.fail() ||
+          ((c = is.peek()) != ' ' && c != '\t' && c != '\n')) {
+        KALDI_WARN << "Invalid archive file format reading "
+                   << PrintableRxfilename(archive_rxfilename_);
+        if (opts_.permissive) break;
+        return false;
+      }
+      if (c != '\n') is.get();  // Consume the space or tab.
+      int64 offset = is.tellg();
+      Holder holder;
+      if (!holder.Read(is)) {
+        KALDI_WARN << "Object read failed, reading archive "
+                   << PrintableRxfilename(archive_rxfilename_);
+        if (opts_.permissive) break;
+        return false;
+      }
+      entries.push_back(std::make_pair(key, offset));
+    }
+    return index_.Init(&entries);
+  }
+
+  // The number of keys of an index file that we check against the archive.
+  static const size_t kNumKeysToCheck = 16;
+
+  RspecifierOptions opts_;
+  std::string archive_rxfilename_;
+  MappedFile file_;
+  ArchiveIndex index_;
+  bool is_open_;
+  bool have_object_;  // true if holder_ contains the object for current_key_.
+  std::string current_key_;
+  Holder holder_;
+};
+
+
+
 template<class Holder>
 RandomAccessTableReader<Holder>::RandomAccessTableReader(const std::string &rspecifier):
     impl_(NULL) {
@@ -2075,7 +2537,9 @@ bool RandomAccessTableReader<Holder>::Open(const std::string &rspecifier) {
       impl_ = new RandomAccessTableReaderScriptImpl<Holder>();
       break;
     case kArchiveRspecifier:
-      if (opts.sorted) {
+      if (opts.mmap) {
+        impl_ = new RandomAccessTableReaderMappedArchiveImpl<Holder>();
+      } else if (opts.sorted) {
         if (opts.called_sorted) // "doubly" sorted case.
           impl_ = new RandomAccessTableReaderDSortedArchiveImpl<Holder>();
         else
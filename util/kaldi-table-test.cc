@@ -23,6 +23,7 @@
 #include "util/kaldi-holder.h"
 #include "util/table-types.h"
 #ifndef _MSC_VER
+#include <sys/stat.h>
 #include <unistd.h> // for sleep.
 #endif
 
@@ -172,6 +173,38 @@ void UnitTestClassifyWspecifier() {
 
 void UnitTestClassifyRspecifier() {
 
+  {
+    std::string a = "mmap,s,ark:foo";
+    std::string fname = "x";
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &fname, &opts);
+    KALDI_ASSERT(ans == kArchiveRspecifier && fname == "foo" && opts.mmap &&
+                 opts.sorted);
+  }
+
+  {
+    std::string a = "prefetch=5,ark:foo";
+    std::string fname = "x";
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &fname, &opts);
+    KALDI_ASSERT(ans == kArchiveRspecifier && fname == "foo" &&
+                 opts.prefetch == 5);
+  }
+
+  {
+    std::string a = "prefetch=x,ark:foo";
+    RspecifierType ans = ClassifyRspecifier(a, NULL, NULL);
+    KALDI_ASSERT(ans == kNoRspecifier);
+  }
+
+  {
+    std::string a = "mmap,nmmap,scp:foo";
+    std::string fname = "x";
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &fname, &opts);
+    KALDI_ASSERT(ans == kScriptRspecifier && fname == "foo" && !opts.mmap);
+  }
+
   {
     std::string a = "ark:foo|";
     std::string fname = "x";
@@ -444,7 +477,9 @@ void UnitTestTableSequentialDoubleBoth(bool binary, bool read_scp) {
   ans = bw.Close();
   KALDI_ASSERT(ans);
 
-  SequentialDoubleReader sbr(read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  std::string rspecifier = (read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  if (rand() % 2 == 0) rspecifier = "prefetch=2," + rspecifier;  // read ahead.
+  SequentialDoubleReader sbr(rspecifier);
   std::vector<std::string> k2;
   std::vector<double> v2;
   for (; !sbr.Done(); sbr.Next()) {
@@ -487,7 +522,9 @@ void UnitTestTableSequentialInt32VectorBoth(bool binary, bool read_scp) {
   ans = bw.Close();
   KALDI_ASSERT(ans);
 
-  SequentialInt32VectorReader sbr(read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  std::string rspecifier = (read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  if (rand() % 2 == 0) rspecifier = "prefetch=2," + rspecifier;  // read ahead.
+  SequentialInt32VectorReader sbr(rspecifier);
   std::vector<std::string> k2;
   std::vector<std::vector<int32> > v2;
   for (; !sbr.Done(); sbr.Next()) {
@@ -523,7 +560,9 @@ void UnitTestTableSequentialInt32PairVectorBoth(bool binary, bool read_scp) {
   ans = bw.Close();
   KALDI_ASSERT(ans);
 
-  SequentialInt32PairVectorReader sbr(read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  std::string rspecifier = (read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  if (rand() % 2 == 0) rspecifier = "prefetch=2," + rspecifier;  // read ahead.
+  SequentialInt32PairVectorReader sbr(rspecifier);
   std::vector<std::string> k2;
   std::vector<std::vector<std::pair<int32, int32> > > v2;
   for (; !sbr.Done(); sbr.Next()) {
@@ -564,7 +603,9 @@ void UnitTestTableSequentialInt32VectorVectorBoth(bool binary, bool read_scp) {
   ans = bw.Close();
   KALDI_ASSERT(ans);
 
-  SequentialInt32VectorVectorReader sbr(read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  std::string rspecifier = (read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  if (rand() % 2 == 0) rspecifier = "prefetch=2," + rspecifier;  // read ahead.
+  SequentialInt32VectorVectorReader sbr(rspecifier);
   std::vector<std::string> k2;
   std::vector<std::vector<std::vector<int32> > > v2;
   for (; !sbr.Done(); sbr.Next()) {
@@ -644,7 +685,9 @@ void UnitTestTableSequentialDoubleMatrixBoth(bool binary, bool read_scp) {
   ans = bw.Close();
   KALDI_ASSERT(ans);
 
-  SequentialDoubleMatrixReader sbr(read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  std::string rspecifier = (read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  if (rand() % 2 == 0) rspecifier = "prefetch=2," + rspecifier;  // read ahead.
+  SequentialDoubleMatrixReader sbr(rspecifier);
   std::vector<std::string> k2;
   std::vector<Matrix<double>* > v2;
   for (; !sbr.Done(); sbr.Next()) {
@@ -691,7 +734,9 @@ void UnitTestTableSequentialBaseFloatVectorBoth(bool binary, bool read_scp) {
   ans = bw.Close();
   KALDI_ASSERT(ans);
 
-  SequentialBaseFloatVectorReader sbr(read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  std::string rspecifier = (read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  if (rand() % 2 == 0) rspecifier = "prefetch=2," + rspecifier;  // read ahead.
+  SequentialBaseFloatVectorReader sbr(rspecifier);
   std::vector<std::string> k2;
   std::vector<Vector<BaseFloat>* > v2;
   for (; !sbr.Done(); sbr.Next()) {
@@ -763,6 +808,7 @@ void UnitTestTableRandomBothDouble(bool binary, bool read_scp,
   else if (rand()%2 == 0) name += "ncs,";
   if (once) name += "o,";
   else if (rand()%2 == 0) name += "no,";
+  if (rand()%2 == 0) name += "mmap,";  // memory-mapped access.
   name += std::string(read_scp ? "scp:tmpf.scp" : "ark:tmpf");
 
   RandomAccessDoubleReader sbr(name);
@@ -836,6 +882,7 @@ void UnitTestTableRandomBothDoubleMatrix(bool binary, bool read_scp,
   else if (rand()%2 == 0) name += "ncs,";
   if (once) name += "o,";
   else if (rand()%2 == 0) name += "no,";
+  if (rand()%2 == 0) name += "mmap,";  // memory-mapped access.
   name += std::string(read_scp ? "scp:tmpf.scp" : "ark:tmpf");
 
   RandomAccessDoubleMatrixReader sbr(name);
@@ -870,6 +917,106 @@ void UnitTestTableRandomBothDoubleMatrix(bool binary, bool read_scp,
 }
 
 
+// Tests that the index for "mmap, ark:" is only written with the "idx"
+// option, that it is then reused, and that it is not used once the archive
+// has changed.
+// Returns the inode number of a file (or -1 if it does not exist); the index
+// is written to a temporary file and renamed, so if it is rewritten its inode
+// changes.
+static int64 FileInode(const char *filename) {
+  struct stat st;
+  if (stat(filename, &st) != 0) return -1;
+  return st.st_ino;
+}
+
+void UnitTestTableRandomMmapIndex() {
+  std::remove("tmpf.idx");
+  for (int32 iter = 0; iter < 4; iter++) {
+    bool binary_archive = (iter % 2 == 0);
+    {
+      Int32Writer writer(binary_archive ? "ark,b:tmpf" : "ark,t:tmpf");
+      for (int32 i = 0; i < 10; i++)
+        writer.Write(CharToString('a' + i), i + iter);
+    }
+    if (iter == 0) {
+      // Without "idx" no index file is written.
+      RandomAccessInt32Reader reader("mmap,ark:tmpf");
+      KALDI_ASSERT(reader.Value(CharToString('c')) == 2);
+      KALDI_ASSERT(FileInode("tmpf.idx") == -1);
+    }
+    int64 inode = -1;
+    for (int32 n = 0; n < 3; n++) {
+      // On the last pass there is no "idx" option; the index file should
+      // still be read.
+      RandomAccessInt32Reader reader(n < 2 ? "mmap,idx,ark:tmpf" :
+                                     "mmap,ark:tmpf");
+      KALDI_ASSERT(!reader.HasKey("z"));
+      for (int32 i = 9; i >= 0; i--)
+        KALDI_ASSERT(reader.Value(CharToString('a' + i)) == i + iter);
+      // The index file should have been written (for iter > 0, rewritten,
+      // as the archive changed) on the first pass, and reused, not rebuilt,
+      // after that.
+      bool binary;
+      Input ki;
+      KALDI_ASSERT(ki.Open("tmpf.idx", &binary) && !binary);
+      if (n == 0) inode = FileInode("tmpf.idx");
+      else KALDI_ASSERT(FileInode("tmpf.idx") == inode);
+    }
+  }
+}
+
+// Tests the "prefetch=N" option of SequentialTableReader with FreeCurrent(),
+// closing before the end, and scp entries that can't be read.
+void UnitTestTableSequentialPrefetch() {
+  {
+    Int32Writer writer("ark:tmpf");
+    for (int32 i = 0; i < 20; i++)
+      writer.Write(std::string(1, 'a' + i), i);
+  }
+  {
+    SequentialInt32Reader reader("prefetch=3,ark:tmpf");
+    int32 i = 0;
+    for (; !reader.Done(); reader.Next(), i++) {
+      KALDI_ASSERT(reader.Key() == std::string(1, 'a' + i) &&
+                   reader.Value() == i);
+      if (i % 2 == 0) reader.FreeCurrent();
+    }
+    KALDI_ASSERT(i == 20 && reader.Close());
+  }
+  {
+    // Stop reading while the background thread may still be reading.
+    SequentialInt32Reader reader("prefetch=1,ark:tmpf");
+    for (int32 i = 0; i < 5; i++, reader.Next())
+      KALDI_ASSERT(reader.Value() == i);
+    KALDI_ASSERT(reader.Close());
+  }
+  {
+    Output ko("tmpf.scp", false);
+    ko.Stream() << "a tmpf:2\nb nonexistent\nc tmpf:2\n";
+  }
+  {
+    SequentialInt32Reader reader("prefetch=2,p,scp:tmpf.scp");
+    KALDI_ASSERT(reader.Key() == "a" && reader.Value() == 0);
+    reader.Next();
+    KALDI_ASSERT(reader.Key() == "c");  // "b" is skipped in permissive mode.
+    reader.Next();
+    KALDI_ASSERT(reader.Done() && reader.Close());
+  }
+  {
+    SequentialInt32Reader reader("prefetch=2,scp:tmpf.scp");
+    reader.Next();
+    KALDI_ASSERT(reader.Key() == "b");
+    bool threw = false;
+    try {
+      reader.Value();
+    } catch (...) {
+      threw = true;
+    }
+    KALDI_ASSERT(threw);
+    reader.Next();
+    KALDI_ASSERT(reader.Key() == "c" && reader.Value() == 0);
+  }
+}
 
 }  // end namespace kaldi.
 
@@ -878,6 +1025,8 @@ int main() {
   UnitTestReadScriptFile();
   UnitTestClassifyWspecifier();
   UnitTestClassifyRspecifier();
+  UnitTestTableRandomMmapIndex();
+  UnitTestTableSequentialPrefetch();
   for (int i = 0; i < 10; i++) {
     bool b = (i == 0);
     UnitTestTableSequentialBool(b);
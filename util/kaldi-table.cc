@@ -219,7 +219,7 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
   // We also allow the meaningless prefixes b, and t,
   // plus the options o (once), no (not-once),
   // s (sorted) and ns (not-sorted), p (permissive)
-  // and np (not-permissive).
+  // and np (not-permissive), mmap and nmmap, idx and nidx, and prefetch=N.
   // so the following would be valid:
   //
   // f, o, b, np, ark:rxfilename  ->  kArchiveRspecifier
@@ -276,6 +276,20 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
       if (opts) opts->called_sorted = true;
     } else if (!strcmp(c, "ncs")) {
       if (opts) opts->called_sorted = false;
+    } else if (!strcmp(c, "mmap")) {
+      if (opts) opts->mmap = true;
+    } else if (!strcmp(c, "nmmap")) {
+      if (opts) opts->mmap = false;
+    } else if (!strcmp(c, "idx")) {
+      if (opts) opts->idx = true;
+    } else if (!strcmp(c, "nidx")) {
+      if (opts) opts->idx = false;
+    } else if (!strncmp(c, "prefetch=", 9)) {
+      int32 prefetch;
+      if (!ConvertStringToInteger(std::string(c + 9), &prefetch) ||
+          prefetch < 0)
+        return kNoRspecifier;
+      if (opts) opts->prefetch = prefetch;
     } else if (!strcmp(c, "ark")) {
       if (rs == kNoRspecifier) rs = kArchiveRspecifier;
       else return kNoRspecifier;  // Repeated or combined ark and scp options invalid.
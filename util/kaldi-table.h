@@ -173,6 +173,21 @@ bool WriteScriptFile(std::ostream &os,
 //   p   means "permissive", and causes it to skip over keys whose corresponding
 //       scp-file entries cannot be read. [and to ignore errors in archives and
 //       script files, and just consider the "good" entries].
+//   mmap  means the files are to be memory-mapped (this only affects
+//       RandomAccessTableReader).  For "ark:", the archive must be a file; it
+//       is scanned once to index it, unless there is an up-to-date index in a
+//       file with ".idx" appended to the archive's name.  Objects are read
+//       from the mapped memory on demand, in any order.  For "scp:", entries
+//       that are files or files with offsets (foo.ark:1234) are read from
+//       mapped memory, with each file mapped only once.
+//   idx   with "mmap, ark:", means that if the archive has to be indexed, the
+//       index is written to the ".idx" file, so later programs can reuse it.
+//       (Without this option we never write that file.)
+//   prefetch=N  (e.g. prefetch=5) means that a background thread reads
+//       up to N objects ahead of the one the program is working on (this
+//       only affects SequentialTableReader).  This lets the reading (and
+//       decompression, or the commands in a pipe) overlap with the
+//       computation; it costs memory for up to N extra objects.
 //       We allow the negation of the options above, as in no, ns, np,
 //       but these aren't currently very useful (just equivalent to omitting the
 //       corresponding option).
@@ -186,6 +201,7 @@ bool WriteScriptFile(std::ostream &os,
 //  So for instance the following would be a valid rspecifier:
 //
 //   "o, s, p, ark:gunzip -c foo.gz|"
+//   "prefetch=10, ark:gunzip -c foo.gz|"
 
 struct  RspecifierOptions {
   // These options only make a difference for the RandomAccessTableReader class.
@@ -198,9 +214,15 @@ struct  RspecifierOptions {
   // For archive files it will suppress errors getting thrown if the archive
   
   // is corrupted and can't be read to the end.
+  bool mmap;  // If true, random access is via memory-mapped files.
+  bool idx;  // If true (with mmap, for archives), save the archive's index in
+  // a file foo.ark.idx for reuse.
+  int32 prefetch;  // If >0, SequentialTableReader reads this many objects
+  // ahead in a background thread.
 
   RspecifierOptions(): once(false), sorted(false),
-                       called_sorted(false), permissive(false) { }
+                       called_sorted(false), permissive(false), mmap(false),
+                       idx(false), prefetch(0) { }
 };
 
 enum RspecifierType  {
@@ -0,0 +1,120 @@
+// util/memory-pool-inl.h
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_MEMORY_POOL_INL_H_
+#define KALDI_UTIL_MEMORY_POOL_INL_H_
+
+// Do not include this file directly.  It is included by memory-pool.h
+
+
+namespace kaldi {
+
+inline void MemoryPoolStats::Add(const MemoryPoolStats &other) {
+  num_allocs += other.num_allocs;
+  num_frees += other.num_frees;
+  num_resets += other.num_resets;
+  num_live += other.num_live;
+  max_live += other.max_live;
+  num_blocks += other.num_blocks;
+  bytes_allocated += other.bytes_allocated;
+}
+
+inline void MemoryPoolStats::Print(std::ostream &os) const {
+  os << "allocs = " << num_allocs << ", frees = " << num_frees
+     << ", resets = " << num_resets << ", live = " << num_live
+     << ", max-live = " << max_live << ", blocks = " << num_blocks
+     << ", bytes = " << bytes_allocated;
+}
+
+template<class T> MemoryPool<T>::MemoryPool(size_t block_size):
+    block_size_(block_size), free_head_(NULL), cur_(NULL), cur_end_(NULL),
+    next_block_(0) {
+  KALDI_ASSERT(block_size > 0);
+  // Round the size up to a multiple of sizeof(double) and of sizeof(void*);
+  // this is enough alignment for the kinds of structs we store here (new
+  // char[] gives us memory aligned for any fundamental type).
+  size_t align = std::max(sizeof(double), sizeof(void*));
+  size_t sz = std::max(sizeof(T), sizeof(void*));
+  elem_size_ = ((sz + align - 1) / align) * align;
+}
+
+template<class T>
+inline void *MemoryPool<T>::Allocate() {
+  void *ans;
+  if (free_head_ != NULL) {
+    ans = free_head_;
+    free_head_ = *reinterpret_cast<void**>(free_head_);
+  } else {
+    if (cur_ == cur_end_) NextBlock();
+    ans = cur_;
+    cur_ += elem_size_;
+  }
+  stats_.num_allocs++;
+  if (++stats_.num_live > stats_.max_live)
+    stats_.max_live = stats_.num_live;
+  return ans;
+}
+
+template<class T>
+inline void MemoryPool<T>::Free(T *t) {
+  KALDI_PARANOID_ASSERT(t != NULL && stats_.num_live > 0);
+  void *p = static_cast<void*>(t);
+  *reinterpret_cast<void**>(p) = free_head_;
+  free_head_ = p;
+  stats_.num_frees++;
+  stats_.num_live--;
+}
+
+template<class T>
+void MemoryPool<T>::NextBlock() {
+  if (next_block_ == blocks_.size()) {
+    size_t bytes = elem_size_ * block_size_;
+    blocks_.push_back(new char[bytes]);
+    stats_.num_blocks++;
+    stats_.bytes_allocated += bytes;
+  }
+  cur_ = blocks_[next_block_++];
+  cur_end_ = cur_ + elem_size_ * block_size_;
+}
+
+template<class T>
+void MemoryPool<T>::Reset() {
+  free_head_ = NULL;
+  cur_ = cur_end_ = NULL;
+  next_block_ = 0;
+  stats_.num_live = 0;
+  stats_.num_resets++;
+}
+
+template<class T>
+void MemoryPool<T>::Release() {
+  for (size_t i = 0; i < blocks_.size(); i++)
+    delete [] blocks_[i];
+  blocks_.clear();
+  free_head_ = NULL;
+  cur_ = cur_end_ = NULL;
+  next_block_ = 0;
+  stats_.num_live = 0;
+}
+
+
+} // end namespace kaldi
+
+#endif
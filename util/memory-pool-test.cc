@@ -0,0 +1,112 @@
+// util/memory-pool-test.cc
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "util/memory-pool.h"
+#include <set>
+#include <cstdlib>
+#include <iostream>
+
+namespace kaldi {
+
+struct TestPoolObject {
+  float a;
+  TestPoolObject *next;
+  char c;
+  TestPoolObject(float a, TestPoolObject *next, char c): a(a), next(next),
+                                                         c(c) { }
+};
+
+template<class T> void TestMemoryPoolAlignment() {
+  MemoryPool<T> pool(1 + rand() % 10);
+  for (int32 i = 0; i < 100; i++) {
+    void *p = pool.Allocate();
+    KALDI_ASSERT(reinterpret_cast<size_t>(p) % sizeof(void*) == 0);
+    *static_cast<T*>(p) = T();
+  }
+  KALDI_ASSERT(pool.NumLive() == 100);
+}
+
+void TestMemoryPool() {
+  size_t block_size = 1 + rand() % 20;
+  MemoryPool<TestPoolObject> pool(block_size);
+  std::set<TestPoolObject*> live;
+  for (int32 utt = 0; utt < 5; utt++) {
+    TestPoolObject *list = NULL;
+    int32 n = rand() % 200;
+    for (int32 i = 0; i < n; i++) {
+      if (!live.empty() && rand() % 3 == 0) {
+        // Free a random-ish one (the first one in the set).
+        TestPoolObject *obj = *live.begin();
+        KALDI_ASSERT(obj->c == 'x');
+        live.erase(live.begin());
+        pool.Free(obj);
+      } else {
+        TestPoolObject *obj = new (pool.Allocate())
+            TestPoolObject(i, list, 'x');
+        KALDI_ASSERT(live.count(obj) == 0);  // no object handed out twice.
+        live.insert(obj);
+        list = obj;
+      }
+      KALDI_ASSERT(pool.NumLive() == live.size());
+    }
+    size_t num_blocks = pool.Stats().num_blocks,
+        max_live = pool.Stats().max_live;
+    KALDI_ASSERT(num_blocks * block_size >= max_live);
+    // Bulk-free everything, as a decoder would between utterances.
+    pool.Reset();
+    live.clear();
+    KALDI_ASSERT(pool.NumLive() == 0);
+    // Allocating again should not need any more memory from the system.
+    for (size_t i = 0; i < max_live; i++)
+      new (pool.Allocate()) TestPoolObject(i, NULL, 'y');
+    KALDI_ASSERT(pool.Stats().num_blocks == num_blocks);
+    pool.Reset();
+  }
+  const MemoryPoolStats &stats = pool.Stats();
+  KALDI_ASSERT(stats.num_resets == 10 &&
+               stats.num_allocs >= stats.num_frees &&
+               stats.bytes_allocated >=
+               stats.num_blocks * block_size * sizeof(TestPoolObject));
+  MemoryPoolStats total;
+  total.Add(stats);
+  total.Add(stats);
+  KALDI_ASSERT(total.num_allocs == 2 * stats.num_allocs);
+  std::ostringstream os;
+  total.Print(os);
+  KALDI_LOG << "Stats are: " << os.str();
+  pool.Release();
+  KALDI_ASSERT(pool.Stats().num_live == 0);
+  new (pool.Allocate()) TestPoolObject(0, NULL, 'z');  // still usable.
+}
+
+
+} // end namespace kaldi
+
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 10; i++) {
+    TestMemoryPool();
+    TestMemoryPoolAlignment<char>();
+    TestMemoryPoolAlignment<double>();
+    TestMemoryPoolAlignment<int32>();
+  }
+  std::cout << "Test OK.\n";
+}
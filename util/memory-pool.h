@@ -0,0 +1,125 @@
+// util/memory-pool.h
+
+// Copyright 2014  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_MEMORY_POOL_H_
+#define KALDI_UTIL_MEMORY_POOL_H_
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include "base/kaldi-common.h"
+
+
+/* This header provides a simple slab allocator for small objects of a single
+   type, intended for use in decoders where we allocate and free very large
+   numbers of small structs (tokens, links) per frame.  Memory is obtained from
+   the system in large blocks and never returned until the pool is destroyed;
+   freed objects go on a free list for reuse, and Reset() makes all the memory
+   available again in constant time (e.g. between utterances), without the
+   user having to free each object individually.  This is similar to what
+   HashList (hash-list.h) does internally for its Elems.
+
+   The objects are not constructed or destroyed by the pool: use placement new
+   on the memory returned by Allocate(), and only use this for types that
+   are trivially destructible (we never call the destructor).
+
+   See memory-pool-test.cc for an example of how to use this object.
+*/
+
+
+namespace kaldi {
+
+/// Statistics on the use of a MemoryPool; these accumulate over the lifetime
+/// of the pool (they are not cleared by Reset()), except num_live.
+struct MemoryPoolStats {
+  size_t num_allocs;   // Total number of calls to Allocate().
+  size_t num_frees;    // Total number of calls to Free().
+  size_t num_resets;   // Number of calls to Reset().
+  size_t num_live;     // Number of objects currently in use.
+  size_t max_live;     // Maximum of num_live over the lifetime of the pool.
+  size_t num_blocks;   // Number of blocks we obtained from the system.
+  size_t bytes_allocated;  // Total bytes obtained from the system.
+  MemoryPoolStats(): num_allocs(0), num_frees(0), num_resets(0), num_live(0),
+                     max_live(0), num_blocks(0), bytes_allocated(0) { }
+  /// Adds the stats from "other" to this (e.g. to pool the stats over several
+  /// decoders); max_live is the sum of the max_live values.
+  void Add(const MemoryPoolStats &other);
+  /// Prints the stats in a human-readable form on a single line.
+  void Print(std::ostream &os) const;
+};
+
+
+template<class T> class MemoryPool {
+ public:
+  /// "block_size" is the number of objects we allocate at a time from the
+  /// system.  It should be largish so that the number of blocks stays small.
+  explicit MemoryPool(size_t block_size = 1024);
+
+  /// Returns uninitialized memory large enough for one object of type T.
+  /// Call placement new on it, e.g. new (pool.Allocate()) T(args).
+  inline void *Allocate();
+
+  /// Returns the memory of an object to the pool.  Think of this as delete,
+  /// except that the destructor is not called.
+  inline void Free(T *t);
+
+  /// Makes all the memory of the pool available for re-use, as if Free() had
+  /// been called for every currently allocated object; any pointers the user
+  /// still holds become invalid.  This takes time independent of the number
+  /// of objects.  The memory is not returned to the system.
+  void Reset();
+
+  /// Returns the memory to the system.  Like Reset(), it invalidates all
+  /// objects.
+  void Release();
+
+  /// Returns the number of objects currently allocated and not freed.
+  size_t NumLive() const { return stats_.num_live; }
+
+  const MemoryPoolStats &Stats() const { return stats_; }
+
+  ~MemoryPool() { Release(); }
+
+ private:
+  // Makes cur_ point to the start of a fresh block, reusing previously
+  // allocated blocks before we allocate new ones.
+  void NextBlock();
+
+  size_t block_size_;  // number of objects per block.
+  size_t elem_size_;  // size of each object in bytes, rounded up so the
+                      // objects are suitably aligned and so we can fit a
+                      // pointer in a freed object.
+  void *free_head_;  // head of list of freed objects.  The first bytes of
+                     // each freed object contain the pointer to the next one.
+  char *cur_;  // next never-yet-used object in the current block, if
+               // cur_ != cur_end_.
+  char *cur_end_;  // end of the current block.
+  size_t next_block_;  // index into blocks_ of the next block to use.
+  std::vector<char*> blocks_;  // blocks we obtained from the system.
+  MemoryPoolStats stats_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MemoryPool);
+};
+
+
+} // end namespace kaldi
+
+#include "util/memory-pool-inl.h"
+
+#endif